@@ -30,9 +30,12 @@
 #include <fstream>
 #include <ctime>
 #include <map>
+#include <algorithm>
+#include <boost/unordered_map.hpp>
 #include <omp.h>
 
-#define MAX_POINTS_IN_MEMORY 20000
+// max number of points in one tile buffer, a full tile buffer is written at once
+#define MAX_POINTS_PER_TILEBUFFER 65536
 
 namespace ElevationData
 {
@@ -41,94 +44,269 @@ namespace ElevationData
       std::vector<ElevationPoint*> vecPts;
    };
 
-   int64 points_in_map = 0;
-
    //---------------------------------------------------------------------------
-   // Elevation Map Utils:
-   void AddPoint(std::map< int64, std::list<ElevationPoint> >& streamMap, int64 idx, ElevationPoint& pt)
+   // Partitions elevation points into tiles.
+   // Every tile with buffered points has a contiguous buffer (x,y,elevation,weight
+   // per point). Buffers are only allocated for active tiles (tile -> buffer map
+   // with a free list), so memory depends on the buffer size and not on the
+   // number of tiles. A full tile buffer is written with one write, if all
+   // buffers together exceed the memory limit all of them are written.
+   // In external sort mode the buffers are appended to one spill file instead 
+   // of the tile files. Finish() then writes every tile in one pass, so every 
+   // tile file is opened (and locked) only once.
+
+   class TilePartitioner
    {
-      std::map< int64, std::list<ElevationPoint> >::iterator it;
-      it = streamMap.find(idx);
-      if (it == streamMap.end()) // not found, create new entry!
+   public:
+      TilePartitioner(const std::string& sTileDir, int lod, int64 elvTileX0, int64 elvTileY1, int tilewidth, size_t nMaxPoints, size_t nTilePoints, bool bLock, bool bExternalSort, const std::string& sSpillFile)
+         : _sTileDir(sTileDir), _lod(lod), _elvTileX0(elvTileX0), _elvTileY1(elvTileY1), _tilewidth(tilewidth),
+           _nMaxPoints(nMaxPoints), _nTilePoints(nTilePoints), _nPoints(0), _bLock(bLock), _bExternalSort(bExternalSort), _sSpillFile(sSpillFile), _nSpillSize(0)
       {
-         std::list<ElevationPoint> lst;
-         lst.push_back(pt);
-         streamMap.insert(std::pair< int64, std::list<ElevationPoint> >(idx, lst));
+         if (_bExternalSort)
+         {
+            _spill.open(_sSpillFile.c_str(), std::ios::binary | std::ios::trunc);
+         }
       }
-      else // key found, add elevation point to existing list
+
+      virtual ~TilePartitioner()
       {
-         it->second.push_back(pt);
+         if (_bExternalSort)
+         {
+            _spill.close();
+            FileSystem::rm(_sSpillFile);
+         }
       }
 
-      points_in_map++;
-
-   }
-
-   void WriteMap(boost::shared_ptr<MercatorQuadtree> qQuadtree, std::map< int64, std::list<ElevationPoint> >& streamMap, const std::string& sTileDir, int tilewidth_i, int lod, int64 elvTileX0, int64 elvTileY1)
-   {
-      std::map< int64, std::list<ElevationPoint> >::iterator it = streamMap.begin();
-
-      while (it!=streamMap.end())
+      // add point to tile idx (idx = tty*tilewidth+ttx)
+      void AddPoint(int64 idx, const ElevationPoint& pt)
       {
-         int64 idx = it->first;
+         int b;
+         boost::unordered_map<int64, int>::iterator it = _mapActive.find(idx);
+         if (it != _mapActive.end())
+         {
+            b = it->second;
+         }
+         else
+         {
+            if (_vFree.size() == 0)
+            {
+               _vBuckets.push_back(SBucket());
+               _vFree.push_back(int(_vBuckets.size()-1));
+            }
+            b = _vFree.back();
+            _vFree.pop_back();
+            _vBuckets[b].idx = idx;
+            _mapActive.insert(std::pair<int64, int>(idx, b));
+         }
 
-         // convert idx to tile coord:
-         int tx = idx % tilewidth_i;
-         int ty = idx / tilewidth_i;
-         int64 tileX = tx + elvTileX0;
-         int64 tileY = elvTileY1 - ty;
+         std::vector<double>& bucket = _vBuckets[b].data;
+         bucket.push_back(pt.x);
+         bucket.push_back(pt.y);
+         bucket.push_back(pt.elevation);
+         bucket.push_back(pt.weight);
+         _nPoints++;
+
+         if (bucket.size() >= 4*_nTilePoints)
+         {
+            _nPoints -= bucket.size()/4;
+            _WriteBucket(b);  // bucket stays assigned to this tile
+         }
 
-         std::string sQuadcode = qQuadtree->TileCoordToQuadkey(tileX,tileY,lod);
-         std::string sTilefile = ProcessingUtils::GetTilePath(sTileDir, ".pts" , lod, tileX, tileY);
+         if (_nPoints >= _nMaxPoints)
+         {
+            Flush();
+         }
+      }
 
-         /*double px0,py0,px1,py1;
-         qQuadtree->QuadKeyToMercatorCoord(sQuadcode, px0, py1, px1, py0);*/
+      // write all buffered points
+      void Flush()
+      {
+         boost::unordered_map<int64, int>::iterator it;
+         for (it = _mapActive.begin(); it != _mapActive.end(); ++it)
+         {
+            if (_vBuckets[it->second].data.size()>0)
+            {
+               _WriteBucket(it->second);
+            }
+         }
+         _ReleaseBuckets();
+         _nPoints = 0;
+      }
 
-         // LOCK this tile. If this tile is currently locked then wait until the lock is removed.
-         int lockhandle = FileSystem::Lock(sTilefile);
+      // write remaining points. In external sort mode all tiles are written now.
+      bool Finish()
+      {
+         if (!_bExternalSort)
+         {
+            Flush();
+            return true;
+         }
 
-         std::ofstream fout;
+         _spill.close();
+         std::ifstream in(_sSpillFile.c_str(), std::ios::binary);
+         std::vector<double> vData;
+         std::vector<SSegment> vNoSegments;
 
-         if (FileSystem::FileExists(sTilefile))
+         // tiles with spilled or buffered points, in tile order
+         std::vector<int64> vTiles;
+         boost::unordered_map<int64, std::vector<SSegment> >::iterator its;
+         for (its = _mapSegments.begin(); its != _mapSegments.end(); ++its)
          {
-            fout.open(sTilefile.c_str(), std::ios::binary | std::ios::app); // open in append mode
+            vTiles.push_back(its->first);
          }
-         else
+         boost::unordered_map<int64, int>::iterator it;
+         for (it = _mapActive.begin(); it != _mapActive.end(); ++it)
          {
-               fout.open(sTilefile.c_str(), std::ios::binary); // open in append mode
+            if (_vBuckets[it->second].data.size()>0 && _mapSegments.find(it->first) == _mapSegments.end())
+            {
+               vTiles.push_back(it->first);
+            }
          }
+         std::sort(vTiles.begin(), vTiles.end());
 
-         if (fout.good())
+         for (size_t t=0;t<vTiles.size();t++)
          {
-            std::list<ElevationPoint> lst = it->second;
-            std::list<ElevationPoint>::iterator jt = lst.begin();
+            int64 idx = vTiles[t];
+            its = _mapSegments.find(idx);
+            const std::vector<SSegment>& vSegments = its != _mapSegments.end() ? its->second : vNoSegments;
+            it = _mapActive.find(idx);
 
-            while (jt != lst.end())
-            {        
-               fout.write((const char*)&(jt->x), sizeof(double));
-               fout.write((const char*)&(jt->y), sizeof(double));
-               fout.write((const char*)&(jt->elevation), sizeof(double));
-               fout.write((const char*)&(jt->weight), sizeof(double));
+            int lockhandle = -1;
+            std::ofstream fout;
+            std::string sTilefile = _OpenTile(idx, fout, lockhandle);
 
-               jt++;
+            if (fout.good())
+            {
+               for (size_t i=0;i<vSegments.size();i++)
+               {
+                  vData.resize(4*vSegments[i].count);
+                  in.seekg(vSegments[i].offset, std::ios::beg);
+                  in.read((char*)&vData[0], vData.size()*sizeof(double));
+                  fout.write((const char*)&vData[0], vData.size()*sizeof(double));
+               }
+
+               if (it != _mapActive.end() && _vBuckets[it->second].data.size()>0)
+               {
+                  const std::vector<double>& bucket = _vBuckets[it->second].data;
+                  fout.write((const char*)&bucket[0], bucket.size()*sizeof(double));
+               }
             }
+            fout.close();
+
+            // unlock file. Other computers/processes/threads can access it again.
+            if (_bLock)
+               FileSystem::Unlock(sTilefile, lockhandle);
          }
-         // unlock file. Other computers/processes/threads can access it again.
-         FileSystem::Unlock(sTilefile, lockhandle);
 
-         it++;
+         _ReleaseBuckets();
+         _mapSegments.clear();
+         _nPoints = 0;
+
+         return in.good() || in.eof();
       }
 
-      streamMap.clear();
-      points_in_map = 0;
+      size_t GetNumPoints() { return _nPoints; }
 
-      //std::string sTilefile = ProcessingUtils::GetTilePath(sTileDir, ".pts" , lod, xx, yy);
-   }
+   protected:
+      struct SSegment
+      {
+         std::streamoff offset;
+         size_t count;     // number of points
+      };
 
+      struct SBucket
+      {
+         int64 idx;                 // tile
+         std::vector<double> data;  // x,y,elevation,weight per point
+      };
+
+      // all buckets are unused, their memory is released
+      void _ReleaseBuckets()
+      {
+         _mapActive.clear();
+         _vFree.resize(_vBuckets.size());
+         for (size_t i=0;i<_vBuckets.size();i++)
+         {
+            std::vector<double>().swap(_vBuckets[i].data);
+            _vFree[i] = int(_vBuckets.size()-1-i);
+         }
+      }
+
+      std::string _OpenTile(int64 idx, std::ofstream& fout, int& lockhandle)
+      {
+         // convert idx to tile coord:
+         int tx = int(idx % _tilewidth);
+         int ty = int(idx / _tilewidth);
+         int64 tileX = tx + _elvTileX0;
+         int64 tileY = _elvTileY1 - ty;
+
+         std::string sTilefile = ProcessingUtils::GetTilePath(_sTileDir, ".pts" , _lod, tileX, tileY);
+
+         // LOCK this tile. If this tile is currently locked then wait until the lock is removed.
+         if (_bLock)
+            lockhandle = FileSystem::Lock(sTilefile);
+
+         fout.open(sTilefile.c_str(), std::ios::binary | std::ios::app); // open in append mode
+
+         return sTilefile;
+      }
+
+      // write points of bucket b to its tile (or spill file) and clear it
+      void _WriteBucket(int b)
+      {
+         SBucket& bucket = _vBuckets[b];
+
+         if (_bExternalSort)
+         {
+            SSegment segment;
+            segment.offset = _nSpillSize;
+            segment.count = bucket.data.size()/4;
+            _spill.write((const char*)&bucket.data[0], bucket.data.size()*sizeof(double));
+            _nSpillSize += bucket.data.size()*sizeof(double);
+            _mapSegments[bucket.idx].push_back(segment);
+         }
+         else
+         {
+            int lockhandle = -1;
+            std::ofstream fout;
+            std::string sTilefile = _OpenTile(bucket.idx, fout, lockhandle);
+
+            if (fout.good())
+            {
+               fout.write((const char*)&bucket.data[0], bucket.data.size()*sizeof(double));
+            }
+            fout.close();
+
+            // unlock file. Other computers/processes/threads can access it again.
+            if (_bLock)
+               FileSystem::Unlock(sTilefile, lockhandle);
+         }
+
+         bucket.data.clear();
+      }
+
+      std::string _sTileDir;
+      int _lod;
+      int64 _elvTileX0;
+      int64 _elvTileY1;
+      int _tilewidth;
+      size_t _nMaxPoints;     // max number of points in memory
+      size_t _nTilePoints;    // max number of points per tile buffer
+      size_t _nPoints;        // number of points currently in memory
+      bool _bLock;
+      bool _bExternalSort;
+      std::string _sSpillFile;
+      std::ofstream _spill;
+      std::streamoff _nSpillSize;
+      std::vector<SBucket> _vBuckets;
+      std::vector<int> _vFree;                                          // unused buckets
+      boost::unordered_map<int64, int> _mapActive;                      // tile -> bucket
+      boost::unordered_map<int64, std::vector<SSegment> > _mapSegments; // tile -> spilled points
+   };
 
    //---------------------------------------------------------------------------
 
-   int process( boost::shared_ptr<Logger> qLogger, boost::shared_ptr<ProcessingSettings> qSettings, std::string sLayer, bool bVerbose, bool bLock, bool bVirtual, int epsg, std::string sElevationFile, bool bFill, int& out_lod, int64& out_x0, int64& out_y0, int64& out_x1, int64& out_y1)
+   int process( boost::shared_ptr<Logger> qLogger, boost::shared_ptr<ProcessingSettings> qSettings, std::string sLayer, bool bVerbose, bool bLock, bool bVirtual, int epsg, std::string sElevationFile, bool bFill, int nBufferSizeMB, bool bExternalSort, int& out_lod, int64& out_x0, int64& out_y0, int64& out_x1, int64& out_y1)
    {
       DataSetInfo oInfo;
 
@@ -288,12 +466,14 @@ namespace ElevationData
       tilewidth = width_merc / (tilewidth);
       tileheight =  height_merc / (tileheight);
 
-      int max_threads = omp_get_max_threads();
+      // number of points kept in memory (x,y,elevation,weight per point)
+      size_t nMaxPoints = size_t(nBufferSizeMB)*1024*1024 / (4*sizeof(double));
 
-      std::map< int64, std::list<ElevationPoint> >   streamMap;
+      TilePartitioner oPartitioner(sTileDir, lod, elvTileX0, elvTileY1, tilewidth_i, nMaxPoints, MAX_POINTS_PER_TILEBUFFER, bLock, bExternalSort, sTempfile + ".part");
 
       ElevationPoint pt;
-      int n = 0;
+      size_t n = 0;
+      size_t nOutside = 0;
       while (oElevationReader.GetNextPoint(pt))
       {
          n++;
@@ -301,41 +481,40 @@ namespace ElevationData
           // calculate tile coordinate of current point:         
          int64 ttx = int64((pt.x - x0) / tilewidth);
          int64 tty = int64((pt.y - y0) / tileheight);
-         int64 tileX = ttx+elvTileX0;
-         int64 tileY = tty+elvTileY0;
+
+         // points outside the (clipped) tile extent are ignored
+         if (ttx < 0 || tty < 0 || ttx >= tilewidth_i || tty >= tileheight_i)
+         {
+            nOutside++;
+            continue;
+         }
 
          int64 idx = tty*tilewidth_i+ttx;
 
-         AddPoint(streamMap, idx, pt);
+         oPartitioner.AddPoint(idx, pt);
 
-         if (points_in_map>=MAX_POINTS_IN_MEMORY) // flush
+         if (bVerbose && n % 1000000 == 0)
          {
-            if (bVerbose)
-            {
-               oss << "\nWriting (" << points_in_map << " points to disk. (";
-               oss << n << " of " << numpts << " points stored)";
-               qLogger->Info(oss.str());
-               oss.str("");
-            }
-
-            WriteMap(qQuadtree, streamMap, sTileDir, tilewidth_i, lod, elvTileX0, elvTileY1);
+            oss << "status: " << n << " of " << numpts << " points stored.";
+            qLogger->Info(oss.str());
+            oss.str("");
          }
       }
 
       //Write remaining points:
 
-      if (bVerbose  && points_in_map>0)
+      if (bVerbose)
       {
-         if (bVerbose)
-            {
-               oss << "\nWriting (" << streamMap.size() << " points to disk\n";
-               oss << "status: " << n << " of " << numpts << " points stored.";
-               qLogger->Info(oss.str());
-               oss.str("");
-            }
+         oss << "\nWriting remaining points to disk\n";
+         oss << "status: " << n << " of " << numpts << " points stored (" << nOutside << " outside of layer).";
+         qLogger->Info(oss.str());
+         oss.str("");
       }
 
-      WriteMap(qQuadtree, streamMap, sTileDir, tilewidth_i, lod, elvTileX0, elvTileY1);
+      if (!oPartitioner.Finish())
+      {
+         qLogger->Error("Failed writing elevation tiles.");
+      }
 
       // finished, print stats:
       t1=clock();
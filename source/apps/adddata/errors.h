@@ -28,6 +28,7 @@
 #define ERROR_ELVLAYERSETTINGS   6     // can't load elevsation layer settings
 #define ERROR_LOADELEVATION      10    // can't load elevation
 #define ERROR_FILE               11    // file error (process status file)
+#define ERROR_LOADIMAGE          12    // can't open image
 
 // General Errors:
 #define ERROR_NOMEMORY        101;     // not enough memory
@@ -19,16 +19,25 @@
 #include "imagedata.h"
 #include "string/FilenameUtils.h"
 #include "io/FileSystem.h"
+#include "io/TileStore.h"
+#include "io/TileOccupancy.h"
 #include "geo/ImageLayerSettings.h"
 #include "geo/MercatorQuadtree.h"
+#include "geo/RasterBlockCache.h"
 #include "image/ImageLoader.h"
 #include "image/ImageWriter.h"
 #include <sstream>
 #include <ctime>
+#include <algorithm>
 #ifdef _OPENMP
 # include <omp.h>
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define _USE_SSE2
+#  include <emmintrin.h>
+#endif
+
 
 //------------------------------------------------------------------------------
 namespace ImageData
@@ -50,10 +59,302 @@ namespace ImageData
    const double dHanc = 1.0/(double(tilesize)-1.0);
    const double dWanc = 1.0/(double(tilesize)-1.0);
    //------------------------------------------------------------------------------
+   // Tile warping
+   //
+   // The affine inverse of the bilinear anchor interpolation is bilinear again, so
+   // the source coordinates of a tile row are linear in x. They are computed with
+   // forward differences instead of per pixel. Bilinear weights are 8 bit fixed point,
+   // the weighted sum is rounded once, so the result differs by at most 1 from
+   // _ReadImageValueBilinear. Pixels whose source coordinate lies exactly on the
+   // image border may be written or not, depending on rounding of the differences.
+
+   struct WarpWindow
+   {
+      const unsigned char* data;    // RGB source window
+      int width;
+      int height;
+      double minX, minY;            // image extent in window coordinates
+      double maxX, maxY;
+   };
+
+   //------------------------------------------------------------------------------
+   // RGBA value (r in lowest byte) of window pixel, coordinates are clamped to window
+   inline unsigned int _FetchRGBA(const WarpWindow& w, int x, int y)
+   {
+      x = math::Clamp<int>(x, 0, w.width-1);
+      y = math::Clamp<int>(y, 0, w.height-1);
+      const unsigned char* p = w.data + 3*(size_t(y)*w.width + x);
+      return p[0] | (p[1] << 8) | (p[2] << 16) | 0xFF000000u;
+   }
+
+   //------------------------------------------------------------------------------
+   // source pixels and weights of one target pixel. Returns false if outside of image.
+   inline bool _WarpSample(const WarpWindow& w, double x, double y, bool bNearest, unsigned int p[4], int& u, int& v)
+   {
+      if (x<w.minX || x>w.maxX || y<w.minY || y>w.maxY)
+      {
+         return false;
+      }
+
+      if (bNearest)
+      {
+         p[0] = _FetchRGBA(w, int(x+0.5), int(y+0.5));
+         u = v = 0;
+      }
+      else
+      {
+         int ix = int(x);
+         int iy = int(y);
+         u = int((x-ix)*256.0+0.5);
+         v = int((y-iy)*256.0+0.5);
+         p[0] = _FetchRGBA(w, ix, iy);
+         p[1] = _FetchRGBA(w, ix+1, iy);
+         p[2] = _FetchRGBA(w, ix, iy+1);
+         p[3] = _FetchRGBA(w, ix+1, iy+1);
+      }
+      return true;
+   }
+
+   //------------------------------------------------------------------------------
+   // a*(256-w) + b*w, not rounded (<= 65280)
+   inline unsigned int _Lerp8(unsigned int a, unsigned int b, int w)
+   {
+      return a*(256-w) + b*w;
+   }
 
-   int process( boost::shared_ptr<Logger> qLogger, boost::shared_ptr<ProcessingSettings> qSettings, std::string sLayer, bool bVerbose, bool bLock, int epsg, std::string sImagefile, bool bFill, int& out_lod, int64& out_x0, int64& out_y0, int64& out_x1, int64& out_y1)
+   inline void _WarpPixel(const WarpWindow& w, double x, double y, bool bNearest, bool bFill, unsigned char* pDst)
+   {
+      unsigned int p[4];
+      int u, v;
+      if (!_WarpSample(w, x, y, bNearest, p, u, v))
+         return;
+      if (bFill && pDst[3] != 0)
+         return;
+
+      for (int c=0;c<4;c++)
+      {
+         int shift = 8*c;
+         if (bNearest)
+         {
+            pDst[c] = (unsigned char)(p[0] >> shift);
+         }
+         else
+         {
+            unsigned int top = _Lerp8((p[0] >> shift) & 0xFF, (p[1] >> shift) & 0xFF, u);
+            unsigned int bottom = _Lerp8((p[2] >> shift) & 0xFF, (p[3] >> shift) & 0xFF, u);
+            pDst[c] = (unsigned char)((top*(256-v) + bottom*v + 32768) >> 16);
+         }
+      }
+   }
+
+#ifdef _USE_SSE2
+   //------------------------------------------------------------------------------
+   // 16 bit lanes: a*(256-w) + b*w, not rounded. Fits for a,b <= 255 and w <= 256.
+   inline __m128i _Lerp16SSE2(__m128i a, __m128i b, __m128i w)
+   {
+      __m128i iw = _mm_sub_epi16(_mm_set1_epi16(256), w);
+      return _mm_add_epi16(_mm_mullo_epi16(a, iw), _mm_mullo_epi16(b, w));
+   }
+
+   //------------------------------------------------------------------------------
+   // 16 bit lanes: (a*(256-w) + b*w + 32768) >> 16 with 32 bit intermediates, a,b <= 65280
+   inline __m128i _LerpRound16SSE2(__m128i a, __m128i b, __m128i w)
+   {
+      __m128i iw = _mm_sub_epi16(_mm_set1_epi16(256), w);
+      __m128i alo = _mm_mullo_epi16(a, iw);
+      __m128i ahi = _mm_mulhi_epu16(a, iw);
+      __m128i blo = _mm_mullo_epi16(b, w);
+      __m128i bhi = _mm_mulhi_epu16(b, w);
+      const __m128i round = _mm_set1_epi32(32768);
+      __m128i sum0 = _mm_add_epi32(_mm_add_epi32(_mm_unpacklo_epi16(alo, ahi), _mm_unpacklo_epi16(blo, bhi)), round);
+      __m128i sum1 = _mm_add_epi32(_mm_add_epi32(_mm_unpackhi_epi16(alo, ahi), _mm_unpackhi_epi16(blo, bhi)), round);
+      return _mm_packs_epi32(_mm_srli_epi32(sum0, 16), _mm_srli_epi32(sum1, 16));
+   }
+
+   //------------------------------------------------------------------------------
+   // bilinear interpolation of 4 RGBA pixels, weights are per pixel
+   inline __m128i _BilinearSSE2(__m128i p00, __m128i p10, __m128i p01, __m128i p11, const int* u, const int* v)
+   {
+      const __m128i zero = _mm_setzero_si128();
+      __m128i ulo = _mm_setr_epi16((short)u[0],(short)u[0],(short)u[0],(short)u[0],(short)u[1],(short)u[1],(short)u[1],(short)u[1]);
+      __m128i uhi = _mm_setr_epi16((short)u[2],(short)u[2],(short)u[2],(short)u[2],(short)u[3],(short)u[3],(short)u[3],(short)u[3]);
+      __m128i vlo = _mm_setr_epi16((short)v[0],(short)v[0],(short)v[0],(short)v[0],(short)v[1],(short)v[1],(short)v[1],(short)v[1]);
+      __m128i vhi = _mm_setr_epi16((short)v[2],(short)v[2],(short)v[2],(short)v[2],(short)v[3],(short)v[3],(short)v[3],(short)v[3]);
+
+      __m128i toplo = _Lerp16SSE2(_mm_unpacklo_epi8(p00, zero), _mm_unpacklo_epi8(p10, zero), ulo);
+      __m128i tophi = _Lerp16SSE2(_mm_unpackhi_epi8(p00, zero), _mm_unpackhi_epi8(p10, zero), uhi);
+      __m128i botlo = _Lerp16SSE2(_mm_unpacklo_epi8(p01, zero), _mm_unpacklo_epi8(p11, zero), ulo);
+      __m128i bothi = _Lerp16SSE2(_mm_unpackhi_epi8(p01, zero), _mm_unpackhi_epi8(p11, zero), uhi);
+
+      return _mm_packus_epi16(_LerpRound16SSE2(toplo, botlo, vlo), _LerpRound16SSE2(tophi, bothi, vhi));
+   }
+#endif
+
+   //------------------------------------------------------------------------------
+   // Warp one tile row. The source coordinate of pixel tx is (x+tx*sx, y+tx*sy) in window
+   // coordinates. Pixels outside of the image are not written, with bFill only pixels
+   // with alpha = 0 are written.
+   void _WarpRow(const WarpWindow& w, double x, double y, double sx, double sy, bool bNearest, bool bFill, unsigned char* pRow, int nPixels)
+   {
+      int tx = 0;
+
+#ifdef _USE_SSE2
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i alpha = _mm_set1_epi32(0xFF000000);
+
+      for (;tx+4<=nPixels;tx+=4)
+      {
+         unsigned int p[4][4];
+         int u[4], v[4];
+         int inside[4];
+         for (int k=0;k<4;k++)
+         {
+            inside[k] = _WarpSample(w, x, y, bNearest, p[k], u[k], v[k]) ? -1 : 0;
+            if (!inside[k])
+            {
+               p[k][0] = p[k][1] = p[k][2] = p[k][3] = 0;
+               u[k] = v[k] = 0;
+            }
+            x += sx;
+            y += sy;
+         }
+
+         __m128i mask = _mm_setr_epi32(inside[0], inside[1], inside[2], inside[3]);
+         if (_mm_movemask_epi8(mask) == 0)
+            continue;
+
+         __m128i dst = _mm_loadu_si128((const __m128i*)(pRow + 4*tx));
+         if (bFill)
+         {
+            mask = _mm_and_si128(mask, _mm_cmpeq_epi32(_mm_and_si128(dst, alpha), zero));
+         }
+
+         __m128i result = _mm_setr_epi32((int)p[0][0], (int)p[1][0], (int)p[2][0], (int)p[3][0]);
+         if (!bNearest)
+         {
+            __m128i p10 = _mm_setr_epi32((int)p[0][1], (int)p[1][1], (int)p[2][1], (int)p[3][1]);
+            __m128i p01 = _mm_setr_epi32((int)p[0][2], (int)p[1][2], (int)p[2][2], (int)p[3][2]);
+            __m128i p11 = _mm_setr_epi32((int)p[0][3], (int)p[1][3], (int)p[2][3], (int)p[3][3]);
+            result = _BilinearSSE2(result, p10, p01, p11, u, v);
+         }
+
+         result = _mm_or_si128(_mm_and_si128(mask, result), _mm_andnot_si128(mask, dst));
+         _mm_storeu_si128((__m128i*)(pRow + 4*tx), result);
+      }
+#endif
+
+      for (;tx<nPixels;tx++)
+      {
+         _WarpPixel(w, x, y, bNearest, bFill, pRow + 4*tx);
+         x += sx;
+         y += sy;
+      }
+   }
+
+   //------------------------------------------------------------------------------
+
+   //------------------------------------------------------------------------------
+   // input image of a batch
+   struct Source
    {
       DataSetInfo oInfo;
+      int64 tileX0, tileY0, tileX1, tileY1;         // tiles covered by the image (clipped to layer)
+      boost::shared_ptr<RasterBlockCache> qCache;   // open while the current tile row is inside the image
+   };
+
+   //------------------------------------------------------------------------------
+   // Warp source image into tile. The anchors are the tile corners in source srs.
+   void _WarpSourceToTile(Source& source, const Anchor& anchor, unsigned char* pTile, bool bFill, bool bNearest, boost::shared_ptr<Logger> qLogger, const std::string& sTilefile)
+   {
+      const DataSetInfo& oInfo = source.oInfo;
+
+      // source pixel window of this tile: bilinear interpolation of the anchors
+      // stays inside the bounding box of the (affine transformed) corners.
+      double cornerX[4] = {anchor.anchor_Ax, anchor.anchor_Bx, anchor.anchor_Cx, anchor.anchor_Dx};
+      double cornerY[4] = {anchor.anchor_Ay, anchor.anchor_By, anchor.anchor_Cy, anchor.anchor_Dy};
+      double pixelX[4], pixelY[4];
+      double minPixelX = 1e20, minPixelY = 1e20, maxPixelX = -1e20, maxPixelY = -1e20;
+      for (int c=0;c<4;++c)
+      {
+         pixelX[c] = (oInfo.affineTransformation_inverse[0] + cornerX[c] * oInfo.affineTransformation_inverse[1] + cornerY[c] * oInfo.affineTransformation_inverse[2]);
+         pixelY[c] = (oInfo.affineTransformation_inverse[3] + cornerX[c] * oInfo.affineTransformation_inverse[4] + cornerY[c] * oInfo.affineTransformation_inverse[5]);
+         minPixelX = math::Min<double>(minPixelX, pixelX[c]);
+         minPixelY = math::Min<double>(minPixelY, pixelY[c]);
+         maxPixelX = math::Max<double>(maxPixelX, pixelX[c]);
+         maxPixelY = math::Max<double>(maxPixelY, pixelY[c]);
+      }
+
+      // one pixel border for bilinear filtering (and rounding), clipped to image
+      int winX0 = int(math::Max<double>(floor(minPixelX)-1.0, 0.0));
+      int winY0 = int(math::Max<double>(floor(minPixelY)-1.0, 0.0));
+      int winX1 = int(math::Min<double>(floor(maxPixelX)+2.0, double(oInfo.nSizeX-1)));
+      int winY1 = int(math::Min<double>(floor(maxPixelY)+2.0, double(oInfo.nSizeY-1)));
+
+      if (winX0 > winX1 || winY0 > winY1)
+      {
+         return;
+      }
+
+      boost::shared_array<unsigned char> vWindow = source.qCache->ReadWindowRGB(winX0, winY0, winX1, winY1);
+      if (!vWindow)
+      {
+         qLogger->Error("Failed reading image data of " + oInfo.sFilename + " for tile " + sTilefile);
+         return;
+      }
+
+      // write current tile. Pixels outside of the image stay unchanged.
+      WarpWindow window;
+      window.data = vWindow.get();
+      window.width = winX1-winX0+1;
+      window.height = winY1-winY0+1;
+      window.minX = -winX0;
+      window.minY = -winY0;
+      window.maxX = oInfo.nSizeX-winX0;
+      window.maxY = oInfo.nSizeY-winY0;
+
+      // left (A-D) and right (B-C) edge of the tile in window coordinates
+      double leftX = pixelX[0]-winX0, leftY = pixelY[0]-winY0;
+      double rightX = pixelX[1]-winX0, rightY = pixelY[1]-winY0;
+      double dLeftX = (pixelX[3]-pixelX[0])*dHanc, dLeftY = (pixelY[3]-pixelY[0])*dHanc;
+      double dRightX = (pixelX[2]-pixelX[1])*dHanc, dRightY = (pixelY[2]-pixelY[1])*dHanc;
+
+      for (int ty=0;ty<tilesize;++ty)
+      {
+         _WarpRow(window, leftX, leftY, (rightX-leftX)*dWanc, (rightY-leftY)*dWanc, bNearest, bFill, pTile+4*ty*tilesize, tilesize);
+         leftX += dLeftX;
+         leftY += dLeftY;
+         rightX += dRightX;
+         rightY += dRightY;
+      }
+   }
+
+   //------------------------------------------------------------------------------
+
+   int process( boost::shared_ptr<Logger> qLogger, boost::shared_ptr<ProcessingSettings> qSettings, std::string sLayer, bool bVerbose, bool bLock, int epsg, std::string sImagefile, bool bFill, bool bNearest, int nCacheSizeMB, int& out_lod, int64& out_x0, int64& out_y0, int64& out_x1, int64& out_y1)
+   {
+      std::vector<std::string> vImagefiles(1, sImagefile);
+      std::vector<InputResult> vResult;
+
+      int retval = process(qLogger, qSettings, sLayer, bVerbose, bLock, epsg, vImagefiles, bFill, bNearest, nCacheSizeMB, out_lod, vResult);
+
+      out_x0 = vResult[0].x0;
+      out_y0 = vResult[0].y0;
+      out_x1 = vResult[0].x1;
+      out_y1 = vResult[0].y1;
+
+      return retval != 0 ? retval : vResult[0].nError;
+   }
+
+   //------------------------------------------------------------------------------
+
+   int process( boost::shared_ptr<Logger> qLogger, boost::shared_ptr<ProcessingSettings> qSettings, std::string sLayer, bool bVerbose, bool bLock, int epsg, const std::vector<std::string>& vImagefiles, bool bFill, bool bNearest, int nCacheSizeMB, int& out_lod, std::vector<InputResult>& out_vResult)
+   {
+      out_vResult.resize(vImagefiles.size());
+      for (size_t i=0;i<out_vResult.size();i++)
+      {
+         out_vResult[i].nError = 0;
+         out_vResult[i].x0 = out_vResult[i].y0 = out_vResult[i].x1 = out_vResult[i].y1 = 0;
+      }
 
       if (!ProcessingUtils::init_gdal())
       {
@@ -76,8 +377,24 @@ namespace ImageData
          return ERROR_IMAGELAYERSETTINGS;
       }
 
+      boost::shared_ptr<ITileStore> qTileStore = ITileStore::Create(qImageLayerSettings->GetTileStore(), sTileDir, ".png");
+      if (!qTileStore)
+      {
+         qLogger->Error("Unknown tile store: " + qImageLayerSettings->GetTileStore());
+         ProcessingUtils::exit_gdal();
+         return ERROR_IMAGELAYERSETTINGS;
+      }
+
       int lod = qImageLayerSettings->GetMaxLod();
       out_lod = lod;
+
+      // empty and single colour tiles are only recorded in the occupancy index
+      boost::shared_ptr<TileOccupancy> qOccupancy;
+      if (qImageLayerSettings->GetOccupancyIndex())
+      {
+         qOccupancy = boost::shared_ptr<TileOccupancy>(new TileOccupancy(sTileDir, lod));
+      }
+
       int64 layerTileX0, layerTileY0, layerTileX1, layerTileY1;
       qImageLayerSettings->GetTileExtent(layerTileX0, layerTileY0, layerTileX1, layerTileY1);
 
@@ -97,103 +414,213 @@ namespace ImageData
       clock_t t0,t1;
       t0 = clock();
 
-      ProcessingUtils::RetrieveDatasetInfo(sImagefile, qCT.get(), &oInfo, bVerbose);
+      boost::shared_ptr<MercatorQuadtree> qQuadtree = boost::shared_ptr<MercatorQuadtree>(new MercatorQuadtree());
 
-      if (!oInfo.bGood)
-      {
-         qLogger->Error("Failed retrieving info!");
-      }
+      //---------------------------------------------------------------------------
+      // Tile extents of all input images. The list order is the priority order:
+      // with --fill the first image wins, with --overwrite the last one (like
+      // adding the images one by one).
 
-      if (bVerbose)
+      std::vector<Source> vSources;
+      std::vector<size_t> vSourceInput;   // index of source in vImagefiles
+
+      for (size_t i=0;i<vImagefiles.size();i++)
       {
-         oss << "Loaded image info:\n   Image Size: w= " << oInfo.nSizeX << ", h= " << oInfo.nSizeY << "\n";
-         oss << "   dest: " << oInfo.dest_lrx << ", " << oInfo.dest_lry << ", " << oInfo.dest_ulx << ", " << oInfo.dest_uly << "\n";
-         qLogger->Info(oss.str());
-         oss.str("");
-      }
+         Source source;
+         ProcessingUtils::RetrieveDatasetInfo(vImagefiles[i], qCT.get(), &source.oInfo, bVerbose);
 
-      boost::shared_ptr<MercatorQuadtree> qQuadtree = boost::shared_ptr<MercatorQuadtree>(new MercatorQuadtree());
+         if (!source.oInfo.bGood || source.oInfo.nBands != 3)
+         {
+            qLogger->Error("Failed retrieving info of " + vImagefiles[i] + " (currently only RGB images are supported)");
+            out_vResult[i].nError = ERROR_LOADIMAGE;
+            continue;
+         }
 
-      int64 px0, py0, px1, py1;
-      qQuadtree->MercatorToPixel(oInfo.dest_ulx, oInfo.dest_uly, lod, px0, py0);
-      qQuadtree->MercatorToPixel(oInfo.dest_lrx, oInfo.dest_lry, lod, px1, py1);
+         if (bVerbose)
+         {
+            oss << "Loaded image info of " << vImagefiles[i] << ":\n   Image Size: w= " << source.oInfo.nSizeX << ", h= " << source.oInfo.nSizeY << "\n";
+            oss << "   dest: " << source.oInfo.dest_lrx << ", " << source.oInfo.dest_lry << ", " << source.oInfo.dest_ulx << ", " << source.oInfo.dest_uly << "\n";
+            qLogger->Info(oss.str());
+            oss.str("");
+         }
 
-      int64 imageTileX0, imageTileY0, imageTileX1, imageTileY1;
-      qQuadtree->PixelToTileCoord(px0, py0, imageTileX0, imageTileY0);
-      qQuadtree->PixelToTileCoord(px1, py1, imageTileX1, imageTileY1);
+         int64 px0, py0, px1, py1;
+         qQuadtree->MercatorToPixel(source.oInfo.dest_ulx, source.oInfo.dest_uly, lod, px0, py0);
+         qQuadtree->MercatorToPixel(source.oInfo.dest_lrx, source.oInfo.dest_lry, lod, px1, py1);
 
-      if (bVerbose)
-      {
-         oss << "\nTile Coords (image):";
-         oss << "   (" << imageTileX0 << ", " << imageTileY0 << ")-(" << imageTileX1 << ", " << imageTileY1 << ")\n";
-         qLogger->Info(oss.str());
-         oss.str("");
+         int64 imageTileX0, imageTileY0, imageTileX1, imageTileY1;
+         qQuadtree->PixelToTileCoord(px0, py0, imageTileX0, imageTileY0);
+         qQuadtree->PixelToTileCoord(px1, py1, imageTileX1, imageTileY1);
+
+         if (bVerbose)
+         {
+            oss << "\nTile Coords (image):";
+            oss << "   (" << imageTileX0 << ", " << imageTileY0 << ")-(" << imageTileX1 << ", " << imageTileY1 << ")\n";
+            qLogger->Info(oss.str());
+            oss.str("");
+         }
+
+         // check if image is outside layer
+         if (imageTileX0 > layerTileX1 || 
+            imageTileY0 > layerTileY1 ||
+            imageTileX1 < layerTileX0 ||
+            imageTileY1 < layerTileY0)
+         {
+            qLogger->Info(vImagefiles[i] + ": The dataset is outside of the layer and not being added!");
+            continue;
+         }
+
+         // clip tiles to layer extent
+         source.tileX0 = math::Max<int64>(imageTileX0, layerTileX0);
+         source.tileY0 = math::Max<int64>(imageTileY0, layerTileY0);
+         source.tileX1 = math::Min<int64>(imageTileX1, layerTileX1);
+         source.tileY1 = math::Min<int64>(imageTileY1, layerTileY1);
+
+         out_vResult[i].x0 = source.tileX0;
+         out_vResult[i].y0 = source.tileY0;
+         out_vResult[i].x1 = source.tileX1;
+         out_vResult[i].y1 = source.tileY1;
+
+         vSources.push_back(source);
+         vSourceInput.push_back(i);
       }
 
-      // check if image is outside layer
-      if (imageTileX0 > layerTileX1 || 
-         imageTileY0 > layerTileY1 ||
-         imageTileX1 < layerTileX0 ||
-         imageTileY1 < layerTileY0)
+      if (vSources.size() == 0)
       {
-         qLogger->Info("The dataset is outside of the layer and not being added!");
          ProcessingUtils::exit_gdal();
          return 0;
       }
 
-      // clip tiles to layer extent
-      imageTileX0 = math::Max<int64>(imageTileX0, layerTileX0);
-      imageTileY0 = math::Max<int64>(imageTileY0, layerTileY0);
-      imageTileX1 = math::Min<int64>(imageTileX1, layerTileX1);
-      imageTileY1 = math::Min<int64>(imageTileY1, layerTileY1);
-
-      out_x0 = imageTileX0;
-      out_y0 = imageTileY0;
-      out_x1 = imageTileX1;
-      out_y1 = imageTileY1;
-
-      // Load image 
-      boost::shared_array<unsigned char> vImage = ProcessingUtils::ImageToMemoryRGB(oInfo);
-      unsigned char* pImage = vImage.get();
+      //---------------------------------------------------------------------------
+      // Tiles are processed row by row. An image is opened when the first row 
+      // touching it is reached and closed after its last row. The block cache 
+      // is shared by all images open at the same time.
 
-      if (!vImage)
+      std::vector<std::pair<int64, int> > vEvents;          // (row, +1 open / -1 close)
+      std::vector<std::pair<int64, size_t> > vByFirstRow;   // (first row, source)
+      for (size_t s=0;s<vSources.size();s++)
       {
-         qLogger->Error("Can't load image into memory!\n");
-         return ERROR_NOMEMORY;
+         vEvents.push_back(std::pair<int64, int>(vSources[s].tileY0, 1));
+         vEvents.push_back(std::pair<int64, int>(vSources[s].tileY1+1, -1));
+         vByFirstRow.push_back(std::pair<int64, size_t>(vSources[s].tileY0, s));
       }
+      std::sort(vEvents.begin(), vEvents.end());
+      std::sort(vByFirstRow.begin(), vByFirstRow.end());
 
-      //########################################################################
-      // Beacuse proj4 is not thread safe at this time, 
-      // the target extents are precalculate.
-      // unfortunately this can't be fixed by using OpenMP locks / critical sections
-
-      int64 numTiles = (imageTileX1-imageTileX0+1)*(imageTileY1-imageTileY0+1);
-      boost::shared_array<Anchor> vAnchor = boost::shared_array<Anchor>(new Anchor[numTiles]);
-      Anchor* pAnchor = vAnchor.get();
-
-      if (!vAnchor)
+      int nOpen = 0, nMaxOpen = 0;
+      for (size_t e=0;e<vEvents.size();e++)
       {
-         qLogger->Error("Not enough memory for target tile structure! (This is a known issue and will be fixed soon!)\n");
-         return ERROR_NOMEMORY;
+         nOpen += vEvents[e].second;
+         nMaxOpen = math::Max<int>(nMaxOpen, nOpen);
       }
+      // the caches of all open images together stay within nCacheSizeMB. A cache
+      // smaller than one block still keeps the block it is reading.
+      size_t nCacheSize = size_t(nCacheSizeMB)*1024*1024 / size_t(nMaxOpen);
 
+      int64 rowY0 = vByFirstRow[0].first;
+      int64 rowY1 = vSources[0].tileY1;
+      for (size_t s=1;s<vSources.size();s++)
+      {
+         rowY1 = math::Max<int64>(rowY1, vSources[s].tileY1);
+      }
 
       if (bVerbose)
       {
-         oss << "\nCalculating Destination Coordinates (transformation)...";
+         oss << "\nCalculating Tiles of " << vSources.size() << " images";
          qLogger->Info(oss.str());
          oss.str("");
       }
 
-      
-      for (int64 xx = imageTileX0; xx <= imageTileX1; ++xx)
+      std::vector<size_t> vActive;        // open sources, in priority order
+      size_t nNextSource = 0;             // next source in vByFirstRow
+      int64 numTilesWritten = 0;
+
+      for (int64 yy = rowY0; yy <= rowY1; ++yy)
       {
-         for (int64 yy = imageTileY0; yy <= imageTileY1; ++yy)
+         // close images above the current row
+         for (size_t a=0;a<vActive.size();)
          {
-            int64 cnt = (xx-imageTileX0)*(imageTileY1-imageTileY0+1)+yy-imageTileY0;
+            if (vSources[vActive[a]].tileY1 < yy)
+            {
+               vSources[vActive[a]].qCache.reset();
+               vActive.erase(vActive.begin()+a);
+            }
+            else
+            {
+               a++;
+            }
+         }
+
+         if (vActive.size() == 0 && nNextSource < vByFirstRow.size())
+         {
+            // skip rows without images
+            yy = math::Max<int64>(yy, vByFirstRow[nNextSource].first);
+         }
+
+         // open images starting in current row. Every open image gets an equal share
+         // of the cache size (at most nMaxOpen images are open at the same time).
+         while (nNextSource < vByFirstRow.size() && vByFirstRow[nNextSource].first == yy)
+         {
+            size_t s = vByFirstRow[nNextSource++].second;
+            vSources[s].qCache = boost::shared_ptr<RasterBlockCache>(new RasterBlockCache(vSources[s].oInfo, nCacheSize));
+            if (!vSources[s].qCache->IsGood())
+            {
+               qLogger->Error("Can't open image for reading: " + vSources[s].oInfo.sFilename);
+               out_vResult[vSourceInput[s]].nError = ERROR_LOADIMAGE;
+               vSources[s].qCache.reset();
+               continue;
+            }
+            vActive.push_back(s);
+         }
+         std::sort(vActive.begin(), vActive.end());
+
+         if (vActive.size() == 0)
+         {
+            continue;
+         }
+
+         //------------------------------------------------------------------------
+         // tile -> contributing images index of the current row
+
+         int64 rowX0 = vSources[vActive[0]].tileX0;
+         int64 rowX1 = vSources[vActive[0]].tileX1;
+         for (size_t a=1;a<vActive.size();a++)
+         {
+            rowX0 = math::Min<int64>(rowX0, vSources[vActive[a]].tileX0);
+            rowX1 = math::Max<int64>(rowX1, vSources[vActive[a]].tileX1);
+         }
+
+         std::vector<int64> vTileX;
+         std::vector<std::vector<size_t> > vTileSources;
+         for (int64 xx = rowX0; xx <= rowX1; ++xx)
+         {
+            std::vector<size_t> vContributing;
+            for (size_t a=0;a<vActive.size();a++)
+            {
+               if (vSources[vActive[a]].tileX0 <= xx && xx <= vSources[vActive[a]].tileX1)
+               {
+                  vContributing.push_back(vActive[a]);
+               }
+            }
+            if (vContributing.size() > 0)
+            {
+               vTileX.push_back(xx);
+               vTileSources.push_back(vContributing);
+            }
+         }
+
+         //------------------------------------------------------------------------
+         // The target extents (anchor points) of all tiles of the row are
+         // calculated using one batch transformation.
+
+         int64 numTiles = (int64)vTileX.size();
+         std::vector<double> vAnchorX(4*numTiles);
+         std::vector<double> vAnchorY(4*numTiles);
 
-            std::string sQuadcode = qQuadtree->TileCoordToQuadkey(xx,yy,lod);
-             double px0m, py0m, px1m, py1m;
+         for (int64 cnt = 0; cnt < numTiles; ++cnt)
+         {
+            std::string sQuadcode = qQuadtree->TileCoordToQuadkey(vTileX[cnt],yy,lod);
+            double px0m, py0m, px1m, py1m;
             qQuadtree->QuadKeyToMercatorCoord(sQuadcode, px0m, py0m, px1m, py1m);
 
             double ulx = px0m;
@@ -201,58 +628,48 @@ namespace ImageData
             double lrx = px1m;
             double lry = py0m;
 
-            double anchor_Ax = ulx; 
-            double anchor_Ay = lry;
-            double anchor_Bx = lrx; 
-            double anchor_By = lry;
-            double anchor_Cx = lrx; 
-            double anchor_Cy = uly;
-            double anchor_Dx = ulx; 
-            double anchor_Dy = uly;
-
-            qCT->TransformBackwards(&anchor_Ax, &anchor_Ay);
-            qCT->TransformBackwards(&anchor_Bx, &anchor_By);
-            qCT->TransformBackwards(&anchor_Cx, &anchor_Cy);
-            qCT->TransformBackwards(&anchor_Dx, &anchor_Dy);
-
-            pAnchor[cnt].anchor_Ax = anchor_Ax;
-            pAnchor[cnt].anchor_Ay = anchor_Ay;
-            pAnchor[cnt].anchor_Bx = anchor_Bx;
-            pAnchor[cnt].anchor_By = anchor_By;
-            pAnchor[cnt].anchor_Cx = anchor_Cx;
-            pAnchor[cnt].anchor_Cy = anchor_Cy;
-            pAnchor[cnt].anchor_Dx = anchor_Dx;
-            pAnchor[cnt].anchor_Dy = anchor_Dy;
-
-            cnt++;
+            // anchors A, B, C, D
+            vAnchorX[4*cnt+0] = ulx; vAnchorY[4*cnt+0] = lry;
+            vAnchorX[4*cnt+1] = lrx; vAnchorY[4*cnt+1] = lry;
+            vAnchorX[4*cnt+2] = lrx; vAnchorY[4*cnt+2] = uly;
+            vAnchorX[4*cnt+3] = ulx; vAnchorY[4*cnt+3] = uly;
          }
-      }
-      //########################################################################
 
-      if (bVerbose)
-      {
-         oss << "\nCalculating Tiles";
-         qLogger->Info(oss.str());
-         oss.str("");
-      }
+         qCT->TransformArrayBackwards(vAnchorX.size(), &vAnchorX[0], &vAnchorY[0]);
 
-      // iterate through all tiles and create them
-      #pragma omp parallel for
-      for (int64 xx = imageTileX0; xx <= imageTileX1; ++xx)
-      {
-         for (int64 yy = imageTileY0; yy <= imageTileY1; ++yy)
+         //------------------------------------------------------------------------
+         // every tile is loaded, composited from all its images and stored once.
+         // The occupancy index (written by other processes too) is loaded once
+         // per row.
+
+         if (qOccupancy)
          {
-            int64 cnt = (xx-imageTileX0)*(imageTileY1-imageTileY0+1)+yy-imageTileY0;
+            qOccupancy->Load();
+         }
+
+         #pragma omp parallel for schedule(dynamic)
+         for (int64 cnt = 0; cnt < numTiles; ++cnt)
+         {
+            int64 xx = vTileX[cnt];
+
+            Anchor anchor;
+            anchor.anchor_Ax = vAnchorX[4*cnt+0];
+            anchor.anchor_Ay = vAnchorY[4*cnt+0];
+            anchor.anchor_Bx = vAnchorX[4*cnt+1];
+            anchor.anchor_By = vAnchorY[4*cnt+1];
+            anchor.anchor_Cx = vAnchorX[4*cnt+2];
+            anchor.anchor_Cy = vAnchorY[4*cnt+2];
+            anchor.anchor_Dx = vAnchorX[4*cnt+3];
+            anchor.anchor_Dy = vAnchorY[4*cnt+3];
 
             boost::shared_array<unsigned char> vTile;
 
-            std::string sQuadcode = qQuadtree->TileCoordToQuadkey(xx,yy,lod);
-            std::string sTilefile = ProcessingUtils::GetTilePath(sTileDir, ".png" , lod, xx, yy);
+            std::string sTilefile = qTileStore->GetTileName(lod, xx, yy);
 
             if (bVerbose)
             {
                std::stringstream sst;
-               sst << "processing " << sQuadcode << " (" << xx << ", " << yy << ")";
+               sst << "processing " << qQuadtree->TileCoordToQuadkey(xx,yy,lod) << " (" << xx << ", " << yy << "), " << vTileSources[cnt].size() << " image(s)";
                qLogger->Info(sst.str());
             }
 
@@ -285,11 +702,32 @@ namespace ImageData
             // tile already exists ?
             bool bCreateNew = true;
 
-            if (FileSystem::FileExists(sTilefile))
+            // State of tile: a tile in the tile store has data (empty and uniform
+            // tiles are removed from it), otherwise the occupancy index is used.
+            // The store is read first, it may have been written after the index
+            // was loaded.
+            TileOccupancy::ETileState eIndexed = TileOccupancy::TILE_DATA;
+            unsigned int nUniformValue = 0;
+            if (qOccupancy)
+            {
+               eIndexed = qOccupancy->GetState(xx, yy, &nUniformValue);
+            }
+
+            std::vector<unsigned char> vTileData;
+            bool bStored = qTileStore->Read(lod, xx, yy, vTileData);
+            TileOccupancy::ETileState eState = bStored ? TileOccupancy::TILE_DATA : eIndexed;
+
+            if (eState == TileOccupancy::TILE_UNIFORM)
+            {
+               vTile = boost::shared_array<unsigned char>(new unsigned char[tilesize*tilesize*4]);
+               TileOccupancy::Fill(vTile.get(), tilesize*tilesize, nUniformValue);
+               bCreateNew = false;
+            }
+            else if (bStored)
             {
                qLogger->Info(sTilefile + " already exists, updating");
                ImageObject outputimage;
-               if (ImageLoader::LoadFromDisk(Img::Format_PNG, sTilefile, Img::PixelFormat_RGBA, outputimage))
+               if (ImageLoader::LoadFromMemory(Img::Format_PNG, &vTileData[0], (unsigned int)vTileData.size(), Img::PixelFormat_RGBA, outputimage))
                {
                   if (outputimage.GetHeight() == tilesize && outputimage.GetWidth() == tilesize)
                   {
@@ -308,94 +746,10 @@ namespace ImageData
 
             unsigned char* pTile = vTile.get();
 
-            // Copy image to tile:
-            /*double px0m, py0m, px1m, py1m;
-            qQuadtree->QuadKeyToMercatorCoord(sQuadcode, px0m, py0m, px1m, py1m);
-
-            double ulx = px0m;
-            double uly = py1m;
-            double lrx = px1m;
-            double lry = py0m;
-
-            double anchor_Ax = ulx; 
-            double anchor_Ay = lry;
-            double anchor_Bx = lrx; 
-            double anchor_By = lry;
-            double anchor_Cx = lrx; 
-            double anchor_Cy = uly;
-            double anchor_Dx = ulx; 
-            double anchor_Dy = uly;
-
-            // avoid calculating transformation per pixel. This is done using anchor point method
-           
-            qCT->TransformBackwards(&anchor_Ax, &anchor_Ay);
-            qCT->TransformBackwards(&anchor_Bx, &anchor_By);
-            qCT->TransformBackwards(&anchor_Cx, &anchor_Cy);
-            qCT->TransformBackwards(&anchor_Dx, &anchor_Dy);
-            */
-
-
-            double anchor_Ax = pAnchor[cnt].anchor_Ax;
-            double anchor_Ay = pAnchor[cnt].anchor_Ay;
-            double anchor_Bx = pAnchor[cnt].anchor_Bx;
-            double anchor_By = pAnchor[cnt].anchor_By;
-            double anchor_Cx = pAnchor[cnt].anchor_Cx;
-            double anchor_Cy = pAnchor[cnt].anchor_Cy;
-            double anchor_Dx = pAnchor[cnt].anchor_Dx;
-            double anchor_Dy = pAnchor[cnt].anchor_Dy;
-   
-            // write current tile
-            for (int ty=0;ty<tilesize;++ty)
+            // Copy images to tile, in priority order
+            for (size_t k=0;k<vTileSources[cnt].size();k++)
             {
-               for (int tx=0;tx<tilesize;++tx)
-               {
-                  double dx = (double)tx*dWanc;
-                  double dy = (double)ty*dHanc;
-                  double xd = (anchor_Ax*(1.0-dx)*(1.0-dy)+anchor_Bx*dx*(1.0-dy)+anchor_Dx*(1.0-dx)*dy+anchor_Cx*dx*dy);
-                  double yd = (anchor_Ay*(1.0-dx)*(1.0-dy)+anchor_By*dx*(1.0-dy)+anchor_Dy*(1.0-dx)*dy+anchor_Cy*dx*dy);
-
-                  // pixel coordinate in original image
-                  double dPixelX = (oInfo.affineTransformation_inverse[0] + xd * oInfo.affineTransformation_inverse[1] + yd * oInfo.affineTransformation_inverse[2]);
-                  double dPixelY = (oInfo.affineTransformation_inverse[3] + xd * oInfo.affineTransformation_inverse[4] + yd * oInfo.affineTransformation_inverse[5]);
-                  unsigned char r,g,b,a;
-
-                  // out of image -> set transparent
-                  if (dPixelX<0 || dPixelX>oInfo.nSizeX ||
-                     dPixelY<0 || dPixelY>oInfo.nSizeY)
-                  {
-                     r = g = b = a = 0;
-                  }
-                  else
-                  {
-                     // read pixel in image pImage[dPixelX, dPixelY] (biliear, bicubic or nearest neighbour)
-                     // and store as r,g,b
-                     _ReadImageValueBilinear(pImage, oInfo.nSizeX, oInfo.nSizeY, dPixelX, dPixelY, &r, &g, &b, &a);
-                  }
-
-                  size_t adr=4*ty*tilesize+4*tx;
-
-                  if (a>0)
-                  {
-                     if (bFill)
-                     {
-                        if (pTile[adr+3] == 0)
-                        {
-                           pTile[adr+0] = r;  
-                           pTile[adr+1] = g;  
-                           pTile[adr+2] = b; 
-                           pTile[adr+3] = a;
-                        }
-                     }
-                     else // if (bOverwrite)
-                     {
-                        // currently RGB for testing purposes!
-                        pTile[adr+0] = r;  
-                        pTile[adr+1] = g;  
-                        pTile[adr+2] = b; 
-                        pTile[adr+3] = a;
-                     }
-                  }
-               }
+               _WarpSourceToTile(vSources[vTileSources[cnt][k]], anchor, pTile, bFill, bNearest, qLogger, sTilefile);
             }
 
             // save tile (pTile)
@@ -404,22 +758,47 @@ namespace ImageData
                qLogger->Info("Storing tile: " + sTilefile);
             }
 
-            ImageWriter::WritePNG(sTilefile, pTile, tilesize, tilesize);
+            if (qOccupancy)
+            {
+               eState = TileOccupancy::Classify(pTile, tilesize*tilesize, 0, nUniformValue);
+            }
+
+            if (eState == TileOccupancy::TILE_DATA && ImageWriter::EncodePNG(pTile, tilesize, tilesize, vTileData))
+            {
+               qTileStore->Write(lod, xx, yy, &vTileData[0], vTileData.size());
+            }
+
+            // record tile while it is locked, other processes see it after unlocking.
+            if (qOccupancy && (eState != TileOccupancy::TILE_DATA || eIndexed != TileOccupancy::TILE_DATA))
+            {
+               qOccupancy->SetState(xx, yy, eState, nUniformValue);
+               qOccupancy->Flush();
+            }
+
+            // tile became empty or uniform: remove the old tile, so readers which
+            // don't use the index don't get outdated data.
+            if (bStored && eState != TileOccupancy::TILE_DATA)
+            {
+               qTileStore->Remove(lod, xx, yy);
+            }
 
             // unlock file. Other computers/processes/threads can access it again.
             FileSystem::Unlock(sTilefile, lockhandle);
          }
-      }
 
+         numTilesWritten += numTiles;
+      }
 
-      //---------------------------------------------------------------------------
-
+      for (size_t s=0;s<vSources.size();s++)
+      {
+         vSources[s].qCache.reset(); // close datasets before gdal is cleaned up
+      }
 
       //---------------------------------------------------------------------------
       t1=clock();
 
       std::ostringstream out;
-      out << "calculated in: " << double(t1-t0)/double(CLOCKS_PER_SEC) << " s \n";
+      out << numTilesWritten << " tiles calculated in: " << double(t1-t0)/double(CLOCKS_PER_SEC) << " s \n";
       qLogger->Info(out.str());
 
       ProcessingUtils::exit_gdal();
@@ -427,4 +806,4 @@ namespace ImageData
       return 0;
    }
 
-}
\ No newline at end of file
+}
@@ -25,6 +25,7 @@
 #include "ogprocess.h"
 #include "errors.h"
 #include <string>
+#include <vector>
 
 
 
@@ -95,7 +96,21 @@ namespace ImageData
 
    //---------------------------------------------------------------------------
 
-   int process( boost::shared_ptr<Logger> qLogger, boost::shared_ptr<ProcessingSettings> qSettings, std::string sLayer, bool bVerbose, bool bLock, int epsg, std::string sImagefile, bool bFill, int& out_lod, int64& out_x0, int64& out_y0, int64& out_x1, int64& out_y1 );
+   //! Result of one input image of a batch
+   struct InputResult
+   {
+      int   nError;           // 0: success, otherwise error code (errors.h)
+      int64 x0, y0, x1, y1;   // tile extent of image in layer
+   };
+
+   //---------------------------------------------------------------------------
+
+   int process( boost::shared_ptr<Logger> qLogger, boost::shared_ptr<ProcessingSettings> qSettings, std::string sLayer, bool bVerbose, bool bLock, int epsg, std::string sImagefile, bool bFill, bool bNearest, int nCacheSizeMB, int& out_lod, int64& out_x0, int64& out_y0, int64& out_x1, int64& out_y1 );
+
+   //---------------------------------------------------------------------------
+   // Batch mode: all images are added in one pass. Every tile is loaded, composited
+   // from all images covering it (in list order) and stored only once.
+   int process( boost::shared_ptr<Logger> qLogger, boost::shared_ptr<ProcessingSettings> qSettings, std::string sLayer, bool bVerbose, bool bLock, int epsg, const std::vector<std::string>& vImagefiles, bool bFill, bool bNearest, int nCacheSizeMB, int& out_lod, std::vector<InputResult>& out_vResult );
 
 
 
@@ -40,6 +40,7 @@
 #include <iostream>
 #include <boost/program_options.hpp>
 #include <sstream>
+#include <algorithm>
 #include <omp.h>
 
 enum ELayerType
@@ -58,6 +59,9 @@ int main(int argc, char *argv[])
    po::options_description desc("Program-Options");
    desc.add_options()
        ("image", po::value<std::string>(), "image file to add")
+       ("images", po::value< std::vector<std::string> >()->multitoken(), "list of image files, added in one pass (with --fill the first file has priority, with --overwrite the last)")
+       ("inputdir", po::value<std::string>(), "directory with image files, added in one pass (requires --filetype)")
+       ("filetype", po::value<std::string>(), "file type of images in --inputdir, e.g. tif")
        ("elevation",  po::value<std::string>(), "elevation file to add")
        ("rawimage",  po::value<std::string>(), "raw image file to add")
 	    ("point", po::value<std::string>(), "point file to add")
@@ -66,9 +70,14 @@ int main(int argc, char *argv[])
        ("fill", "fill empty parts, don't overwrite already existing data")
        ("overwrite", "overwrite existing data")
        ("numthreads", po::value<int>(), "force number of threads")
+       ("cachesize", po::value<int>(), "[optional] size of image block cache in MB (image only, default: 512)")
+       ("nearest", "[optional] nearest neighbour resampling instead of bilinear (image only)")
+       ("buffersize", po::value<int>(), "[optional] size of point buffer in MB (elevation only, default: 256)")
+       ("externalsort", "[optional] sort points on disk and write every tile once at the end (elevation only)")
        //("maxlod", po::value<int>(), "[optional]process top down to this LOD level (rawimage only)")
        ("verbose", "verbose output")
        ("nolock", "disable file locking (also forcing 1 thread)")
+       ("lockbackend", po::value<std::string>(), "[optional] lock backend: process, host or lockfile (default)")
        ("force", "force adding data")
        ;
 
@@ -87,6 +96,8 @@ int main(int argc, char *argv[])
    }
 
    std::string sFile;
+   std::vector<std::string> vFiles;    // image batch (--images, --inputdir)
+   bool bBatch = false;
    std::string sSRS;
    std::string sLayer;
    bool bFill = false;
@@ -97,6 +108,10 @@ int main(int argc, char *argv[])
    ELayerType eLayer = IMAGE_LAYER;
    bool bUseProcessStatus = true;
    //int  iMaxLod = 0;
+   int  nCacheSizeMB = 512;
+   int  nBufferSizeMB = 256;
+   bool bExternalSort = false;
+   bool bNearest = false;
    int  iLod;
 
 
@@ -123,7 +138,7 @@ int main(int argc, char *argv[])
 
    //---------------------------------------------------------------------------
 
-   if (!vm.count("image") && !vm.count("elevation") && !vm.count("rawimage") && !vm.count("point"))
+   if (!vm.count("image") && !vm.count("images") && !vm.count("inputdir") && !vm.count("elevation") && !vm.count("rawimage") && !vm.count("point"))
    {
       bError = true;
    }
@@ -138,6 +153,35 @@ int main(int argc, char *argv[])
          sFile = FileSystem::GetCWD() + "/" + sFile;
       }
    }
+   else if (vm.count("images") || vm.count("inputdir"))
+   {
+      eLayer = IMAGE_LAYER;
+      bBatch = true;
+
+      if (vm.count("images"))
+      {
+         vFiles = vm["images"].as< std::vector<std::string> >();
+      }
+      else if (vm.count("filetype"))
+      {
+         std::string sInputDir = vm["inputdir"].as<std::string>();
+         vFiles = FileSystem::GetFilesInDirectory(sInputDir, vm["filetype"].as<std::string>());
+         std::sort(vFiles.begin(), vFiles.end());
+      }
+
+      for (size_t i=0;i<vFiles.size();i++)
+      {
+         if (FilenameUtils::IsRelative(vFiles[i]))
+         {
+            vFiles[i] = FileSystem::GetCWD() + "/" + vFiles[i];
+         }
+      }
+
+      if (vFiles.size() == 0)
+      {
+         bError = true;
+      }
+   }
    else if  (vm.count("elevation"))
    {
       eLayer = ELEVATION_LAYER;
@@ -211,6 +255,30 @@ int main(int argc, char *argv[])
          omp_set_num_threads(n);
       }
    }
+   if (vm.count("cachesize"))
+   {
+      nCacheSizeMB = vm["cachesize"].as<int>();
+      if (nCacheSizeMB<1)
+      {
+         bError = true;
+      }
+   }
+   if (vm.count("buffersize"))
+   {
+      nBufferSizeMB = vm["buffersize"].as<int>();
+      if (nBufferSizeMB<1)
+      {
+         bError = true;
+      }
+   }
+   if (vm.count("externalsort"))
+   {
+      bExternalSort = true;
+   }
+   if (vm.count("nearest"))
+   {
+      bNearest = true;
+   }
    /*if (vm.count("maxlod"))
    {
       iMaxLod = vm["maxlod"].as<int>();
@@ -227,6 +295,20 @@ int main(int argc, char *argv[])
       omp_set_num_threads(1);
    }
 
+   if (vm.count("lockbackend"))
+   {
+      EFileLockBackend eBackend;
+      if (IFileLock::ParseBackend(vm["lockbackend"].as<std::string>(), eBackend))
+      {
+         FileSystem::SetLockBackend(eBackend);
+      }
+      else
+      {
+         std::cout << "unknown lock backend " << vm["lockbackend"].as<std::string>() << "\n";
+         bError = true;
+      }
+   }
+
    if (vm.count("virtual"))
    {
       bVirtual = true;
@@ -260,6 +342,11 @@ int main(int argc, char *argv[])
 
 
 
+   if (!bBatch)
+   {
+      vFiles.push_back(sFile);
+   }
+
    //---------------------------------------------------------------------------
    // CREATE / UPDATE PROCESS STATUS
    //---------------------------------------------------------------------------
@@ -295,43 +382,55 @@ int main(int argc, char *argv[])
          qProcessStatus->SetLayerName(sLayer);
       }
 
-      pElement = qProcessStatus->GetElement(sFile);
-
-      if (pElement)
+      // files already added or currently processed by another instance are removed from the batch
+      std::vector<std::string> vPending;
+      for (size_t i=0;i<vFiles.size();i++)
       {
-         if (pElement->IsFinished())
+         pElement = qProcessStatus->GetElement(vFiles[i]);
+
+         if (pElement)
          {
-            // this file was already processed! Do not process again!
-            qLogger->Warn("This file has already been added to the dataset. Ignoring it.\n");
-            FileSystem::Unlock(sProcessStatusFile, lockid);
-            return 0;
+            if (pElement->IsFinished())
+            {
+               // this file was already processed! Do not process again!
+               qLogger->Warn(vFiles[i] + ": This file has already been added to the dataset. Ignoring it.\n");
+               continue;
+            }
+            if (pElement->IsProcessing())
+            {
+               qLogger->Error(vFiles[i] + ": This file is currently being processed by another instance. Ignoring it.\n");
+               continue;
+            }
+
+            // Element exists, but creation failed or didn't complete
+            // Set Start Time again.
+            pElement->SetStatusMessage("reprocessing");
+            pElement->SetStartTime(); // update start time
          }
-         if (pElement->IsProcessing())
+         else
          {
-            qLogger->Error("This file is currently being processed by another instance. Ignoring it.\n");
-            FileSystem::Unlock(sProcessStatusFile, lockid);
-            return 0;
+            ProcessElement newElement;
+            newElement.SetFilename(vFiles[i]);
+            newElement.SetStartTime();
+            newElement.SetStatusMessage("processing");
+            newElement.Processing();
+            qProcessStatus->AddElement(newElement);
          }
-
-         // Element exists, but creation failed or didn't complete
-         // Set Start Time again.
-         pElement->SetStatusMessage("reprocessing");
-         pElement->SetStartTime(); // update start time
+         vPending.push_back(vFiles[i]);
       }
-      else
+
+      if (vPending.size() > 0)
       {
-         ProcessElement newElement;
-         newElement.SetFilename(sFile);
-         newElement.SetStartTime();
-         newElement.SetStatusMessage("processing");
-         newElement.Processing();
-         qProcessStatus->AddElement(newElement);
+         qProcessStatus->Save(sProcessStatusFile);
       }
 
-      qProcessStatus->Save(sProcessStatusFile);
-
       FileSystem::Unlock(sProcessStatusFile, lockid);
 
+      vFiles = vPending;
+      if (vFiles.size() == 0)
+      {
+         return 0;
+      }
    }
 
 
@@ -340,10 +439,15 @@ int main(int argc, char *argv[])
    int lod = 0;
    int64 x0 = 0, y0 = 0, x1 = 0, y1 = 0;
    int64 z0 = 0, z1 = 0;
+   std::vector<ImageData::InputResult> vResult;   // batch mode: result of every image
 
-   if (eLayer == IMAGE_LAYER) 
+   if (bBatch)
+   {
+      retval = ImageData::process(qLogger, qSettings, sLayer, bVerbose, bLock, epsg, vFiles, bFill, bNearest, nCacheSizeMB, lod, vResult);
+   }
+   else if (eLayer == IMAGE_LAYER) 
    {
-      retval = ImageData::process(qLogger, qSettings, sLayer, bVerbose, bLock, epsg, sFile, bFill, lod, x0, y0, x1, y1);
+      retval = ImageData::process(qLogger, qSettings, sLayer, bVerbose, bLock, epsg, sFile, bFill, bNearest, nCacheSizeMB, lod, x0, y0, x1, y1);
    }
    else if (eLayer == RAWIMAGE_LAYER)
    {
@@ -351,7 +455,7 @@ int main(int argc, char *argv[])
    }
    else if (eLayer == ELEVATION_LAYER)
    {
-      retval = ElevationData::process(qLogger, qSettings, sLayer, bVerbose, bLock, bVirtual, epsg, sFile, bFill, lod, x0, y0, x1, y1);
+      retval = ElevationData::process(qLogger, qSettings, sLayer, bVerbose, bLock, bVirtual, epsg, sFile, bFill, nBufferSizeMB, bExternalSort, lod, x0, y0, x1, y1);
    }
 #ifdef _USE_POINTS   
    else if (eLayer == POINT_LAYER)
@@ -377,35 +481,51 @@ int main(int argc, char *argv[])
          return ERROR_FILE;
       }
 
-      pElement = qProcessStatus->GetElement(sFile);
-      if (!pElement)
+      for (size_t i=0;i<vFiles.size();i++)
       {
-         qLogger->Error("Can't find element in process status file.\n");
-         FileSystem::Unlock(sProcessStatusFile, lockid);
-         return ERROR_FILE;
-      }
+         pElement = qProcessStatus->GetElement(vFiles[i]);
+         if (!pElement)
+         {
+            qLogger->Error("Can't find element in process status file.\n");
+            FileSystem::Unlock(sProcessStatusFile, lockid);
+            return ERROR_FILE;
+         }
 
-      pElement->SetFinishTime();
+         int fileretval = retval;
+         if (bBatch)
+         {
+            if (fileretval == 0)
+            {
+               fileretval = vResult[i].nError;
+            }
+            x0 = vResult[i].x0;
+            y0 = vResult[i].y0;
+            x1 = vResult[i].x1;
+            y1 = vResult[i].y1;
+         }
 
-      if (retval == 0)
-      {
-         pElement->SetStatusMessage("success");
-         pElement->SetLod(lod);
-         if (eLayer == POINT_LAYER)
+         pElement->SetFinishTime();
+
+         if (fileretval == 0)
          {
-            pElement->SetExtent(x0,y0,z0,x1,y1,z1);
+            pElement->SetStatusMessage("success");
+            pElement->SetLod(lod);
+            if (eLayer == POINT_LAYER)
+            {
+               pElement->SetExtent(x0,y0,z0,x1,y1,z1);
+            }
+            else
+            {
+               pElement->SetExtent(x0,y0,x1,y1);
+            }
+            pElement->MarkFinished();
+            pElement->FinishedProcessing();
          }
          else
          {
-            pElement->SetExtent(x0,y0,x1,y1);
+            pElement->SetStatusMessage("failed");
+            pElement->MarkFailed();
          }
-         pElement->MarkFinished();
-         pElement->FinishedProcessing();
-      }
-      else
-      {
-         pElement->SetStatusMessage("failed");
-         pElement->MarkFailed();
       }
 
       qProcessStatus->Save(sProcessStatusFile);
@@ -413,6 +533,12 @@ int main(int argc, char *argv[])
       FileSystem::Unlock(sProcessStatusFile, lockid);
    }
 
+   // batch mode: report the first failed image
+   for (size_t i=0;i<vResult.size() && retval == 0;i++)
+   {
+      retval = vResult[i].nError;
+   }
+
    return retval;
 }
 
@@ -43,7 +43,7 @@
 
 namespace PointData
 {
-   const size_t membuffer = 100000; // number of points to keep in memory
+   const size_t membuffer = 256*1024*1024; // memory for buffered points (bytes)
 
    int process( boost::shared_ptr<Logger> qLogger, boost::shared_ptr<ProcessingSettings> qSettings, std::string sLayer, bool bVerbose, bool bLock, int epsg, std::string sPointFile, bool bFill, int& out_lod, int64& out_x0, int64& out_y0, int64& out_z0, int64& out_x1, int64& out_y1, int64& out_z1)
    {
@@ -67,6 +67,7 @@ namespace PointData
       std::string sTileDir = FilenameUtils::DelimitPath(FilenameUtils::DelimitPath(sPointLayerDir) + "tiles");
       std::string sTempDir = FilenameUtils::DelimitPath(FilenameUtils::DelimitPath(sPointLayerDir) + "temp/tiles");
       std::string sIndexFile = FilenameUtils::DelimitPath(sPointLayerDir) + "temp/" + FilenameUtils::ExtractBaseFileName(sPointFile) + ".idx";
+      std::string sRunPrefix = FilenameUtils::DelimitPath(sPointLayerDir) + "temp/" + FilenameUtils::ExtractBaseFileName(sPointFile);
 
       boost::shared_ptr<PointLayerSettings> qPointLayerSettings = PointLayerSettings::Load(sPointLayerDir);
       if (!qPointLayerSettings)
@@ -150,57 +151,76 @@ namespace PointData
       //------------------------------------------------------------------------
 
       size_t numpts = 0;
-      size_t totalpoints = 0;
 
-      CloudPoint pt;
       CloudPoint pt_octree; // point in octree coords
       PointCloudReader pr;
-      PointMap pointmap(lod);
+      PointMap pointmap(lod, sRunPrefix, membuffer);
+
+      // points are read and transformed in batches, so parsing, the coordinate
+      // transformation and the conversion to octree coordinates run on all cores.
+      std::vector<CloudPoint> vBatch;
+      std::vector<double> vX, vY;
+      std::vector<int64> vOctree;
 
       if (pr.Open(sPointFile))
       {
-         GeoCoord in_geopt;          
-         vec3<double> in_pt_cart;    // point in geocentric cartesian coordinates (WGS84)
-         vec3<double> out_pt_octree; // point in local octree coordinates
-
-         while (pr.ReadPoint(pt))
+         while (pr.ReadPoints(vBatch))
          {
-            qCT->Transform(&pt.x, &pt.y);
+            int64 n = (int64)vBatch.size();
+            vX.resize(n);
+            vY.resize(n);
+            vOctree.resize(3*n);
 
-            in_geopt.SetLongitude(pt.x);
-            in_geopt.SetLatitude(pt.y);
-            in_geopt.SetEllipsoidHeight(pt.elevation);
-            
-            in_geopt.ToCartesian(&in_pt_cart.x, &in_pt_cart.y, &in_pt_cart.z);
-            out_pt_octree = Linv.vec3mul(in_pt_cart);
-            pt_octree.r = pt.r;
-            pt_octree.g = pt.g;
-            pt_octree.b = pt.b;
-            pt_octree.a = pt.a;
-            pt_octree.intensity = pt.intensity;
-            pt_octree.x = out_pt_octree.x;
-            pt_octree.y = out_pt_octree.y;
-            pt_octree.elevation = out_pt_octree.z;
-
-            int64 octreeX = int64(out_pt_octree.x * lodlen); 
-            int64 octreeY = int64(out_pt_octree.y * lodlen); 
-            int64 octreeZ = int64(out_pt_octree.z * lodlen); 
-
-            // now we have the octree coordinate (octreeX,Y,Z) of the point
-            // -> add the point to pointmap (which is actually a hash map)
-            // -> note: don't calculate the octocode for each point, it would be way too slow.
-            pointmap.AddPoint(octreeX, octreeY, octreeZ, pt_octree);
-
-            if (pointmap.GetNumPoints()>membuffer)
+            for (int64 i=0;i<n;i++)
             {
-               totalpoints+=pointmap.GetNumPoints();
+               vX[i] = vBatch[i].x;
+               vY[i] = vBatch[i].y;
+            }
 
-               pointmap.ExportData(sTempDir);
+            qCT->TransformArray(vX.size(), &vX[0], &vY[0]);
 
-               pointmap.Clear();
+#           pragma omp parallel for
+            for (int64 i=0;i<n;i++)
+            {
+               GeoCoord in_geopt;          
+               vec3<double> in_pt_cart;    // point in geocentric cartesian coordinates (WGS84)
+               vec3<double> out_pt_octree; // point in local octree coordinates
+               CloudPoint& cur = vBatch[i];
+
+               in_geopt.SetLongitude(vX[i]);
+               in_geopt.SetLatitude(vY[i]);
+               in_geopt.SetEllipsoidHeight(cur.elevation);
+            
+               in_geopt.ToCartesian(&in_pt_cart.x, &in_pt_cart.y, &in_pt_cart.z);
+               out_pt_octree = Linv.vec3mul(in_pt_cart);
+               cur.x = out_pt_octree.x;
+               cur.y = out_pt_octree.y;
+               cur.elevation = out_pt_octree.z;
+
+               vOctree[3*i+0] = int64(out_pt_octree.x * lodlen); 
+               vOctree[3*i+1] = int64(out_pt_octree.y * lodlen); 
+               vOctree[3*i+2] = int64(out_pt_octree.z * lodlen); 
             }
 
-            numpts++;
+            for (int64 i=0;i<n;i++)
+            {
+               const CloudPoint& cur = vBatch[i];
+               pt_octree.r = cur.r;
+               pt_octree.g = cur.g;
+               pt_octree.b = cur.b;
+               pt_octree.a = cur.a;
+               pt_octree.intensity = cur.intensity;
+               pt_octree.x = cur.x;
+               pt_octree.y = cur.y;
+               pt_octree.elevation = cur.elevation;
+
+               // now we have the octree coordinate (octreeX,Y,Z) of the point
+               // -> add the point to pointmap (which is actually a hash map)
+               // -> note: don't calculate the octocode for each point, it would be way too slow.
+               pointmap.AddPoint(vOctree[3*i+0], vOctree[3*i+1], vOctree[3*i+2], pt_octree);
+
+               numpts++;
+            }
          }
       }
       else
@@ -208,10 +228,16 @@ namespace PointData
          return -1;
       }
 
-      if (pointmap.GetNumPoints()>0)
-         pointmap.ExportData(sTempDir);
+      // merge partitioned points into the cell files
+      if (bVerbose)
+      {
+         oss << "Writing cells...\n";
+         qLogger->Info(oss.str());
+         oss.str("");
+      }
+      pointmap.ExportData(sTempDir);
 
-      totalpoints+=pointmap.GetNumPoints();
+      size_t totalpoints = pointmap.GetNumPoints();
     
       // export list of all written tiles (for future processing)
        if (bVerbose)
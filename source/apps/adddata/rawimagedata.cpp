@@ -20,6 +20,8 @@
 #include "rawimagedata.h"
 #include "string/FilenameUtils.h"
 #include "io/FileSystem.h"
+#include "io/TileStore.h"
+#include "io/TileOccupancy.h"
 #include "geo/ImageLayerSettings.h"
 #include "geo/MercatorQuadtree.h"
 #include "image/ImageLoader.h"
@@ -62,8 +64,26 @@ namespace RawImageData
          return ERROR_IMAGELAYERSETTINGS;
       }
 
+      boost::shared_ptr<ITileStore> qTileStore = ITileStore::Create(qImageLayerSettings->GetTileStore(), sTileDir, ".raw");
+      if (!qTileStore)
+      {
+         qLogger->Error("Unknown tile store: " + qImageLayerSettings->GetTileStore());
+         ProcessingUtils::exit_gdal();
+         return ERROR_IMAGELAYERSETTINGS;
+      }
+
       int lod = qImageLayerSettings->GetMaxLod();
       out_lod = lod;
+
+      // tiles without data (-9999) and constant tiles are only recorded in the occupancy index
+      boost::shared_ptr<TileOccupancy> qOccupancy;
+      const float fNodata = -9999.0f;
+      unsigned int nNodataValue = TileOccupancy::PixelValue(&fNodata);
+      if (qImageLayerSettings->GetOccupancyIndex())
+      {
+         qOccupancy = boost::shared_ptr<TileOccupancy>(new TileOccupancy(sTileDir, lod));
+      }
+
       int64 layerTileX0, layerTileY0, layerTileX1, layerTileY1;
       qImageLayerSettings->GetTileExtent(layerTileX0, layerTileY0, layerTileX1, layerTileY1);
 
@@ -149,18 +169,56 @@ namespace RawImageData
          ProcessingUtils::exit_gdal();
          return ERROR_NOMEMORY;
       }
+      //------------------------------------------------------------------------
+      // Calculate anchor points of all tiles using one batch transformation.
+      // (the transformation object must not be used inside the parallel loop below)
+      int64 numTilesY = imageTileY1-imageTileY0+1;
+      int64 numTiles = (imageTileX1-imageTileX0+1)*numTilesY;
+      std::vector<double> vAnchorX(4*numTiles);
+      std::vector<double> vAnchorY(4*numTiles);
+
+#pragma omp parallel for
+      for (int64 cnt = 0; cnt < numTiles; ++cnt)
+      {
+         int64 xx = imageTileX0 + cnt / numTilesY;
+         int64 yy = imageTileY0 + cnt % numTilesY;
+
+         std::string sQuadcode = qQuadtree->TileCoordToQuadkey(xx,yy,lod);
+         double px0m, py0m, px1m, py1m;
+         qQuadtree->QuadKeyToMercatorCoord(sQuadcode, px0m, py0m, px1m, py1m);
+
+         double ulx = px0m;
+         double uly = py1m;
+         double lrx = px1m;
+         double lry = py0m;
+
+         // anchors A, B, C, D
+         vAnchorX[4*cnt+0] = ulx; vAnchorY[4*cnt+0] = lry;
+         vAnchorX[4*cnt+1] = lrx; vAnchorY[4*cnt+1] = lry;
+         vAnchorX[4*cnt+2] = lrx; vAnchorY[4*cnt+2] = uly;
+         vAnchorX[4*cnt+3] = ulx; vAnchorY[4*cnt+3] = uly;
+      }
+
+      qCT->TransformArrayBackwards(vAnchorX.size(), &vAnchorX[0], &vAnchorY[0]);
+
       // iterate through all tiles and create them
 #ifndef _DEBUG
 #pragma omp parallel for
 #endif
       for (int64 xx = imageTileX0; xx <= imageTileX1; ++xx)
       {
+         // the occupancy index (written by other processes too) is loaded once per column
+         if (qOccupancy)
+         {
+            qOccupancy->Load();
+         }
+
          for (int64 yy = imageTileY0; yy <= imageTileY1; ++yy)
          {
             boost::shared_array<float> vTile;
 
             std::string sQuadcode = qQuadtree->TileCoordToQuadkey(xx,yy,lod);
-            std::string sTilefile = ProcessingUtils::GetTilePath(sTileDir, ".raw" , lod, xx, yy);
+            std::string sTilefile = qTileStore->GetTileName(lod, xx, yy);
 
             if (bVerbose)
             {
@@ -189,11 +247,32 @@ namespace RawImageData
             // tile already exists ?
             bool bCreateNew = true;
 
-            if (FileSystem::FileExists(sTilefile))
+            // State of tile: a tile in the tile store has data (empty and uniform
+            // tiles are removed from it), otherwise the occupancy index is used.
+            // The store is read first, it may have been written after the index
+            // was loaded.
+            TileOccupancy::ETileState eIndexed = TileOccupancy::TILE_DATA;
+            unsigned int nUniformValue = 0;
+            if (qOccupancy)
+            {
+               eIndexed = qOccupancy->GetState(xx, yy, &nUniformValue);
+            }
+
+            std::vector<unsigned char> vTileData;
+            bool bStored = qTileStore->Read(lod, xx, yy, vTileData);
+            TileOccupancy::ETileState eState = bStored ? TileOccupancy::TILE_DATA : eIndexed;
+
+            if (eState == TileOccupancy::TILE_UNIFORM)
+            {
+               vTile = boost::shared_array<float>(new float[tilesize*tilesize]);
+               TileOccupancy::Fill(vTile.get(), tilesize*tilesize, nUniformValue);
+               bCreateNew = false;
+            }
+            else if (bStored)
             {
                qLogger->Info(sTilefile + " already exists, updating");
                Raw32ImageObject outputimage;
-               if (ImageLoader::LoadRaw32FromDisk(sTilefile, tilesize,tilesize, outputimage))
+               if (ImageLoader::LoadRaw32FromMemory(&vTileData[0], vTileData.size(), tilesize,tilesize, outputimage))
                {
                   if (outputimage.GetHeight() == tilesize && outputimage.GetWidth() == tilesize)
                   {
@@ -214,28 +293,16 @@ namespace RawImageData
             float* pTile = vTile.get();
 
             // Copy image to tile:
-            double px0m, py0m, px1m, py1m;
-            qQuadtree->QuadKeyToMercatorCoord(sQuadcode, px0m, py0m, px1m, py1m);
-
-            double ulx = px0m;
-            double uly = py1m;
-            double lrx = px1m;
-            double lry = py0m;
-
-            double anchor_Ax = ulx; 
-            double anchor_Ay = lry;
-            double anchor_Bx = lrx; 
-            double anchor_By = lry;
-            double anchor_Cx = lrx; 
-            double anchor_Cy = uly;
-            double anchor_Dx = ulx; 
-            double anchor_Dy = uly;
-
             // avoid calculating transformation per pixel using anchor point method
-            qCT->TransformBackwards(&anchor_Ax, &anchor_Ay);
-            qCT->TransformBackwards(&anchor_Bx, &anchor_By);
-            qCT->TransformBackwards(&anchor_Cx, &anchor_Cy);
-            qCT->TransformBackwards(&anchor_Dx, &anchor_Dy);
+            int64 cnt = (xx-imageTileX0)*numTilesY+yy-imageTileY0;
+            double anchor_Ax = vAnchorX[4*cnt+0]; 
+            double anchor_Ay = vAnchorY[4*cnt+0];
+            double anchor_Bx = vAnchorX[4*cnt+1]; 
+            double anchor_By = vAnchorY[4*cnt+1];
+            double anchor_Cx = vAnchorX[4*cnt+2]; 
+            double anchor_Cy = vAnchorY[4*cnt+2];
+            double anchor_Dx = vAnchorX[4*cnt+3]; 
+            double anchor_Dy = vAnchorY[4*cnt+3];
 
             // write current tile
             for (int ty=0;ty<tilesize;++ty)
@@ -296,7 +363,29 @@ namespace RawImageData
                qLogger->Info("Storing tile: " + sTilefile);
             }
 
-            ImageWriter::WriteRaw32(sTilefile, tilesize, tilesize, pTile);
+            if (qOccupancy)
+            {
+               eState = TileOccupancy::Classify(pTile, tilesize*tilesize, nNodataValue, nUniformValue);
+            }
+
+            if (eState == TileOccupancy::TILE_DATA)
+            {
+               qTileStore->Write(lod, xx, yy, (const unsigned char*)pTile, tilesize*tilesize*sizeof(float));
+            }
+
+            // record tile while it is locked, other processes see it after unlocking.
+            if (qOccupancy && (eState != TileOccupancy::TILE_DATA || eIndexed != TileOccupancy::TILE_DATA))
+            {
+               qOccupancy->SetState(xx, yy, eState, nUniformValue);
+               qOccupancy->Flush();
+            }
+
+            // tile became empty or uniform: remove the old tile, so readers which
+            // don't use the index don't get outdated data.
+            if (bStored && eState != TileOccupancy::TILE_DATA)
+            {
+               qTileStore->Remove(lod, xx, yy);
+            }
             // --- DOWNSAMPLING   --------------------------------------------------------
             /*if(iMaxLod > lod)
             {
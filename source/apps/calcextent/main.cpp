@@ -193,24 +193,38 @@ int _frominput(const std::vector<std::string>& vecFiles, const std::string& srs,
 
       size_t numpts = 0;
 
-      CloudPoint pt;
+      std::vector<CloudPoint> vBatch;
+      std::vector<double> vX, vY;
       for (size_t i = 0; i< vecFiles.size();++i)
       {
          PointCloudReader pr;
 
          if (pr.Open(vecFiles[i]))
          {
-            while (pr.ReadPoint(pt))
+            while (pr.ReadPoints(vBatch))
             {
-               qCT->Transform(&pt.x, &pt.y);
-               xmin = math::Min<double>(xmin, pt.x);
-               ymin = math::Min<double>(ymin, pt.y);
-               zmin = math::Min<double>(zmin, pt.elevation);
-               xmax = math::Max<double>(xmax, pt.x);
-               ymax = math::Max<double>(ymax, pt.y);
-               zmax = math::Max<double>(zmax, pt.elevation);
-
-               numpts++;
+               size_t n = vBatch.size();
+               vX.resize(n);
+               vY.resize(n);
+               for (size_t k=0;k<n;k++)
+               {
+                  vX[k] = vBatch[k].x;
+                  vY[k] = vBatch[k].y;
+               }
+
+               qCT->TransformArray(n, &vX[0], &vY[0]);
+
+               for (size_t k=0;k<n;k++)
+               {
+                  xmin = math::Min<double>(xmin, vX[k]);
+                  ymin = math::Min<double>(ymin, vY[k]);
+                  zmin = math::Min<double>(zmin, vBatch[k].elevation);
+                  xmax = math::Max<double>(xmax, vX[k]);
+                  ymax = math::Max<double>(ymax, vY[k]);
+                  zmax = math::Max<double>(zmax, vBatch[k].elevation);
+               }
+
+               numpts += n;
             }
          }
       }
@@ -35,6 +35,7 @@
 #include "geo/ElevationLayerSettings.h"
 #include "geo/PointLayerSettings.h"
 #include "io/FileSystem.h"
+#include "io/TileStore.h"
 #include "app/Logger.h"
 #include <iostream>
 #include <boost/program_options.hpp>
@@ -44,11 +45,11 @@
 //-----------------------------------------------------------------------------
 
 int _start(int argc, char *argv[], boost::shared_ptr<Logger> qLogger, const std::string& processpath);
-int _createimagelayer(const std::string& sLayerName,  const std::string& sLayerPath, int nLod, const std::vector<int64>& vecExtent, boost::shared_ptr<Logger> qLogger, bool temp = false);
+int _createimagelayer(const std::string& sLayerName,  const std::string& sLayerPath, int nLod, const std::vector<int64>& vecExtent, boost::shared_ptr<Logger> qLogger, bool temp = false, const std::string& sTileStore = "directory", bool bOccupancy = false);
 int _createelevationlayer(const std::string& sLayerName,  const std::string& sLayerPath, int nLod, const std::vector<int64>& vecExtent, boost::shared_ptr<Logger> qLogger);
 int _createpointlayer(const std::string& sLayerName,  const std::string& sLayerPath, int nLod, const std::vector<double>& vecBoundary, boost::shared_ptr<Logger> qLogger);
 int _createmapniklayer(const std::string& sLayerName,  const std::string& sLayerPath, const std::vector<double>& vecBoundary, boost::shared_ptr<Logger> qLogger);
-int _createDirectoriesXY( const std::string& sLayerPath, boost::shared_ptr<Logger> qLogger, const std::vector<int64>& vecExtent, int nLod, bool bTemp); 
+int _createDirectoriesXY( const std::string& sLayerPath, boost::shared_ptr<Logger> qLogger, const std::vector<int64>& vecExtent, int nLod, bool bTemp, bool bColumns = true); 
 int _createDirectoriesXYZ( const std::string& sLayerPath, boost::shared_ptr<Logger> qLogger, int nLod, bool bTemp); 
 
 
@@ -122,6 +123,8 @@ int _start(int argc, char *argv[], boost::shared_ptr<Logger> qLogger, const std:
        ("force", "[optional] force creation. (Warning: if this layer already exists it will be deleted)")
        ("numthreads", po::value<int>(), "[optional] force number of threads")
        ("type",  po::value<std::string>(), "[optional] layer type. This can be image, elevation, poi, point, geometry. image is default value.")
+       ("tilestore",  po::value<std::string>(), "[optional] tile store of image layers: directory (one file per tile, default) or pack (pack files per block of tiles)")
+       ("occupancy", "[optional] image layers: record empty and single colour tiles in an occupancy index instead of writing them")
        ;
 
    po::variables_map vm;
@@ -145,6 +148,8 @@ int _start(int argc, char *argv[], boost::shared_ptr<Logger> qLogger, const std:
    std::vector<double> vecBoundary;
    bool bForce = false;
    ELayerType eLayer = IMAGE_LAYER;
+   std::string sTileStore = "directory";
+   bool bOccupancy = false;
 
    
    if (!vm.count("name"))
@@ -243,6 +248,21 @@ int _start(int argc, char *argv[], boost::shared_ptr<Logger> qLogger, const std:
        qLogger->Warn("It is highly recommended to use --type! Using default --type image");
    }
 
+   if (vm.count("tilestore"))
+   {
+      sTileStore = vm["tilestore"].as<std::string>();
+      if (!ITileStore::Create(sTileStore, "", ""))
+      {
+         qLogger->Error("unknown tile store: " + sTileStore);
+         bError = true;
+      }
+   }
+
+   if (vm.count("occupancy"))
+   {
+      bOccupancy = true;
+   }
+
    if (eLayer == POINT_LAYER)
    {
       if (vecBoundary.size() != 6 )
@@ -298,11 +318,11 @@ int _start(int argc, char *argv[], boost::shared_ptr<Logger> qLogger, const std:
 
    if (eLayer == IMAGE_LAYER)
    {
-      return _createimagelayer(sLayerName, sLayerPath, nLod, vecExtent, qLogger, false);
+      return _createimagelayer(sLayerName, sLayerPath, nLod, vecExtent, qLogger, false, sTileStore, bOccupancy);
    }
    if (eLayer == IMAGE_POSTPROCESSING_LAYER)
    {
-      return _createimagelayer(sLayerName, sLayerPath, nLod, vecExtent, qLogger, true);
+      return _createimagelayer(sLayerName, sLayerPath, nLod, vecExtent, qLogger, true, sTileStore, bOccupancy);
    }
    if (eLayer == MAPNIK_LAYER)
    {
@@ -325,7 +345,7 @@ int _start(int argc, char *argv[], boost::shared_ptr<Logger> qLogger, const std:
 
 //------------------------------------------------------------------------------
 
-int _createimagelayer(const std::string& sLayerName, const std::string& sLayerPath, int nLod, const std::vector<int64>& vecExtent, boost::shared_ptr<Logger> qLogger, bool temp)
+int _createimagelayer(const std::string& sLayerName, const std::string& sLayerPath, int nLod, const std::vector<int64>& vecExtent, boost::shared_ptr<Logger> qLogger, bool temp, const std::string& sTileStore, bool bOccupancy)
 {
    if (!FileSystem::makedir(sLayerPath))
    {
@@ -339,6 +359,8 @@ int _createimagelayer(const std::string& sLayerName, const std::string& sLayerPa
    qImageLayerSettings->SetLayerName(sLayerName);
    qImageLayerSettings->SetMaxLod(nLod);
    qImageLayerSettings->SetTileExtent(vecExtent[0], vecExtent[1], vecExtent[2], vecExtent[3]);
+   qImageLayerSettings->SetTileStore(sTileStore);
+   qImageLayerSettings->SetOccupancyIndex(bOccupancy);
 
    if (!qImageLayerSettings->Save(sLayerPath))
    {
@@ -346,7 +368,10 @@ int _createimagelayer(const std::string& sLayerName, const std::string& sLayerPa
       return ERROR_WRITE_PERMISSION;
    }
 
-   return _createDirectoriesXY(sLayerPath, qLogger, vecExtent, nLod, temp);
+   // pack files are stored in the directory of the level of detail
+   bool bColumns = ITileStore::Create(sTileStore, "", "")->NeedsColumnDirectories();
+
+   return _createDirectoriesXY(sLayerPath, qLogger, vecExtent, nLod, temp, bColumns);
 }
 
 //------------------------------------------------------------------------------
@@ -429,7 +454,7 @@ int _createmapniklayer(const std::string& sLayerName,  const std::string& sLayer
 
 //------------------------------------------------------------------------------
 
-int _createDirectoriesXY( const std::string& sLayerPath, boost::shared_ptr<Logger> qLogger, const std::vector<int64>& vecExtent, int nLod, bool bTemp) 
+int _createDirectoriesXY( const std::string& sLayerPath, boost::shared_ptr<Logger> qLogger, const std::vector<int64>& vecExtent, int nLod, bool bTemp, bool bColumns) 
 {
    // Create Quadtree (default constructor represents WebMercator: EPSG 3857)
    boost::shared_ptr<MercatorQuadtree> qQuadtree = boost::shared_ptr<MercatorQuadtree>(new MercatorQuadtree());
@@ -488,6 +513,11 @@ int _createDirectoriesXY( const std::string& sLayerPath, boost::shared_ptr<Logge
          FileSystem::makedir(oss1_tmp.str());
       }
 
+      if (!bColumns)
+      {
+         continue;
+      }
+
       // Creating directories in parallel speeds up the whole thing!
 
 #     pragma omp parallel for
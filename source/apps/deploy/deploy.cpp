@@ -20,7 +20,10 @@
 #include "ogprocess.h"
 #include "geo/ImageLayerSettings.h"
 #include "geo/ElevationLayerSettings.h"
+#include "geo/ElevationTile.h"
 #include "io/FileSystem.h"
+#include "io/TileStore.h"
+#include "io/TileOccupancy.h"
 #include "string/FilenameUtils.h"
 #include "string/StringUtils.h"
 #include "image/ImageLoader.h"
@@ -30,6 +33,7 @@
 #include <sstream>
 #include <ctime>
 #include <fstream>
+#include <map>
 #include <omp.h>
 
 namespace Deploy
@@ -40,6 +44,7 @@ namespace Deploy
       std::string    sFileName;  // filename of archive
       std::ofstream* pFileout;
       TarWriter*     pTarWriter; // the writer
+      std::map<unsigned int, std::vector<unsigned char> > mapUniform;  // encoded uniform tiles (key: pixel value)
    };
    //---------------------------------------------------------------------------
 
@@ -82,6 +87,48 @@ namespace Deploy
 
    //---------------------------------------------------------------------------
 
+   // Encode uniform tile with the specified rgba pixel value. The result is cached per thread.
+   const std::vector<unsigned char>& EncodeUniformTile(ThreadInfo& info, unsigned int value, EOuputImageFormat imageformat, int quality)
+   {
+      std::map<unsigned int, std::vector<unsigned char> >::iterator it = info.mapUniform.find(value);
+      if (it != info.mapUniform.end())
+      {
+         return it->second;
+      }
+
+      const int tilesize = 256;
+      std::vector<unsigned char>& vData = info.mapUniform[value];
+      std::vector<unsigned char> vTile(4*tilesize*tilesize);
+      TileOccupancy::Fill(&vTile[0], tilesize*tilesize, value);
+
+      if (imageformat == OUTFORMAT_PNG)
+      {
+         ImageWriter::EncodePNG(&vTile[0], tilesize, tilesize, vData);
+      }
+      else if (imageformat == OUTFORMAT_JPG)
+      {
+         // jpeg doesn't support alpha.
+         std::vector<unsigned char> vRGB(3*tilesize*tilesize);
+         for (int i=0;i<tilesize*tilesize;i++)
+         {
+            vRGB[3*i+0] = vTile[4*i+0];
+            vRGB[3*i+1] = vTile[4*i+1];
+            vRGB[3*i+2] = vTile[4*i+2];
+         }
+
+         boost::shared_array<unsigned char> outjpg;
+         int len;
+         if (JPEGHandler::RGBToJpeg(&vRGB[0], tilesize, tilesize, quality, outjpg, len))
+         {
+            vData.assign(outjpg.get(), outjpg.get() + len);
+         }
+      }
+
+      return vData;
+   }
+
+   //---------------------------------------------------------------------------
+
    void DeployImageLayer(boost::shared_ptr<Logger> qLogger, boost::shared_ptr<ProcessingSettings> qSettings, const std::string& sLayer, const std::string& sPath, bool bArchive, EOuputImageFormat imageformat, int quality)
    {
       std::ostringstream oss;
@@ -100,6 +147,13 @@ namespace Deploy
       qImageLayerSettings->GetTileExtent(tx0,ty0,tx1,ty1);
       int maxlod = qImageLayerSettings->GetMaxLod();
 
+      boost::shared_ptr<ITileStore> qTileStore = ITileStore::Create(qImageLayerSettings->GetTileStore(), sTileDir, ".png");
+      if (!qTileStore)
+      {
+         qLogger->Error("Unknown tile store: " + qImageLayerSettings->GetTileStore());
+         return;
+      }
+
       oss << "tile extent: " << tx0 << ", " << ty0 << ", " << tx1  << ", " << ty1 << "\n";
       qLogger->Info(oss.str());
       oss.str("");
@@ -126,6 +180,14 @@ namespace Deploy
          qQuadtree->QuadKeyToTileCoord(qc0, tx0, ty0, tmp_lod);
          qQuadtree->QuadKeyToTileCoord(qc1, tx1, ty1, tmp_lod);
 
+         // empty and uniform tiles are only recorded in the occupancy index
+         boost::shared_ptr<TileOccupancy> qOccupancy;
+         if (qImageLayerSettings->GetOccupancyIndex())
+         {
+            qOccupancy = boost::shared_ptr<TileOccupancy>(new TileOccupancy(sTileDir, nLevelOfDetail));
+            qOccupancy->Load();
+         }
+
 #     pragma omp parallel for
          for (int64 y=ty0;y<=ty1;y++)
          {
@@ -142,26 +204,43 @@ namespace Deploy
                      pThreadInfo[i].pTarWriter = new TarWriter(*pThreadInfo[i].pFileout);
                   }
 
-                  if (imageformat == OUTFORMAT_PNG)
+                  TileOccupancy::ETileState eState = TileOccupancy::TILE_DATA;
+                  unsigned int value = 0;
+                  if (qOccupancy)
+                  {
+                     eState = qOccupancy->GetState(x, y, &value);
+                  }
+
+                  if (eState == TileOccupancy::TILE_UNIFORM)
+                  {
+                     std::string sArchiveTile = ProcessingUtils::GetTilePath("tiles/", imageformat == OUTFORMAT_JPG ? ".jpg" : ".png", nLevelOfDetail, x, y);
+                     const std::vector<unsigned char>& vData = EncodeUniformTile(pThreadInfo[i], value, imageformat, quality);
+
+                     if (vData.size()>0)
+                     {
+                        pThreadInfo[i].pTarWriter->AddData(sArchiveTile.c_str(), (char*)&vData[0], vData.size());
+                     }
+                  }
+                  else if (eState == TileOccupancy::TILE_DATA && imageformat == OUTFORMAT_PNG)
                   {
-                     std::string sOrigTile = ProcessingUtils::GetTilePath(sTileDir, ".png" , nLevelOfDetail, x, y);
                      std::string sArchiveTile = ProcessingUtils::GetTilePath("tiles/", ".png" , nLevelOfDetail, x, y);
+                     std::vector<unsigned char> vData;
 
-                     if (FileSystem::FileExists(sOrigTile))
+                     if (qTileStore->Read(nLevelOfDetail, x, y, vData) && vData.size()>0)
                      {
-                        pThreadInfo[i].pTarWriter->AddFile(sOrigTile.c_str(), sArchiveTile.c_str());
+                        pThreadInfo[i].pTarWriter->AddData(sArchiveTile.c_str(), (char*)&vData[0], vData.size());
                      }
                   }
-                  else if (imageformat == OUTFORMAT_JPG)
+                  else if (eState == TileOccupancy::TILE_DATA && imageformat == OUTFORMAT_JPG)
                   {
-                     std::string sOrigTile = ProcessingUtils::GetTilePath(sTileDir, ".png" , nLevelOfDetail, x, y);
                      std::string sArchiveTile = ProcessingUtils::GetTilePath("tiles/", ".jpg" , nLevelOfDetail, x, y);
+                     std::vector<unsigned char> vData;
 
-                     if (FileSystem::FileExists(sOrigTile))
+                     if (qTileStore->Read(nLevelOfDetail, x, y, vData) && vData.size()>0)
                      {
                         ImageObject img;
                         // load as RGB as jpeg doesn't support alpha.
-                        if (ImageLoader::LoadFromDisk(Img::Format_PNG, sOrigTile, Img::PixelFormat_RGB, img))
+                        if (ImageLoader::LoadFromMemory(Img::Format_PNG, &vData[0], (unsigned int)vData.size(), Img::PixelFormat_RGB, img))
                         {
                            boost::shared_array<unsigned char> outjpg;
                            int len;
@@ -207,7 +286,120 @@ namespace Deploy
 
    void DeployElevationLayer(boost::shared_ptr<Logger> qLogger, boost::shared_ptr<ProcessingSettings> qSettings, const std::string& sLayer, const std::string& sPath, bool bArchive, EOutputElevationFormat elevationformat)
    {
+      std::ostringstream oss;
+
+      std::string sElevationLayerDir = FilenameUtils::DelimitPath(qSettings->GetPath()) + sLayer;
+      std::string sTempTileDir = FilenameUtils::DelimitPath(FilenameUtils::DelimitPath(sElevationLayerDir) + "temp/tiles");
+
+      boost::shared_ptr<ElevationLayerSettings> qElevationLayerSettings = ElevationLayerSettings::Load(sElevationLayerDir);
+      if (!qElevationLayerSettings)
+      {
+         qLogger->Error("Failed retrieving elevation layer settings!");
+         return;
+      }
+
+      int64 tx0,ty0,tx1,ty1;
+      qElevationLayerSettings->GetTileExtent(tx0,ty0,tx1,ty1);
+      int maxlod = qElevationLayerSettings->GetMaxLod();
+
+      // tiles are encoded from the intermediate (.tri) tiles, so any format can be deployed.
+      std::string sFormat = (elevationformat == OUTFORMAT_BINARY) ? "binary" : "json";
+      std::string sExtension = ElevationTile::GetFileExtension(sFormat);
+
+      oss << "tile extent: " << tx0 << ", " << ty0 << ", " << tx1  << ", " << ty1 << "\n";
+      qLogger->Info(oss.str());
+      oss.str("");
+
+      ThreadInfo* pThreadInfo = GenerateThreadInfo(); 
+
+      clock_t t0,t1;
+      t0 = clock();
+
+      boost::shared_ptr<MercatorQuadtree> qQuadtree = boost::shared_ptr<MercatorQuadtree>(new MercatorQuadtree());
+      std::string qc0 = qQuadtree->TileCoordToQuadkey(tx0, ty0, maxlod);
+      std::string qc1 = qQuadtree->TileCoordToQuadkey(tx1, ty1, maxlod);
+
+      for (int nLevelOfDetail = maxlod; nLevelOfDetail>0; nLevelOfDetail--)
+      {
+         std::ostringstream oss;
+         oss << "Deploying Level of Detail " << nLevelOfDetail;
+         qLogger->Info(oss.str());
+
+         qc0 = StringUtils::Left(qc0, nLevelOfDetail);
+         qc1 = StringUtils::Left(qc1, nLevelOfDetail);
+
+         int tmp_lod;
+         qQuadtree->QuadKeyToTileCoord(qc0, tx0, ty0, tmp_lod);
+         qQuadtree->QuadKeyToTileCoord(qc1, tx1, ty1, tmp_lod);
 
+#     pragma omp parallel for
+         for (int64 y=ty0;y<=ty1;y++)
+         {
+            for (int64 x=tx0;x<=tx1;x++)
+            {
+               if (bArchive)
+               {
+                  int i = omp_get_thread_num();
+                  if (pThreadInfo[i].pTarWriter == 0)
+                  {
+                     std::string sFilename = FilenameUtils::DelimitPath(sPath) + pThreadInfo[i].sFileName;
+                     pThreadInfo[i].pFileout = new std::ofstream();
+                     pThreadInfo[i].pFileout->open(sFilename.c_str(), std::ios::binary);
+                     pThreadInfo[i].pTarWriter = new TarWriter(*pThreadInfo[i].pFileout);
+                  }
+
+                  std::string sTempTile = ProcessingUtils::GetTilePath(sTempTileDir, ".tri", nLevelOfDetail, x, y);
+                  std::string sArchiveTile = ProcessingUtils::GetTilePath("tiles/", sExtension, nLevelOfDetail, x, y);
+
+                  double x0,y0,x1,y1;
+                  std::string qc = qQuadtree->TileCoordToQuadkey(x, y, nLevelOfDetail);
+                  qQuadtree->QuadKeyToMercatorCoord(qc, x0, y1, x1, y0);
+
+                  ElevationTile oElevationTile(x0, y0, x1, y1);
+                  if (oElevationTile.ReadBinary(sTempTile))
+                  {
+                     if (elevationformat == OUTFORMAT_BINARY)
+                     {
+                        std::vector<unsigned char> vData;
+                        oElevationTile.CreateBinary(vData);
+                        if (vData.size()>0)
+                        {
+                           pThreadInfo[i].pTarWriter->AddData(sArchiveTile.c_str(), (char*)&vData[0], vData.size());
+                        }
+                     }
+                     else
+                     {
+                        std::string datastr = oElevationTile.CreateJSON();
+                        pThreadInfo[i].pTarWriter->AddData(sArchiveTile.c_str(), (char*)datastr.c_str(), datastr.size());
+                     }
+                  }
+               }
+               else
+               {
+                  //
+               }
+            }
+         }
+      }
+
+      // close all streams:
+
+      for (int i=0;i<omp_get_max_threads();i++)
+      {
+         if (pThreadInfo[i].pTarWriter)
+         {
+            pThreadInfo[i].pTarWriter->Finalize();
+            pThreadInfo[i].pFileout->close();
+            delete pThreadInfo[i].pFileout;
+         }
+      }
+
+      DestroyThreadInfo(pThreadInfo);
+
+      t1=clock();
+      oss << "calculated in: " << double(t1-t0)/double(CLOCKS_PER_SEC) << " s \n";
+      qLogger->Info(oss.str());
+      oss.str("");
    }
 
 
@@ -43,6 +43,7 @@ enum EOuputImageFormat
 enum EOutputElevationFormat
 {
    OUTFORMAT_JSON,
+   OUTFORMAT_BINARY,
 };
 
 namespace Deploy
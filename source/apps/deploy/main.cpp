@@ -43,7 +43,7 @@ int main(int argc, char *argv[])
       ("outpath", po::value<std::string>(), "where to write the data (path must exist!)")
       ("type", po::value<std::string>(), "[optional] image (default) or elevation.")
       ("archive", "[optional] create deployment in tar archive. (One archive per thread)")
-      ("format", po::value<std::string>(), "[optional] elevation: json (default), image: png(default)|jpg")
+      ("format", po::value<std::string>(), "[optional] elevation: json (default)|binary, image: png(default)|jpg")
       ("quality", po::value<int>(), "[optional] jpeg image quality in the range 0-100 (0 is worst quality and 100 is best).")
       ("numthreads", po::value<int>(), "[optional] force number of threads")
       ;
@@ -157,6 +157,10 @@ int main(int argc, char *argv[])
       {
          elevationformat = OUTFORMAT_JSON;
       }
+      else if (sFormat == "binary")
+      {
+         elevationformat = OUTFORMAT_BINARY;
+      }
    }
 
    //--------------------------------------------------------------------------
@@ -28,11 +28,15 @@
 #define _HILLSHADING_H
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <cstring>
 #include <string/FilenameUtils.h>
 #include <string/StringUtils.h>
 #include <image/ImageWriter.h>
 #include "geo/MercatorQuadtree.h"
 #include <io/FileSystem.h>
+#include <io/TileStore.h>
+#include <image/JPEGHandler.h>
 #include <gdal.h>
 #include <gdalgrid.h>
 #include <gdal_priv.h>
@@ -215,6 +219,66 @@ inline void*  GDALCreateHillshadeData(double* adfGeoTransform,
     return pData;
 }
 
+/************************************************************************/
+/*                  Row versions of the algorithms                      */
+/************************************************************************/
+// The following functions process n pixels of a row at once. pAbove, pRow and
+// pBelow point to the first pixel in the rows above, at and below the current
+// row, pixels at index -1 and n must be valid.
+
+// Same as GDALHillshadeZevenbergenThorneAlg. The aspect is not calculated:
+// sqrt(x*x+y*y)*sin(atan2(y,x)-az) equals y*cos(az)-x*sin(az).
+inline void GDALHillshadeZevenbergenThorneRow(const float* pAbove, const float* pRow, const float* pBelow, int n, float* pOut, const GDALHillshadeAlgData* psData)
+{
+    const double sin_az = sin(psData->azRadians);
+    const double cos_az = cos(psData->azRadians);
+    const double inv_ewres = 1.0 / psData->ewres;
+    const double inv_nsres = 1.0 / psData->nsres;
+
+    for (int i=0;i<n;i++)
+    {
+        double x = (pRow[i-1]*SCALE - pRow[i+1]*SCALE) * inv_ewres;
+        double y = (pBelow[i]*SCALE - pAbove[i]*SCALE) * inv_nsres;
+
+        double cang = (psData->sin_altRadians -
+                       psData->cos_altRadians_mul_z_scale_factor * (y*cos_az - x*sin_az)) /
+                       sqrt(1 + psData->square_z_scale_factor * (x*x + y*y));
+
+        pOut[i] = (float)(cang <= 0.0 ? 1.0 : 1.0 + 254.0 * cang);
+    }
+}
+
+// Same as GDALSlopeHornAlg (percent mode)
+inline void GDALSlopeHornRow(const float* pAbove, const float* pRow, const float* pBelow, int n, float* pOut, const GDALHillshadeAlgData* psData)
+{
+    const double inv_ewres = 1.0 / psData->ewres;
+    const double inv_nsres = 1.0 / psData->nsres;
+    const double factor = 100.0 / (8*psData->slopeScale);
+
+    for (int i=0;i<n;i++)
+    {
+        double dx = ((pAbove[i-1]*SCALE + pRow[i-1]*SCALE + pRow[i-1]*SCALE + pBelow[i-1]*SCALE) -
+                     (pAbove[i+1]*SCALE + pRow[i+1]*SCALE + pRow[i+1]*SCALE + pBelow[i+1]*SCALE)) * inv_ewres;
+
+        double dy = ((pBelow[i-1]*SCALE + pBelow[i]*SCALE + pBelow[i]*SCALE + pBelow[i+1]*SCALE) -
+                     (pAbove[i-1]*SCALE + pAbove[i]*SCALE + pAbove[i]*SCALE + pAbove[i+1]*SCALE)) * inv_nsres;
+
+        pOut[i] = (float)(sqrt(dx * dx + dy * dy) * factor);
+    }
+}
+
+// Flag pixels with a nodata value in their 3x3 window
+inline void NoDataRow(const float* pAbove, const float* pRow, const float* pBelow, int n, unsigned char* pOut)
+{
+    for (int i=0;i<n;i++)
+    {
+        float m = math::Min<float>(math::Min<float>(pAbove[i-1], pAbove[i]), pAbove[i+1]);
+        m = math::Min<float>(m, math::Min<float>(math::Min<float>(pRow[i-1], pRow[i]), pRow[i+1]));
+        m = math::Min<float>(m, math::Min<float>(math::Min<float>(pBelow[i-1], pBelow[i]), pBelow[i+1]));
+        pOut[i] = m*SCALE < -1000.0f ? 1 : 0;
+    }
+}
+
 
 // ------------------------------ Hillshade generate
 
@@ -225,6 +289,183 @@ struct HSProcessChunk
    int layerLod;
 };
 //---------------------------------------------------------------------------
+// Cache of decoded raw elevation tiles (256x256 floats).
+// Neighbouring jobs share 6 of their 9 raw tiles and jobs with a level of detail
+// higher than the layer share all of them, so the most recently used tiles are
+// kept instead of reading them again. Not thread safe: use one cache per thread.
+class RawTileCache
+{
+public:
+   RawTileCache(size_t nCapacity = 32) : _nCapacity(nCapacity), _nTime(0) {}
+
+   // returns values of raw tile or 0 if tile doesn't exist.
+   const float* Get(ITileStore* pTileStore, int lod, int64 x, int64 y)
+   {
+      _nTime++;
+
+      for (size_t i=0;i<_vEntries.size();i++)
+      {
+         SEntry& entry = _vEntries[i];
+         if (entry.lod == lod && entry.x == x && entry.y == y)
+         {
+            entry.time = _nTime;
+            return entry.vValues.empty() ? 0 : &entry.vValues[0];
+         }
+      }
+
+      // replace least recently used tile
+      size_t idx = _vEntries.size();
+      if (_vEntries.size() < _nCapacity)
+      {
+         _vEntries.push_back(SEntry());
+      }
+      else
+      {
+         idx = 0;
+         for (size_t i=1;i<_vEntries.size();i++)
+         {
+            if (_vEntries[i].time < _vEntries[idx].time)
+            {
+               idx = i;
+            }
+         }
+      }
+
+      SEntry& entry = _vEntries[idx];
+      entry.lod = lod;
+      entry.x = x;
+      entry.y = y;
+      entry.time = _nTime;
+      entry.vValues.clear();
+
+      if (pTileStore->Read(lod, x, y, _vData))
+      {
+         // missing values of short tiles are nodata
+         size_t nValues = math::Min<size_t>(_vData.size() / sizeof(float), 256*256);
+         entry.vValues.resize(256*256, -9999.0f);
+         if (nValues>0)
+         {
+            memcpy(&entry.vValues[0], &_vData[0], nValues*sizeof(float));
+         }
+      }
+
+      return entry.vValues.empty() ? 0 : &entry.vValues[0];
+   }
+
+protected:
+   struct SEntry
+   {
+      int lod;
+      int64 x, y;
+      size_t time;
+      std::vector<float> vValues;   // empty if tile doesn't exist
+   };
+
+   std::vector<SEntry> _vEntries;
+   std::vector<unsigned char> _vData;   // file buffer
+   size_t _nCapacity;
+   size_t _nTime;
+};
+//---------------------------------------------------------------------------
+// copy raw elevation tile (256x256) to position posX, posY of chunk.
+inline void _CopyRawTile(HSProcessChunk& pData, int posX, int posY, const float* pValues)
+{
+   float* pChunk = pData.data.GetRawData().get();
+   int nXSize = pData.data.GetWidth();
+   for (int y=0;y<256;y++)
+   {
+      memcpy(pChunk + (posY + y)*nXSize + posX, pValues + y*256, 256*sizeof(float));
+   }
+}
+//---------------------------------------------------------------------------
+// copy raw elevation tile (256x256) from tile store to position posX, posY of chunk. Returns false if tile doesn't exist.
+inline bool _ReadRawTile(RawTileCache& cache, ITileStore* pTileStore, int lod, int64 x, int64 y, HSProcessChunk& pData, int posX, int posY)
+{
+   const float* pValues = cache.Get(pTileStore, lod, x, y);
+   if (!pValues)
+   {
+      return false;
+   }
+
+   _CopyRawTile(pData, posX, posY, pValues);
+   return true;
+}
+//---------------------------------------------------------------------------
+// set all values of a (uniform) raw tile at posX, posY
+inline void _FillRawTile(HSProcessChunk& pData, int posX, int posY, float value)
+{
+   float* pChunk = pData.data.GetRawData().get();
+   int nXSize = pData.data.GetWidth();
+   for (int y=0;y<256;y++)
+   {
+      std::fill(pChunk + (posY + y)*nXSize + posX, pChunk + (posY + y)*nXSize + posX + 256, value);
+   }
+}
+//---------------------------------------------------------------------------
+// 5x5 gauss filter of the area x0,y0 to x1,y1 (exclusive) of buffer.
+// The filter is symmetric, so pixel pairs with same distance to the center are
+// summed first in a horizontal and a vertical pass and only 9 weights remain.
+inline void _GaussFilter(const float* pSrc, int nXSize, int nYSize, int x0, int y0, int x1, int y1, float* pDst)
+{
+   // weights by horizontal/vertical distance to center:
+   //   0.0037,    0.0147,    0.0256,    0.0147,    0.0037
+   //   0.0147,    0.0586,    0.0952,    0.0586,    0.0147
+   //   0.0256,    0.0952,    0.1502,    0.0952,    0.0256
+   //   0.0147,    0.0586,    0.0952,    0.0586,    0.0147
+   //   0.0037,    0.0147,    0.0256,    0.0147,    0.0037
+   const float w00 = 0.1502f, w01 = 0.0952f, w02 = 0.0256f;
+   const float w11 = 0.0586f, w12 = 0.0147f, w22 = 0.0037f;
+
+   x0 = math::Max<int>(x0, 2);
+   y0 = math::Max<int>(y0, 2);
+   x1 = math::Min<int>(x1, nXSize-2);
+   y1 = math::Min<int>(y1, nYSize-2);
+   if (x0>=x1 || y0>=y1)
+   {
+      return;
+   }
+
+   const int w = x1-x0;
+   const int rows = y1-y0+4;
+
+   // horizontal pass: sum of pixels at distance 1 and 2 (rows y0-2 to y1+2)
+   std::vector<float> vH1(w*rows);
+   std::vector<float> vH2(w*rows);
+   for (int r=0;r<rows;r++)
+   {
+      const float* s = pSrc + (y0-2+r)*nXSize + x0;
+      float* h1 = &vH1[r*w];
+      float* h2 = &vH2[r*w];
+      for (int i=0;i<w;i++)
+      {
+         h1[i] = s[i-1] + s[i+1];
+         h2[i] = s[i-2] + s[i+2];
+      }
+   }
+
+   // vertical pass
+   for (int y=y0;y<y1;y++)
+   {
+      const float* s = pSrc + y*nXSize + x0;
+      const float* h1 = &vH1[(y-y0+2)*w];
+      const float* h2 = &vH2[(y-y0+2)*w];
+      float* d = pDst + y*nXSize + x0;
+      for (int i=0;i<w;i++)
+      {
+         float s0 = s[i];
+         float s1 = s[i-nXSize] + s[i+nXSize];
+         float s2 = s[i-2*nXSize] + s[i+2*nXSize];
+         float h10 = h1[i];
+         float h11 = h1[i-w] + h1[i+w];
+         float h12 = h1[i-2*w] + h1[i+2*w];
+         float h20 = h2[i];
+         float h21 = h2[i-w] + h2[i+w];
+         float h22 = h2[i-2*w] + h2[i+2*w];
+         d[i] = w00*s0 + w01*(s1 + h10) + w02*(s2 + h20) + w11*h11 + w12*(h12 + h21) + w22*h22;
+      }
+   }
+}
+//---------------------------------------------------------------------------
 inline void _ReadRawImageDataMem(float* buffer, int bufferwidth, int bufferheight, int x, int y, float* value)
 {
    if (x<0) x = 0;
@@ -344,7 +585,7 @@ inline void _ReadImageValueBilinear(unsigned char* buffer, int bufferwidth, int
 }
 
 
-inline void process_hillshading(std::string filepath, HSProcessChunk pData, boost::shared_ptr<MercatorQuadtree> qQuadtree, int x, int y, int zoom, double z_depth, double azimut, double altitude, double scale, double slopeScale = 1,bool generateSlope = false, bool generateNormalMap = false, int width = 256, int height = 256, bool overrideTile = true, bool lockEnabled = false, bool bNoData = false, bool bJPEG = false, bool colored = false, bool textured = false, boost::shared_array<ImageObject> textures = boost::shared_array<ImageObject>())
+inline void process_hillshading(boost::shared_ptr<ITileStore> qTileStore, HSProcessChunk pData, boost::shared_ptr<MercatorQuadtree> qQuadtree, int x, int y, int zoom, double z_depth, double azimut, double altitude, double scale, double slopeScale = 1,bool generateSlope = false, bool generateNormalMap = false, int width = 256, int height = 256, bool overrideTile = true, bool lockEnabled = false, bool bNoData = false, bool bJPEG = false, bool colored = false, bool textured = false, boost::shared_array<ImageObject> textures = boost::shared_array<ImageObject>())
 {
    int nXSize = pData.data.GetWidth();
    int nYSize = pData.data.GetHeight();
@@ -360,27 +601,8 @@ inline void process_hillshading(std::string filepath, HSProcessChunk pData, boos
    boost::shared_array<float> vInputTile;
    vInputTile = boost::shared_array<float>(new float[nXSize*nYSize]);
    // ---- Gauss filtering
-   float filter[5][5] =
-   {   {0.0037,    0.0147,    0.0256,    0.0147,    0.0037},
-       {0.0147,    0.0586,    0.0952,    0.0586,    0.0147},
-       {0.0256,    0.0952,    0.1502,    0.0952,    0.0256},
-       {0.0147,    0.0586,    0.0952,    0.0586,    0.0147},
-       {0.0037,    0.0147,    0.0256,    0.0147,    0.0037} };
-   for(size_t gx = 2; gx < nXSize-2; gx++)
-   {
-      for(size_t gy = 2; gy < nYSize-2; gy++)
-      {
-         float val = 0;
-         for(size_t fx = 0; fx < 5; fx++)
-         {
-            for(size_t fy = 0; fy < 5; fy++)
-            {
-               val += filter[fx][fy]*pData.data.GetValue(gx-2+fx,gy-2+fy);
-            }
-         }
-         vInputTile[gx+gy*nXSize] = val;
-      }
-   }
+   // only the center tile (and a small border for the 3x3 windows and interpolation) is used
+   _GaussFilter(pData.data.GetRawData().get(), nXSize, nYSize, offsetX-4, offsetY-4, 2*offsetX+4, 2*offsetY+4, vInputTile.get());
 
    // ---- HEADER OUT
    /*boost::shared_array<unsigned char> vTile1;
@@ -411,15 +633,9 @@ inline void process_hillshading(std::string filepath, HSProcessChunk pData, boos
    // create new tile memory and clear to fully transparent
    boost::shared_array<unsigned char> vTile;
    boost::shared_array<unsigned char> vPatternTile;
-   std::stringstream tilepath;
-   tilepath << filepath << zoom;
-   if(!FileSystem::DirExists(tilepath.str()))
-      FileSystem::makedir(tilepath.str());
-   tilepath << "/" << x;
-   if(!FileSystem::DirExists(tilepath.str()))
-      FileSystem::makedir(tilepath.str());
-   tilepath << "/" << y << (bJPEG ? ".jpg" : ".png");
-   std::string bla = tilepath.str();
+   // levels of detail below the layer are not created by createlayer
+   std::string sTilename = qTileStore->GetTileName(zoom, x, y);
+   FileSystem::makeallsubdirs(sTilename);
    vTile = boost::shared_array<unsigned char>(new unsigned char[width*height*4]);
    memset(vTile.get(),0,width*height*4);
    vPatternTile = boost::shared_array<unsigned char>(new unsigned char[width*height*4]);
@@ -427,7 +643,7 @@ inline void process_hillshading(std::string filepath, HSProcessChunk pData, boos
    unsigned char* pTile = vTile.get();
    unsigned char* pPatternTile = vPatternTile.get();
 
-   if(!overrideTile && FileSystem::FileExists(tilepath.str()))
+   if(!overrideTile && qTileStore->Exists(zoom, x, y))
    {
       return;
    }
@@ -447,68 +663,74 @@ inline void process_hillshading(std::string filepath, HSProcessChunk pData, boos
       x0+=-parentX*256+offsetX+1;y0+=-parentY*256+offsetY;x1+=-parentX*256+offsetX+1;y1+=-parentY*256+offsetY;
       double deltaX = (x1-x0)/256.0;
       double deltaY = (y1-y0)/256.0;
+      // the hillshading parameters are the same for all pixels of the tile
+      double  adfGeoTransform[6];
+      adfGeoTransform[0] = pData.dfXMin;                                             // top left x 
+      adfGeoTransform[1] = fabs((pData.dfXMax*MERC) -(pData.dfXMin*MERC)) / pData.data.GetWidth();  //w-e pixel resolution 
+      adfGeoTransform[2] = 0;                                                        // rotation, 0 if image is "north up" 
+      adfGeoTransform[3] = pData.dfYMax;                                              // top left y 
+      adfGeoTransform[4] = 0;                                                         // rotation, 0 if image is "north up" 
+      adfGeoTransform[5] = -fabs((pData.dfYMax*MERC) -(pData.dfYMin*MERC)) / pData.data.GetHeight();// n-s pixel resolution 
+      GDALHillshadeAlgData* pCalcObj = (GDALHillshadeAlgData*)GDALCreateHillshadeData(adfGeoTransform, dem_z,dem_scale,dem_altitude, dem_azimut, slopeScale,1,width);
+
+      // hillshading, slope and nodata flags are calculated for a whole row at once
+      const int nRowLength = offsetX; // dx = offsetX ... 2*offsetX-1
+      std::vector<float> vShade(nRowLength);
+      std::vector<float> vSlope(nRowLength);
+      std::vector<unsigned char> vNoData(nRowLength);
+
       // --->
-      for(size_t dx = offsetX; dx < (2*offsetX); dx++)
+      for(size_t dy = offsetY; dy < (2*offsetY);dy++)
       {
-         for(size_t dy = offsetY; dy < (2*offsetY);dy++)
+         const float* pAbove = vInputTile.get() + offsetX + (dy-1)*nXSize;
+         const float* pRow = vInputTile.get() + offsetX + dy*nXSize;
+         const float* pBelow = vInputTile.get() + offsetX + (dy+1)*nXSize;
+
+         NoDataRow(pAbove, pRow, pBelow, nRowLength, &vNoData[0]);
+         if (!generateNormalMap)
          {
-			   int ddx = dx;
-			   int ddy = dy;
-            float afWin[9];
-            float ifWin[9];
-            //      0 1 2
-            //      3 4 5
-            //      6 7 8 
-            
-            afWin[0] = vInputTile[(ddx-1)+(ddy-1)*nXSize]*SCALE;  ifWin[0] = afWin[0];
-            afWin[1] = vInputTile[(ddx)+(ddy-1)*nXSize]*SCALE;    ifWin[1] = afWin[1];
-            afWin[2] = vInputTile[(ddx+1)+(ddy-1)*nXSize]*SCALE;  ifWin[2] = afWin[2];
-            afWin[3] = vInputTile[(ddx-1)+(ddy)*nXSize]*SCALE;    ifWin[3] = afWin[3];
-            // Hotspot
-            afWin[4] = vInputTile[(ddx)+(ddy)*nXSize]*SCALE;      ifWin[4] = afWin[4];
-            // -
-            afWin[5] = vInputTile[(ddx+1)+(ddy)*nXSize]*SCALE;    ifWin[5] = afWin[5];
-            afWin[6] = vInputTile[(ddx-1)+(ddy+1)*nXSize]*SCALE;  ifWin[6] = afWin[6];
-            afWin[7] = vInputTile[(ddx)+(ddy+1)*nXSize]*SCALE;    ifWin[7] = afWin[7];
-            afWin[8] = vInputTile[(ddx+1)+(ddy+1)*nXSize]*SCALE;  ifWin[8] = afWin[8];
-            if(zoom  > pData.layerLod)
+            GDALHillshadeZevenbergenThorneRow(pAbove, pRow, pBelow, nRowLength, &vShade[0], pCalcObj);
+            if (generateSlope)
             {
-               float v0,v1,v2,v3,v4,v5,v6,v7,v8;
-               double posX =  x0+(ddx-offsetX)*deltaX;
-               double posY =  y0+(ddy-offsetY)*deltaY;
-               _ReadRawImageValueBilinear(vInputTile.get(),nXSize,nYSize,posX-deltaX,posY-deltaY,&v0);
-               _ReadRawImageValueBilinear(vInputTile.get(),nXSize,nYSize,posX,posY-deltaY,&v1);
-               _ReadRawImageValueBilinear(vInputTile.get(),nXSize,nYSize,posX+deltaX,posY-deltaY,&v2);
-               _ReadRawImageValueBilinear(vInputTile.get(),nXSize,nYSize,posX-deltaX,posY,&v3);
-
-               _ReadRawImageValueBilinear(vInputTile.get(),nXSize,nYSize,posX,posY,&v4);
-
-               _ReadRawImageValueBilinear(vInputTile.get(),nXSize,nYSize,posX+deltaX,posY,&v5);
-               _ReadRawImageValueBilinear(vInputTile.get(),nXSize,nYSize,posX-deltaX,posY+deltaY,&v6);
-               _ReadRawImageValueBilinear(vInputTile.get(),nXSize,nYSize,posX,posY+deltaY,&v7);
-               _ReadRawImageValueBilinear(vInputTile.get(),nXSize,nYSize,posX+deltaX,posY+deltaY,&v8);
-               ifWin[0] = v0*SCALE;ifWin[1] = v1*SCALE;ifWin[2] = v2*SCALE;
-               ifWin[3] = v3*SCALE;ifWin[4] = v4*SCALE;ifWin[5] = v5*SCALE;
-               ifWin[6] = v6*SCALE;ifWin[7] = v7*SCALE;ifWin[8] = v8*SCALE;
+               GDALSlopeHornRow(pAbove, pRow, pBelow, nRowLength, &vSlope[0], pCalcObj);
             }
-            bool foundNData = false;
-            // found no data value
-            /*if( afWin[4] < -9000.0 && !bNoData)
-            {
-               foundNData = true;
-            }*/
-            for(size_t i = 0; i < 9; i++)
+         }
+
+         for(size_t dx = offsetX; dx < (2*offsetX); dx++)
+         {
+			   int ddx = dx;
+			   int ddy = dy;
+            size_t i = dx-offsetX;
+            bool foundNData = (vNoData[i] != 0) && !bNoData;
+
+            // height of pixel (only used for coloring)
+            float fHeight = 0;
+            if (colored || textured)
             {
-                  if(afWin[i] < -1000.0f && !bNoData)
-                  {
-                     foundNData = true;
-                     break;
-                  }
+               if(zoom  > pData.layerLod)
+               {
+                  double posX =  x0+(ddx-offsetX)*deltaX;
+                  double posY =  y0+(ddy-offsetY)*deltaY;
+                  _ReadRawImageValueBilinear(vInputTile.get(),nXSize,nYSize,posX,posY,&fHeight);
+               }
+               else
+               {
+                  fHeight = vInputTile[(ddx)+(ddy)*nXSize];
+               }
+               fHeight *= SCALE;
             }
             
             if(generateNormalMap)
             {
                // Write FILE
+               //      0 1 2
+               //      3 4 5
+               //      6 7 8 
+               float afWin[9];
+               afWin[0] = pAbove[i-1]*SCALE; afWin[1] = pAbove[i]*SCALE; afWin[2] = pAbove[i+1]*SCALE;
+               afWin[3] = pRow[i-1]*SCALE;   afWin[4] = pRow[i]*SCALE;   afWin[5] = pRow[i+1]*SCALE;
+               afWin[6] = pBelow[i-1]*SCALE; afWin[7] = pBelow[i]*SCALE; afWin[8] = pBelow[i+1]*SCALE;
+
                size_t adr=4*(dy-offsetY)*width+4*(dx-offsetX);
                vec3<float> value = SobleOperator(afWin, dem_z);
                if (pTile[adr+3] == 0)
@@ -521,21 +743,13 @@ inline void process_hillshading(std::string filepath, HSProcessChunk pData, boos
             }
             else
             {
-               double  adfGeoTransform[6];
-               adfGeoTransform[0] = pData.dfXMin;                                             // top left x 
-               adfGeoTransform[1] = fabs((pData.dfXMax*MERC) -(pData.dfXMin*MERC)) / pData.data.GetWidth();  //w-e pixel resolution 
-               adfGeoTransform[2] = 0;                                                        // rotation, 0 if image is "north up" 
-               adfGeoTransform[3] = pData.dfYMax;                                              // top left y 
-               adfGeoTransform[4] = 0;                                                         // rotation, 0 if image is "north up" 
-               adfGeoTransform[5] = -fabs((pData.dfYMax*MERC) -(pData.dfYMin*MERC)) / pData.data.GetHeight();// n-s pixel resolution 
 			      double slopeValue = 0.0;
 
-               GDALHillshadeAlgData* pCalcObj = (GDALHillshadeAlgData*)GDALCreateHillshadeData(adfGeoTransform, dem_z,dem_scale,dem_altitude, dem_azimut, slopeScale,1,width);
                float value= 0;
                if(generateSlope)
                {
-                  value = GDALSlopeHornAlg(afWin,0,pCalcObj);
-                  float hValue = GDALHillshadeZevenbergenThorneAlg(afWin,-9999.0,pCalcObj);
+                  value = vSlope[i];
+                  float hValue = vShade[i];
 				      slopeValue=value/255;
                   value = (255-value)*0.8;
                   if(hValue < 180)
@@ -557,14 +771,14 @@ inline void process_hillshading(std::string filepath, HSProcessChunk pData, boos
                }
                else
                {
-                  value = GDALHillshadeZevenbergenThorneAlg(afWin,-9999.0,pCalcObj);// GDALHillshadeAlg(afWin,0,pCalcObj);
+                  value = vShade[i];
                }
                // Write PNG
                size_t adr=4*(dy-offsetY)*width+4*(dx-offsetX);
                unsigned char scaledValue = (unsigned char)value; //(pData.data.GetValue(dx,dy)/500)*255; //math::Floor(value); 
 			      if(colored)
 			      {
-				      double scaledHeight = ifWin[4];
+				      double scaledHeight = fHeight;
 				      // COLORED
 				      Color::hsv colHSV;
 				      if(scaledHeight < 400)
@@ -604,7 +818,7 @@ inline void process_hillshading(std::string filepath, HSProcessChunk pData, boos
                    ImageObject desert = textures[4];
                    ImageObject water = textures[5];
 				      // TEXTURED
-				      double scaledHeight = ifWin[4];
+				      double scaledHeight = fHeight;
 				      Color::rgb colRGB;
 				  int step1 = 200;
 				  int step2 = 600;
@@ -719,10 +933,11 @@ inline void process_hillshading(std::string filepath, HSProcessChunk pData, boos
 					   pTile[adr+2] = foundNData ? 0 : scaledValue; 
 					   pTile[adr+3] = foundNData ? 0 : 255;
 				   }
-               CPLFree(pCalcObj);
             }
          }
       }
+      CPLFree(pCalcObj);
+
       // scale up if necessary
       unsigned char * pTempTile = vTile.get();
       boost::shared_array<unsigned char> vInterpolatedTile;
@@ -766,45 +981,32 @@ inline void process_hillshading(std::string filepath, HSProcessChunk pData, boos
       }
 
       // OUTPUT
-      if(lockEnabled)
+      std::vector<unsigned char> vData;
+      bool bEncoded;
+      if(bJPEG)
       {
-         int lockhandle = FileSystem::Lock(tilepath.str());
-         ImageWriter::WritePNG(tilepath.str(), pTempTile, width, height);
-         if(bJPEG)
-         {
-            ImageObject img;
-            img.AllocateImage(width,height, Img::PixelFormat_RGB);
-            img.FillFromRGBA(pTempTile);
-            bool success = ImageWriter::WriteJPG(tilepath.str() , img, 78);
-            if(!success)
-            {
-               std::cout << tilepath.str() << " couldn't be written!\n";
-            }
-         }
-         else
+         ImageObject img;
+         img.AllocateImage(width,height, Img::PixelFormat_RGB);
+         img.FillFromRGBA(pTempTile);
+         boost::shared_array<unsigned char> outjpg;
+         int len;
+         bEncoded = JPEGHandler::RGBToJpeg(img.GetRawData().get(), width, height, 78, outjpg, len);
+         if (bEncoded)
          {
-            ImageWriter::WritePNG(tilepath.str(), pTempTile, width, height);
+            vData.assign(outjpg.get(), outjpg.get()+len);
          }
-         FileSystem::Unlock(tilepath.str(), lockhandle);
       }
       else
       {
-          if(bJPEG)
-         {
-            ImageObject img;
-            img.AllocateImage(width,height, Img::PixelFormat_RGB);
-            img.FillFromRGBA(pTempTile);
-            bool success = ImageWriter::WriteJPG(tilepath.str() , img, 78);
-            if(!success)
-            {
-               std::cout << tilepath.str() << " couldn't be written!\n";
-            }
-         }
-         else
-         {
-            ImageWriter::WritePNG(tilepath.str(), pTempTile, width, height);
-         }
+         bEncoded = ImageWriter::EncodePNG(pTempTile, width, height, vData);
+      }
+
+      int lockhandle = lockEnabled ? FileSystem::Lock(sTilename) : -1;
+      if(!bEncoded || !qTileStore->Write(zoom, x, y, &vData[0], vData.size()))
+      {
+         std::cout << sTilename << " couldn't be written!\n";
       }
+      FileSystem::Unlock(sTilename, lockhandle);
    }
 }
 
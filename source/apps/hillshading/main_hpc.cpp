@@ -31,6 +31,7 @@
 #include "string/StringUtils.h"
 #include "geo/ImageLayerSettings.h"
 #include "io/FileSystem.h"
+#include "io/TileOccupancy.h"
 #include "image/ImageLoader.h"
 #include "image/ImageWriter.h"
 #include "app/Logger.h"
@@ -38,8 +39,10 @@
 #include <iostream>
 #include <boost/program_options.hpp>
 #include <sstream>
+#include <map>
 #include <omp.h>
 #include <app/QueueManager.h>
+#include <app/SharedJobQueue.h>
 #include "hillshading.h"
 #include <math/vec3.h>
 
@@ -66,6 +69,7 @@ struct SJob
    bool bVerbose = false;
    bool bGenerateJobs = false;
    bool bOverrideQueue = false;
+   bool bSharedQueue = false;   // claim jobs from memory mapped queue (workers on one host)
    bool bOverrideTiles = true;
    bool bLockEnabled = false;
    bool bNormalMaps = false;
@@ -89,12 +93,43 @@ struct SJob
    int iY = 0;
    std::string sTempTileDir;
    std::string sTileDir;
+   boost::shared_ptr<ITileStore> qRawTileStore;   // input: raw elevation tiles
+   boost::shared_ptr<ITileStore> qTileStore;      // output: hillshading tiles
    boost::shared_ptr<MercatorQuadtree> qQuadtree;
    int64 layerTileX0, layerTileY0, layerTileX1, layerTileY1;
    QueueManager _QueueManager = QueueManager();
+   SharedJobQueue _SharedJobQueue;
    boost::shared_array<ImageObject> pTextures;
+   bool bOccupancy = false;  // layer has occupancy indices (see TileOccupancy)
+   std::map<int, boost::shared_ptr<TileOccupancy> > mapRawOccupancy;   // input: raw elevation tiles per level of detail
+   std::map<int, boost::shared_ptr<TileOccupancy> > mapOccupancy;      // output: hillshading tiles per level of detail
+   std::vector<RawTileCache> vRawTileCache;  // decoded raw elevation tiles (one cache per thread)
 // -------------------------------------------------------------------
 
+//  Occupancy index of level of detail, loaded on first use. Returns 0 if the layer has no occupancy index.
+TileOccupancy* GetOccupancy(std::map<int, boost::shared_ptr<TileOccupancy> >& mapIndex, const std::string& sDir, int lod)
+{
+   if (!bOccupancy)
+   {
+      return 0;
+   }
+
+   TileOccupancy* pOccupancy;
+   #pragma omp critical (hsoccupancy)
+   {
+      boost::shared_ptr<TileOccupancy>& qOccupancy = mapIndex[lod];
+      if (!qOccupancy)
+      {
+         qOccupancy = boost::shared_ptr<TileOccupancy>(new TileOccupancy(sDir, lod));
+         qOccupancy->Load();
+      }
+      pOccupancy = qOccupancy.get();
+   }
+   return pOccupancy;
+}
+
+//------------------------------------------------------------------------------------
+
 //  Job function (called every thread/compute node)
 void ProcessJob(const SJob& job, int layerLod)
 {
@@ -111,13 +146,28 @@ void ProcessJob(const SJob& job, int layerLod)
    int64 parentX,parentY;
    int parentLod;
    MercatorQuadtree::QuadKeyToTileCoord(sParentQuad,parentX, parentY,parentLod);
+
+   TileOccupancy* pRawOccupancy = GetOccupancy(mapRawOccupancy, sTempTileDir, parentLod);
+   TileOccupancy* pOccupancy = GetOccupancy(mapOccupancy, sTileDir, job.lod);
+
+   // all pixels of a tile without elevation data are transparent
+   if (pRawOccupancy && !bNoData && pRawOccupancy->GetState(parentX, parentY) == TileOccupancy::TILE_EMPTY)
+   {
+      // remove the tile of an earlier run, readers which don't use the index would still get it
+      if (pOccupancy->GetState(job.xx, job.yy) == TileOccupancy::TILE_DATA)
+      {
+         qTileStore->Remove(job.lod, job.xx, job.yy);
+      }
+      pOccupancy->SetState(job.xx, job.yy, TileOccupancy::TILE_EMPTY);
+      return;
+   }
+
    for (int ty=-1;ty<=1;ty++)
    {
       for (int tx=-1;tx<=1;tx++)
       {
          //std::string sQuadcode = qQuadtree->TileCoordToQuadkey(job.xx+tx,job.yy+ty,job.lod);
          std::string sQuadcode = qQuadtree->TileCoordToQuadkey(parentX+tx, parentY+ty,parentLod);
-         std::string sTilefile = ProcessingUtils::GetTilePath(sTempTileDir, ".raw" , parentLod, parentX+tx, parentY+ty);
                   
          double sx0, sy1, sx1, sy0;
          qQuadtree->QuadKeyToMercatorCoord(sQuadcode, sx0, sy1, sx1, sy0);
@@ -130,38 +180,37 @@ void ProcessJob(const SJob& job, int layerLod)
          assert(sx0 < sx1);
          assert(sy0 < sy1);
 
-         //std::cout << "   " << sTilefile << "\n";
-
-         std::ifstream fin;
-         fin.open(sTilefile.c_str(), std::ios::binary);
          int posX = (tx+1)*(inputX/3);
          int posY = (ty+1)*(inputY/3);
-         int offX = 0;
-         int offY = 0;
-         if (fin.good())
+
+         // empty tiles are already nodata, uniform tiles are not in the tile store
+         TileOccupancy::ETileState eState = TileOccupancy::TILE_DATA;
+         unsigned int value = 0;
+         if (pRawOccupancy)
          {
-            while (!fin.eof())
-            {    
-               float value;
-               fin.read((char*)&(value), sizeof(float));
-               if (!fin.eof())
-               {
-                  pData.data.SetValue(posX+offX, posY+offY, value);
-               }
-               offX++;
-               if(offX % 256 == 0)
-               {
-                  offX = 0;
-                  offY++;
-               }
+            eState = pRawOccupancy->GetState(parentX+tx, parentY+ty, &value);
+         }
 
-            }
+         if (eState == TileOccupancy::TILE_UNIFORM)
+         {
+            float fValue;
+            memcpy(&fValue, &value, sizeof(float));
+            _FillRawTile(pData, posX, posY, fValue);
+         }
+         else if (eState == TileOccupancy::TILE_DATA)
+         {
+            _ReadRawTile(vRawTileCache[omp_get_thread_num()], qRawTileStore.get(), parentLod, parentX+tx, parentY+ty, pData, posX, posY);
          }
-         fin.close();
       }
    }
    // Generate tile
-   process_hillshading(sTileDir, pData, qQuadtree, job.xx, job.yy, job.lod, z_depth, azimut, altitude,sscale,slopeScale, bSlope, bNormalMaps, outputX, outputY, bOverrideTiles, bLockEnabled, bNoData, bJPEG, bColored, bTextured, pTextures);
+   process_hillshading(qTileStore, pData, qQuadtree, job.xx, job.yy, job.lod, z_depth, azimut, altitude,sscale,slopeScale, bSlope, bNormalMaps, outputX, outputY, bOverrideTiles, bLockEnabled, bNoData, bJPEG, bColored, bTextured, pTextures);
+
+   // the tile replaces an empty or uniform tile of the index
+   if (pOccupancy && pOccupancy->GetState(job.xx, job.yy) != TileOccupancy::TILE_DATA)
+   {
+      pOccupancy->SetState(job.xx, job.yy, TileOccupancy::TILE_DATA);
+   }
 }
 
 //------------------------------------------------------------------------------------
@@ -205,12 +254,14 @@ int main(int argc, char *argv[])
       ("slopescale", po::value<double>(),"[optional] define slope scale default 1")
       ("numthreads", po::value<int>(), "[optional] force number of threads")
       ("amount", po::value<int>(), "[opional] define amount of jobs to be read for one process at the time")
+      ("sharedqueue", "[optional] fetch jobs lock-free from memory mapped queue (all processes must run on the same host)")
       ("zdepth", po::value<double>(), "[opional] hillshading z factor")
       ("azimut", po::value<double>(), "[opional] hillshading azimut")
       ("altitude", po::value<double>(), "[opional] hillshading altitude")
       ("scale", po::value<double>(), "[opional] hillshading scale")
       ("nooverride", "[opional] overriding existing tiles disabled")
       ("enablelocking", "[opional] lock files to prevent concurrency on parallel processes")
+      ("lockbackend", po::value<std::string>(), "[optional] lock backend: process, host or lockfile (default)")
       ("verbose", "[optional] verbose output")
       ("processborders", "[optional] process border tiles")
       ("nodata", "[optional] include nodata values")
@@ -261,6 +312,8 @@ int main(int argc, char *argv[])
    }
    if(vm.count("amount"))
       iAmount = vm["amount"].as<int>();
+   if(vm.count("sharedqueue"))
+      bSharedQueue = true;
    if(vm.count("zdepth"))
       z_depth = vm["zdepth"].as<double>();
    if(vm.count("azimut"))
@@ -287,6 +340,21 @@ int main(int argc, char *argv[])
       bOverrideTiles = false;
     if(vm.count("enablelocking"))
       bLockEnabled = true;
+
+   if (vm.count("lockbackend"))
+   {
+      EFileLockBackend eBackend;
+      if (IFileLock::ParseBackend(vm["lockbackend"].as<std::string>(), eBackend))
+      {
+         FileSystem::SetLockBackend(eBackend);
+      }
+      else
+      {
+         std::cout << "unknown lock backend " << vm["lockbackend"].as<std::string>() << "\n";
+         bError = true;
+      }
+   }
+
 	if(vm.count("colored"))
       bColored = true;
    if(vm.count("processborders"))
@@ -325,6 +393,15 @@ int main(int argc, char *argv[])
       return ERROR_IMAGELAYERSETTINGS;
    }
    int layermaxlod = qImageLayerSettings->GetMaxLod();
+   bOccupancy = qImageLayerSettings->GetOccupancyIndex();
+
+   qRawTileStore = ITileStore::Create(qImageLayerSettings->GetTileStore(), sTempTileDir, ".raw");
+   qTileStore = ITileStore::Create(qImageLayerSettings->GetTileStore(), sTileDir, bJPEG ? ".jpg" : ".png");
+   if (!qTileStore)
+   {
+      std::cout << "[" << sProcessHostName<< "] " << "Unknown tile store: " << qImageLayerSettings->GetTileStore() << "\n" << std::flush;
+      return ERROR_IMAGELAYERSETTINGS;
+   }
    
    qImageLayerSettings->GetTileExtent(layerTileX0, layerTileY0, layerTileX1, layerTileY1);
    if (bVerbose)
@@ -457,12 +534,16 @@ int main(int argc, char *argv[])
       }
       std::vector<SJob> vecConverted;
       std::vector<QJob> jobs;
+      vRawTileCache.resize(omp_get_max_threads());
       std::cout << "[" << sProcessHostName<< "] >>>" << "start processing...\n"<< std::flush;
       do
       {
          jobs.clear();
          vecConverted.clear();
-         jobs = _QueueManager.FetchJobList(sJobQueueFile, sizeof(SJob), iAmount,bVerbose);
+         if (bSharedQueue)
+            jobs = _SharedJobQueue.FetchJobList(sJobQueueFile, sizeof(SJob), iAmount, bVerbose);
+         else
+            jobs = _QueueManager.FetchJobList(sJobQueueFile, sizeof(SJob), iAmount,bVerbose);
          if(jobs.size() > 0)
          {
          ConvertJobs(jobs, vecConverted);
@@ -486,13 +567,27 @@ int main(int argc, char *argv[])
 #ifndef _DEBUG
                }
 #endif
+            // write occupancy records of this job list
+            std::map<int, boost::shared_ptr<TileOccupancy> >::iterator it;
+            for (it = mapOccupancy.begin(); it != mapOccupancy.end(); ++it)
+            {
+               it->second->Flush();
+            }
+            // jobs are done once their occupancy records are written
+            if (bSharedQueue)
+            {
+               for (size_t i = 0; i < jobs.size(); i++)
+               {
+                  _SharedJobQueue.CompleteJob(jobs[i]);
+               }
+            }
             subT1 = clock();
             double subTime=(double(subT1-subT0)/double(CLOCKS_PER_SEC));
             double subTps = vecConverted.size()/subTime;
             std::cout << "--[" << sProcessHostName<< "] " << "  processing average " << subTps << " tiles per second.\n";
             std::cout << "--[" << sProcessHostName<< "] " << "  processed " << vecConverted.size() << " jobs\n       terminating with (z, x, y) " << "(" << last.lod << ", " << last.xx << ", " << last.yy << ")\n"<< std::flush;
          }
-      }while(jobs.size() >= iAmount); 
+      }while(jobs.size() >= iAmount || (bSharedQueue && jobs.size() > 0));
    }
    t_1 = clock();
          double time=(double(t_1-t_0)/double(CLOCKS_PER_SEC));
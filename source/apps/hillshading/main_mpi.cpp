@@ -54,6 +54,7 @@ std::string sAlgorithm;
 int iNumThreads = 8;
 bool bVerbose = false;
 int queueSize = 4096;
+bool bRootWorker = false;   // rank 0 processes jobs too
 int inputX = 768;
 int inputY = 768;
 int outputX = 256;
@@ -221,6 +222,7 @@ int main(int argc, char *argv[])
          ("layer_zoom", po::value<int>(), "maximum zoom which has to be generated previously using ogAddData")
          ("numthreads", po::value<int>(), "[optional] force number of threads")
          ("mpi_queue_size", po::value<int>(), "[optional] mpi queue size (Default: 10000)")
+         ("mpi_rootworker", "[optional] process jobs on rank 0 too")
          ("verbose", "[optional] verbose output")
          ;
 
@@ -253,6 +255,8 @@ int main(int argc, char *argv[])
          iNumThreads = vm["num_threads"].as<int>();
       if(vm.count("mpi_queue_size"))
          queueSize = vm["mpi_queue_size"].as<int>();
+      if(vm.count("mpi_rootworker"))
+         bRootWorker = true;
       if(vm.count("verbose"))
          bVerbose = true;
 
@@ -282,6 +286,7 @@ int main(int argc, char *argv[])
    BroadcastInt(queueSize,0);
 
    MPIJobManager<SJob> jobmgr(queueSize);
+   jobmgr.SetRootWorker(bRootWorker);
 
    //---------------------------------------------------------------------------
    // -- Beginn process
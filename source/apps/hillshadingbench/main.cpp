@@ -0,0 +1,259 @@
+/*******************************************************************************
+#      ____               __          __  _      _____ _       _               #
+#     / __ \              \ \        / / | |    / ____| |     | |              #
+#    | |  | |_ __   ___ _ __ \  /\  / /__| |__ | |  __| | ___ | |__   ___      #
+#    | |  | | '_ \ / _ \ '_ \ \/  \/ / _ \ '_ \| | |_ | |/ _ \| '_ \ / _ \     #
+#    | |__| | |_) |  __/ | | \  /\  /  __/ |_) | |__| | | (_) | |_) |  __/     #
+#     \____/| .__/ \___|_| |_|\/  \/ \___|_.__/ \_____|_|\___/|_.__/ \___|     #
+#           | |                                                                #
+#           |_|                                                                #
+#                                                                              #
+#                                (c) 2011 by                                   #
+#           University of Applied Sciences Northwestern Switzerland            #
+#                     Institute of Geomatics Engineering                       #
+#                           martin.christen@fhnw.ch                            #
+********************************************************************************
+*     Licensed under MIT License. Read the file LICENSE for more information   *
+*******************************************************************************/
+
+/******************************************************************************/
+/* Benchmark of the hillshading kernels used by ogHillshading on a synthetic  */
+/* 768x768 elevation chunk (3x3 raw tiles, with a nodata hole).               */
+/* The separable gauss filter and the row kernels are compared against the    */
+/* per pixel reference (2D convolution through GetValue, GDAL algorithms on   */
+/* a 3x3 window). The program fails if a result is outside the tolerance.     */
+/******************************************************************************/
+
+#include "ogprocess.h"
+#include "../hillshading/hillshading.h"
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <boost/program_options.hpp>
+#include <omp.h>
+
+//-----------------------------------------------------------------------------
+// Reference: full 5x5 convolution, column by column, as ogHillshading did before _GaussFilter.
+
+void _referenceGauss(Raw32ImageObject& data, float* pDst)
+{
+   const float filter[5][5] =
+   {   {0.0037f,    0.0147f,    0.0256f,    0.0147f,    0.0037f},
+       {0.0147f,    0.0586f,    0.0952f,    0.0586f,    0.0147f},
+       {0.0256f,    0.0952f,    0.1502f,    0.0952f,    0.0256f},
+       {0.0147f,    0.0586f,    0.0952f,    0.0586f,    0.0147f},
+       {0.0037f,    0.0147f,    0.0256f,    0.0147f,    0.0037f} };
+
+   int nXSize = data.GetWidth();
+   int nYSize = data.GetHeight();
+
+   for (int gx = 2; gx < nXSize-2; gx++)
+   {
+      for (int gy = 2; gy < nYSize-2; gy++)
+      {
+         float val = 0;
+         for (int fx = 0; fx < 5; fx++)
+         {
+            for (int fy = 0; fy < 5; fy++)
+            {
+               val += filter[fx][fy]*data.GetValue(gx-2+fx,gy-2+fy);
+            }
+         }
+         pDst[gx+gy*nXSize] = val;
+      }
+   }
+}
+
+//-----------------------------------------------------------------------------
+// Reference: GDAL algorithms on the 3x3 window of every pixel of the center tile.
+
+void _referenceShading(const float* pSrc, int nXSize, int offset, int size, GDALHillshadeAlgData* pCalcObj, float* pShade, float* pSlope, unsigned char* pNoData)
+{
+   for (int dy = offset; dy < offset+size; dy++)
+   {
+      for (int dx = offset; dx < offset+size; dx++)
+      {
+         float afWin[9];
+         afWin[0] = pSrc[(dx-1)+(dy-1)*nXSize]; afWin[1] = pSrc[dx+(dy-1)*nXSize]; afWin[2] = pSrc[(dx+1)+(dy-1)*nXSize];
+         afWin[3] = pSrc[(dx-1)+dy*nXSize];     afWin[4] = pSrc[dx+dy*nXSize];     afWin[5] = pSrc[(dx+1)+dy*nXSize];
+         afWin[6] = pSrc[(dx-1)+(dy+1)*nXSize]; afWin[7] = pSrc[dx+(dy+1)*nXSize]; afWin[8] = pSrc[(dx+1)+(dy+1)*nXSize];
+
+         size_t i = (dy-offset)*size + (dx-offset);
+         pNoData[i] = 0;
+         for (int k = 0; k < 9; k++)
+         {
+            if (afWin[k] < -1000.0f)
+            {
+               pNoData[i] = 1;
+               break;
+            }
+         }
+         pShade[i] = GDALHillshadeZevenbergenThorneAlg(afWin, -9999.0f, pCalcObj);
+         pSlope[i] = GDALSlopeHornAlg(afWin, -9999.0f, pCalcObj);
+      }
+   }
+}
+
+//-----------------------------------------------------------------------------
+
+void _rowShading(const float* pSrc, int nXSize, int offset, int size, GDALHillshadeAlgData* pCalcObj, float* pShade, float* pSlope, unsigned char* pNoData)
+{
+   for (int dy = offset; dy < offset+size; dy++)
+   {
+      const float* pAbove = pSrc + offset + (dy-1)*nXSize;
+      const float* pRow = pSrc + offset + dy*nXSize;
+      const float* pBelow = pSrc + offset + (dy+1)*nXSize;
+      size_t i = (dy-offset)*size;
+
+      NoDataRow(pAbove, pRow, pBelow, size, pNoData + i);
+      GDALHillshadeZevenbergenThorneRow(pAbove, pRow, pBelow, size, pShade + i, pCalcObj);
+      GDALSlopeHornRow(pAbove, pRow, pBelow, size, pSlope + i, pCalcObj);
+   }
+}
+
+//-----------------------------------------------------------------------------
+
+namespace po = boost::program_options;
+
+int main(int argc, char *argv[])
+{
+   po::options_description desc("Program-Options");
+   desc.add_options()
+       ("iterations", po::value<int>(), "[optional] number of tiles per measurement (default 20)")
+       ;
+
+   po::variables_map vm;
+
+   bool bError = false;
+   int iterations = 20;
+
+   try
+   {
+      po::store(po::parse_command_line(argc, argv, desc), vm);
+      po::notify(vm);
+   }
+   catch (std::exception&)
+   {
+      bError = true;
+   }
+
+   if (vm.count("iterations"))
+   {
+      iterations = vm["iterations"].as<int>();
+      if (iterations < 1)
+      {
+         std::cout << "iterations must be >= 1\n";
+         bError = true;
+      }
+   }
+
+   //---------------------------------------------------------------------------
+   if (bError)
+   {
+      std::cout << desc << "\n";
+      return 1;
+   }
+   //---------------------------------------------------------------------------
+
+   // synthetic terrain of 3x3 tiles around tile 2150/1400 at level 12
+   const int size = 256;
+   const int nXSize = 3*size;
+   const int nYSize = 3*size;
+
+   Raw32ImageObject data;
+   data.AllocateImage(nXSize, nYSize, -9999.0f);
+   srand(7);
+   for (int y=0;y<nYSize;y++)
+   {
+      for (int x=0;x<nXSize;x++)
+      {
+         float v = float(1500 + 800*sin(x*0.013)*cos(y*0.021) + 120*sin(x*0.11+y*0.07) + (rand()%1000)*0.01);
+         if (x>300 && x<330 && y>400 && y<420)
+         {
+            v = -9999.0f;
+         }
+         data.SetValue(x, y, v);
+      }
+   }
+
+   MercatorQuadtree quadtree;
+   double mx0, my0, mx1, my1;
+   quadtree.QuadKeyToMercatorCoord(quadtree.TileCoordToQuadkey(2149, 1399, 12), mx0, my0, mx1, my1);
+   double dfXMin = mx0, dfYMax = my0;
+   quadtree.QuadKeyToMercatorCoord(quadtree.TileCoordToQuadkey(2151, 1401, 12), mx0, my0, mx1, my1);
+   double dfXMax = mx1, dfYMin = my1;
+
+   double adfGeoTransform[6];
+   adfGeoTransform[0] = dfXMin;
+   adfGeoTransform[1] = fabs((dfXMax*MERC) - (dfXMin*MERC)) / nXSize;
+   adfGeoTransform[2] = 0;
+   adfGeoTransform[3] = dfYMax;
+   adfGeoTransform[4] = 0;
+   adfGeoTransform[5] = -fabs((dfYMax*MERC) - (dfYMin*MERC)) / nYSize;
+   GDALHillshadeAlgData* pCalcObj = (GDALHillshadeAlgData*)GDALCreateHillshadeData(adfGeoTransform, 1.0, 1.0, 45, 315, 1.0, 1, size);
+
+   std::vector<float> vRefGauss(nXSize*nYSize, 0.0f), vGauss(nXSize*nYSize, 0.0f);
+   std::vector<float> vRefShade(size*size), vShade(size*size), vRefSlope(size*size), vSlope(size*size);
+   std::vector<unsigned char> vRefNoData(size*size), vNoData(size*size);
+
+   double t0 = omp_get_wtime();
+   for (int i=0;i<iterations;i++)
+      _referenceGauss(data, &vRefGauss[0]);
+   double t1 = omp_get_wtime();
+   for (int i=0;i<iterations;i++)
+      _GaussFilter(data.GetRawData().get(), nXSize, nYSize, size-4, size-4, 2*size+4, 2*size+4, &vGauss[0]);
+   double t2 = omp_get_wtime();
+   for (int i=0;i<iterations;i++)
+      _referenceShading(&vRefGauss[0], nXSize, size, size, pCalcObj, &vRefShade[0], &vRefSlope[0], &vRefNoData[0]);
+   double t3 = omp_get_wtime();
+   for (int i=0;i<iterations;i++)
+      _rowShading(&vGauss[0], nXSize, size, size, pCalcObj, &vShade[0], &vSlope[0], &vNoData[0]);
+   double t4 = omp_get_wtime();
+
+   CPLFree(pCalcObj);
+
+   // compare the area used for the center tile (gauss), and the center tile.
+   // Tolerances: float rounding of the gauss filter (relative 1e-5),
+   // one grey level for hillshading and 0.1 percent for the slope.
+   double dMaxGauss = 0;
+   bool bGauss = true;
+   for (int y=size-1;y<=2*size;y++)
+   {
+      for (int x=size-1;x<=2*size;x++)
+      {
+         double ref = vRefGauss[x+y*nXSize];
+         double d = fabs(vGauss[x+y*nXSize] - ref);
+         dMaxGauss = math::Max<double>(dMaxGauss, d);
+         bGauss = bGauss && d <= 1e-5*math::Max<double>(1.0, fabs(ref));
+      }
+   }
+
+   int nMaxShade = 0;
+   double dMaxSlope = 0;
+   bool bNoData = (vRefNoData == vNoData);
+   bool bSlope = true;
+   for (size_t i=0;i<vShade.size();i++)
+   {
+      if (vRefNoData[i])
+         continue;
+      nMaxShade = math::Max<int>(nMaxShade, abs(int((unsigned char)vShade[i]) - int((unsigned char)vRefShade[i])));
+      double d = fabs(vSlope[i] - vRefSlope[i]);
+      dMaxSlope = math::Max<double>(dMaxSlope, d);
+      bSlope = bSlope && d <= 1e-3*math::Max<double>(1.0, fabs(vRefSlope[i]));
+   }
+   bool bShade = nMaxShade <= 1;
+
+   std::cout << "tiles            : " << iterations << " (" << nXSize << "x" << nYSize << " chunk)\n";
+   std::cout << "gauss reference  : " << 1e3*(t1-t0)/iterations << " ms/tile\n";
+   std::cout << "gauss separable  : " << 1e3*(t2-t1)/iterations << " ms/tile, max. difference " << dMaxGauss << (bGauss ? "" : "  ### OUT OF TOLERANCE") << "\n";
+   std::cout << "shade reference  : " << 1e3*(t3-t2)/iterations << " ms/tile\n";
+   std::cout << "shade row kernels: " << 1e3*(t4-t3)/iterations << " ms/tile\n";
+   std::cout << "  hillshading    : max. difference " << nMaxShade << " grey levels" << (bShade ? "" : "  ### OUT OF TOLERANCE") << "\n";
+   std::cout << "  slope          : max. difference " << dMaxSlope << (bSlope ? "" : "  ### OUT OF TOLERANCE") << "\n";
+   std::cout << "  nodata flags   : " << (bNoData ? "identical" : "### DIFFERENT") << "\n";
+
+   return (bGauss && bShade && bSlope && bNoData) ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,258 @@
+/*******************************************************************************
+#      ____               __          __  _      _____ _       _               #
+#     / __ \              \ \        / / | |    / ____| |     | |              #
+#    | |  | |_ __   ___ _ __ \  /\  / /__| |__ | |  __| | ___ | |__   ___      #
+#    | |  | | '_ \ / _ \ '_ \ \/  \/ / _ \ '_ \| | |_ | |/ _ \| '_ \ / _ \     #
+#    | |__| | |_) |  __/ | | \  /\  /  __/ |_) | |__| | | (_) | |_) |  __/     #
+#     \____/| .__/ \___|_| |_|\/  \/ \___|_.__/ \_____|_|\___/|_.__/ \___|     #
+#           | |                                                                #
+#           |_|                                                                #
+#                                                                              #
+#                                (c) 2011 by                                   #
+#           University of Applied Sciences Northwestern Switzerland            #
+#                     Institute of Geomatics Engineering                       #
+#                           martin.christen@fhnw.ch                            #
+********************************************************************************
+*     Licensed under MIT License. Read the file LICENSE for more information   *
+*******************************************************************************/
+
+/******************************************************************************/
+/* Benchmark of ImageLoader on a directory of tiles (e.g. a tile directory    */
+/* of a layer). All .png and .raw files below the path are loaded with the    */
+/* bulk reads of ImageLoader and with the previous byte/float wise reads.     */
+/* The program fails if the decoded images differ.                            */
+/******************************************************************************/
+
+#include "ogprocess.h"
+#include "io/FileSystem.h"
+#include "image/ImageLoader.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <boost/program_options.hpp>
+#include <omp.h>
+
+//-----------------------------------------------------------------------------
+
+void _collectFiles(const std::string& sDir, const std::string& sExtension, std::vector<std::string>& vFiles)
+{
+   std::vector<std::string> vFilesInDir = FileSystem::GetFilesInDirectory(sDir, sExtension);
+   vFiles.insert(vFiles.end(), vFilesInDir.begin(), vFilesInDir.end());
+
+   std::vector<std::string> vSubdirs = FileSystem::GetSubdirsInDirectory(sDir);
+   for (size_t i=0;i<vSubdirs.size();i++)
+   {
+      _collectFiles(sDir + "/" + vSubdirs[i], sExtension, vFiles);
+   }
+}
+
+//-----------------------------------------------------------------------------
+// Reference: the file is read one byte at a time, as ImageLoader did before the bulk reads.
+
+bool _referenceLoad(const std::string& sFilename, ImageObject& outputimage)
+{
+   std::vector<unsigned char> vecData;
+   std::ifstream ifs(sFilename.c_str(), std::ios::in | std::ios::binary);
+   if (!ifs.good())
+      return false;
+
+   unsigned char s;
+   while (!ifs.eof())
+   {
+      ifs.read((char*)&s, 1);
+      vecData.push_back(s);
+   }
+
+   return ImageLoader::LoadFromMemory(Img::Format_PNG, &vecData[0], vecData.size(), Img::PixelFormat_RGBA, outputimage);
+}
+
+//-----------------------------------------------------------------------------
+// Reference: raw tiles are read one float at a time into a new image.
+
+bool _referenceLoadRaw32(const std::string& sFilename, int w, int h, Raw32ImageObject& outputdata)
+{
+   std::ifstream ifs(sFilename.c_str(), std::ios::binary);
+   if (!ifs.good())
+      return false;
+
+   Raw32ImageObject image;
+   image.AllocateImage(w,h);
+   int offset = 0;
+   while (!ifs.eof())
+   {
+      float value;
+      ifs.read((char*)&(value), sizeof(float));
+      if (!ifs.eof())
+      {
+         image.SetValue(offset, value);
+      }
+      offset++;
+   }
+   outputdata = image;
+   return true;
+}
+
+//-----------------------------------------------------------------------------
+
+namespace po = boost::program_options;
+
+int main(int argc, char *argv[])
+{
+   po::options_description desc("Program-Options");
+   desc.add_options()
+       ("path", po::value<std::string>(), "directory with .png and/or .raw tiles (searched recursively)")
+       ("passes", po::value<int>(), "[optional] number of times every file is loaded (default 3)")
+       ;
+
+   po::variables_map vm;
+
+   bool bError = false;
+   std::string sPath;
+   int passes = 3;
+
+   try
+   {
+      po::store(po::parse_command_line(argc, argv, desc), vm);
+      po::notify(vm);
+   }
+   catch (std::exception&)
+   {
+      bError = true;
+   }
+
+   if (!vm.count("path"))
+   {
+      bError = true;
+   }
+   else
+   {
+      sPath = vm["path"].as<std::string>();
+      if (!FileSystem::DirExists(sPath))
+      {
+         std::cout << "path " << sPath << " doesn't exist\n";
+         bError = true;
+      }
+   }
+
+   if (vm.count("passes"))
+   {
+      passes = vm["passes"].as<int>();
+      if (passes < 1)
+      {
+         std::cout << "passes must be >= 1\n";
+         bError = true;
+      }
+   }
+
+   //---------------------------------------------------------------------------
+   if (bError)
+   {
+      std::cout << desc << "\n";
+      return 1;
+   }
+   //---------------------------------------------------------------------------
+
+   std::vector<std::string> vPngFiles, vRawFiles;
+   _collectFiles(sPath, ".png", vPngFiles);
+   _collectFiles(sPath, ".raw", vRawFiles);
+
+   std::cout << "png tiles     : " << vPngFiles.size() << "\n";
+   std::cout << "raw tiles     : " << vRawFiles.size() << "\n";
+   std::cout << "passes        : " << passes << "\n";
+
+   bool bSame = true;
+   int nFailed = 0;
+
+   //---------------------------------------------------------------------------
+   // png tiles
+   if (vPngFiles.size() > 0)
+   {
+      ImageObject refimage, image;
+      std::vector<unsigned char> vBuffer;
+      double tRef = 0, tNew = 0;
+
+      for (int pass=0;pass<passes;pass++)
+      {
+         for (size_t i=0;i<vPngFiles.size();i++)
+         {
+            double t0 = omp_get_wtime();
+            bool bRef = _referenceLoad(vPngFiles[i], refimage);
+            double t1 = omp_get_wtime();
+            bool bNew = ImageLoader::LoadFromDisk(Img::Format_PNG, vPngFiles[i], Img::PixelFormat_RGBA, image, vBuffer);
+            double t2 = omp_get_wtime();
+            tRef += t1-t0;
+            tNew += t2-t1;
+
+            if (!bRef || !bNew)
+            {
+               nFailed++;
+               bSame = bSame && (bRef == bNew);
+            }
+            else if (pass == 0)
+            {
+               bSame = bSame && refimage.GetWidth() == image.GetWidth() && refimage.GetHeight() == image.GetHeight() &&
+                  memcmp(refimage.GetRawData().get(), image.GetRawData().get(), 4*image.GetWidth()*image.GetHeight()) == 0;
+            }
+         }
+      }
+
+      double n = double(passes)*vPngFiles.size();
+      std::cout << "png reference : " << 1e6*tRef/n << " us/tile\n";
+      std::cout << "png bulk read : " << 1e6*tNew/n << " us/tile\n";
+   }
+
+   //---------------------------------------------------------------------------
+   // raw tiles (square tiles of floats, the size is taken from the file size)
+   if (vRawFiles.size() > 0)
+   {
+      Raw32ImageObject refimage, image;
+      double tRef = 0, tNew = 0;
+
+      for (int pass=0;pass<passes;pass++)
+      {
+         for (size_t i=0;i<vRawFiles.size();i++)
+         {
+            std::ifstream ifs(vRawFiles[i].c_str(), std::ios::binary | std::ios::ate);
+            int size = (int)(std::sqrt(double(ifs.tellg())/sizeof(float)) + 0.5);
+            ifs.close();
+
+            double t0 = omp_get_wtime();
+            bool bRef = _referenceLoadRaw32(vRawFiles[i], size, size, refimage);
+            double t1 = omp_get_wtime();
+            bool bNew = ImageLoader::LoadRaw32FromDisk(vRawFiles[i], size, size, image);
+            double t2 = omp_get_wtime();
+            tRef += t1-t0;
+            tNew += t2-t1;
+
+            if (!bRef || !bNew)
+            {
+               nFailed++;
+               bSame = bSame && (bRef == bNew);
+            }
+            else if (pass == 0)
+            {
+               bSame = bSame && memcmp(refimage.GetRawData().get(), image.GetRawData().get(), sizeof(float)*size*size) == 0;
+            }
+         }
+      }
+
+      double n = double(passes)*vRawFiles.size();
+      std::cout << "raw reference : " << 1e6*tRef/n << " us/tile\n";
+      std::cout << "raw bulk read : " << 1e6*tNew/n << " us/tile\n";
+   }
+
+   if (nFailed > 0)
+   {
+      std::cout << "unreadable    : " << nFailed << "\n";
+   }
+   if (!bSame)
+   {
+      std::cout << "### RESULT DIFFERS\n";
+   }
+
+   return bSame ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,207 @@
+/*******************************************************************************
+#      ____               __          __  _      _____ _       _               #
+#     / __ \              \ \        / / | |    / ____| |     | |              #
+#    | |  | |_ __   ___ _ __ \  /\  / /__| |__ | |  __| | ___ | |__   ___      #
+#    | |  | | '_ \ / _ \ '_ \ \/  \/ / _ \ '_ \| | |_ | |/ _ \| '_ \ / _ \     #
+#    | |__| | |_) |  __/ | | \  /\  /  __/ |_) | |__| | | (_) | |_) |  __/     #
+#     \____/| .__/ \___|_| |_|\/  \/ \___|_.__/ \_____|_|\___/|_.__/ \___|     #
+#           | |                                                                #
+#           |_|                                                                #
+#                                                                              #
+#                                (c) 2011 by                                   #
+#           University of Applied Sciences Northwestern Switzerland            #
+#                     Institute of Geomatics Engineering                       #
+#                           martin.christen@fhnw.ch                            #
+********************************************************************************
+*     Licensed under MIT License. Read the file LICENSE for more information   *
+*******************************************************************************/
+/******************************************************************************/
+/*                                                                            */
+/*                      Test of the MPI job distribution                      */
+/*   Runs rounds of dummy jobs with different costs through MPIJobManager and */
+/*   checks that every job was processed exactly once. Run it with mpirun     */
+/*   on your cluster before starting data processing.                         */
+/*                                                                            */
+/******************************************************************************/
+
+#include "og.h"
+#include "mpi/Utils.h"
+
+#include <mpi.h>
+#include <omp.h>
+#include <iostream>
+#include <vector>
+#include <boost/program_options.hpp>
+#ifdef OS_WINDOWS
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Job-Struct
+struct Job
+{
+   int id;
+   int cost;      // processing time in 0.1 ms
+};
+
+//------------------------------------------------------------------------------
+// globals:
+std::vector<int> g_vProcessed;   // number of times each job was processed on this rank
+
+//------------------------------------------------------------------------------
+// MPI Job callback function (called every thread/compute node)
+void jobCallback(const Job& job, int rank)
+{
+#ifdef OS_WINDOWS
+   Sleep((job.cost+9)/10);
+#else
+   usleep(job.cost*100);
+#endif
+
+   #pragma omp atomic
+   g_vProcessed[job.id]++;
+}
+
+//------------------------------------------------------------------------------
+
+namespace po = boost::program_options;
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+   int rank, totalnodes;
+
+   MPI_Init(&argc, &argv);
+   MPI_Comm_size(MPI_COMM_WORLD, &totalnodes);
+   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+   // settings, parsed in rank 0 and broadcasted:
+   // number of jobs, rounds, max work size, min work size (0: default), root worker, verbose
+   int settings[6] = {2000, 2, 64, 0, 0, 0};
+
+   if (rank == 0)
+   {
+      po::options_description desc("Program-Options");
+      desc.add_options()
+         ("jobs", po::value<int>(), "[optional] number of jobs per round (default: 2000)")
+         ("rounds", po::value<int>(), "[optional] number of rounds (default: 2)")
+         ("maxworksize", po::value<int>(), "[optional] max number of jobs per packet (default: 64)")
+         ("minworksize", po::value<int>(), "[optional] min number of jobs per packet (default: number of threads)")
+         ("numthreads", po::value<int>(), "[optional] force number of threads (for each compute node)")
+         ("mpi_rootworker", "[optional] process jobs on rank 0 too")
+         ("verbose", "[optional] verbose output")
+         ;
+
+      po::variables_map vm;
+      bool bError = false;
+
+      try
+      {
+         po::store(po::parse_command_line(argc, argv, desc), vm);
+         po::notify(vm);
+      }
+      catch (std::exception&)
+      {
+         bError = true;
+      }
+
+      if (vm.count("jobs"))
+         settings[0] = vm["jobs"].as<int>();
+      if (vm.count("rounds"))
+         settings[1] = vm["rounds"].as<int>();
+      if (vm.count("maxworksize"))
+         settings[2] = vm["maxworksize"].as<int>();
+      if (vm.count("minworksize"))
+         settings[3] = vm["minworksize"].as<int>();
+      if (vm.count("mpi_rootworker"))
+         settings[4] = 1;
+      if (vm.count("verbose"))
+         settings[5] = 1;
+
+      if (settings[0] < 1 || settings[1] < 1 || settings[2] < 1 || settings[3] < 0)
+      {
+         bError = true;
+      }
+
+      if (vm.count("numthreads"))
+      {
+         int n = vm["numthreads"].as<int>();
+         if (n>0 && n<65)
+         {
+            std::cout << "Forcing number of threads to " << n << " per node\n";
+            omp_set_num_threads(n);
+         }
+      }
+
+      if (bError)
+      {
+         std::cout << desc;
+         return MPI_Abort(MPI_COMM_WORLD, 1);
+      }
+   }
+
+   MPI_Bcast(settings, 6, MPI_INT, 0, MPI_COMM_WORLD);
+
+   int nJobs = settings[0];
+   int nRounds = settings[1];
+   bool bVerbose = settings[5] != 0;
+
+   MPIJobManager<Job> jobmgr(settings[2]);
+   if (settings[3] > 0)
+      jobmgr.SetMinWorkSize(settings[3]);
+   jobmgr.SetRootWorker(settings[4] != 0);
+
+   int nFailedRounds = 0;
+
+   for (int round=0;round<nRounds;round++)
+   {
+      g_vProcessed.assign(nJobs, 0);
+
+      if (jobmgr.IsRoot())
+      {
+         for (int i=0;i<nJobs;i++)
+         {
+            Job job;
+            job.id = i;
+            job.cost = 1+(i%7);
+            jobmgr.AddJob(job);
+         }
+      }
+
+      double t0 = MPI_Wtime();
+      jobmgr.Process(jobCallback, bVerbose);
+      double t1 = MPI_Wtime();
+
+      std::vector<int> vTotal(nJobs, 0);
+      MPI_Reduce(&g_vProcessed[0], &vTotal[0], nJobs, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+
+      if (rank == 0)
+      {
+         int nMissing = 0;
+         int nDuplicate = 0;
+         for (int i=0;i<nJobs;i++)
+         {
+            if (vTotal[i] == 0) nMissing++;
+            else if (vTotal[i] > 1) nDuplicate++;
+         }
+
+         std::cout << "round " << round+1 << ": " << nJobs << " jobs on " << totalnodes << " ranks in " << t1-t0 << " s, "
+                   << nMissing << " missing, " << nDuplicate << " processed more than once\n" << std::flush;
+
+         if (nMissing || nDuplicate)
+            nFailedRounds++;
+      }
+   }
+
+   if (rank == 0)
+   {
+      std::cout << (nFailedRounds ? "FAILED\n" : "OK\n") << std::flush;
+   }
+
+   MPI_Finalize();
+
+   return nFailedRounds ? 1 : 0;
+}
@@ -89,6 +89,7 @@ int main(int argc, char *argv[])
        ("path", po::value<std::string>(), "where to run test (this path must exist)")
        ("numthreads", po::value<int>(), "number of threads to use for test")
        ("iterations", po::value<int>(), "number of iterations per thread")
+       ("backend", po::value<std::string>(), "[optional] lock backend: process, host or lockfile (default)")
        ;
 
    po::variables_map vm;
@@ -123,6 +124,20 @@ int main(int argc, char *argv[])
       }
    }
    
+   if (vm.count("backend"))
+   {
+      EFileLockBackend eBackend;
+      if (IFileLock::ParseBackend(vm["backend"].as<std::string>(), eBackend))
+      {
+         FileSystem::SetLockBackend(eBackend);
+      }
+      else
+      {
+         std::cout << "unknown backend " << vm["backend"].as<std::string>() << "\n";
+         bError = true;
+      }
+   }
+
    if (!FileSystem::DirExists(g_sPath))
    {
       std::cout << "path " << g_sPath << " doesn't exist\n";
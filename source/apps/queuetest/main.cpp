@@ -0,0 +1,340 @@
+/*******************************************************************************
+#      ____               __          __  _      _____ _       _               #
+#     / __ \              \ \        / / | |    / ____| |     | |              #
+#    | |  | |_ __   ___ _ __ \  /\  / /__| |__ | |  __| | ___ | |__   ___      #
+#    | |  | | '_ \ / _ \ '_ \ \/  \/ / _ \ '_ \| | |_ | |/ _ \| '_ \ / _ \     #
+#    | |__| | |_) |  __/ | | \  /\  /  __/ |_) | |__| | | (_) | |_) |  __/     #
+#     \____/| .__/ \___|_| |_|\/  \/ \___|_.__/ \_____|_|\___/|_.__/ \___|     #
+#           | |                                                                #
+#           |_|                                                                #
+#                                                                              #
+#                                (c) 2011 by                                   #
+#           University of Applied Sciences Northwestern Switzerland            #
+#                     Institute of Geomatics Engineering                       #
+#                           martin.christen@fhnw.ch                            #
+********************************************************************************
+*     Licensed under MIT License. Read the file LICENSE for more information   *
+*******************************************************************************/
+
+/******************************************************************************/
+/* This application tests the shared job queue (--sharedqueue) with several  */
+/* processes on one host. Generate a job file, then start several worker     */
+/* processes at the same time on the same path, one of them appending jobs    */
+/* while the others are fetching. Finally verify that every job was processed */
+/* exactly once:                                                              */
+/*                                                                            */
+/*  ogSharedQueueTest --path p --generate 2000                                */
+/*  ogSharedQueueTest --path p --worker 1 --total 3000 --append 500 &         */
+/*  ogSharedQueueTest --path p --worker 2 --total 3000 &                      */
+/*  ogSharedQueueTest --path p --worker 3 --total 3000 &                      */
+/*  wait; ogSharedQueueTest --path p --verify                                 */
+/******************************************************************************/
+
+#include "ogprocess.h"
+#include "io/FileSystem.h"
+#include "app/QueueManager.h"
+#include "app/SharedJobQueue.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <boost/thread.hpp>
+#include <boost/filesystem.hpp>
+
+
+struct TestJob
+{
+   int id;
+   int cost;      // processing time in 0.1 ms
+};
+
+std::string g_sPath;
+std::string g_sJobFile;
+int g_worker = 0;
+int g_total = 0;           // workers run until this number of jobs is finished
+int g_append = 0;          // number of jobs per append
+int g_appendcount = 2;     // number of appends
+
+//-----------------------------------------------------------------------------
+
+void _Sleep(int us)
+{
+   boost::this_thread::sleep(boost::posix_time::microseconds(us));
+}
+
+//-----------------------------------------------------------------------------
+
+void _AppendJobs(int first, int count, bool append)
+{
+   QueueManager qm;
+   for (int i=0;i<count;i++)
+   {
+      TestJob work;
+      work.id = first+i;
+      work.cost = 1 + (work.id % 7);
+      QJob job;
+      job.data = boost::shared_array<char>(new char[sizeof(TestJob)]);
+      memcpy(job.data.get(), &work, sizeof(TestJob));
+      job.size = sizeof(TestJob);
+      qm.AddToJobQueue(g_sJobFile, job, append || i>0, count);
+   }
+}
+
+//-----------------------------------------------------------------------------
+
+int _JobFileCount()
+{
+   int handle = FileSystem::Lock(g_sJobFile);
+   std::ifstream ifs(g_sJobFile.c_str(), std::ios::in|std::ios::binary);
+   ifs.seekg(0, std::ios::end);
+   int count = ifs.good() ? (int)(ifs.tellg() / (std::streamoff)sizeof(TestJob)) : 0;
+   FileSystem::Unlock(g_sJobFile, handle);
+   return count;
+}
+
+//-----------------------------------------------------------------------------
+
+// appends jobs while the workers are fetching
+void appendfunc()
+{
+   for (int i=0;i<g_appendcount;i++)
+   {
+      _Sleep(50000);
+      int first = _JobFileCount();
+      _AppendJobs(first, g_append, true);
+      std::cout << "appended jobs " << first << " - " << first+g_append-1 << "\n" << std::flush;
+   }
+}
+
+//-----------------------------------------------------------------------------
+
+// every thread uses its own queue (and mapping) like a separate process
+void workerfunc(int thread)
+{
+   SharedJobQueue queue;
+   std::vector<std::string> vResult;
+   unsigned int random = 1 + 7919*g_worker + 104729*thread;
+
+   for (;;)
+   {
+      std::vector<QJob> jobs = queue.FetchJobList(g_sJobFile, sizeof(TestJob), 5);
+      if (jobs.size() == 0)
+      {
+         // with --total stay idle until all jobs (including appended ones) are finished
+         if (queue.GetFinishedCount() >= g_total)
+            break;
+         _Sleep(1000);
+         continue;
+      }
+
+      for (size_t i=0;i<jobs.size();i++)
+      {
+         TestJob work;
+         memcpy(&work, jobs[i].data.get(), sizeof(TestJob));
+         std::ostringstream oss;
+         if (work.id != jobs[i].id)
+         {
+            oss << "B " << work.id << " " << jobs[i].id;
+            vResult.push_back(oss.str());
+            continue;
+         }
+
+         _Sleep(work.cost*100);
+
+         random = random*1103515245 + 12345;
+         if ((random >> 16) % 50 == 0)
+         {
+            if (!queue.RequeueJob(jobs[i]))
+            {
+               oss << "F " << work.id;
+               vResult.push_back(oss.str());
+            }
+         }
+         else
+         {
+            oss << "D " << work.id;
+            vResult.push_back(oss.str());
+            queue.CompleteJob(jobs[i]);
+         }
+      }
+   }
+
+   std::ostringstream ossFile;
+   ossFile << g_sPath << "/queuetest_" << g_worker << "_" << thread << ".txt";
+   std::ofstream ofs(ossFile.str().c_str());
+   for (size_t i=0;i<vResult.size();i++)
+   {
+      ofs << vResult[i] << "\n";
+   }
+}
+
+//-----------------------------------------------------------------------------
+
+int verify()
+{
+   int nJobs = _JobFileCount();
+   std::vector<int> vCount(nJobs, 0);
+   int nBad = 0;
+
+   boost::filesystem::directory_iterator end;
+   for (boost::filesystem::directory_iterator it(g_sPath); it != end; ++it)
+   {
+      std::string sName = it->path().filename().string();
+      if (sName.compare(0, 10, "queuetest_") != 0)
+         continue;
+
+      std::ifstream ifs(it->path().string().c_str());
+      std::string sType;
+      int id;
+      while (ifs >> sType >> id)
+      {
+         if (sType == "B" || id < 0 || id >= nJobs)
+         {
+            nBad++;
+            if (sType == "B") ifs >> id;
+            continue;
+         }
+         vCount[id]++;
+      }
+   }
+
+   int nMissing = 0, nDuplicate = 0;
+   for (int i=0;i<nJobs;i++)
+   {
+      if (vCount[i] == 0) nMissing++;
+      else if (vCount[i] > 1) nDuplicate++;
+   }
+
+   std::cout << nJobs << " jobs: " << nMissing << " missing, " << nDuplicate << " processed more than once, " << nBad << " wrong\n";
+   if (nMissing || nDuplicate || nBad)
+   {
+      std::cout << "FAILED\n";
+      return 1;
+   }
+   std::cout << "OK\n";
+   return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+namespace po = boost::program_options;
+
+int main(int argc, char *argv[])
+{
+   po::options_description desc("Program-Options");
+   desc.add_options()
+       ("path", po::value<std::string>(), "where to run test (this path must exist)")
+       ("generate", po::value<int>(), "create new job file with this number of jobs")
+       ("worker", po::value<int>(), "run as worker with this id (unique for every process)")
+       ("numthreads", po::value<int>(), "[optional] number of worker threads, each with its own queue (default: 2)")
+       ("total", po::value<int>(), "[optional] keep fetching until this number of jobs is finished")
+       ("append", po::value<int>(), "[optional] append this number of jobs while working (one process only)")
+       ("appendcount", po::value<int>(), "[optional] number of appends (default: 2)")
+       ("verify", "check that every job was processed exactly once")
+       ("lockbackend", po::value<std::string>(), "[optional] lock backend: process, host or lockfile (default)")
+       ;
+
+   po::variables_map vm;
+
+   bool bError = false;
+   int numthreads = 2;
+
+   try
+   {
+      po::store(po::parse_command_line(argc, argv, desc), vm);
+      po::notify(vm);
+   }
+   catch (std::exception&)
+   {
+      bError = true;
+   }
+
+   if (!vm.count("path") || (vm.count("generate") + vm.count("worker") + vm.count("verify")) != 1)
+   {
+      bError = true;
+   }
+   else
+   {
+      g_sPath = vm["path"].as<std::string>();
+      if (!FileSystem::DirExists(g_sPath))
+      {
+         std::cout << "path " << g_sPath << " doesn't exist\n";
+         bError = true;
+      }
+   }
+
+   if (vm.count("numthreads"))
+      numthreads = vm["numthreads"].as<int>();
+   if (vm.count("total"))
+      g_total = vm["total"].as<int>();
+   if (vm.count("append"))
+      g_append = vm["append"].as<int>();
+   if (vm.count("appendcount"))
+      g_appendcount = vm["appendcount"].as<int>();
+
+   if (numthreads < 1 || g_total < 0 || g_append < 0 || g_appendcount < 0)
+   {
+      bError = true;
+   }
+
+   if (vm.count("lockbackend"))
+   {
+      EFileLockBackend eBackend;
+      if (IFileLock::ParseBackend(vm["lockbackend"].as<std::string>(), eBackend))
+      {
+         FileSystem::SetLockBackend(eBackend);
+      }
+      else
+      {
+         std::cout << "unknown lock backend " << vm["lockbackend"].as<std::string>() << "\n";
+         bError = true;
+      }
+   }
+
+   //---------------------------------------------------------------------------
+   if (bError)
+   {
+      std::cout << desc << "\n";
+      return 1;
+   }
+   //---------------------------------------------------------------------------
+
+   g_sJobFile = g_sPath + "/queuetest.jobs";
+
+   if (vm.count("generate"))
+   {
+      int n = vm["generate"].as<int>();
+      boost::filesystem::directory_iterator end;
+      for (boost::filesystem::directory_iterator it(g_sPath); it != end; ++it)
+      {
+         if (it->path().filename().string().compare(0, 10, "queuetest_") == 0)
+            FileSystem::rm(it->path().string());
+      }
+      _AppendJobs(0, n, false);
+      std::cout << "generated " << n << " jobs\n";
+      return 0;
+   }
+
+   if (vm.count("verify"))
+   {
+      return verify();
+   }
+
+   g_worker = vm["worker"].as<int>();
+
+   boost::thread_group threads;
+   for (int i=0;i<numthreads;++i)
+   {
+      threads.create_thread(boost::bind(workerfunc, i));
+   }
+   if (g_append > 0)
+   {
+      threads.create_thread(appendfunc);
+   }
+   threads.join_all();
+
+   std::cout << "OK. Worker " << g_worker << " finished.\n";
+
+   return 0;
+}
@@ -22,6 +22,7 @@
 
 #include "resample.h"
 #include "resample_elevation.h"
+#include "resample_pointcloud.h"
 #include "geo/ElevationLayerSettings.h"
 #include "geo/PointLayerSettings.h"
 #include "geo/PointMap.h"
@@ -30,6 +31,7 @@
 #include "math/CloudPoint.h"
 #include <boost/program_options.hpp>
 #include <set>
+#include <algorithm>
 #include <cassert>
 #include <omp.h>
 
@@ -42,10 +44,11 @@ int main(int argc, char *argv[])
    desc.add_options()
        ("layer", po::value<std::string>(), "image layer to resample")
        ("type", po::value<std::string>(), "[optional] image (default) or raw or elevation, or point.")
-       ("maxpoints", po::value<int>(), "[optional] for elevation layer: max number of points per tile. Default is 512.")
+       ("maxpoints", po::value<int>(), "[optional] for elevation layer: max number of points per tile. Default is 512. For point layer: max number of points per octree cell. Default is 4096.")
        ("numthreads", po::value<int>(), "force number of threads")
        ("verbose", "optional info")
        ("pointfile", "generate file with thinned out points")
+       ("lockbackend", po::value<std::string>(), "[optional] lock backend: process, host or lockfile (default)")
        ;
 
    po::variables_map vm;
@@ -143,10 +146,15 @@ int main(int argc, char *argv[])
       }
    }
 
+   if (layertype == 2)
+   {
+      nMaxpoints = 4096;
+   }
+
    if (vm.count("maxpoints"))
    {
       int v = vm["maxpoints"].as<int>();
-      if (v>32 && v<2048)
+      if (v>32 && (v<2048 || (layertype == 2 && v<=65536)))
       {
          nMaxpoints = v;
       }
@@ -158,6 +166,20 @@ int main(int argc, char *argv[])
       bPointfile = true;
    }
 
+   if (vm.count("lockbackend"))
+   {
+      EFileLockBackend eBackend;
+      if (IFileLock::ParseBackend(vm["lockbackend"].as<std::string>(), eBackend))
+      {
+         FileSystem::SetLockBackend(eBackend);
+      }
+      else
+      {
+         std::cout << "unknown lock backend " << vm["lockbackend"].as<std::string>() << "\n";
+         bError = true;
+      }
+   }
+
    //---------------------------------------------------------------------------
    if (bError)
    {
@@ -188,9 +210,6 @@ int main(int argc, char *argv[])
       clock_t t0,t1;
       t0 = clock();
 
-      //--------------------------------------------------------------------------
-      // create tile blocks (for each thread)
-      TileBlock* pTileBlockArray = _createTileBlockArray();
       //---------------------------------------------------------------------------
       int64 tx0,ty0,tx1,ty1;
       qImageLayerSettings->GetTileExtent(tx0,ty0,tx1,ty1);
@@ -206,44 +225,34 @@ int main(int argc, char *argv[])
          qLogger->Info(oss.str());
       }
 
-      boost::shared_ptr<MercatorQuadtree> qQuadtree = boost::shared_ptr<MercatorQuadtree>(new MercatorQuadtree());
-
-      std::string qc0 = qQuadtree->TileCoordToQuadkey(tx0, ty0, maxlod);
-      std::string qc1 = qQuadtree->TileCoordToQuadkey(tx1, ty1, maxlod);
-
-      for (int nLevelOfDetail = maxlod - 1; nLevelOfDetail>0; nLevelOfDetail--)
+      PyramidSetup setup;
+      setup.qTileStore = ITileStore::Create(qImageLayerSettings->GetTileStore(), bRaw ? sTempTileDir : sTileDir, bRaw ? ".raw" : ".png");
+      if (!setup.qTileStore)
       {
-         std::ostringstream oss;
-         oss << "Processing Level of Detail " << nLevelOfDetail;
-         qLogger->Info(oss.str());
-
-         qc0 = StringUtils::Left(qc0, nLevelOfDetail);
-         qc1 = StringUtils::Left(qc1, nLevelOfDetail);
-
-         int tmp_lod;
-         qQuadtree->QuadKeyToTileCoord(qc0, tx0, ty0, tmp_lod);
-         qQuadtree->QuadKeyToTileCoord(qc1, tx1, ty1, tmp_lod);
-
-#        pragma omp parallel for
-         for (int64 y=ty0;y<=ty1;y++)
+         qLogger->Error("Unknown tile store: " + qImageLayerSettings->GetTileStore());
+         return ERROR_IMAGELAYERSETTINGS;
+      }
+      if (qImageLayerSettings->GetOccupancyIndex())
+      {
+         for (int lod=0;lod<=maxlod;lod++)
          {
-            for (int64 x=tx0;x<=tx1;x++)
-            {
-               std::string tiledir = bRaw? sTempTileDir : sTileDir;
-               _resampleFromParent(pTileBlockArray, qQuadtree, x, y, nLevelOfDetail, tiledir,bRaw);
-            }
+            setup.vOccupancy.push_back(boost::shared_ptr<TileOccupancy>(new TileOccupancy(bRaw ? sTempTileDir : sTileDir, lod)));
          }
       }
-     
+      setup.rawData = bRaw;
+      setup.maxlod = maxlod;
+      setup.tx0 = tx0;
+      setup.ty0 = ty0;
+      setup.tx1 = tx1;
+      setup.ty1 = ty1;
+
+      _resamplePyramid(setup, qLogger);
 
       // output time to calculate resampling:
       t1=clock();
       std::ostringstream out;
       out << "calculated in: " << double(t1-t0)/double(CLOCKS_PER_SEC) << " s \n";
       qLogger->Info(out.str());
-
-      // clean up
-      _destroyTileBlockArray(pTileBlockArray);
    }
    else if (layertype == 1) // elevation layer
    {
@@ -261,6 +270,7 @@ int main(int argc, char *argv[])
       int maxlod = qElevationLayerSettings->GetMaxLod();
       int64 tx0,ty0,tx1,ty1;
       qElevationLayerSettings->GetTileExtent(tx0, ty0, tx1, ty1);
+      std::string sTileFormat = qElevationLayerSettings->GetTileFormat();
 
       if (bVerbose)
       {
@@ -269,6 +279,7 @@ int main(int argc, char *argv[])
          oss << "     name = " << qElevationLayerSettings->GetLayerName() << "\n";
          oss << "   maxlod = " << maxlod << "\n";
          oss << "   extent = " << tx0 << ", " << ty0 << ", " << tx1 << ", " << ty1 << "\n";;
+         oss << "   format = " << sTileFormat << "\n";
          qLogger->Info(oss.str());
       }
 
@@ -298,7 +309,7 @@ int main(int argc, char *argv[])
          {
             for (int64 x=tx0;x<=tx1;x++)
             {
-               _resampleElevationFromParent(qQuadtree, x, y, nLevelOfDetail, sTileDir, sTempTileDir, nMaxpoints);
+               _resampleElevationFromParent(qQuadtree, x, y, nLevelOfDetail, sTileDir, sTempTileDir, nMaxpoints, sTileFormat);
             }
          }
       }
@@ -355,6 +366,9 @@ int main(int argc, char *argv[])
 
       pm.ImportIndex(sIndexFiles);
 
+      std::vector<int64> vCells;  // keys of cells at next lower lod (parents of the cells at maxlod)
+      int64 parentpow = pow / 2;
+
       //std::set<int64>::iterator it = indices.begin();
       int64 key;
       while (pm.GetNextIndex(key))
@@ -366,6 +380,8 @@ int main(int argc, char *argv[])
          j = (key - dpow*k) / pow;
          i = key - dpow*k - j*pow;
 
+         vCells.push_back(parentpow*parentpow*(k/2) + parentpow*(j/2) + i/2);
+
          // Filename:
          std::ostringstream oss;
          oss << sTempTileDir << lod << "/" << i << "/" << j << "-" << k << ".dat";
@@ -432,23 +448,52 @@ int main(int argc, char *argv[])
          pointfile.close();
       }
 
-      // B) create voxels for remaining lods
-      // #todo: lod calc
-      /*it = indices.begin();
-      while (it != indices.end())
+      // B) create voxels for remaining lods (bottom-up, each cell is a subsample of its eight children)
+      for (int nLevelOfDetail = lod-1; nLevelOfDetail>=0; nLevelOfDetail--)
       {
-         int64 i,j,k;
-         int64 key = *it;
-         // convert key -> octree coord (i,j,k)
-         k = key / dpow;
-         j = (key - dpow*k) / pow;
-         i = key - dpow*k - j*pow;
+         std::sort(vCells.begin(), vCells.end());
+         vCells.erase(std::unique(vCells.begin(), vCells.end()), vCells.end());
+
+         int64 lpow = int64(1) << nLevelOfDetail;
+         int64 ldpow = lpow * lpow;
 
-         std::string sOctocode = Octocode::IndexToOctocode(i,j,k,lod);
-         std::string sParent = Octocode::GetParent(sOctocode);
+         // create directories before cells are written in parallel
+         std::set<int64> setColumns;
+         for (size_t c=0;c<vCells.size();c++)
+         {
+            setColumns.insert(vCells[c] % lpow);
+         }
+         std::set<int64>::iterator jt;
+         for (jt = setColumns.begin(); jt != setColumns.end(); ++jt)
+         {
+            FileSystem::makeallsubdirs(_pointCloudCellFilename(sTempTileDir, nLevelOfDetail, *jt, 0, 0));
+         }
 
-         it++;
-      }*/
+         int64 nPoints = 0;
+         int64 nCells = (int64)vCells.size();
+#        pragma omp parallel for reduction(+:nPoints)
+         for (int64 c=0;c<nCells;c++)
+         {
+            int64 k = vCells[c] / ldpow;
+            int64 j = (vCells[c] - ldpow*k) / lpow;
+            int64 i = vCells[c] - ldpow*k - j*lpow;
+            nPoints += _resamplePointCloudFromParent(i, j, k, nLevelOfDetail, sTempTileDir, nMaxpoints);
+         }
+
+         std::ostringstream oss;
+         oss << "Level of Detail " << nLevelOfDetail << ": " << nCells << " cells, " << nPoints << " points";
+         qLogger->Info(oss.str());
+
+         // parents of this lod
+         int64 ppow = lpow / 2;
+         for (size_t c=0;c<vCells.size();c++)
+         {
+            int64 k = vCells[c] / ldpow;
+            int64 j = (vCells[c] - ldpow*k) / lpow;
+            int64 i = vCells[c] - ldpow*k - j*lpow;
+            vCells[c] = ppow*ppow*(k/2) + ppow*(j/2) + i/2;
+         }
+      }
    }
 #endif
 
@@ -49,12 +49,15 @@ int g_Lod = 0;
 boost::shared_ptr<MercatorQuadtree> q_qQuadtree;
 TileBlock* g_pTileBlockArray = 0;
 std::string g_sTileDir;
+boost::shared_ptr<ITileStore> g_qTileStore;
+boost::shared_ptr<TileOccupancy> g_qChildOccupancy;  // occupancy index of g_Lod+1 (if layer has one)
+boost::shared_ptr<TileOccupancy> g_qOccupancy;       // occupancy index of g_Lod
 
 //------------------------------------------------------------------------------
 // MPI Job callback function (called every thread/compute node)
 void jobCallback(const Job& job, int rank)
 {
-   _resampleFromParent(g_pTileBlockArray, q_qQuadtree, job.sx, job.sy, g_Lod, g_sTileDir);
+   _resampleFromParent(g_pTileBlockArray, q_qQuadtree, job.sx, job.sy, g_Lod, g_qTileStore, false, g_qChildOccupancy.get(), g_qOccupancy.get());
 }
 
 //------------------------------------------------------------------------------
@@ -103,6 +106,8 @@ void BroadcastBool(bool& val, int sender)
 int main(int argc, char *argv[])
 {
    std::string sImageLayerDir;
+   std::string sTileStore;
+   bool bOccupancy = false;
    int64 tx0,ty0,tx1,ty1;
    int maxlod;
    clock_t t0,t1;
@@ -235,6 +240,8 @@ int main(int argc, char *argv[])
 
       qImageLayerSettings->GetTileExtent(tx0,ty0,tx1,ty1);
       maxlod = qImageLayerSettings->GetMaxLod();
+      sTileStore = qImageLayerSettings->GetTileStore();
+      bOccupancy = qImageLayerSettings->GetOccupancyIndex();
 
 
       if (bVerbose)
@@ -249,6 +256,7 @@ int main(int argc, char *argv[])
    }
    
    BroadcastString(g_sTileDir, 0);
+   BroadcastString(sTileStore, 0);
    BroadcastString(sImageLayerDir, 0);
    BroadcastInt64(tx0, 0);
    BroadcastInt64(ty0, 0);
@@ -258,10 +266,18 @@ int main(int argc, char *argv[])
    BroadcastInt(layertype, 0);
    BroadcastInt(nMaxpoints, 0);
    BroadcastBool(bVerbose, 0);
+   BroadcastBool(bOccupancy, 0);
 
 
    if (layertype == 0) // image layer
    {
+      g_qTileStore = ITileStore::Create(sTileStore, g_sTileDir, ".png");
+      if (!g_qTileStore)
+      {
+         std::cout << "**ERROR: Unknown tile store " << sTileStore << "\n";
+         return MPI_Abort(MPI_COMM_WORLD, ERROR_IMAGELAYERSETTINGS);
+      }
+
       g_pTileBlockArray = _createTileBlockArray();
 
       q_qQuadtree= boost::shared_ptr<MercatorQuadtree>(new MercatorQuadtree());
@@ -284,6 +300,14 @@ int main(int argc, char *argv[])
          q_qQuadtree->QuadKeyToTileCoord(qc0, tx0, ty0, tmp_lod);
          q_qQuadtree->QuadKeyToTileCoord(qc1, tx1, ty1, tmp_lod);
 
+         if (bOccupancy)
+         {
+            g_qChildOccupancy = boost::shared_ptr<TileOccupancy>(new TileOccupancy(g_sTileDir, nLevelOfDetail+1));
+            g_qChildOccupancy->Load();
+            g_qOccupancy = boost::shared_ptr<TileOccupancy>(new TileOccupancy(g_sTileDir, nLevelOfDetail));
+            g_qOccupancy->Load();
+         }
+
          if (bVerbose && rank == 0)
          {
            std::cout << "[RANGE]: [" << tx0 << ", " << ty0 << "]-[" << tx1 << ", " << ty1 << "]\n" << std::flush;
@@ -306,6 +330,13 @@ int main(int argc, char *argv[])
          }
 
          jobmgr.Process(jobCallback, bVerbose);
+
+         // all records of this level must be written before the next level reads them
+         if (bOccupancy)
+         {
+            g_qOccupancy->Flush();
+            MPI_Barrier(MPI_COMM_WORLD);
+         }
       }
 
       MPI_Finalize();
@@ -1,6 +1,12 @@
 
 #include "resample.h"
 #include <omp.h>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define _USE_SSE2
+#  include <emmintrin.h>
+#endif
 
 //------------------------------------------------------------------------------
 
@@ -21,315 +27,670 @@ void _destroyTileBlockArray(TileBlock* pTileBlockArray)
    }
 }
 //------------------------------------------------------------------------------
-void _resampleFromParent( TileBlock* pTileBlockArray, boost::shared_ptr<MercatorQuadtree> qQuadtree, int64 x, int64 y,int nLevelOfDetail, std::string sTileDir, bool rawData) 
+
+namespace
+{
+   //---------------------------------------------------------------------------
+   // read png tile from tile store. Returns false if tile doesn't exist.
+   bool _loadTile(ITileStore* pTileStore, int lod, int64 x, int64 y, ImageObject& image, std::vector<unsigned char>& vData)
+   {
+      return pTileStore->Read(lod, x, y, vData) &&
+             ImageLoader::LoadFromMemory(Img::Format_PNG, &vData[0], (unsigned int)vData.size(), Img::PixelFormat_RGBA, image);
+   }
+
+   //---------------------------------------------------------------------------
+   // read raw tile from tile store. Returns false if tile doesn't exist.
+   bool _loadRawTile(ITileStore* pTileStore, int lod, int64 x, int64 y, Raw32ImageObject& image, std::vector<unsigned char>& vData)
+   {
+      return pTileStore->Read(lod, x, y, vData) &&
+             ImageLoader::LoadRaw32FromMemory(&vData[0], vData.size(), tilesize, tilesize, image);
+   }
+
+   //---------------------------------------------------------------------------
+
+   void _storeTile(ITileStore* pTileStore, int lod, int64 x, int64 y, unsigned char* pTile)
+   {
+      std::vector<unsigned char> vData;
+      if (ImageWriter::EncodePNG(pTile, tilesize, tilesize, vData))
+      {
+         pTileStore->Write(lod, x, y, &vData[0], vData.size());
+      }
+   }
+
+   //---------------------------------------------------------------------------
+
+   void _storeRawTile(ITileStore* pTileStore, int lod, int64 x, int64 y, float* pTile)
+   {
+      pTileStore->Write(lod, x, y, (const unsigned char*)pTile, tilesize*tilesize*sizeof(float));
+   }
+
+   //---------------------------------------------------------------------------
+   // pixel value of empty tiles in the occupancy index
+   inline unsigned int _emptyValue(bool rawData)
+   {
+      return rawData ? TileOccupancy::PixelValue(&rawNodata) : 0;
+   }
+
+   //---------------------------------------------------------------------------
+   // Returns true if the tile created from four children with the specified
+   // states is known without downsampling: all children are empty or have the
+   // same uniform value. Transparent pixels are ignored when downsampling, so
+   // this doesn't hold for uniform transparent rgba tiles.
+   bool _getParentState(const TileOccupancy::ETileState* state, const unsigned int* value, bool rawData, TileOccupancy::ETileState& parentState, unsigned int& parentValue)
+   {
+      for (int i=1;i<4;i++)
+      {
+         if (state[i] != state[0] || (state[0] == TileOccupancy::TILE_UNIFORM && value[i] != value[0]))
+            return false;
+      }
+
+      if (state[0] == TileOccupancy::TILE_DATA)
+         return false;
+
+      if (state[0] == TileOccupancy::TILE_UNIFORM && !rawData && ((const unsigned char*)&value[0])[3] == 0)
+         return false;
+
+      parentState = state[0];
+      parentValue = value[0];
+      return true;
+   }
+
+   //---------------------------------------------------------------------------
+   // record state of tile in occupancy index. Empty and stored tiles are only
+   // recorded if they replace an empty or uniform tile of the index, tiles which
+   // are not in the index are read from the tile store.
+   void _recordTile(TileOccupancy* pOccupancy, int64 x, int64 y, TileOccupancy::ETileState state, unsigned int value)
+   {
+      if (!pOccupancy)
+         return;
+
+      if (state == TileOccupancy::TILE_UNIFORM || pOccupancy->GetState(x, y) != TileOccupancy::TILE_DATA)
+      {
+         pOccupancy->SetState(x, y, state, value);
+      }
+   }
+
+   //---------------------------------------------------------------------------
+   // store downsampled tile (pTile: rgba or float pixels) unless it is empty or uniform
+   void _storeResampledTile(ITileStore* pTileStore, TileOccupancy* pOccupancy, int lod, int64 x, int64 y, void* pTile, bool rawData)
+   {
+      TileOccupancy::ETileState state = TileOccupancy::TILE_DATA;
+      unsigned int value = 0;
+
+      if (pOccupancy)
+      {
+         state = TileOccupancy::Classify(pTile, tilesize*tilesize, _emptyValue(rawData), value);
+      }
+
+      if (state == TileOccupancy::TILE_DATA)
+      {
+         if (rawData)
+         {
+            _storeRawTile(pTileStore, lod, x, y, (float*)pTile);
+         }
+         else
+         {
+            _storeTile(pTileStore, lod, x, y, (unsigned char*)pTile);
+         }
+      }
+      else if (pOccupancy->GetState(x, y) == TileOccupancy::TILE_DATA)
+      {
+         // remove the tile of an earlier run, readers which don't use the index would still get it
+         pTileStore->Remove(lod, x, y);
+      }
+
+      _recordTile(pOccupancy, x, y, state, value);
+   }
+}
+
+//------------------------------------------------------------------------------
+void _resampleFromParent( TileBlock* pTileBlockArray, boost::shared_ptr<MercatorQuadtree> qQuadtree, int64 x, int64 y,int nLevelOfDetail, boost::shared_ptr<ITileStore> qTileStore, bool rawData, TileOccupancy* pChildOccupancy, TileOccupancy* pOccupancy) 
 {
    int curthread = omp_get_thread_num();
    TileBlock& tile = pTileBlockArray[curthread];
-   tile.Clear();
 
    std::string qcCurrent = qQuadtree->TileCoordToQuadkey(x,y,nLevelOfDetail);
 
    // calculate parent quadkeys:
-   std::string qc0,qc1,qc2,qc3;
-   qc0 = qcCurrent + '0';
-   qc1 = qcCurrent + '1';
-   qc2 = qcCurrent + '2';
-   qc3 = qcCurrent + '3';
+   std::string qc[4];
+   qc[0] = qcCurrent + '0';
+   qc[1] = qcCurrent + '1';
+   qc[2] = qcCurrent + '2';
+   qc[3] = qcCurrent + '3';
 
-   int64 _tx, _ty;
+   int64 _tx[4], _ty[4];
    int tmp_lod;
 
-   if(!rawData)
+   // state of children. Without occupancy index all children are read from the tile store.
+   TileOccupancy::ETileState state[4];
+   unsigned int value[4] = {0, 0, 0, 0};
+
+   for (int i=0;i<4;i++)
    {
+      qQuadtree->QuadKeyToTileCoord(qc[i], _tx[i], _ty[i], tmp_lod);
+      state[i] = pChildOccupancy ? pChildOccupancy->GetState(_tx[i], _ty[i], &value[i]) : TileOccupancy::TILE_DATA;
+   }
 
-      qQuadtree->QuadKeyToTileCoord(qcCurrent, _tx, _ty, tmp_lod);
-      std::string sCurrentTile = ProcessingUtils::GetTilePath(sTileDir, ".png" , tmp_lod, _tx, _ty);
+   TileOccupancy::ETileState parentState;
+   unsigned int parentValue;
+   if (_getParentState(state, value, rawData, parentState, parentValue))
+   {
+      _recordTile(pOccupancy, x, y, parentState, parentValue);
+      return;
+   }
 
-      qQuadtree->QuadKeyToTileCoord(qc0, _tx, _ty, tmp_lod);
-      std::string sTilefile0 = ProcessingUtils::GetTilePath(sTileDir, ".png" , tmp_lod, _tx, _ty);
+   // load children, uniform children are created from their value.
+   const void* p[4];
+   int nEmpty = 0;
 
-      qQuadtree->QuadKeyToTileCoord(qc1, _tx, _ty, tmp_lod);
-      std::string sTilefile1 = ProcessingUtils::GetTilePath(sTileDir, ".png" , tmp_lod, _tx, _ty);
+   for (int i=0;i<4;i++)
+   {
+      p[i] = 0;
 
-      qQuadtree->QuadKeyToTileCoord(qc2, _tx, _ty, tmp_lod);
-      std::string sTilefile2 = ProcessingUtils::GetTilePath(sTileDir, ".png" , tmp_lod, _tx, _ty);
+      if (state[i] == TileOccupancy::TILE_UNIFORM)
+      {
+         if (rawData)
+         {
+            tile.rawChildren[i].AllocateImage(tilesize, tilesize);
+            p[i] = tile.rawChildren[i].GetRawData().get();
+         }
+         else
+         {
+            tile.children[i].AllocateImage(tilesize, tilesize, Img::PixelFormat_RGBA);
+            p[i] = tile.children[i].GetRawData().get();
+         }
+         TileOccupancy::Fill((void*)p[i], tilesize*tilesize, value[i]);
+      }
+      else if (state[i] == TileOccupancy::TILE_DATA)
+      {
+         if (rawData)
+         {
+            if (_loadRawTile(qTileStore.get(), tmp_lod, _tx[i], _ty[i], tile.rawChildren[i], tile.vData))
+               p[i] = tile.rawChildren[i].GetRawData().get();
+         }
+         else
+         {
+            if (_loadTile(qTileStore.get(), tmp_lod, _tx[i], _ty[i], tile.children[i], tile.vData))
+               p[i] = tile.children[i].GetRawData().get();
+         }
+      }
+
+      if (!p[i]) nEmpty++;
+   }
+
+   // no children: nothing to store
+   if (nEmpty == 4)
+   {
+      _recordTile(pOccupancy, x, y, TileOccupancy::TILE_EMPTY, 0);
+      return;
+   }
+
+   if (!rawData)
+   {
+      _downsampleTiles((const unsigned char*)p[0], (const unsigned char*)p[1], (const unsigned char*)p[2], (const unsigned char*)p[3], tile.tile);
+      _storeResampledTile(qTileStore.get(), pOccupancy, nLevelOfDetail, x, y, tile.tile, false);
+   }
+   else
+   {
+      // the tile memory of the block holds tilesize*tilesize floats
+      float* pTarget = (float*)tile.tile;
+      _downsampleRawTiles((const float*)p[0], (const float*)p[1], (const float*)p[2], (const float*)p[3], pTarget);
+      _storeResampledTile(qTileStore.get(), pOccupancy, nLevelOfDetail, x, y, pTarget, true);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+#ifdef _USE_SSE2
+   //---------------------------------------------------------------------------
+   // a, b: 4 RGBA pixels of two rows. Returns sum and number of the pixels with alpha > 0 of
+   // both 2x2 blocks (16 bit per channel, the count is repeated for all channels).
+   inline void _sumBlocksSSE2(__m128i a, __m128i b, __m128i& sum, __m128i& count)
+   {
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i alpha = _mm_set1_epi32(0xFF000000);
+      const __m128i one = _mm_set1_epi32(0x01010101);
+
+      __m128i ta = _mm_cmpeq_epi32(_mm_and_si128(a, alpha), zero);  // transparent pixels
+      __m128i tb = _mm_cmpeq_epi32(_mm_and_si128(b, alpha), zero);
+      a = _mm_andnot_si128(ta, a);
+      b = _mm_andnot_si128(tb, b);
+      __m128i na = _mm_andnot_si128(ta, one);
+      __m128i nb = _mm_andnot_si128(tb, one);
+
+      // vertical sums of pixels 0,1 and 2,3, then horizontal sums
+      __m128i v01 = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+      __m128i v23 = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+      sum = _mm_add_epi16(_mm_unpacklo_epi64(v01, v23), _mm_unpackhi_epi64(v01, v23));
+
+      __m128i n01 = _mm_add_epi16(_mm_unpacklo_epi8(na, zero), _mm_unpacklo_epi8(nb, zero));
+      __m128i n23 = _mm_add_epi16(_mm_unpackhi_epi8(na, zero), _mm_unpackhi_epi8(nb, zero));
+      count = _mm_add_epi16(_mm_unpacklo_epi64(n01, n23), _mm_unpackhi_epi64(n01, n23));
+   }
 
-      qQuadtree->QuadKeyToTileCoord(qc3, _tx, _ty, tmp_lod);
-      std::string sTilefile3 = ProcessingUtils::GetTilePath(sTileDir, ".png" , tmp_lod, _tx, _ty);
+   //---------------------------------------------------------------------------
+   // integer division sum/count for count 0..4: (2*sum * ceil(32768/count)) >> 16
+   // is exact for sum <= 4*255.
+   inline __m128i _divideSSE2(__m128i sum, __m128i count)
+   {
+      __m128i r = _mm_and_si128(_mm_cmpeq_epi16(count, _mm_set1_epi16(1)), _mm_set1_epi16((short)32768));
+      r = _mm_or_si128(r, _mm_and_si128(_mm_cmpeq_epi16(count, _mm_set1_epi16(2)), _mm_set1_epi16(16384)));
+      r = _mm_or_si128(r, _mm_and_si128(_mm_cmpeq_epi16(count, _mm_set1_epi16(3)), _mm_set1_epi16(10923)));
+      r = _mm_or_si128(r, _mm_and_si128(_mm_cmpeq_epi16(count, _mm_set1_epi16(4)), _mm_set1_epi16(8192)));
+
+      return _mm_mulhi_epu16(_mm_slli_epi16(sum, 1), r);
+   }
+#endif
 
-      ImageObject IH0, IH1, IH2, IH3;
+   //---------------------------------------------------------------------------
+   // downsample two rows (pRow and pRow+stride) of a child tile to nOut RGBA pixels
+   inline void _downsampleRow(const unsigned char* pRow, size_t stride, unsigned char* pOut, int nOut)
+   {
+      int x = 0;
 
-      bool b0 = ImageLoader::LoadFromDisk(Img::Format_PNG, sTilefile0, Img::PixelFormat_RGBA, IH0);
-      bool b1 = ImageLoader::LoadFromDisk(Img::Format_PNG, sTilefile1, Img::PixelFormat_RGBA, IH1);
-      bool b2 = ImageLoader::LoadFromDisk(Img::Format_PNG, sTilefile2, Img::PixelFormat_RGBA, IH2);
-      bool b3 = ImageLoader::LoadFromDisk(Img::Format_PNG, sTilefile3, Img::PixelFormat_RGBA, IH3);
+#ifdef _USE_SSE2
+      for (;x+4<=nOut;x+=4)
+      {
+         __m128i a0 = _mm_loadu_si128((const __m128i*)(pRow + 8*x));
+         __m128i a1 = _mm_loadu_si128((const __m128i*)(pRow + 8*x + 16));
+         __m128i b0 = _mm_loadu_si128((const __m128i*)(pRow + stride + 8*x));
+         __m128i b1 = _mm_loadu_si128((const __m128i*)(pRow + stride + 8*x + 16));
 
-      unsigned char* p0 = IH0.GetRawData().get();
-      unsigned char* p1 = IH1.GetRawData().get();
-      unsigned char* p2 = IH2.GetRawData().get();
-      unsigned char* p3 = IH3.GetRawData().get();
+         __m128i sum01, count01, sum23, count23;
+         _sumBlocksSSE2(a0, b0, sum01, count01);
+         _sumBlocksSSE2(a1, b1, sum23, count23);
 
-      unsigned char cr;
-      unsigned char cg;
-      unsigned char cb;
-      unsigned char ca;
+         __m128i result = _mm_packus_epi16(_divideSSE2(sum01, count01), _divideSSE2(sum23, count23));
+         _mm_storeu_si128((__m128i*)(pOut + 4*x), result);
+      }
+#endif
 
-      for (int y=0;y<tilesize;y++)
+      for (;x<nOut;x++)
       {
-         for (int x=0;x<tilesize;x++)
+         size_t adr = 8*size_t(x);
+         unsigned char* pPixel = pOut + 4*size_t(x);
+         _getInterpolatedColor(pRow, adr, adr+4, stride+adr, stride+adr+4, pPixel, pPixel+1, pPixel+2, pPixel+3);
+      }
+   }
+
+   //---------------------------------------------------------------------------
+   // downsample two rows (pRow and pRow+stride) of a raw child tile to nOut values
+   inline void _downsampleRawRow(const float* pRow, size_t stride, float* pOut, int nOut)
+   {
+      int x = 0;
+
+#ifdef _USE_SSE2
+      const __m128 nodata = _mm_set1_ps(rawNodata);
+      const __m128 zero = _mm_setzero_ps();
+      const __m128 one = _mm_set1_ps(1.0f);
+
+      for (;x+4<=nOut;x+=4)
+      {
+         __m128 a0 = _mm_loadu_ps(pRow + 2*x);
+         __m128 a1 = _mm_loadu_ps(pRow + 2*x + 4);
+         __m128 b0 = _mm_loadu_ps(pRow + stride + 2*x);
+         __m128 b1 = _mm_loadu_ps(pRow + stride + 2*x + 4);
+
+         __m128 ma0 = _mm_cmpneq_ps(a0, nodata);
+         __m128 ma1 = _mm_cmpneq_ps(a1, nodata);
+         __m128 mb0 = _mm_cmpneq_ps(b0, nodata);
+         __m128 mb1 = _mm_cmpneq_ps(b1, nodata);
+
+         // vertical sums of valid values, then sums of horizontal pairs
+         __m128 s0 = _mm_add_ps(_mm_and_ps(ma0, a0), _mm_and_ps(mb0, b0));
+         __m128 s1 = _mm_add_ps(_mm_and_ps(ma1, a1), _mm_and_ps(mb1, b1));
+         __m128 n0 = _mm_add_ps(_mm_and_ps(ma0, one), _mm_and_ps(mb0, one));
+         __m128 n1 = _mm_add_ps(_mm_and_ps(ma1, one), _mm_and_ps(mb1, one));
+
+         __m128 sum = _mm_add_ps(_mm_shuffle_ps(s0, s1, _MM_SHUFFLE(2,0,2,0)), _mm_shuffle_ps(s0, s1, _MM_SHUFFLE(3,1,3,1)));
+         __m128 count = _mm_add_ps(_mm_shuffle_ps(n0, n1, _MM_SHUFFLE(2,0,2,0)), _mm_shuffle_ps(n0, n1, _MM_SHUFFLE(3,1,3,1)));
+
+         __m128 valid = _mm_cmpgt_ps(count, zero);
+         __m128 result = _mm_div_ps(sum, _mm_max_ps(count, one));
+         result = _mm_or_ps(_mm_and_ps(valid, result), _mm_andnot_ps(valid, nodata));
+
+         _mm_storeu_ps(pOut + x, result);
+      }
+#endif
+
+      for (;x<nOut;x++)
+      {
+         size_t adr = 2*size_t(x);
+         _getInterpolatedRawColor(pRow, adr, adr+1, stride+adr, stride+adr+1, &pOut[x]);
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+
+void _downsampleTiles(const unsigned char* p0, const unsigned char* p1, const unsigned char* p2, const unsigned char* p3, unsigned char* pTarget)
+{
+   // A B
+   // C D
+   const unsigned char* pChild[4] = {p0, p1, p2, p3};
+   const int half = tilesize/2;
+
+   for (int q=0;q<4;q++)
+   {
+      int ox = (q & 1) * half;
+      int oy = (q >> 1) * half;
+
+      for (int y=0;y<half;y++)
+      {
+         unsigned char* pOut = pTarget + 4*((oy+y)*tilesize + ox);
+
+         if (pChild[q])
          {
-            size_t adr = 4*y*tilesize+4*x;
+            _downsampleRow(pChild[q] + 4*(2*y)*tilesize, 4*tilesize, pOut, half);
+         }
+         else
+         {
+            memset(pOut, 0, 4*half);
+         }
+      }
+   }
+}
 
-            if (y<tilesize/2)
-            {
-               if (x<tilesize/2)
-               {
-                  // A
-                  if (p0)
-                  {
-                     int x0 = 2*x;
-                     int y0 = 2*y; 
-                     int x1 = x0+1;
-                     int y1 = y0+1;
-
-                     size_t tileadr0 = 4*y0*tilesize+4*x0;
-                     size_t tileadr1 = 4*y0*tilesize+4*x1;
-                     size_t tileadr2 = 4*y1*tilesize+4*x0;
-                     size_t tileadr3 = 4*y1*tilesize+4*x1;
-
-                     _getInterpolatedColor(p0, tileadr0, tileadr1, tileadr2, tileadr3, &cr, &cg, &cb, &ca);
-                  }
-                  else
-                  {
-                     cr = cg = cb = ca = 0;
-                  }
-               }
-               else
-               {
-                  // B 
-                  if (p1)
-                  {
-                     int x0 = 2*(x-tilesize/2);
-                     int y0 = 2*y; 
-                     int x1 = x0+1;
-                     int y1 = y0+1;
-
-                     size_t tileadr0 = 4*y0*tilesize+4*x0;
-                     size_t tileadr1 = 4*y0*tilesize+4*x1;
-                     size_t tileadr2 = 4*y1*tilesize+4*x0;
-                     size_t tileadr3 = 4*y1*tilesize+4*x1;
-
-                     _getInterpolatedColor(p1, tileadr0, tileadr1, tileadr2, tileadr3, &cr, &cg, &cb, &ca);
-                  }
-                  else
-                  {
-                     cr = cg = cb = ca = 0;
-                  }
-               }
-            }
-            else
+//------------------------------------------------------------------------------
+
+void _downsampleRawTiles(const float* p0, const float* p1, const float* p2, const float* p3, float* pTarget)
+{
+   // A B
+   // C D
+   const float* pChild[4] = {p0, p1, p2, p3};
+   const int half = tilesize/2;
+
+   for (int q=0;q<4;q++)
+   {
+      int ox = (q & 1) * half;
+      int oy = (q >> 1) * half;
+
+      for (int y=0;y<half;y++)
+      {
+         float* pOut = pTarget + (oy+y)*tilesize + ox;
+
+         if (pChild[q])
+         {
+            _downsampleRawRow(pChild[q] + (2*y)*tilesize, tilesize, pOut, half);
+         }
+         else
+         {
+            for (int x=0;x<half;x++)
             {
-               if (x<tilesize/2)
-               {
-                  // C
-                  if (p2)
-                  {
-                     int x0 = 2*x;
-                     int y0 = 2*(y-tilesize/2); 
-                     int x1 = x0+1;
-                     int y1 = y0+1;
-
-                     size_t tileadr0 = 4*y0*tilesize+4*x0;
-                     size_t tileadr1 = 4*y0*tilesize+4*x1;
-                     size_t tileadr2 = 4*y1*tilesize+4*x0;
-                     size_t tileadr3 = 4*y1*tilesize+4*x1;
-
-                     _getInterpolatedColor(p2, tileadr0, tileadr1, tileadr2, tileadr3, &cr, &cg, &cb, &ca);
-                  }
-                  else
-                  {
-                     cr = cg = cb = ca = 0;
-                  }
-               }
-               else
-               {
-                  // D 
-                  if (p3)
-                  {
-                     int x0 = 2*(x-tilesize/2); 
-                     int y0 = 2*(y-tilesize/2); 
-                     int x1 = x0+1;
-                     int y1 = y0+1;
-
-                     size_t tileadr0 = 4*y0*tilesize+4*x0;
-                     size_t tileadr1 = 4*y0*tilesize+4*x1;
-                     size_t tileadr2 = 4*y1*tilesize+4*x0;
-                     size_t tileadr3 = 4*y1*tilesize+4*x1;
-
-                     _getInterpolatedColor(p3, tileadr0, tileadr1, tileadr2, tileadr3, &cr, &cg, &cb, &ca);
-                  }
-                  else
-                  {
-                     cr = cg = cb = ca = 0;
-                  }
-               }
+               pOut[x] = rawNodata;
             }
+         }
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+// Depth first pyramid generation
+//------------------------------------------------------------------------------
+
+namespace
+{
+   // tile extent at specified level of detail
+   inline void _getPyramidExtent(const PyramidSetup& setup, int lod, int64& x0, int64& y0, int64& x1, int64& y1)
+   {
+      int shift = setup.maxlod - lod;
+      x0 = setup.tx0 >> shift;
+      y0 = setup.ty0 >> shift;
+      x1 = setup.tx1 >> shift;
+      y1 = setup.ty1 >> shift;
+   }
 
-            tile.tile[adr+0] = cr;
-            tile.tile[adr+1] = cg;
-            tile.tile[adr+2] = cb;
-            tile.tile[adr+3] = ca;
+   //---------------------------------------------------------------------------
+   // occupancy index of level of detail or 0
+   inline TileOccupancy* _getOccupancy(const PyramidSetup& setup, int lod)
+   {
+      return setup.vOccupancy.empty() ? 0 : setup.vOccupancy[lod].get();
+   }
+
+   //---------------------------------------------------------------------------
+   // load tile from tile store (tiles at maxlod)
+   PyramidTile _loadPyramidTile(const PyramidSetup& setup, int lod, int64 x, int64 y)
+   {
+      PyramidTile tile;
+      std::vector<unsigned char> vData;
+
+      TileOccupancy* pOccupancy = _getOccupancy(setup, lod);
+      if (pOccupancy)
+      {
+         TileOccupancy::ETileState state = pOccupancy->GetState(x, y, &tile.value);
+         if (state != TileOccupancy::TILE_DATA)
+         {
+            tile.state = state;
+            return tile;
          }
       }
 
-      ImageWriter::WritePNG(sCurrentTile, tile.tile, tilesize, tilesize);
+      if (setup.rawData)
+      {
+         Raw32ImageObject image;
+         if (_loadRawTile(setup.qTileStore.get(), lod, x, y, image, vData))
+         {
+            tile.raw = image.GetRawData();
+            tile.state = TileOccupancy::TILE_DATA;
+         }
+      }
+      else
+      {
+         ImageObject image;
+         if (_loadTile(setup.qTileStore.get(), lod, x, y, image, vData))
+         {
+            tile.rgba = image.GetRawData();
+            tile.state = TileOccupancy::TILE_DATA;
+         }
+      }
+
+      return tile;
+   }
+
+   //---------------------------------------------------------------------------
+   // pixels of tile, 0 for empty tiles. Uniform tiles are created in vTemp.
+   const void* _getPyramidPixels(const PyramidTile& tile, bool rawData, boost::shared_array<unsigned char>& vTemp)
+   {
+      if (tile.state == TileOccupancy::TILE_UNIFORM)
+      {
+         vTemp = boost::shared_array<unsigned char>(new unsigned char[4*tilesize*tilesize]);
+         TileOccupancy::Fill(vTemp.get(), tilesize*tilesize, tile.value);
+         return vTemp.get();
+      }
+
+      return rawData ? (const void*)tile.raw.get() : (const void*)tile.rgba.get();
+   }
+
+   //---------------------------------------------------------------------------
+   // create tile from its four children (in quadkey order), write it to the tile store and return it.
+   // Tiles without children are not written, empty and uniform tiles are only recorded in the occupancy index.
+   PyramidTile _writePyramidTile(const PyramidSetup& setup, int lod, int64 x, int64 y, const PyramidTile* children)
+   {
+      PyramidTile tile;
+      TileOccupancy* pOccupancy = _getOccupancy(setup, lod);
+
+      TileOccupancy::ETileState state[4];
+      unsigned int value[4];
+      for (int i=0;i<4;i++)
+      {
+         state[i] = children[i].state;
+         value[i] = children[i].value;
+      }
+
+      if (_getParentState(state, value, setup.rawData, tile.state, tile.value))
+      {
+         _recordTile(pOccupancy, x, y, tile.state, tile.value);
+         return tile;
+      }
+
+      boost::shared_array<unsigned char> vTemp[4];
+      const void* p[4];
+      for (int i=0;i<4;i++)
+      {
+         p[i] = _getPyramidPixels(children[i], setup.rawData, vTemp[i]);
+      }
+
+      void* pTile;
+      if (setup.rawData)
+      {
+         tile.raw = boost::shared_array<float>(new float[tilesize*tilesize]);
+         _downsampleRawTiles((const float*)p[0], (const float*)p[1], (const float*)p[2], (const float*)p[3], tile.raw.get());
+         pTile = tile.raw.get();
       }
       else
       {
-         qQuadtree->QuadKeyToTileCoord(qcCurrent, _tx, _ty, tmp_lod);
-         std::string sCurrentTile = ProcessingUtils::GetTilePath(sTileDir, ".raw" , tmp_lod, _tx, _ty);
+         tile.rgba = boost::shared_array<unsigned char>(new unsigned char[4*tilesize*tilesize]);
+         _downsampleTiles((const unsigned char*)p[0], (const unsigned char*)p[1], (const unsigned char*)p[2], (const unsigned char*)p[3], tile.rgba.get());
+         pTile = tile.rgba.get();
+      }
 
-         qQuadtree->QuadKeyToTileCoord(qc0, _tx, _ty, tmp_lod);
-         std::string sTilefile0 = ProcessingUtils::GetTilePath(sTileDir, ".raw" , tmp_lod, _tx, _ty);
-         
+      tile.state = TileOccupancy::TILE_DATA;
+      if (pOccupancy)
+      {
+         tile.state = TileOccupancy::Classify(pTile, tilesize*tilesize, _emptyValue(setup.rawData), tile.value);
+      }
 
-         qQuadtree->QuadKeyToTileCoord(qc1, _tx, _ty, tmp_lod);
-         std::string sTilefile1 = ProcessingUtils::GetTilePath(sTileDir, ".raw" , tmp_lod, _tx, _ty);
+      if (tile.state == TileOccupancy::TILE_DATA)
+      {
+         if (setup.rawData)
+         {
+            _storeRawTile(setup.qTileStore.get(), lod, x, y, tile.raw.get());
+         }
+         else
+         {
+            _storeTile(setup.qTileStore.get(), lod, x, y, tile.rgba.get());
+         }
+      }
+      else
+      {
+         tile.raw.reset();
+         tile.rgba.reset();
+      }
+
+      _recordTile(pOccupancy, x, y, tile.state, tile.value);
+
+      return tile;
+   }
 
-         qQuadtree->QuadKeyToTileCoord(qc2, _tx, _ty, tmp_lod);
-         std::string sTilefile2 = ProcessingUtils::GetTilePath(sTileDir, ".raw" , tmp_lod, _tx, _ty);
+   //---------------------------------------------------------------------------
+   // create tile and all tiles below it (depth first). Only one path of the
+   // subtree is kept in memory: at most 4 tiles per level of detail.
+   PyramidTile _buildPyramidTile(const PyramidSetup& setup, int lod, int64 x, int64 y)
+   {
+      PyramidTile children[4];
 
-         qQuadtree->QuadKeyToTileCoord(qc3, _tx, _ty, tmp_lod);
-         std::string sTilefile3 = ProcessingUtils::GetTilePath(sTileDir, ".raw" , tmp_lod, _tx, _ty);
+      int64 cx0, cy0, cx1, cy1;
+      _getPyramidExtent(setup, lod+1, cx0, cy0, cx1, cy1);
 
-         Raw32ImageObject IH0, IH1, IH2, IH3;
+      for (int i=0;i<4;i++)
+      {
+         // quadkey digit i: bit 0 is x, bit 1 is y
+         int64 cx = 2*x + (i & 1);
+         int64 cy = 2*y + (i >> 1);
 
-         bool b0 = ImageLoader::LoadRaw32FromDisk(sTilefile0, tilesize,tilesize, IH0);
-         bool b1 = ImageLoader::LoadRaw32FromDisk(sTilefile1, tilesize,tilesize, IH1);
-         bool b2 = ImageLoader::LoadRaw32FromDisk(sTilefile2, tilesize,tilesize, IH2);
-         bool b3 = ImageLoader::LoadRaw32FromDisk(sTilefile3, tilesize,tilesize, IH3);
-         _resampleRawImages(&IH0,&IH1,&IH2,&IH3,sCurrentTile,tilesize,b0,b1,b2,b3);
+         if (lod+1 == setup.maxlod)
+         {
+            children[i] = _loadPyramidTile(setup, lod+1, cx, cy);
+         }
+         else if (cx>=cx0 && cx<=cx1 && cy>=cy0 && cy<=cy1)
+         {
+            children[i] = _buildPyramidTile(setup, lod+1, cx, cy);
+         }
       }
+
+      return _writePyramidTile(setup, lod, x, y, children);
+   }
 }
 
 //------------------------------------------------------------------------------
-   void _resampleRawImages(Raw32ImageObject* IH0, Raw32ImageObject* IH1,Raw32ImageObject* IH2,Raw32ImageObject* IH3, std::string sTargetFile, int tilesize,bool b0, bool b1, bool b2, bool b3) 
+
+void _resamplePyramid(const PyramidSetup& setup, boost::shared_ptr<Logger> qLogger)
+{
+   if (setup.maxlod < 2)
+      return;
+
+   // The subtrees below the first level with enough tiles for all threads
+   // are created in parallel. This level is at most maxlod-1.
+   int nThreads = omp_get_max_threads();
+   int splitlod = 1;
+   int64 x0, y0, x1, y1;
+   _getPyramidExtent(setup, splitlod, x0, y0, x1, y1);
+
+   while (splitlod < setup.maxlod-1 && (x1-x0+1)*(y1-y0+1) < 4*nThreads)
    {
+      splitlod++;
+      _getPyramidExtent(setup, splitlod, x0, y0, x1, y1);
+   }
 
-      float* p0 = IH0->GetRawData().get();
-      float* p1 = IH1->GetRawData().get();
-      float* p2 = IH2->GetRawData().get();
-      float* p3 = IH3->GetRawData().get();
-      
-      
-     
-      boost::shared_array<float> sampleTile = boost::shared_array<float>(new float[tilesize*tilesize]);
-      memset(sampleTile.get(),0,tilesize*tilesize*sizeof(float));
+   // the index of maxlod is complete, the indices of the other levels are
+   // needed to know which tiles were recorded by previous runs.
+   for (size_t lod=0;lod<setup.vOccupancy.size();lod++)
+   {
+      setup.vOccupancy[lod]->Load();
+   }
+
+   std::ostringstream oss;
+   oss << "Processing Level of Detail " << setup.maxlod-1 << " to " << splitlod << " (depth first)";
+   qLogger->Info(oss.str());
 
-       
-      for (int y=0;y<tilesize;y++)
+   int64 w = x1-x0+1;
+   int64 h = y1-y0+1;
+   std::vector<PyramidTile> vLevel((size_t)(w*h));
+
+#  pragma omp parallel for schedule(dynamic)
+   for (int64 i=0;i<w*h;i++)
+   {
+      vLevel[(size_t)i] = _buildPyramidTile(setup, splitlod, x0 + i % w, y0 + i / w);
+   }
+
+   // the remaining levels are created from the tiles of the previous level in memory.
+   for (int lod=splitlod-1;lod>0;lod--)
+   {
+      std::ostringstream osslod;
+      osslod << "Processing Level of Detail " << lod;
+      qLogger->Info(osslod.str());
+
+      int64 px0, py0, px1, py1;
+      _getPyramidExtent(setup, lod, px0, py0, px1, py1);
+      int64 pw = px1-px0+1;
+      int64 ph = py1-py0+1;
+      std::vector<PyramidTile> vParent((size_t)(pw*ph));
+
+#     pragma omp parallel for
+      for (int64 i=0;i<pw*ph;i++)
       {
-         for (int x=0;x<tilesize;x++)
+         int64 x = px0 + i % pw;
+         int64 y = py0 + i / pw;
+         PyramidTile children[4];
+
+         for (int c=0;c<4;c++)
          {
-            float cvalue = -9999.0f;
-            size_t adr = y*tilesize+x;
+            int64 cx = 2*x + (c & 1);
+            int64 cy = 2*y + (c >> 1);
 
-            if (y<tilesize/2)
-            {
-               if (x<tilesize/2)
-               {
-                  // A
-                  if (b0)
-                  {
-                     int x0 = 2*x;
-                     int y0 = 2*y; 
-                     int x1 = x0+1;
-                     int y1 = y0+1;
-
-                     size_t tileadr0 = y0*tilesize+x0;
-                     size_t tileadr1 = y0*tilesize+x1;
-                     size_t tileadr2 = y1*tilesize+x0;
-                     size_t tileadr3 = y1*tilesize+x1;
-
-                     _getInterpolatedRawColor(p0, tileadr0, tileadr1, tileadr2, tileadr3, &cvalue);
-                  }
-                  else
-                  {
-                     cvalue = -9999.0f;
-                  }
-               }
-               else
-               {
-                  // B 
-                  if (b1)
-                  {
-                     int x0 = 2*(x-tilesize/2);
-                     int y0 = 2*y; 
-                     int x1 = x0+1;
-                     int y1 = y0+1;
-
-                     size_t tileadr0 = y0*tilesize+x0;
-                     size_t tileadr1 = y0*tilesize+x1;
-                     size_t tileadr2 = y1*tilesize+x0;
-                     size_t tileadr3 = y1*tilesize+x1;
-
-                     _getInterpolatedRawColor(p1, tileadr0, tileadr1, tileadr2, tileadr3, &cvalue);
-                  }
-                  else
-                  {
-                     cvalue = -9999.0f;
-                  }
-               }
-            }
-            else
+            if (cx>=x0 && cx<=x1 && cy>=y0 && cy<=y1)
             {
-               if (x<tilesize/2)
-               {
-                  // C
-                  if (b2)
-                  {
-                     int x0 = 2*x;
-                     int y0 = 2*(y-tilesize/2); 
-                     int x1 = x0+1;
-                     int y1 = y0+1;
-
-                     size_t tileadr0 = y0*tilesize+x0;
-                     size_t tileadr1 = y0*tilesize+x1;
-                     size_t tileadr2 = y1*tilesize+x0;
-                     size_t tileadr3 = y1*tilesize+x1;
-
-                     _getInterpolatedRawColor(p2, tileadr0, tileadr1, tileadr2, tileadr3, &cvalue);
-                  }
-                  else
-                  {
-                     cvalue = -9999.0f;
-                  }
-               }
-               else
-               {
-                  // D 
-                  if (b3)
-                  {
-                     int x0 = 2*(x-tilesize/2); 
-                     int y0 = 2*(y-tilesize/2); 
-                     int x1 = x0+1;
-                     int y1 = y0+1;
-
-                     size_t tileadr0 = y0*tilesize+x0;
-                     size_t tileadr1 = y0*tilesize+x1;
-                     size_t tileadr2 = y1*tilesize+x0;
-                     size_t tileadr3 = y1*tilesize+x1;
-
-                     _getInterpolatedRawColor(p3, tileadr0, tileadr1, tileadr2, tileadr3, &cvalue);
-                  }
-                  else
-                  {
-                     cvalue = -9999.0f;
-                  }
-               }
+               children[c] = vLevel[(size_t)((cy-y0)*w + (cx-x0))];
             }
-           sampleTile[adr] = cvalue;
          }
+
+         vParent[(size_t)i] = _writePyramidTile(setup, lod, x, y, children);
+      }
+
+      vLevel.swap(vParent);
+      x0 = px0; y0 = py0; x1 = px1; y1 = py1;
+      w = pw; h = ph;
+   }
+
+   for (size_t lod=0;lod<setup.vOccupancy.size();lod++)
+   {
+      if (!setup.vOccupancy[lod]->Flush())
+      {
+         qLogger->Error("Failed writing occupancy index");
       }
-      ImageWriter::WriteRaw32(sTargetFile,tilesize, tilesize, sampleTile.get());
-   }
\ No newline at end of file
+   }
+}
+
+//------------------------------------------------------------------------------
@@ -9,6 +9,8 @@
 #include "string/FilenameUtils.h"
 #include "string/StringUtils.h"
 #include "io/FileSystem.h"
+#include "io/TileStore.h"
+#include "io/TileOccupancy.h"
 #include "geo/ImageLayerSettings.h"
 #include "image/ImageLoader.h"
 #include "image/ImageWriter.h"
@@ -27,6 +29,7 @@
 #define ERROR_IMAGELAYERSETTINGS 5
 //------------------------------------------------------------------------------
 const int tilesize = 256;
+const float rawNodata = -9999.0f; // no data value of raw (float) tiles
 //------------------------------------------------------------------------------
 
 // Holding/managing memory for an image tile
@@ -49,22 +52,43 @@ public:
    }
 
    unsigned char* tile;
+
+   // child tiles and file buffer, reused for every tile of this thread
+   ImageObject children[4];
+   Raw32ImageObject rawChildren[4];
+   std::vector<unsigned char> vData;
 };
 //------------------------------------------------------------------------------
 
    //------------------------------------------------------------------------------
+   // average of valid samples (adr0, adr1: upper row, adr2, adr3: lower row). rawNodata if there are no valid samples.
    inline void _getInterpolatedRawColor(const float* rgbData, const size_t adr0, const size_t adr1, const size_t adr2, const size_t adr3, float* v)
    {
-      float value = 0.0f;
       float v0, v1, v2, v3;
+      float n0, n1, n2, n3;
       
       v0 = rgbData[adr0];
       v1 = rgbData[adr1];
       v2 = rgbData[adr2];
       v3 = rgbData[adr3];
-      value = v0 + v1 + v2 + v3;
-      value/=4;
-      *v = (float)value;
+
+      n0 = (v0 != rawNodata) ? 1.0f : 0.0f;
+      n1 = (v1 != rawNodata) ? 1.0f : 0.0f;
+      n2 = (v2 != rawNodata) ? 1.0f : 0.0f;
+      n3 = (v3 != rawNodata) ? 1.0f : 0.0f;
+      v0 = (v0 != rawNodata) ? v0 : 0.0f;
+      v1 = (v1 != rawNodata) ? v1 : 0.0f;
+      v2 = (v2 != rawNodata) ? v2 : 0.0f;
+      v3 = (v3 != rawNodata) ? v3 : 0.0f;
+
+      // same order of summation as the SSE2 version
+      float value = (v0 + v2) + (v1 + v3);
+      float count = (n0 + n2) + (n1 + n3);
+
+      if (count == 4.0f)
+         *v = value * 0.25f;  // exact, avoids the division in the common case
+      else
+         *v = (count > 0.0f) ? value / count : rawNodata;
    }
 
 //------------------------------------------------------------------------------
@@ -142,8 +166,40 @@ inline void _getInterpolatedColor(const unsigned char* rgbData, const size_t adr
 //------------------------------------------------------------------------------
 TileBlock* _createTileBlockArray();
 void _destroyTileBlockArray(TileBlock* pTileBlockArray);
-void _resampleFromParent(TileBlock* pTileBlockArray, boost::shared_ptr<MercatorQuadtree> qQuadtree, int64 x, int64 y,int nLevelOfDetail, std::string sTileDir, bool rawData = false);
-void _resampleRawImages(Raw32ImageObject* IH0, Raw32ImageObject* IH1,Raw32ImageObject* IH2,Raw32ImageObject* IH3, std::string sTargetFile, int tilesize, bool b0, bool b1, bool b2, bool b3);
+// Create tile from its four children. pChildOccupancy/pOccupancy are the (loaded) occupancy indices of
+// the children and of the tile, or 0 if the layer has no occupancy index. Tiles without children are not written.
+void _resampleFromParent(TileBlock* pTileBlockArray, boost::shared_ptr<MercatorQuadtree> qQuadtree, int64 x, int64 y,int nLevelOfDetail, boost::shared_ptr<ITileStore> qTileStore, bool rawData = false, TileOccupancy* pChildOccupancy = 0, TileOccupancy* pOccupancy = 0);
+
+// 2x2 box filter of four child tiles (A B / C D) into target tile. Missing children (0) are transparent/rawNodata.
+// Transparent pixels and no data values are ignored. Uses SSE2 if available.
+void _downsampleTiles(const unsigned char* p0, const unsigned char* p1, const unsigned char* p2, const unsigned char* p3, unsigned char* pTarget);
+void _downsampleRawTiles(const float* p0, const float* p1, const float* p2, const float* p3, float* pTarget);
+
+//------------------------------------------------------------------------------
+// Tile kept in memory during pyramid generation (rgba for image layers, raw for raw layers).
+// Both are empty if the tile doesn't exist or is uniform (value is the pixel of uniform tiles).
+struct PyramidTile
+{
+   PyramidTile() : state(TileOccupancy::TILE_EMPTY), value(0) {}
+
+   TileOccupancy::ETileState state;
+   unsigned int value;
+   boost::shared_array<unsigned char> rgba;
+   boost::shared_array<float> raw;
+};
+
+struct PyramidSetup
+{
+   boost::shared_ptr<ITileStore> qTileStore;   // png tiles (image layers) or raw tiles (raw layers)
+   std::vector<boost::shared_ptr<TileOccupancy> > vOccupancy;  // occupancy index per level of detail, empty if the layer has no index
+   bool rawData;
+   int maxlod;
+   int64 tx0, ty0, tx1, ty1;  // tile extent at maxlod
+};
+
+// Create all levels of detail from maxlod-1 to 1. Every tile is created from its four children
+// while they are still in memory (depth first), so every tile is written once and never read back.
+void _resamplePyramid(const PyramidSetup& setup, boost::shared_ptr<Logger> qLogger);
 
 //------------------------------------------------------------------------------
 
@@ -32,7 +32,7 @@
 #include <iostream>
 #include <sstream>
 
-void _resampleElevationFromParent(boost::shared_ptr<MercatorQuadtree> qQuadtree, int64 x, int64 y,int nLevelOfDetail, std::string sTileDir, std::string sTempTileDir, int nMaxpoints)
+void _resampleElevationFromParent(boost::shared_ptr<MercatorQuadtree> qQuadtree, int64 x, int64 y,int nLevelOfDetail, std::string sTileDir, std::string sTempTileDir, int nMaxpoints, const std::string& sTileFormat)
 {
    // current tile:
    std::string qcCurrent = qQuadtree->TileCoordToQuadkey(x,y,nLevelOfDetail);
@@ -49,7 +49,7 @@ void _resampleElevationFromParent(boost::shared_ptr<MercatorQuadtree> qQuadtree,
 
    qQuadtree->QuadKeyToTileCoord(qcCurrent, _tx, _ty, tmp_lod);
    std::string sCurrentTile_binary = ProcessingUtils::GetTilePath(sTempTileDir, ".tri" , tmp_lod, _tx, _ty);
-   std::string sCurrentTile_json = ProcessingUtils::GetTilePath(sTileDir, ".json" , tmp_lod, _tx, _ty);
+   std::string sCurrentTile = ProcessingUtils::GetTilePath(sTileDir, ElevationTile::GetFileExtension(sTileFormat), tmp_lod, _tx, _ty);
 
    qQuadtree->QuadKeyToTileCoord(qc0, _tx, _ty, tmp_lod);
    std::string sTilefile0_binary = ProcessingUtils::GetTilePath(sTempTileDir, ".tri" , tmp_lod, _tx, _ty);
@@ -97,11 +97,7 @@ void _resampleElevationFromParent(boost::shared_ptr<MercatorQuadtree> qQuadtree,
    
    etCurrent.WriteBinary(sCurrentTile_binary);
    
-   std::string datastr = etCurrent.CreateJSON();
-
-   std::ofstream fout(sCurrentTile_json.c_str());
-   fout << datastr;
-   fout.close();
+   etCurrent.WriteTile(sCurrentTile, sTileFormat);
 
 }
 
@@ -24,7 +24,7 @@
 #include "geo/MercatorQuadtree.h"
 #include <string>
 
-void _resampleElevationFromParent(boost::shared_ptr<MercatorQuadtree> qQuadtree, int64 x, int64 y,int nLevelOfDetail, std::string sTileDir, std::string sTempTileDir, int nMaxpoints);
+void _resampleElevationFromParent(boost::shared_ptr<MercatorQuadtree> qQuadtree, int64 x, int64 y,int nLevelOfDetail, std::string sTileDir, std::string sTempTileDir, int nMaxpoints, const std::string& sTileFormat);
 
 
 
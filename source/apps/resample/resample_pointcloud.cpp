@@ -18,14 +18,183 @@
 
 #include "resample_pointcloud.h"
 #include "ogprocess.h"
+#include "math/CloudPoint.h"
 
 #include <iostream>
 #include <fstream>
 #include <boost/shared_ptr.hpp>
 #include <sstream>
-#include <iostream>
-#include <sstream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cmath>
 
-void _resamplePointCloudFromParent(int64 x, int64 y, int64 z, int nLevelOfDetail, std::string sTileDir, std::string sTempTileDir)
+//------------------------------------------------------------------------------
+
+namespace
 {
-}
\ No newline at end of file
+   // one sample per grid cell: the point closest to the grid cell center
+   struct SGridSample
+   {
+      CloudPoint pt;
+      double     dist2;
+   };
+
+   //---------------------------------------------------------------------------
+   // Point record as written by PointMap::ExportData
+   inline bool _ReadCloudPoint(std::istream& is, CloudPoint& pt)
+   {
+      is.read((char*)&pt.x, sizeof(double));
+      is.read((char*)&pt.y, sizeof(double));
+      is.read((char*)&pt.elevation, sizeof(double));
+      is.read((char*)&pt.r, sizeof(unsigned char));
+      is.read((char*)&pt.g, sizeof(unsigned char));
+      is.read((char*)&pt.b, sizeof(unsigned char));
+      is.read((char*)&pt.intensity, sizeof(int));
+      return is.good();
+   }
+
+   //---------------------------------------------------------------------------
+   inline void _WriteCloudPoint(std::ostream& os, const CloudPoint& pt)
+   {
+      os.write((char*)&pt.x, sizeof(double));
+      os.write((char*)&pt.y, sizeof(double));
+      os.write((char*)&pt.elevation, sizeof(double));
+      os.write((char*)&pt.r, sizeof(unsigned char));
+      os.write((char*)&pt.g, sizeof(unsigned char));
+      os.write((char*)&pt.b, sizeof(unsigned char));
+      os.write((char*)&pt.intensity, sizeof(int));
+   }
+
+   //---------------------------------------------------------------------------
+   inline int _GridCoord(double v, int nGrid)
+   {
+      int g = int(v*nGrid);
+      return g < 0 ? 0 : (g >= nGrid ? nGrid-1 : g);
+   }
+
+   //---------------------------------------------------------------------------
+   // scrambles grid cell index, used to drop grid cells evenly if the budget is exceeded
+   inline unsigned int _HashCell(unsigned int v)
+   {
+      v ^= v >> 16;
+      v *= 0x7feb352dU;
+      v ^= v >> 15;
+      v *= 0x846ca68bU;
+      v ^= v >> 16;
+      return v;
+   }
+
+   //---------------------------------------------------------------------------
+   struct SHashOrder
+   {
+      bool operator()(unsigned int a, unsigned int b) const
+      {
+         return _HashCell(a) < _HashCell(b);
+      }
+   };
+}
+
+//------------------------------------------------------------------------------
+
+std::string _pointCloudCellFilename(const std::string& sTempTileDir, int nLevelOfDetail, int64 x, int64 y, int64 z)
+{
+   std::ostringstream oss;
+   oss << sTempTileDir << nLevelOfDetail << "/" << x << "/" << y << "-" << z << ".dat";
+   return oss.str();
+}
+
+//------------------------------------------------------------------------------
+
+int64 _resamplePointCloudFromParent(int64 x, int64 y, int64 z, int nLevelOfDetail, const std::string& sTempTileDir, int nMaxpoints)
+{
+   // Point clouds mostly sample surfaces: a grid of n x n x n cells with
+   // n*n = nMaxpoints keeps about nMaxpoints points.
+   int nGrid = math::Max<int>(1, int(sqrt(double(nMaxpoints))));
+   double dInvCellSize = double(int64(1) << nLevelOfDetail);
+
+   std::map<unsigned int, SGridSample> mapGrid;
+   CloudPoint pt;
+   bool bChildren = false;
+
+   // children are streamed one by one, only the grid samples are kept in memory
+   for (int c=0;c<8;c++)
+   {
+      int64 cx = 2*x + (c & 1);
+      int64 cy = 2*y + ((c >> 1) & 1);
+      int64 cz = 2*z + ((c >> 2) & 1);
+
+      std::ifstream ifs(_pointCloudCellFilename(sTempTileDir, nLevelOfDetail+1, cx, cy, cz).c_str(), std::ios::binary);
+      if (!ifs.good())
+      {
+         continue;
+      }
+      bChildren = true;
+
+      while (_ReadCloudPoint(ifs, pt))
+      {
+         // position in parent cell [0,1)
+         double u = pt.x*dInvCellSize - double(x);
+         double v = pt.y*dInvCellSize - double(y);
+         double w = pt.elevation*dInvCellSize - double(z);
+
+         int gx = _GridCoord(u, nGrid);
+         int gy = _GridCoord(v, nGrid);
+         int gz = _GridCoord(w, nGrid);
+
+         double du = u*nGrid - (gx + 0.5);
+         double dv = v*nGrid - (gy + 0.5);
+         double dw = w*nGrid - (gz + 0.5);
+         double dist2 = du*du + dv*dv + dw*dw;
+
+         unsigned int cell = (unsigned int)((gz*nGrid + gy)*nGrid + gx);
+         std::map<unsigned int, SGridSample>::iterator it = mapGrid.find(cell);
+         if (it == mapGrid.end())
+         {
+            SGridSample sample;
+            sample.pt = pt;
+            sample.dist2 = dist2;
+            mapGrid.insert(std::pair<unsigned int, SGridSample>(cell, sample));
+         }
+         else if (dist2 < it->second.dist2)
+         {
+            it->second.pt = pt;
+            it->second.dist2 = dist2;
+         }
+      }
+   }
+
+   if (!bChildren || mapGrid.size() == 0)
+   {
+      return 0;
+   }
+
+   // volumetric data fills more grid cells than the budget: drop cells in scrambled order
+   std::vector<unsigned int> vCells;
+   vCells.reserve(mapGrid.size());
+   std::map<unsigned int, SGridSample>::iterator it;
+   for (it = mapGrid.begin(); it != mapGrid.end(); ++it)
+   {
+      vCells.push_back(it->first);
+   }
+   if ((int)vCells.size() > nMaxpoints)
+   {
+      std::nth_element(vCells.begin(), vCells.begin() + nMaxpoints, vCells.end(), SHashOrder());
+      vCells.resize(nMaxpoints);
+      std::sort(vCells.begin(), vCells.end());
+   }
+
+   std::ofstream of(_pointCloudCellFilename(sTempTileDir, nLevelOfDetail, x, y, z).c_str(), std::ios::binary);
+   if (!of.good())
+   {
+      std::cout << "###resample: can't write point cell " << nLevelOfDetail << "/" << x << "/" << y << "-" << z << "\n";
+      return 0;
+   }
+   for (size_t i=0;i<vCells.size();i++)
+   {
+      _WriteCloudPoint(of, mapGrid[vCells[i]].pt);
+   }
+   of.close();
+
+   return (int64)vCells.size();
+}
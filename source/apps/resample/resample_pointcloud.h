@@ -23,7 +23,14 @@
 #include "app/ProcessingSettings.h"
 #include <string>
 
-void _resamplePointCloudFromParent(int64 x, int64 y, int64 z, int nLevelOfDetail, std::string sTileDir, std::string sTempTileDir);
+// Create octree cell (x,y,z) at nLevelOfDetail from its eight child cells at nLevelOfDetail+1.
+// Cells are point files in the PointMap export layout (<sTempTileDir><lod>/<x>/<y>-<z>.dat).
+// The cell receives a spatially stratified subsample of at most nMaxpoints points.
+// Returns number of points written (0: no children, no file written).
+int64 _resamplePointCloudFromParent(int64 x, int64 y, int64 z, int nLevelOfDetail, const std::string& sTempTileDir, int nMaxpoints);
+
+// Filename of an octree cell in the PointMap export layout
+std::string _pointCloudCellFilename(const std::string& sTempTileDir, int nLevelOfDetail, int64 x, int64 y, int64 z);
 
 
 
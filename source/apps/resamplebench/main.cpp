@@ -0,0 +1,207 @@
+/*******************************************************************************
+#      ____               __          __  _      _____ _       _               #
+#     / __ \              \ \        / / | |    / ____| |     | |              #
+#    | |  | |_ __   ___ _ __ \  /\  / /__| |__ | |  __| | ___ | |__   ___      #
+#    | |  | | '_ \ / _ \ '_ \ \/  \/ / _ \ '_ \| | |_ | |/ _ \| '_ \ / _ \     #
+#    | |__| | |_) |  __/ | | \  /\  /  __/ |_) | |__| | | (_) | |_) |  __/     #
+#     \____/| .__/ \___|_| |_|\/  \/ \___|_.__/ \_____|_|\___/|_.__/ \___|     #
+#           | |                                                                #
+#           |_|                                                                #
+#                                                                              #
+#                                (c) 2011 by                                   #
+#           University of Applied Sciences Northwestern Switzerland            #
+#                     Institute of Geomatics Engineering                       #
+#                           martin.christen@fhnw.ch                            #
+********************************************************************************
+*     Licensed under MIT License. Read the file LICENSE for more information   *
+*******************************************************************************/
+
+/******************************************************************************/
+/* Benchmark of the 2x2 downsample kernels used by ogResample.                */
+/* The kernels (_downsampleTiles, _downsampleRawTiles) are compared against   */
+/* the per pixel reference loop on random 256x256 tiles. The program fails    */
+/* if the results differ.                                                     */
+/******************************************************************************/
+
+#include "../resample/resample.h"
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <boost/program_options.hpp>
+#include <omp.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define _USE_SSE2
+#endif
+
+//-----------------------------------------------------------------------------
+// Reference: one pixel at a time with a quadrant branch per pixel (A B / C D),
+// as ogResample did before the row kernels.
+
+void _referenceTiles(unsigned char* pChild[4], unsigned char* pTarget)
+{
+   const int half = tilesize/2;
+
+   for (int y=0;y<tilesize;y++)
+   {
+      for (int x=0;x<tilesize;x++)
+      {
+         size_t adr = 4*y*tilesize+4*x;
+         int q = (y<half ? 0 : 2) + (x<half ? 0 : 1);
+         unsigned char cr, cg, cb, ca;
+
+         if (pChild[q])
+         {
+            int x0 = 2*(x % half);
+            int y0 = 2*(y % half);
+            size_t tileadr0 = 4*y0*tilesize+4*x0;
+            size_t tileadr2 = 4*(y0+1)*tilesize+4*x0;
+            _getInterpolatedColor(pChild[q], tileadr0, tileadr0+4, tileadr2, tileadr2+4, &cr, &cg, &cb, &ca);
+         }
+         else
+         {
+            cr = cg = cb = ca = 0;
+         }
+
+         pTarget[adr+0] = cr;
+         pTarget[adr+1] = cg;
+         pTarget[adr+2] = cb;
+         pTarget[adr+3] = ca;
+      }
+   }
+}
+
+//-----------------------------------------------------------------------------
+
+void _referenceRawTiles(float* pChild[4], float* pTarget)
+{
+   const int half = tilesize/2;
+
+   for (int y=0;y<tilesize;y++)
+   {
+      for (int x=0;x<tilesize;x++)
+      {
+         size_t adr = y*tilesize+x;
+         int q = (y<half ? 0 : 2) + (x<half ? 0 : 1);
+
+         if (pChild[q])
+         {
+            int x0 = 2*(x % half);
+            int y0 = 2*(y % half);
+            size_t tileadr0 = y0*tilesize+x0;
+            size_t tileadr2 = (y0+1)*tilesize+x0;
+            _getInterpolatedRawColor(pChild[q], tileadr0, tileadr0+1, tileadr2, tileadr2+1, &pTarget[adr]);
+         }
+         else
+         {
+            pTarget[adr] = rawNodata;
+         }
+      }
+   }
+}
+
+//-----------------------------------------------------------------------------
+
+namespace po = boost::program_options;
+
+int main(int argc, char *argv[])
+{
+   po::options_description desc("Program-Options");
+   desc.add_options()
+       ("iterations", po::value<int>(), "[optional] number of tiles per measurement (default 2000)")
+       ;
+
+   po::variables_map vm;
+
+   bool bError = false;
+   int iterations = 2000;
+
+   try
+   {
+      po::store(po::parse_command_line(argc, argv, desc), vm);
+      po::notify(vm);
+   }
+   catch (std::exception&)
+   {
+      bError = true;
+   }
+
+   if (vm.count("iterations"))
+   {
+      iterations = vm["iterations"].as<int>();
+      if (iterations < 1)
+      {
+         std::cout << "iterations must be >= 1\n";
+         bError = true;
+      }
+   }
+
+   //---------------------------------------------------------------------------
+   if (bError)
+   {
+      std::cout << desc << "\n";
+      return 1;
+   }
+   //---------------------------------------------------------------------------
+
+   // random children with 20% transparent pixels and 0.2% no data values, child D is missing
+   srand(1);
+   std::vector<unsigned char> vChild[3];
+   std::vector<float> vRawChild[3];
+   unsigned char* pChild[4] = {0, 0, 0, 0};
+   float* pRawChild[4] = {0, 0, 0, 0};
+
+   for (int i=0;i<3;i++)
+   {
+      vChild[i].resize(4*tilesize*tilesize);
+      vRawChild[i].resize(tilesize*tilesize);
+      for (size_t k=0;k<vChild[i].size();k+=4)
+      {
+         vChild[i][k+0] = (unsigned char)(rand() % 256);
+         vChild[i][k+1] = (unsigned char)(rand() % 256);
+         vChild[i][k+2] = (unsigned char)(rand() % 256);
+         vChild[i][k+3] = (rand() % 5 == 0) ? 0 : (unsigned char)(1 + rand() % 255);
+      }
+      for (size_t k=0;k<vRawChild[i].size();k++)
+      {
+         vRawChild[i][k] = (rand() % 500 == 0) ? rawNodata : float(rand() % 100000) / 7.0f;
+      }
+      pChild[i] = &vChild[i][0];
+      pRawChild[i] = &vRawChild[i][0];
+   }
+
+   std::vector<unsigned char> vRef(4*tilesize*tilesize), vOut(4*tilesize*tilesize);
+   std::vector<float> vRawRef(tilesize*tilesize), vRawOut(tilesize*tilesize);
+
+   double t0 = omp_get_wtime();
+   for (int i=0;i<iterations;i++)
+      _referenceTiles(pChild, &vRef[0]);
+   double t1 = omp_get_wtime();
+   for (int i=0;i<iterations;i++)
+      _downsampleTiles(pChild[0], pChild[1], pChild[2], pChild[3], &vOut[0]);
+   double t2 = omp_get_wtime();
+   for (int i=0;i<iterations;i++)
+      _referenceRawTiles(pRawChild, &vRawRef[0]);
+   double t3 = omp_get_wtime();
+   for (int i=0;i<iterations;i++)
+      _downsampleRawTiles(pRawChild[0], pRawChild[1], pRawChild[2], pRawChild[3], &vRawOut[0]);
+   double t4 = omp_get_wtime();
+
+   bool bSame = (vRef == vOut);
+   bool bRawSame = (vRawRef == vRawOut);
+
+#ifdef _USE_SSE2
+   std::cout << "kernels       : SSE2\n";
+#else
+   std::cout << "kernels       : scalar\n";
+#endif
+   std::cout << "tiles         : " << iterations << " (" << tilesize << "x" << tilesize << ")\n";
+   std::cout << "rgba reference: " << 1e6*(t1-t0)/iterations << " us/tile\n";
+   std::cout << "rgba kernel   : " << 1e6*(t2-t1)/iterations << " us/tile" << (bSame ? "" : "  ### RESULT DIFFERS") << "\n";
+   std::cout << "raw reference : " << 1e6*(t3-t2)/iterations << " us/tile\n";
+   std::cout << "raw kernel    : " << 1e6*(t4-t3)/iterations << " us/tile" << (bRawSame ? "" : "  ### RESULT DIFFERS") << "\n";
+
+   return (bSame && bRawSame) ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
@@ -56,7 +56,9 @@
 #include <omp.h>
 #include "functions.h"
 #include "app/QueueManager.h"
+#include "app/SharedJobQueue.h"
 #include <boost/asio.hpp>
+#include <set>
 
 namespace po = boost::program_options;
 
@@ -65,6 +67,7 @@ namespace po = boost::program_options;
 struct SJob
 {
    int x, y, zoom;
+   int size;   // metatile size in tiles (x, y: top left tile)
 };
 
 //------------------------------------------------------------------------------
@@ -81,8 +84,10 @@ bool bUpdateMode;
 bool bVerbose = false;
 bool bGenerateJobs = false;
 bool bOverrideQueue;
+bool bSharedQueue = false;   // claim jobs from memory mapped queue (workers on one host)
 bool bOverrideTiles = true;
 int iAmount = 256;
+int iMetaTile = 1;   // render metatiles of iMetaTile x iMetaTile tiles
 bool bLockEnabled = false;
 double bounds[4];
 int minZoom;
@@ -94,26 +99,32 @@ double _dCompositionAlpha = 1.0;
 std::vector<Tile> vExpireList;
 std::string sJobQueueFile;
 std::string sProcessHostName;
+std::string sTileStore = "directory";
+boost::shared_ptr<ITileStore> g_qTileStore;
 QueueManager _QueueManager = QueueManager();
+SharedJobQueue _SharedJobQueue;
 
 //------------------------------------------------------------------------------
 
-void ProcessJob(const SJob& job)
+bool ProcessJob(const SJob& job)
 {
-   std::stringstream ss;
-   ss << output_path << job.zoom << "/" << job.x << "/" << job.y << ".png";
    std::stringstream ss1;
    ss1 << rootPath << "/" << _sCompositionLayer << "/tiles/";
    //std::cout << "..Render tile " << ss.str() << "on rank: " << rank << "   Tilesize: "<< g_map.getWidth() << " Projection: " << g_mapnikProj.params() << "\n";
    try
    {
 
-    TileRenderer::RenderTile(ss.str(),g_map,job.x,job.y,job.zoom,g_gProj,g_mapnikProj, bVerbose, bOverrideTiles, bLockEnabled,ss1.str(), _sCompositionMode, _dCompositionAlpha);
+    if (!TileRenderer::RenderMetaTile(g_qTileStore,g_map,job.x,job.y,job.zoom,job.size,g_gProj,g_mapnikProj, bVerbose, bOverrideTiles, bLockEnabled,ss1.str(), _sCompositionMode, _dCompositionAlpha))
+    {
+       return false;
+    }
    }catch(std::exception ex)
    {
       std::cout << std::cout << "[" << sProcessHostName<< "] ### RENDER ERROR @ z: "<< job.zoom<< "x: "<< job.x<< "y: "<< job.y << "\n";
       std::cout << std::cout << "[" << sProcessHostName<< "] ### -- Details " << ex.what() << "\n";
+      return false;
    }
+   return true;
 }
 
 //------------------------------------------------------------------------------------
@@ -156,33 +167,34 @@ void GenerateRenderJobs()
             FileSystem::makedir(output_path + szoom);
          int xlow = int(px0.a/256.0);
          int xhigh = int(px1.a/256.0) +1;
-         for(int x = xlow; x <= xhigh; x++)
+         int ylow = int(px0.b/256.0);
+         int yhigh = int(px1.b/256.0)+1;
+
+         // one job per metatile, metatiles are aligned to their size
+         int nMeta = math::Min<int>(iMetaTile, (int)math::Pow2(z));
+         xlow = math::Max<int>(xlow, 0) / nMeta * nMeta;
+         ylow = math::Max<int>(ylow, 0) / nMeta * nMeta;
+         xhigh = math::Min<int>(xhigh, (int)math::Pow2(z)-1);
+         yhigh = math::Min<int>(yhigh, (int)math::Pow2(z)-1);
+
+         for(int x = xlow; x < (xhigh/nMeta+1)*nMeta; x++)
          {
-            // Validate x co-ordinate
-            if((x < 0) || (x >= math::Pow2(z)))
-            {
-               continue;
-            }
-            // check if we have directories in place
+            // check if we have directories in place (all columns of the metatiles)
             std::string str_x = StringUtils::IntegerToString(x,10);
-            if(!FileSystem::DirExists(output_path + szoom + "/" + str_x))
+            if(g_qTileStore->NeedsColumnDirectories() && !FileSystem::DirExists(output_path + szoom + "/" + str_x))
                FileSystem::makedir(output_path + szoom + "/" + str_x);
-               
-            int ylow = int(px0.b/256.0);
-            int yhigh = int(px1.b/256.0)+1;
+         }
 
-            for(int y = ylow; y <= yhigh; y++)
+         for(int x = xlow; x <= xhigh; x+=nMeta)
+         {
+            for(int y = ylow; y <= yhigh; y+=nMeta)
             {
-               // Validate x co-ordinate
-               if((y < 0) || (y >= math::Pow2(z)))
-               {
-                  continue;
-               }
                QJob job;
                SJob work;
                work.x = x; 
                work.y = y;
                work.zoom = z;
+               work.size = nMeta;
                job.data = boost::shared_array<char>(new char[sizeof(SJob)]);
                memcpy(job.data.get(), &work, sizeof(SJob));
                job.size = sizeof(SJob);
@@ -201,22 +213,37 @@ void GenerateRenderJobs()
       // Generate jobs to render UPDATED tiles
       //--------------------------------------
       vExpireList = _readExpireList(expire_list);
+      std::set<std::pair<int, std::pair<int, int> > > setMetaTiles; // (zoom, (x, y)) of metatiles with jobs
       std::cout << "[" << sProcessHostName<< "] " << " Generating expired list jobs (z, x, y) starting from " << "(" << vExpireList[0].zoom << ", " << vExpireList[0].x << ", " << vExpireList[0].y << ")\n"<< std::flush;
       for(size_t i = 0; i < vExpireList.size(); i++)
       {
          Tile t = vExpireList[i];
+
+         // expired tiles of the same metatile are rendered by one job
+         int nMeta = math::Min<int>(iMetaTile, (int)math::Pow2(t.zoom));
+         t.x = t.x / nMeta * nMeta;
+         t.y = t.y / nMeta * nMeta;
+         if (!setMetaTiles.insert(std::make_pair(t.zoom, std::make_pair(t.x, t.y))).second)
+         {
+            continue;
+         }
+
          // generate folder structure
          std::string szoom = StringUtils::IntegerToString(t.zoom, 10);
          if(!FileSystem::DirExists(output_path + szoom))
             {FileSystem::makedir(output_path + szoom);}
-         std::string str_x = StringUtils::IntegerToString(t.x,10);
-         if(!FileSystem::DirExists(output_path + szoom + "/" + str_x))
-            {FileSystem::makedir(output_path + szoom + "/" + str_x);}
+         for(int x = t.x; x < t.x + nMeta; x++)
+         {
+            std::string str_x = StringUtils::IntegerToString(x,10);
+            if(g_qTileStore->NeedsColumnDirectories() && !FileSystem::DirExists(output_path + szoom + "/" + str_x))
+               {FileSystem::makedir(output_path + szoom + "/" + str_x);}
+         }
          QJob job;
          SJob work;
          work.x = t.x; 
          work.y = t.y;
          work.zoom = t.zoom;
+         work.size = nMeta;
          job.data = boost::shared_array<char>(new char[sizeof(SJob)]);
          memcpy(job.data.get(), &work, sizeof(SJob));
          job.size = sizeof(SJob);
@@ -272,9 +299,13 @@ int main ( int argc , char** argv)
       ("generatejobs","[optional] create a jobqueue which can be used in every process")
       ("overridejobqueue","[optional] overrides existing queue file if exist (only when generatejobs is set!)")
       ("amount", po::value<int>(), "[opional] define amount of jobs to be read for one process at the time")
+      ("sharedqueue", "[optional] fetch jobs lock-free from memory mapped queue (all processes must run on the same host)")
+      ("metatile", po::value<int>(), "[optional] generate jobs rendering metatiles of n x n tiles at once (power of 2, e.g. 8). Default is 1.")
       ("nooverride", "[opional] overriding existing tiles disabled")
       ("enablelocking", "[opional] lock files to prevent concurrency on parallel processes")
+      ("lockbackend", po::value<std::string>(), "[optional] lock backend: process, host or lockfile (default)")
       ("expirelist", po::value<std::string>(), "[optional] list of expired tiles for update rendering (global rendering will be disabled)")
+      ("tilestore", po::value<std::string>(), "[optional] tile store: directory (one file per tile, default) or pack (pack files per block of tiles)")
       ;
    po::variables_map vm;  
 
@@ -319,6 +350,13 @@ int main ( int argc , char** argv)
       bError = true;
 	
       
+   if(vm.count("tilestore"))
+      sTileStore = vm["tilestore"].as<std::string>();
+
+   g_qTileStore = ITileStore::Create(sTileStore, output_path, ".png");
+   if(!g_qTileStore)
+      bError = true;
+
    if(vm.count("minzoom"))
       minZoom = vm["minzoom"].as<int>();
       
@@ -340,12 +378,36 @@ int main ( int argc , char** argv)
    if(vm.count("amount"))
       iAmount = vm["amount"].as<int>();
 
+   if(vm.count("sharedqueue"))
+      bSharedQueue = true;
+
+   if(vm.count("metatile"))
+   {
+      iMetaTile = vm["metatile"].as<int>();
+      if(iMetaTile < 1 || iMetaTile > 64 || (iMetaTile & (iMetaTile-1)) != 0)
+         bError = true;
+   }
+
    if(vm.count("generatejobs"))
       bGenerateJobs = true;
 
    if(vm.count("enablelocking"))
       bLockEnabled = true;
 
+   if (vm.count("lockbackend"))
+   {
+      EFileLockBackend eBackend;
+      if (IFileLock::ParseBackend(vm["lockbackend"].as<std::string>(), eBackend))
+      {
+         FileSystem::SetLockBackend(eBackend);
+      }
+      else
+      {
+         std::cout << "unknown lock backend " << vm["lockbackend"].as<std::string>() << "\n";
+         bError = true;
+      }
+   }
+
    if(vm.count("overridejobqueue"))
    {
       bOverrideQueue = true;
@@ -488,7 +550,10 @@ int main ( int argc , char** argv)
          {
             jobs.clear();
             vecConverted.clear();
-            jobs = _QueueManager.FetchJobList(sJobQueueFile, sizeof(SJob), iAmount, bVerbose);
+            if (bSharedQueue)
+               jobs = _SharedJobQueue.FetchJobList(sJobQueueFile, sizeof(SJob), iAmount, bVerbose);
+            else
+               jobs = _QueueManager.FetchJobList(sJobQueueFile, sizeof(SJob), iAmount, bVerbose);
             if(jobs.size() > 0)
             {
                ConvertJobs(jobs, vecConverted);
@@ -506,7 +571,14 @@ int main ( int argc , char** argv)
 #endif
                   for(int index = 0; index < vecConverted.size(); index++)
                   {
-                     ProcessJob(vecConverted[index]);
+                     bool bOk = ProcessJob(vecConverted[index]);
+                     if (bSharedQueue)
+                     {
+                        if (bOk)
+                           _SharedJobQueue.CompleteJob(jobs[index]);
+                        else
+                           _SharedJobQueue.RequeueJob(jobs[index]);
+                     }
                      tileCount++;
                   }
 #ifndef _DEBUG
@@ -518,7 +590,7 @@ int main ( int argc , char** argv)
                std::cout << "--[" << sProcessHostName<< "] " << "  processing average " << subTps << " tiles per second.\n";
                std::cout << "--[" << sProcessHostName<< "] " << "  processed " << vecConverted.size() << " jobs\n       terminating with (z, x, y) " << "(" << last.zoom << ", " << last.x << ", " << last.y << ")\n"<< std::flush;
             }
-         }while(jobs.size() >= iAmount);
+         }while(jobs.size() >= iAmount || (bSharedQueue && jobs.size() > 0));
          t_1 = clock();
          double time=(double(t_1-t_0)/double(CLOCKS_PER_SEC));
          double tps = tileCount/time;
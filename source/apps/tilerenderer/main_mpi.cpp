@@ -77,6 +77,7 @@ std::string expire_list;
 bool bUpdateMode;
 bool bVerbose = false;
 int queueSize = 4096;
+bool bRootWorker = false;   // rank 0 processes jobs too
 double bounds[4];
 int iX = 0;
 int iY = 0;
@@ -290,6 +291,7 @@ int main ( int argc , char** argv)
          ("max_zoom", po::value<int>(), "[optional] max zoom level")
          ("bounds", po::value<std::vector<double>>(), "[optional] boundaries (default: -180.0 -90.0 180.0 90.0)")
          ("mpi_queue_size", po::value<int>(), "[optional] mpi queue size (Default: 10000)")
+         ("mpi_rootworker", "[optional] process jobs on rank 0 too")
          ("verbose", "[optional] Verbose mode")
          ("expired_list", po::value<std::string>(), "[optional] list of expired tiles for update rendering (global rendering will be disabled)")
          ;
@@ -359,6 +361,8 @@ int main ( int argc , char** argv)
 
       if(vm.count("mpi_queue_size"))
          queueSize = vm["mpi_queue_size"].as<int>();
+      if(vm.count("mpi_rootworker"))
+         bRootWorker = true;
 
       if(vm.count("verbose"))
          bVerbose = true;
@@ -421,6 +425,7 @@ int main ( int argc , char** argv)
    BroadcastBool(bUpdateMode,0);
 
    MPIJobManager<SJob> jobmgr(queueSize);
+   jobmgr.SetRootWorker(bRootWorker);
 
    //---------------------------------------------------------------------------
    //-- MAPNIK RENDERING PROCESS --------
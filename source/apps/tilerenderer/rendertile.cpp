@@ -22,79 +22,131 @@
 // Found at: http://trac.openstreetmap.org/browser/applications/rendering/mapnik
 //------------------------------------------------------------------------------
 #include "rendertile.h"
+#include <math/mathutils.h>
+#include <cstring>
+#include <iostream>
 
 //------------------------------------------------------------------------------
-void TileRenderer::RenderTile(std::string tile_uri, mapnik::Map m, int x, int y, int zoom, GoogleProjection tileproj, mapnik::projection prj, bool verbose, bool overrideTile, bool lockEnabled, std::string compositionLayerPath, std::string compositionMode, double compositionAlpha)
+bool TileRenderer::RenderTile(boost::shared_ptr<ITileStore> qTileStore, const mapnik::Map& m, int x, int y, int zoom, GoogleProjection tileproj, mapnik::projection prj, bool verbose, bool overrideTile, bool lockEnabled, std::string compositionLayerPath, std::string compositionMode, double compositionAlpha)
 {
-   if(!overrideTile && FileSystem::FileExists(tile_uri))
+   return RenderMetaTile(qTileStore, m, x, y, zoom, 1, tileproj, prj, verbose, overrideTile, lockEnabled, compositionLayerPath, compositionMode, compositionAlpha);
+}
+
+//------------------------------------------------------------------------------
+bool TileRenderer::RenderMetaTile(boost::shared_ptr<ITileStore> qTileStore, const mapnik::Map& m, int x, int y, int zoom, int size, GoogleProjection tileproj, mapnik::projection prj, bool verbose, bool overrideTile, bool lockEnabled, std::string compositionLayerPath, std::string compositionMode, double compositionAlpha)
+{
+   // metatiles at the border of the world are smaller
+   int nTiles = (int)math::Pow2(zoom);
+   int x1 = math::Min<int>(x + size, nTiles);
+   int y1 = math::Min<int>(y + size, nTiles);
+
+   // tiles to write
+   std::vector<int> vTileX, vTileY;
+   for (int ty = y; ty < y1; ty++)
    {
-      return;
+      for (int tx = x; tx < x1; tx++)
+      {
+         if (overrideTile || !qTileStore->Exists(zoom, tx, ty))
+         {
+            vTileX.push_back(tx);
+            vTileY.push_back(ty);
+         }
+      }
    }
-   else
+
+   if (vTileX.size() == 0)
    {
-	   
-       
-      // Calculate pixel positions of bottom-left & top-right
-      ituple p0(x * 256, (y + 1) * 256);
-      ituple p1((x + 1) * 256, y * 256);
+      return true;
+   }
+
+   int width = (x1-x)*256;
+   int height = (y1-y)*256;
+
+   // Calculate pixel positions of bottom-left & top-right
+   ituple p0(x * 256, y1 * 256);
+   ituple p1(x1 * 256, y * 256);
 
-      // Convert to LatLong (EPSG:4326)
-      dtuple l0 = tileproj.pixel2GeoCoord(p0, zoom);
-      dtuple l1 = tileproj.pixel2GeoCoord(p1, zoom);
+   // Convert to LatLong (EPSG:4326)
+   dtuple l0 = tileproj.pixel2GeoCoord(p0, zoom);
+   dtuple l1 = tileproj.pixel2GeoCoord(p1, zoom);
 
-	  
+   // Convert to map projection (e.g. mercator co-ords EPSG:900913)
+   dtuple c0(l0.a,l0.b);
+   dtuple c1(l1.a,l1.b);
+   prj.forward(c0.a, c0.b);
+   prj.forward(c1.a, c1.b);
 
-      // Convert to map projection (e.g. mercator co-ords EPSG:900913)
-      dtuple c0(l0.a,l0.b);
-      dtuple c1(l1.a,l1.b);
-      prj.forward(c0.a, c0.b);
-      prj.forward(c1.a, c1.b);
+   // the map is shared by all threads, the copy is resized to the metatile
+   mapnik::Map map(m);
 
-      // Bounding box for the tile
+   // Bounding box for the metatile
 #ifndef MAPNIK_2
-      mapnik::Envelope<double> bbox = mapnik::Envelope<double>(c0.a,c0.b,c1.a,c1.b);
-      m.resize(256,256);
-      m.zoomToBox(bbox);
+   mapnik::Envelope<double> bbox = mapnik::Envelope<double>(c0.a,c0.b,c1.a,c1.b);
+   map.resize(width,height);
+   map.zoomToBox(bbox);
 #else
-      mapnik::box2d<double> bbox(c0.a,c0.b,c1.a,c1.b);
-      m.resize(256,256);
-      m.zoom_to_box(bbox);
+   mapnik::box2d<double> bbox(c0.a,c0.b,c1.a,c1.b);
+   map.resize(width,height);
+   map.zoom_to_box(bbox);
 #endif
-      m.set_buffer_size(128);
-
-      // Render image with default Agg renderer
+   map.set_buffer_size(128);
 
+   // Render image with default Agg renderer
 #ifndef MAPNIK_2
-      mapnik::Image32 buf(m.getWidth(),m.getHeight());
-      mapnik::agg_renderer<mapnik::Image32> ren(m,buf);
+   mapnik::Image32 buf(width,height);
+   mapnik::agg_renderer<mapnik::Image32> ren(map,buf);
 #else
-      mapnik::image_32 buf(m.width(), m.height());
-      mapnik::agg_renderer<mapnik::image_32> ren(m,buf);
+   mapnik::image_32 buf(width,height);
+   mapnik::agg_renderer<mapnik::image_32> ren(map,buf);
 #endif
-      ren.apply();
-      if(lockEnabled)
-      {
-         int lockhandle = FileSystem::Lock(tile_uri);
+   ren.apply();
+
+   // slice metatile and encode tiles
+   // serial: the renderers already run one metatile per thread
+   const unsigned char* pMeta = buf.raw_data();
+   bool bResult = true;
+
+   for (int i = 0; i < (int)vTileX.size(); i++)
+   {
+      int tx = vTileX[i];
+      int ty = vTileY[i];
+      std::string tile_uri = qTileStore->GetTileName(zoom, tx, ty);
+
 #ifndef MAPNIK_2
-		 Compose(compositionLayerPath, compositionMode, compositionAlpha, m.getWidth(),m.getHeight(),&buf, zoom, x,y);
-         mapnik::save_to_file<mapnik::ImageData32>(buf.data(),tile_uri,"png");
+      mapnik::Image32 tile(256,256);
 #else
-	 Compose(compositionLayerPath, compositionMode, compositionAlpha, m.width(),m.height(),&buf, zoom, x,y);
-	 mapnik::save_to_file<mapnik::image_data_32>(buf.data(),tile_uri,"png");
+      mapnik::image_32 tile(256,256);
 #endif
-         FileSystem::Unlock(tile_uri, lockhandle);
+      unsigned char* pTile = (unsigned char*)tile.raw_data();
+      for (int row = 0; row < 256; row++)
+      {
+         memcpy(pTile + 4*256*row, pMeta + 4*(width*((ty-y)*256 + row) + (tx-x)*256), 4*256);
       }
-      else
+
+      int lockhandle = lockEnabled ? FileSystem::Lock(tile_uri) : -1;
+      try
       {
+         Compose(compositionLayerPath, compositionMode, compositionAlpha, 256, 256, &tile, zoom, tx, ty);
 #ifndef MAPNIK_2
-		 Compose(compositionLayerPath, compositionMode, compositionAlpha, m.getWidth(),m.getHeight(),&buf, zoom, x,y);
-         mapnik::save_to_file<mapnik::ImageData32>(buf.data(),tile_uri,"png");
+         std::string sPNG = mapnik::save_to_string<mapnik::ImageData32>(tile.data(),"png");
 #else
-		Compose(compositionLayerPath, compositionMode, compositionAlpha, m.width(),m.height(),&buf, zoom, x,y);
-		mapnik::save_to_file<mapnik::image_data_32>(buf.data(),tile_uri,"png");
+         std::string sPNG = mapnik::save_to_string<mapnik::image_data_32>(tile.data(),"png");
 #endif
+         if (!qTileStore->Write(zoom, tx, ty, (const unsigned char*)sPNG.data(), sPNG.size()))
+         {
+            std::cout << "### WRITE ERROR @ z: " << zoom << " x: " << tx << " y: " << ty << "\n";
+            bResult = false;
+         }
       }
+      catch (std::exception& ex)
+      {
+         std::cout << "### ENCODING ERROR @ z: " << zoom << " x: " << tx << " y: " << ty << " -- " << ex.what() << "\n";
+         bResult = false;
+      }
+      FileSystem::Unlock(tile_uri, lockhandle);
    }
+
+   return bResult;
 }
 
 #ifndef MAPNIK_2
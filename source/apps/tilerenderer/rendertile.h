@@ -34,14 +34,16 @@
 #include <mapnik/image_util.hpp>
 #include <mapnik/map.hpp>
 #include <io/FileSystem.h>
+#include <io/TileStore.h>
 #include <image/ImageLoader.h>
+#include <vector>
 
 class TileRenderer
 {
 public:
-	static void RenderTile(
-		std::string			tile_uri, 
-		mapnik::Map			m, 
+	static bool RenderTile(
+		boost::shared_ptr<ITileStore> qTileStore, 
+		const mapnik::Map&	m, 
 		int					x, 
 		int					y, 
 		int					zoom, 
@@ -54,6 +56,26 @@ public:
 		std::string			compositionMode = "overLay", 
 		double				compositionAlpha = 1.0
 		);
+
+	// Render a metatile of size x size tiles (x, y: top left tile) as one image and write its tiles.
+	// Datasource queries, label placement and the buffer are shared by all tiles of the metatile.
+	// Returns false if any tile could not be encoded or written.
+	static bool RenderMetaTile(
+		boost::shared_ptr<ITileStore> qTileStore, 
+		const mapnik::Map&	m, 
+		int					x, 
+		int					y, 
+		int					zoom, 
+		int					size, 
+		GoogleProjection	tileproj, 
+		mapnik::projection	prj, 
+		bool				verbose = false, 
+		bool				overrideTile = true, 
+		bool				lockEnabled = false, 
+		std::string			compositionLayerPath = "", 
+		std::string			compositionMode = "overLay", 
+		double				compositionAlpha = 1.0
+		);
 protected:
 #ifndef MAPNIK_2
 	static void Compose(std::string compositionLayerPath, std::string compositionMode, double compositionAlpha, int width, int height, mapnik::Image32* buf,int zz, int xx, int yy);
@@ -48,6 +48,7 @@ int main(int argc, char *argv[])
       ("layer", po::value<std::string>(), "name of layer to add the data")
       ("triangulate", "triangulate dataset")
       ("maxpoints", po::value<int>(), "[optional] max number of points per tile. Default is 512.")
+      ("format", po::value<std::string>(), "[optional] tile format: json or binary. Default is the format stored in the layer (json).")
       ("grid", "create grid [currently unsupported, do not use!]")
       ("numthreads", po::value<int>(), "force number of threads")
       ("verbose", "verbose output")
@@ -73,6 +74,7 @@ int main(int argc, char *argv[])
    bool bGrid = false;
    bool bVerbose = false;
    int nMaxpoints = 512; // default: max 512 points per tile (including corners and edges)
+   std::string sTileFormat; // empty: use format of layer settings
 
    //---------------------------------------------------------------------------
    // init options:
@@ -124,6 +126,15 @@ int main(int argc, char *argv[])
       }
    }
 
+   if (vm.count("format"))
+   {
+      sTileFormat = vm["format"].as<std::string>();
+      if (sTileFormat != "json" && sTileFormat != "binary")
+      {
+         bError = true;
+      }
+   }
+
    if (vm.count("grid"))
    {
       bGrid = true;
@@ -172,7 +183,7 @@ int main(int argc, char *argv[])
 
    if (bTriangulate)
    {
-      triangulate::process(qLogger, qSettings, nMaxpoints, sLayer, bVerbose);
+      triangulate::process(qLogger, qSettings, nMaxpoints, sLayer, bVerbose, sTileFormat);
    }
    else if (bGrid)
    {
@@ -31,6 +31,8 @@
 #include <fstream>
 #include <ctime>
 #include <algorithm>
+#include <map>
+#include <cstring>
 #include <omp.h>
 
 // uncomment to generate .obj instead of JSON (in temp directory)
@@ -135,8 +137,87 @@ namespace triangulate
    }
 
    //---------------------------------------------------------------------------
+   // points of a point tile (.pts), shared by all target tiles of its neighbourhood
+   typedef boost::shared_ptr<const std::vector<ElevationPoint> > PointTile;
 
-   int process(boost::shared_ptr<Logger> qLogger, boost::shared_ptr<ProcessingSettings> qSettings, int nMaxPoints, std::string sLayer, bool bVerbose)
+   //---------------------------------------------------------------------------
+   // read point tile (x, y, elevation, weight as doubles per point) with one read.
+   inline PointTile ReadPointTile(const std::string& sTilefile)
+   {
+      boost::shared_ptr<std::vector<ElevationPoint> > qPoints(new std::vector<ElevationPoint>());
+      std::vector<unsigned char> vData;
+
+      if (FileSystem::FileToMemory(sTilefile, vData))
+      {
+         const size_t nPointSize = 4*sizeof(double);
+         size_t nPoints = vData.size() / nPointSize;   // incomplete points are ignored
+         qPoints->resize(nPoints);
+
+         for (size_t i=0;i<nPoints;i++)
+         {
+            double values[4];
+            memcpy(values, &vData[i*nPointSize], nPointSize);
+            ElevationPoint& pt = (*qPoints)[i];
+            pt.x = values[0];
+            pt.y = values[1];
+            pt.elevation = values[2];
+            pt.weight = values[3];
+         }
+      }
+
+      return qPoints;
+   }
+
+   //---------------------------------------------------------------------------
+   // Point tiles of three consecutive rows of tiles for a sweep from north to
+   // south. Every point tile is read once, rows which are no longer needed
+   // are released.
+   class PointTileRows
+   {
+   public:
+      PointTileRows(const std::string& sTempTileDir, int lod, int64 x0, int64 x1)
+         : _sTempTileDir(sTempTileDir), _lod(lod), _x0(x0), _x1(x1) {}
+
+      // load rows y-1, y and y+1 (tiles of a row are read in parallel)
+      void MoveTo(int64 y)
+      {
+         while (!_rows.empty() && _rows.begin()->first < y-1)
+         {
+            _rows.erase(_rows.begin());
+         }
+
+         for (int64 row = y-1; row <= y+1; ++row)
+         {
+            if (_rows.find(row) != _rows.end())
+               continue;
+
+            std::vector<PointTile>& vRow = _rows[row];
+            vRow.resize((size_t)(_x1-_x0+1));
+
+            #pragma omp parallel for schedule(dynamic)
+            for (int64 x = _x0; x <= _x1; ++x)
+            {
+               vRow[(size_t)(x-_x0)] = ReadPointTile(ProcessingUtils::GetTilePath(_sTempTileDir, ".pts", _lod, x, row));
+            }
+         }
+      }
+
+      // points of tile (x, y), y must be in the current rows.
+      const std::vector<ElevationPoint>& Get(int64 x, int64 y) const
+      {
+         return *(_rows.find(y)->second[(size_t)(x-_x0)]);
+      }
+
+   protected:
+      std::string _sTempTileDir;
+      int _lod;
+      int64 _x0, _x1;
+      std::map<int64, std::vector<PointTile> > _rows;
+   };
+
+   //---------------------------------------------------------------------------
+
+   int process(boost::shared_ptr<Logger> qLogger, boost::shared_ptr<ProcessingSettings> qSettings, int nMaxPoints, std::string sLayer, bool bVerbose, std::string sTileFormat)
    {
       // Retrieve ElevationLayerSettings:
       std::ostringstream oss;
@@ -152,6 +233,18 @@ namespace triangulate
          return ERROR_ELVLAYERSETTINGS;
       }
 
+      // tile format is stored in layer settings, so resample and deploy use the same format
+      if (sTileFormat.length()>0 && sTileFormat != qElevationLayerSettings->GetTileFormat())
+      {
+         qElevationLayerSettings->SetTileFormat(sTileFormat);
+         if (!qElevationLayerSettings->Save(sElevationLayerDir))
+         {
+            qLogger->Error("Failed storing elevation layer settings!");
+            return ERROR_ELVLAYERSETTINGS;
+         }
+      }
+      sTileFormat = qElevationLayerSettings->GetTileFormat();
+
       int lod = qElevationLayerSettings->GetMaxLod();
       int64 layerTileX0, layerTileY0, layerTileX1, layerTileY1;
       qElevationLayerSettings->GetTileExtent(layerTileX0, layerTileY0, layerTileX1, layerTileY1);
@@ -162,6 +255,7 @@ namespace triangulate
          oss << "     name = " << qElevationLayerSettings->GetLayerName() << "\n";
          oss << "   maxlod = " << lod << "\n";
          oss << "   extent = " << layerTileX0 << ", " << layerTileY0 << ", " << layerTileX1 << ", " << layerTileY1 << "\n";
+         oss << "   format = " << sTileFormat << "\n";
          qLogger->Info(oss.str());
          oss.str("");
       }
@@ -200,56 +294,22 @@ namespace triangulate
          oss.str("");
       }
 
+      // Tiles are processed row by row. The point tiles of the current and the
+      // neighbouring rows are kept in memory, so every point tile is read once.
+      PointTileRows oPointTiles(sTempTileDir, lod, layerTileX0, layerTileX1);
+
+      for (int64 yy = layerTileY0+1; yy < layerTileY1; ++yy)
+      {
+         oPointTiles.MoveTo(yy);
+
 #ifndef _DEBUG
-#     pragma omp parallel for
+#        pragma omp parallel for schedule(dynamic)
 #endif
-      for (int64 xx = layerTileX0+1; xx < layerTileX1; ++xx)
-      {
-         for (int64 yy = layerTileY0+1; yy < layerTileY1; ++yy)
+         for (int64 xx = layerTileX0+1; xx < layerTileX1; ++xx)
          {
             std::string sCurrentQuadcode = qQuadtree->TileCoordToQuadkey(xx,yy,lod);
 
-            //std::cout << sCurrentQuadcode << "\n";
-            std::vector<ElevationPoint> vecPts;
-
-            for (int ty=-1;ty<=1;ty++)
-            {
-               for (int tx=-1;tx<=1;tx++)
-               {
-                  std::string sQuadcode = qQuadtree->TileCoordToQuadkey(xx+tx,yy+ty,lod);
-                  std::string sTilefile = ProcessingUtils::GetTilePath(sTempTileDir, ".pts" , lod, xx+tx, yy+ty);
-                  
-                  double sx0, sy1, sx1, sy0;
-                  qQuadtree->QuadKeyToMercatorCoord(sQuadcode, sx0, sy1, sx1, sy0);
-
-
-                  //std::cout << "   " << sTilefile << "\n";
-
-                  std::ifstream fin;
-                  fin.open(sTilefile.c_str(), std::ios::binary);
-                  if (fin.good())
-                  {
-                     while (!fin.eof())
-                     {
-                        ElevationPoint pt;
-                        fin.read((char*)&(pt.x), sizeof(double));
-                        fin.read((char*)&(pt.y), sizeof(double));
-                        fin.read((char*)&(pt.elevation), sizeof(double));
-                        fin.read((char*)&(pt.weight), sizeof(double));
-                        if (!fin.eof())
-                        {
-                           vecPts.push_back(pt);
-                        }
-
-
-                     }
-                  }
-                  fin.close();
-
-               }
-            }
-            
-            // all points are in vecPts now -> triangulate and see if coverage is big enough
+            // all points of the 3x3 neighbourhood -> triangulate and see if coverage is big enough
 
             double x0,y0,x1,y1;
             qQuadtree->QuadKeyToMercatorCoord(sCurrentQuadcode, x0, y1, x1, y0);
@@ -259,19 +319,28 @@ namespace triangulate
             double yy0 = y0-len;
             double yy1 = y1+len;
 
-            int cnt = 0;
+            std::vector<ElevationPoint> vecPts;
             math::DelaunayTriangulation oTriangulation(xx0,yy0,xx1,yy1);
             math::DelaunayTriangulation oFinalTriangulation(xx0,yy0,xx1,yy1);
-            for (size_t i=0;i<vecPts.size();i++)
+            for (int ty=-1;ty<=1;ty++)
             {
-              if (vecPts[i].x > xx0 && vecPts[i].x < xx1 &&
-                  vecPts[i].y > yy0 && vecPts[i].y < yy1)
+               for (int tx=-1;tx<=1;tx++)
+               {
+                  const std::vector<ElevationPoint>& vecTilePts = oPointTiles.Get(xx+tx, yy+ty);
+
+                  for (size_t i=0;i<vecTilePts.size();i++)
                   {
-                     oTriangulation.InsertPoint(vecPts[i]);
-                     cnt++;
+                     if (vecTilePts[i].x > xx0 && vecTilePts[i].x < xx1 &&
+                         vecTilePts[i].y > yy0 && vecTilePts[i].y < yy1)
+                     {
+                        vecPts.push_back(vecTilePts[i]);
+                     }
                   }
+               }
             }
 
+            oTriangulation.InsertPoints(vecPts);
+
             ElevationPoint NW, NE, SE, SW;
             std::vector<ElevationPoint> vNorth;
             std::vector<ElevationPoint> vEast;
@@ -286,28 +355,24 @@ namespace triangulate
             // Thin out tile if there are too many points:
             oElevationTile.Reduce(nMaxPoints);
 
-            std::string datastr;
-            std::string sFilename;
             std::string sTempfilename; // for resampling info
 
-#ifdef GENERATE_JSON
-            //if (outputformat == JSON)
-            datastr = oElevationTile.CreateJSON();
-            sFilename = ProcessingUtils::GetTilePath(sTileDir, ".json" , lod, xx, yy);
-#else
-            //if (outputformat == OBJ) [internal testing only]
-            datastr = oTriangulation.CreateOBJ(xmin, ymin, xmax, ymax);
-            sFilename = sTempTileDir + sCurrentQuadcode + ".obj";
-#endif
-
             // for binary data (resampling)
             sTempfilename = ProcessingUtils::GetTilePath(sTempTileDir, ".tri", lod, xx, yy);
             oElevationTile.WriteBinary(sTempfilename);
 
-            // write output tile
+#ifdef GENERATE_JSON
+            // write output tile (json or binary)
+            std::string sFilename = ProcessingUtils::GetTilePath(sTileDir, ElevationTile::GetFileExtension(sTileFormat), lod, xx, yy);
+            oElevationTile.WriteTile(sFilename, sTileFormat);
+#else
+            //if (outputformat == OBJ) [internal testing only]
+            std::string datastr = oTriangulation.CreateOBJ(xmin, ymin, xmax, ymax);
+            std::string sFilename = sTempTileDir + sCurrentQuadcode + ".obj";
             std::ofstream fout(sFilename.c_str());
             fout << datastr;
             fout.close();
+#endif
          }
       }
 
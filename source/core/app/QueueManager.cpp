@@ -91,6 +91,12 @@ void QueueManager::AddToJobQueue(std::string filename, QJob job, bool append, in
          FileSystem::rm(ss.str());
          
       }
+      std::string sStateFile = filename + ".shq";   // see SharedJobQueue
+      if(FileSystem::FileExists(sStateFile))
+      {
+         std::cout << "removing expired queue state file\n";
+         FileSystem::rm(sStateFile);
+      }
       _vJobs.clear();
       _iCount = 0;
    }
@@ -34,10 +34,11 @@
 class OPENGLOBE_API QJob
 {
 public:
-   QJob(){}
+   QJob() : size(0), id(-1) {}
    virtual ~QJob() {}
    boost::shared_array<char> data;
    int size;
+   int id;     // index of job in job file (set by SharedJobQueue), -1 if unknown
 };
 
 class OPENGLOBE_API QueueManager
@@ -0,0 +1,485 @@
+/*******************************************************************************
+#      ____               __          __  _      _____ _       _               #
+#     / __ \              \ \        / / | |    / ____| |     | |              #
+#    | |  | |_ __   ___ _ __ \  /\  / /__| |__ | |  __| | ___ | |__   ___      #
+#    | |  | | '_ \ / _ \ '_ \ \/  \/ / _ \ '_ \| | |_ | |/ _ \| '_ \ / _ \     #
+#    | |__| | |_) |  __/ | | \  /\  /  __/ |_) | |__| | | (_) | |_) |  __/     #
+#     \____/| .__/ \___|_| |_|\/  \/ \___|_.__/ \_____|_|\___/|_.__/ \___|     #
+#           | |                                                                #
+#           |_|                                                                #
+#                                                                              #
+#                                (c) 2011 by                                   #
+#           University of Applied Sciences Northwestern Switzerland            #
+#                     Institute of Geomatics Engineering                       #
+#                           martin.christen@fhnw.ch                            #
+********************************************************************************
+*     Licensed under MIT License. Read the file LICENSE for more information   *
+*******************************************************************************/
+// Parallel processing utility: lock-free job queue for workers on one host
+#include "SharedJobQueue.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <io/FileSystem.h>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/exceptions.hpp>
+
+#ifdef OS_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+   const char SHQ_MAGIC[4] = {'O','W','G','Q'};
+   const unsigned int SHQ_VERSION = 1;
+
+   // state word of a job: lower 8 bits state, upper bits number of requeues
+   const unsigned int JOB_PENDING = 0;
+   const unsigned int JOB_CLAIMED = 1;
+   const unsigned int JOB_DONE    = 2;
+   const unsigned int JOB_FAILED  = 3;
+
+   // Header of state file. Followed by one state word per job and the requeue
+   // ring (one slot per job, 0: empty, otherwise job id + 1).
+   struct SHQHeader
+   {
+      char           magic[4];
+      unsigned int   version;
+      unsigned int   bytesPerJob;
+      unsigned int   jobCount;
+      unsigned int   cursor;        // next job never claimed
+      unsigned int   finished;      // number of done or failed jobs
+      unsigned int   requeueHead;   // next ring slot to pop
+      unsigned int   requeueTail;   // next ring slot to push
+      char           reserved[32];
+   };
+
+   //---------------------------------------------------------------------------
+   // atomic operations on 32 bit words in shared memory (full barrier)
+
+#ifdef OS_WINDOWS
+   inline unsigned int _AtomicAdd(volatile unsigned int* p, unsigned int v)
+   {
+      return (unsigned int)InterlockedExchangeAdd((volatile LONG*)p, (LONG)v);
+   }
+
+   inline unsigned int _AtomicCas(volatile unsigned int* p, unsigned int expected, unsigned int desired)
+   {
+      return (unsigned int)InterlockedCompareExchange((volatile LONG*)p, (LONG)desired, (LONG)expected);
+   }
+#else
+   inline unsigned int _AtomicAdd(volatile unsigned int* p, unsigned int v)
+   {
+      return __sync_fetch_and_add(p, v);
+   }
+
+   inline unsigned int _AtomicCas(volatile unsigned int* p, unsigned int expected, unsigned int desired)
+   {
+      return __sync_val_compare_and_swap(p, expected, desired);
+   }
+#endif
+
+   inline unsigned int _AtomicRead(volatile unsigned int* p)
+   {
+      return _AtomicAdd(p, 0);
+   }
+
+   inline void _AtomicWrite(volatile unsigned int* p, unsigned int v)
+   {
+      unsigned int old = *p;
+      unsigned int cur;
+      while ((cur = _AtomicCas(p, old, v)) != old)
+      {
+         old = cur;
+      }
+   }
+
+   //---------------------------------------------------------------------------
+
+   int64 _FileSize(const std::string& sFilename)
+   {
+      std::ifstream ifs(sFilename.c_str(), std::ios::in|std::ios::binary);
+      if (!ifs.good())
+         return -1;
+      ifs.seekg(0, std::ios::end);
+      return (int64)ifs.tellg();
+   }
+
+   //---------------------------------------------------------------------------
+
+   int64 _StateSize(int64 nJobs)
+   {
+      return (int64)sizeof(SHQHeader) + 2*nJobs*(int64)sizeof(unsigned int);
+   }
+
+   //---------------------------------------------------------------------------
+   // true if state file exists, belongs to a job file with bytesPerJob and is
+   // large enough for the job count in the header (an interrupted grow leaves it larger)
+   bool _ReadStateHeader(const std::string& sStateFile, unsigned int bytesPerJob, SHQHeader& header)
+   {
+      std::ifstream ifs(sStateFile.c_str(), std::ios::in|std::ios::binary);
+      ifs.read((char*)&header, sizeof(SHQHeader));
+      if (!ifs.good())
+         return false;
+      ifs.close();
+
+      return memcmp(header.magic, SHQ_MAGIC, 4) == 0 &&
+             header.version == SHQ_VERSION &&
+             header.bytesPerJob == bytesPerJob &&
+             _FileSize(sStateFile) >= _StateSize(header.jobCount);
+   }
+
+   //---------------------------------------------------------------------------
+   // create state file: all jobs pending, requeue ring empty
+   bool _CreateStateFile(const std::string& sStateFile, unsigned int bytesPerJob, unsigned int jobCount, SHQHeader& header)
+   {
+      std::ofstream off(sStateFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+      memset(&header, 0, sizeof(SHQHeader));
+      memcpy(header.magic, SHQ_MAGIC, 4);
+      header.version = SHQ_VERSION;
+      header.bytesPerJob = bytesPerJob;
+      header.jobCount = jobCount;
+      off.write((char*)&header, sizeof(SHQHeader));
+      off.seekp((std::streamoff)(_StateSize(jobCount)-1));
+      off.put(0);
+      off.close();
+      return !off.fail();
+   }
+
+   //---------------------------------------------------------------------------
+   // Extend state file with zeros (pending state words, empty requeue ring). The
+   // file is never shortened, so existing mappings stay valid.
+   bool _GrowStateFile(const std::string& sStateFile, int64 nStateSize)
+   {
+      std::fstream f(sStateFile.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+      if (!f.good())
+         return false;
+      f.seekp((std::streamoff)(nStateSize-1));
+      f.put(0);
+      f.close();
+      return !f.fail();
+   }
+}
+
+//------------------------------------------------------------------------------
+
+SharedJobQueue::SharedJobQueue()
+   : _iBytesPerJob(0), _iJobCount(0), _pJobs(0), _pHeader(0), _pState(0), _pRing(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+SharedJobQueue::~SharedJobQueue()
+{
+}
+
+//------------------------------------------------------------------------------
+
+std::string SharedJobQueue::GetStateFilename(const std::string& filename)
+{
+   return filename + ".shq";
+}
+
+//------------------------------------------------------------------------------
+
+bool SharedJobQueue::_Open(const std::string& filename, int bytes_per_job, bool verbose)
+{
+   using namespace boost::interprocess;
+
+   _qJobRegion.reset();
+   _qStateRegion.reset();
+   _pJobs = 0; _pHeader = 0; _pState = 0; _pRing = 0;
+   _iJobCount = 0;
+
+   if (bytes_per_job <= 0)
+   {
+      std::cout << "###SharedJobQueue: Can't open job file " << filename << "\n";
+      return false;
+   }
+
+   // The queue lock is held while the job file is appended (QueueManager::CommitJobQueue)
+   // and while the state file is created, grown and mapped.
+   int lockhandle = FileSystem::Lock(filename);
+
+   int64 nJobFileSize = _FileSize(filename);
+   if (nJobFileSize < 0)
+   {
+      FileSystem::Unlock(filename, lockhandle);
+      std::cout << "###SharedJobQueue: Can't open job file " << filename << "\n";
+      return false;
+   }
+   int64 nJobs = nJobFileSize / bytes_per_job;
+   if (nJobs == 0)
+   {
+      FileSystem::Unlock(filename, lockhandle);
+      _sFilename = filename;
+      _iBytesPerJob = bytes_per_job;
+      return true;
+   }
+   if (nJobs > 0x7fffffff / 2)
+   {
+      FileSystem::Unlock(filename, lockhandle);
+      std::cout << "###SharedJobQueue: Too many jobs in " << filename << "\n";
+      return false;
+   }
+
+   // The first process creates the state file, all others reuse it. A valid state
+   // file is never recreated: other processes may have it mapped.
+   std::string sStateFile = GetStateFilename(filename);
+   SHQHeader header;
+   if (!_ReadStateHeader(sStateFile, (unsigned int)bytes_per_job, header) || header.jobCount > (unsigned int)nJobs)
+   {
+      if (verbose) std::cout << "-->Creating queue state file " << sStateFile << "\n" << std::flush;
+      if (!_CreateStateFile(sStateFile, (unsigned int)bytes_per_job, (unsigned int)nJobs, header))
+      {
+         FileSystem::Unlock(filename, lockhandle);
+         std::cout << "###SharedJobQueue: Error writing state file " << sStateFile << "\n";
+         return false;
+      }
+   }
+
+   try
+   {
+      file_mapping stateMapping(sStateFile.c_str(), read_write);
+      _qStateRegion = boost::shared_ptr<mapped_region>(new mapped_region(stateMapping, read_write, 0, (std::size_t)_StateSize(header.jobCount)));
+      SHQHeader* pHeader = (SHQHeader*)_qStateRegion->get_address();
+
+      // Jobs appended to the job file are added once all jobs of the state file are
+      // finished. Then no job is claimed and the requeue ring is empty, so it can move
+      // behind the new state words: the file is extended with zeros and the new job
+      // count is published. Processes only claim jobs below the job count of their
+      // own mapping and map the file again when the count changed.
+      unsigned int nStateJobs = _AtomicRead(&pHeader->jobCount);
+      if (nStateJobs < (unsigned int)nJobs && _AtomicRead(&pHeader->finished) == nStateJobs)
+      {
+         if (verbose) std::cout << "-->Adding " << nJobs-nStateJobs << " appended jobs to queue state file " << sStateFile << "\n" << std::flush;
+         if (!_GrowStateFile(sStateFile, _StateSize(nJobs)))
+         {
+            FileSystem::Unlock(filename, lockhandle);
+            std::cout << "###SharedJobQueue: Error writing state file " << sStateFile << "\n";
+            _qStateRegion.reset();
+            return false;
+         }
+         _qStateRegion = boost::shared_ptr<mapped_region>(new mapped_region(stateMapping, read_write, 0, (std::size_t)_StateSize(nJobs)));
+         pHeader = (SHQHeader*)_qStateRegion->get_address();
+         if (_AtomicRead(&pHeader->cursor) > nStateJobs)
+         {
+            _AtomicWrite(&pHeader->cursor, nStateJobs);
+         }
+         _AtomicWrite(&pHeader->jobCount, (unsigned int)nJobs);
+         nStateJobs = (unsigned int)nJobs;
+      }
+
+      // jobs of the state file, appended jobs may not be part of it yet
+      nJobs = nStateJobs;
+
+      file_mapping jobMapping(filename.c_str(), read_only);
+      _qJobRegion = boost::shared_ptr<mapped_region>(new mapped_region(jobMapping, read_only, 0, (std::size_t)(nJobs*bytes_per_job)));
+   }
+   catch (interprocess_exception& ex)
+   {
+      FileSystem::Unlock(filename, lockhandle);
+      std::cout << "###SharedJobQueue: Error mapping job queue: " << ex.what() << "\n";
+      _qJobRegion.reset();
+      _qStateRegion.reset();
+      return false;
+   }
+   FileSystem::Unlock(filename, lockhandle);
+
+   _sFilename = filename;
+   _iBytesPerJob = bytes_per_job;
+   _iJobCount = (int)nJobs;
+   _pJobs = (const char*)_qJobRegion->get_address();
+   _pHeader = _qStateRegion->get_address();
+   _pState = (volatile unsigned int*)((char*)_pHeader + sizeof(SHQHeader));
+   _pRing = _pState + nJobs;
+
+   if (verbose) std::cout << "-->Mapped job queue " << filename << " (" << nJobs << " jobs)\n" << std::flush;
+
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+QJob SharedJobQueue::_CreateJob(int id)
+{
+   QJob newJob;
+   newJob.data = boost::shared_array<char>(new char[_iBytesPerJob]);
+   newJob.size = _iBytesPerJob;
+   newJob.id = id;
+   memcpy(newJob.data.get(), _pJobs + (size_t)id*_iBytesPerJob, _iBytesPerJob);
+   return newJob;
+}
+
+//------------------------------------------------------------------------------
+
+int SharedJobQueue::_PopRequeued()
+{
+   SHQHeader* pHeader = (SHQHeader*)_pHeader;
+   for (;;)
+   {
+      unsigned int head = _AtomicRead(&pHeader->requeueHead);
+      unsigned int tail = _AtomicRead(&pHeader->requeueTail);
+      if ((int)(tail - head) <= 0)
+      {
+         return -1;
+      }
+      if (_AtomicCas(&pHeader->requeueHead, head, head+1) == head)
+      {
+         volatile unsigned int* pSlot = _pRing + (head % (unsigned int)_iJobCount);
+         unsigned int value;
+         // the pushing worker may not have written the slot yet
+         while ((value = _AtomicRead(pSlot)) == 0) {}
+         _AtomicWrite(pSlot, 0);
+         return (int)value-1;
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+
+void SharedJobQueue::_PushRequeued(int id)
+{
+   SHQHeader* pHeader = (SHQHeader*)_pHeader;
+   unsigned int tail = _AtomicAdd(&pHeader->requeueTail, 1);
+   volatile unsigned int* pSlot = _pRing + (tail % (unsigned int)_iJobCount);
+   // a job is in the ring at most once, a slot is only busy until its popper cleared it
+   while (_AtomicCas(pSlot, 0, (unsigned int)id+1) != 0) {}
+}
+
+//------------------------------------------------------------------------------
+
+bool SharedJobQueue::_Refresh(const std::string& filename, int bytes_per_job, bool verbose)
+{
+   if (filename != _sFilename || bytes_per_job != _iBytesPerJob)
+   {
+      return _Open(filename, bytes_per_job, verbose);
+   }
+   if (_pHeader && _AtomicRead(&((SHQHeader*)_pHeader)->jobCount) != (unsigned int)_iJobCount)
+   {
+      // state file was grown by another process, map the new layout
+      return _Open(filename, bytes_per_job, verbose);
+   }
+   if (GetFinishedCount() == _iJobCount && _FileSize(filename) / bytes_per_job > (int64)_iJobCount)
+   {
+      // all jobs finished: add jobs appended to the job file in the meantime
+      return _Open(filename, bytes_per_job, verbose);
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+std::vector<QJob> SharedJobQueue::FetchJobList(std::string filename, int bytes_per_job, int amount, bool verbose)
+{
+   std::vector<QJob> jobs;
+   size_t nRequeued = 0;
+
+   if (amount <= 0)
+   {
+      return jobs;
+   }
+
+   // If nothing can be claimed, try once more: the state file may have been grown
+   // in the meantime, or the last job was finished and appended jobs can be added.
+   for (int pass=0;pass<2 && jobs.empty();pass++)
+   {
+      if (!_Refresh(filename, bytes_per_job, verbose) || _iJobCount == 0)
+         return jobs;
+
+      SHQHeader* pHeader = (SHQHeader*)_pHeader;
+
+      // requeued jobs first
+      while ((int)jobs.size() < amount)
+      {
+         int id = _PopRequeued();
+         if (id < 0)
+            break;
+         unsigned int state = _AtomicRead(&_pState[id]);
+         _AtomicWrite(&_pState[id], (state & ~0xffu) | JOB_CLAIMED);
+         jobs.push_back(_CreateJob(id));
+      }
+      nRequeued = jobs.size();
+
+      // then claim a range of new jobs. The cursor never passes the job count, so
+      // claiming continues with the first appended job once the state file grew.
+      unsigned int nClaim = (unsigned int)(amount - (int)jobs.size());
+      while (nClaim > 0)
+      {
+         unsigned int count = math::Min<unsigned int>(_AtomicRead(&pHeader->jobCount), (unsigned int)_iJobCount);
+         unsigned int first = _AtomicRead(&pHeader->cursor);
+         if (first >= count)
+            break;
+         unsigned int last = math::Min<unsigned int>(first + nClaim, count);
+         if (_AtomicCas(&pHeader->cursor, first, last) == first)
+         {
+            for (unsigned int id = first; id < last; id++)
+            {
+               _AtomicWrite(&_pState[id], JOB_CLAIMED);
+               jobs.push_back(_CreateJob((int)id));
+            }
+            break;
+         }
+      }
+   }
+
+   if(verbose) std::cout << "-->Claimed " << jobs.size() << " jobs (" << nRequeued << " requeued), " << GetFinishedCount() << " of " << _iJobCount << " finished.\n" << std::flush;
+
+   return jobs;
+}
+
+//------------------------------------------------------------------------------
+
+void SharedJobQueue::CompleteJob(const QJob& job)
+{
+   if (job.id < 0 || job.id >= _iJobCount)
+      return;
+
+   SHQHeader* pHeader = (SHQHeader*)_pHeader;
+   unsigned int state = _AtomicRead(&_pState[job.id]);
+   _AtomicWrite(&_pState[job.id], (state & ~0xffu) | JOB_DONE);
+   _AtomicAdd(&pHeader->finished, 1);
+}
+
+//------------------------------------------------------------------------------
+
+bool SharedJobQueue::RequeueJob(const QJob& job, int maxretries)
+{
+   if (job.id < 0 || job.id >= _iJobCount)
+      return false;
+
+   SHQHeader* pHeader = (SHQHeader*)_pHeader;
+   unsigned int state = _AtomicRead(&_pState[job.id]);
+   unsigned int retries = (state >> 8) + 1;
+   if ((int)retries > maxretries)
+   {
+      _AtomicWrite(&_pState[job.id], (state & ~0xffu) | JOB_FAILED);
+      _AtomicAdd(&pHeader->finished, 1);
+      return false;
+   }
+
+   _AtomicWrite(&_pState[job.id], (retries << 8) | JOB_PENDING);
+   _PushRequeued(job.id);
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+int SharedJobQueue::GetJobCount() const
+{
+   return _iJobCount;
+}
+
+//------------------------------------------------------------------------------
+
+int SharedJobQueue::GetFinishedCount() const
+{
+   if (!_pHeader)
+      return 0;
+   return (int)_AtomicRead(&((SHQHeader*)_pHeader)->finished);
+}
@@ -0,0 +1,92 @@
+/*******************************************************************************
+#      ____               __          __  _      _____ _       _               #
+#     / __ \              \ \        / / | |    / ____| |     | |              #
+#    | |  | |_ __   ___ _ __ \  /\  / /__| |__ | |  __| | ___ | |__   ___      #
+#    | |  | | '_ \ / _ \ '_ \ \/  \/ / _ \ '_ \| | |_ | |/ _ \| '_ \ / _ \     #
+#    | |__| | |_) |  __/ | | \  /\  /  __/ |_) | |__| | | (_) | |_) |  __/     #
+#     \____/| .__/ \___|_| |_|\/  \/ \___|_.__/ \_____|_|\___/|_.__/ \___|     #
+#           | |                                                                #
+#           |_|                                                                #
+#                                                                              #
+#                                (c) 2011 by                                   #
+#           University of Applied Sciences Northwestern Switzerland            #
+#                     Institute of Geomatics Engineering                       #
+#                           martin.christen@fhnw.ch                            #
+********************************************************************************
+*     Licensed under MIT License. Read the file LICENSE for more information   *
+*******************************************************************************/
+// Parallel processing utility: lock-free job queue for workers on one host
+#include "og.h"
+#include "QueueManager.h"
+#include <vector>
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+
+#ifndef _SHAREDJOBQUEUE_H
+#define _SHAREDJOBQUEUE_H
+
+namespace boost { namespace interprocess { class mapped_region; } }
+
+//------------------------------------------------------------------------------
+/*!
+ * \brief Job queue shared by all processes and threads on one host.
+ *
+ * Reads the job file written by QueueManager::AddToJobQueue/CommitJobQueue.
+ * Job file and a companion state file (<jobfile>.shq) are memory mapped, jobs
+ * are claimed with an atomic fetch-add on a cursor in the state file, so no
+ * file lock is taken once the queue is open. Every job has a state word
+ * (pending, claimed, done, failed) and failed jobs can be put back into a
+ * requeue ring which is drained before new jobs are claimed.
+ * Jobs appended to the job file are added to the queue when all its jobs are
+ * finished: the state file then grows in place under the queue lock. It is never
+ * shortened while in use. Jobs are claimed with compare-and-swap on the cursor,
+ * below the job count of the own mapping; processes check the job count before
+ * every fetch and map the grown file again.
+ * Memory mapped files are not coherent across hosts: use QueueManager if
+ * workers on different hosts share the job file.
+ */
+class OPENGLOBE_API SharedJobQueue
+{
+public:
+   SharedJobQueue();
+   virtual ~SharedJobQueue();
+
+   //! Claim up to amount jobs. The queue is opened on first call. Returned jobs have a valid id.
+   std::vector<QJob> FetchJobList(std::string filename, int bytes_per_job, int amount, bool verbose = false);
+
+   //! Mark a fetched job as done.
+   void CompleteJob(const QJob& job);
+
+   //! Put a fetched job back into the queue. Returns false (and marks the job failed) after maxretries requeues.
+   bool RequeueJob(const QJob& job, int maxretries = 3);
+
+   //! Number of jobs in the queue (0 if queue is not open)
+   int GetJobCount() const;
+
+   //! Number of jobs done or failed
+   int GetFinishedCount() const;
+
+   //! Name of state file belonging to a job file
+   static std::string GetStateFilename(const std::string& filename);
+
+protected:
+   bool _Open(const std::string& filename, int bytes_per_job, bool verbose);
+   bool _Refresh(const std::string& filename, int bytes_per_job, bool verbose);
+   int  _PopRequeued();
+   void _PushRequeued(int id);
+   QJob _CreateJob(int id);
+
+private:
+   boost::shared_ptr<boost::interprocess::mapped_region> _qJobRegion;
+   boost::shared_ptr<boost::interprocess::mapped_region> _qStateRegion;
+   std::string _sFilename;
+   int _iBytesPerJob;
+   int _iJobCount;
+   const char* _pJobs;
+   void* _pHeader;
+   volatile unsigned int* _pState;
+   volatile unsigned int* _pRing;
+};
+
+#endif
@@ -22,6 +22,7 @@
 #include <cpl_conv.h>
 #include <string>
 #include <cassert>
+#include <omp.h>
 
 #include "CoordinateTransformation.h"
 
@@ -40,6 +41,28 @@
 #define WGS84_RN_POLE      6.399593625758673e+006
 
 
+// minimum number of points for splitting a batch transformation across threads
+#define CT_MINPARALLELBATCH   8192
+// max number of points passed to OGR at once
+#define CT_OGRCHUNK           (1<<20)
+
+namespace
+{
+   bool _OGRTransform(OGRCoordinateTransformation* pCT, size_t nCount, double* dX, double* dY, double* dZ)
+   {
+      bool bOk = true;
+      for (size_t i=0;i<nCount;i+=CT_OGRCHUNK)
+      {
+         int n = (int)((nCount-i < CT_OGRCHUNK) ? nCount-i : CT_OGRCHUNK);
+         if (!pCT->Transform(n, dX+i, dY+i, dZ ? dZ+i : 0))
+            bOk = false;
+      }
+      return bOk;
+   }
+}
+
+//-----------------------------------------------------------------------------
+
 CoordinateTransformation::~CoordinateTransformation()
 {
    if (_pCT)
@@ -53,6 +76,8 @@ CoordinateTransformation::~CoordinateTransformation()
       OCTDestroyCoordinateTransformation((OGRCoordinateTransformation*) _pCTBack); 
       _pCTBack = 0;
    }
+
+   _DestroyThreadTransformations();
 }
 
 CoordinateTransformation::CoordinateTransformation(unsigned int nSourceEPSG, unsigned int nDestEPSG)
@@ -81,9 +106,18 @@ void CoordinateTransformation::Init(unsigned int nSourceEPSG, unsigned int nDest
    _nDestEPSG = nDestEPSG;
 
    _bIdentity = false;
+   _bClosedForm = false;
 
    if (_nSourceEPSG == 0 || _nDestEPSG == 0 || nSourceEPSG == _nDest2)
       _bIdentity = true;
+   else if (_nSourceEPSG == _nDestEPSG)
+   {
+      // WGS84 -> Mercator is calculated without proj4
+      if (_nDest2 != 0)
+         _bClosedForm = true;
+      else
+         _bIdentity = true;
+   }
    
    if (_pCT)
    {
@@ -97,7 +131,9 @@ void CoordinateTransformation::Init(unsigned int nSourceEPSG, unsigned int nDest
       _pCTBack = 0;
    }
 
-   if (!_bIdentity)
+   _DestroyThreadTransformations();
+
+   if (!_bIdentity && !_bClosedForm)
    {
       OGRSpatialReference srcref;
       OGRSpatialReference dstref;
@@ -111,39 +147,102 @@ void CoordinateTransformation::Init(unsigned int nSourceEPSG, unsigned int nDest
    }
 }
 
-bool CoordinateTransformation::Transform(double* dX, double* dY)
+//-----------------------------------------------------------------------------
+
+boost::shared_ptr<CoordinateTransformation> CoordinateTransformation::Clone() const
 {
-   if (_bIdentity)   // no transformation required, source is dest
+   return boost::shared_ptr<CoordinateTransformation>(new CoordinateTransformation(_nSourceEPSG, _nDest2 ? _nDest2 : _nDestEPSG));
+}
+
+//-----------------------------------------------------------------------------
+
+void CoordinateTransformation::_DestroyThreadTransformations()
+{
+   for (size_t i=0;i<_vThreadCT.size();i++)
    {
-      return true;
+      if (_vThreadCT[i])
+         OCTDestroyCoordinateTransformation((OGRCoordinateTransformation*) _vThreadCT[i]);
    }
 
-   if (!_pCT)
-      return false;
-   
-   if(!((OGRCoordinateTransformation*)_pCT)->Transform(1, dX, dY))
-      return false;
+   for (size_t i=0;i<_vThreadCTBack.size();i++)
+   {
+      if (_vThreadCTBack[i])
+         OCTDestroyCoordinateTransformation((OGRCoordinateTransformation*) _vThreadCTBack[i]);
+   }
+
+   _vThreadCT.clear();
+   _vThreadCTBack.clear();
+}
+
+//-----------------------------------------------------------------------------
+
+void CoordinateTransformation::_Forward(double& x, double& y, double clamp)
+{
+   double out_x;
+   double out_y;
+
+   if (_nDest2 == 3395)
+   {
+      Mercator::Forward(x, y, out_x, out_y);
+   }
+   else if (_nDest2 == 3785) // Web Mercator
+   {
+      Mercator::ForwardCustom(x, y, out_x, out_y, 0);
+   }
+   else
+   {
+      return;
+   }
+
+   if (out_y > clamp) out_y = clamp;
+   if (out_y < -clamp) out_y = -clamp;
+   x = out_x;
+   y = out_y;
+}
+
+//-----------------------------------------------------------------------------
+
+void CoordinateTransformation::_Backward(double& x, double& y)
+{
+   double out_x;
+   double out_y;
 
    if (_nDest2 == 3395)
    {
-      double out_x;
-      double out_y;
-      Mercator::Forward(*dX, *dY, out_x, out_y);
-      if (out_y > 1.0) out_y = 1.0;
-      if (out_y < -1.0) out_y = -1.0;
-      *dX = out_x;
-      *dY = out_y;
+      Mercator::Reverse(x, y, out_x, out_y);
    }
    else if (_nDest2 == 3785) // Web Mercator
    {
-      double out_x;
-      double out_y;
-      Mercator::ForwardCustom(*dX, *dY, out_x, out_y, 0);
-      if (out_y > 1.0) out_y = 1.0;
-      if (out_y < -1.0) out_y = -1.0;
-      *dX = out_x;
-      *dY = out_y;
+      Mercator::ReverseCustom(x, y, out_x, out_y, 0);
+   }
+   else
+   {
+      return;
+   }
+
+   x = out_x;
+   y = out_y;
+}
+
+//-----------------------------------------------------------------------------
+
+bool CoordinateTransformation::Transform(double* dX, double* dY)
+{
+   if (_bIdentity)   // no transformation required, source is dest
+   {
+      return true;
    }
+
+   if (!_bClosedForm)
+   {
+      if (!_pCT)
+         return false;
+   
+      if(!((OGRCoordinateTransformation*)_pCT)->Transform(1, dX, dY))
+         return false;
+   }
+
+   _Forward(*dX, *dY, 1.0);
    
    return true;
 }
@@ -156,118 +255,186 @@ bool CoordinateTransformation::TransformBackwards(double* dX, double* dY)
       return true;
    }
 
-   if (!_pCTBack)
+   if (!_bClosedForm && !_pCTBack)
       return false;
 
+   _Backward(*dX, *dY);
 
-   if (_nDest2 == 3395)
+   if (!_bClosedForm)
+      ((OGRCoordinateTransformation*)_pCTBack)->Transform(1, dX, dY);
+   
+   return true;
+}
+
+//-----------------------------------------------------------------------------
+
+
+bool CoordinateTransformation::Transform(double* dX, double* dY, double* dZ)
+{
+   if (_bIdentity)   // no transformation required, source is dest
    {
-      double out_x;
-      double out_y;
-      Mercator::Reverse(*dX, *dY, out_x, out_y);
-      *dX = out_x;
-      *dY = out_y;
-      //dZ = dZ;
+      return true;
    }
-   else if (_nDest2 == 3785) // Web Mercator
+
+   if (!_bClosedForm)
    {
-      double out_x;
-      double out_y;
-      Mercator::ReverseCustom(*dX, *dY, out_x, out_y, 0);
-      *dX = out_x;
-      *dY = out_y;
-      //dZ = dZ;
+      if (!_pCT)
+         return false;
+
+      if(!((OGRCoordinateTransformation*)_pCT)->Transform(1, dX, dY, dZ))
+         return false;
    }
 
+   _Forward(*dX, *dY, AGEPI);
 
-   ((OGRCoordinateTransformation*)_pCTBack)->Transform(1, dX, dY);
-   
    return true;
 }
 
 //-----------------------------------------------------------------------------
 
-
-bool CoordinateTransformation::Transform(double* dX, double* dY, double* dZ)
+bool CoordinateTransformation::TransformBackwards(double* dX, double* dY, double* dZ)
 {
    if (_bIdentity)   // no transformation required, source is dest
    {
       return true;
    }
 
-
-   if (!_pCT)
+   if (!_bClosedForm && !_pCTBack)
       return false;
 
-   if(!((OGRCoordinateTransformation*)_pCT)->Transform(1, dX, dY, dZ))
-      return false;
+   _Backward(*dX, *dY);
 
-   if (_nDest2 == 3395)
+   if (!_bClosedForm)
    {
-      double out_x;
-      double out_y;
-      Mercator::Forward(*dX, *dY, out_x, out_y);
-      if (out_y > AGEPI) out_y = AGEPI;
-      if (out_y < -AGEPI) out_y = -AGEPI;
-      *dX = out_x;
-      *dY = out_y;
-      //dZ = dZ;
+      if(!((OGRCoordinateTransformation*)_pCTBack)->Transform(1, dX, dY, dZ))
+         return false;
    }
-   else if (_nDest2 == 3785) // Web Mercator
+
+   return true;
+}
+
+//-----------------------------------------------------------------------------
+
+bool CoordinateTransformation::TransformArray(size_t nCount, double* dX, double* dY, double* dZ)
+{
+   if (_bIdentity)   // no transformation required, source is dest
    {
-      double out_x;
-      double out_y;
-      Mercator::ForwardCustom(*dX, *dY, out_x, out_y, 0);
-      if (out_y > AGEPI) out_y = AGEPI;
-      if (out_y < -AGEPI) out_y = -AGEPI;
-      *dX = out_x;
-      *dY = out_y;
-      //dZ = dZ;
+      return true;
    }
 
-   return true;
+   bool bOk = true;
+
+   if (!_bClosedForm)
+   {
+      bOk = _TransformOGR(true, nCount, dX, dY, dZ);
+   }
+
+   if (_nDest2 != 0)
+   {
+      const double clamp = dZ ? AGEPI : 1.0;
+      const int64 n = (int64)nCount;
+#     pragma omp parallel for if (n >= CT_MINPARALLELBATCH)
+      for (int64 i=0;i<n;i++)
+      {
+         _Forward(dX[i], dY[i], clamp);
+      }
+   }
+
+   return bOk;
 }
 
 //-----------------------------------------------------------------------------
 
-bool CoordinateTransformation::TransformBackwards(double* dX, double* dY, double* dZ)
+bool CoordinateTransformation::TransformArrayBackwards(size_t nCount, double* dX, double* dY, double* dZ)
 {
    if (_bIdentity)   // no transformation required, source is dest
    {
       return true;
    }
 
-   if (!_pCTBack)
+   if (_nDest2 != 0)
+   {
+      const int64 n = (int64)nCount;
+#     pragma omp parallel for if (n >= CT_MINPARALLELBATCH)
+      for (int64 i=0;i<n;i++)
+      {
+         _Backward(dX[i], dY[i]);
+      }
+   }
+
+   if (!_bClosedForm)
+   {
+      return _TransformOGR(false, nCount, dX, dY, dZ);
+   }
+
+   return true;
+}
+
+//-----------------------------------------------------------------------------
+// proj4 isn't thread safe, so every thread gets its own OGRCoordinateTransformation.
+// Thread 0 uses _pCT/_pCTBack, the others are created once and kept for later batches.
+
+bool CoordinateTransformation::_TransformOGR(bool bForward, size_t nCount, double* dX, double* dY, double* dZ)
+{
+   OGRCoordinateTransformation* pCT = (OGRCoordinateTransformation*)(bForward ? _pCT : _pCTBack);
+
+   if (!pCT)
       return false;
 
-   if (_nDest2 == 3395)
+   int nThreads = omp_in_parallel() ? 1 : omp_get_max_threads();
+
+   if (nThreads < 2 || nCount < CT_MINPARALLELBATCH)
    {
-      double out_x;
-      double out_y;
-      Mercator::Reverse(*dX, *dY, out_x, out_y);
-      *dX = out_x;
-      *dY = out_y;
-      //dZ = dZ;
+      return _OGRTransform(pCT, nCount, dX, dY, dZ);
    }
-   else if (_nDest2 == 3785) // Web Mercator
+
+   std::vector<void*>& vCT = bForward ? _vThreadCT : _vThreadCTBack;
+
+   if ((int)vCT.size() < nThreads)
    {
-      double out_x;
-      double out_y;
-      Mercator::ReverseCustom(*dX, *dY, out_x, out_y, 0);
-      *dX = out_x;
-      *dY = out_y;
-      //dZ = dZ;
+      OGRSpatialReference srcref;
+      OGRSpatialReference dstref;
+
+      srcref.importFromEPSG(bForward ? _nSourceEPSG : _nDestEPSG);
+      dstref.importFromEPSG(bForward ? _nDestEPSG : _nSourceEPSG);
+
+      size_t i0 = vCT.size() > 0 ? vCT.size() : 1;
+      vCT.resize(nThreads, 0);
+      for (size_t i=i0;i<vCT.size();i++)
+      {
+         vCT[i] = (void*)OGRCreateCoordinateTransformation(&srcref, &dstref);
+      }
    }
 
-   if(!((OGRCoordinateTransformation*)_pCTBack)->Transform(1, dX, dY, dZ))
-      return false;
+   int nFailed = 0;
 
-   return true;
+#  pragma omp parallel num_threads(nThreads) reduction(+:nFailed)
+   {
+      int t = omp_get_thread_num();
+      int n = omp_get_num_threads();
+      size_t chunk = (nCount + n - 1) / n;
+      size_t a = chunk * t < nCount ? chunk * t : nCount;
+      size_t b = a + chunk < nCount ? a + chunk : nCount;
+
+      OGRCoordinateTransformation* pThreadCT = (t == 0) ? pCT : (OGRCoordinateTransformation*)vCT[t];
+
+      if (!pThreadCT)
+      {
+         nFailed++;
+      }
+      else if (b > a && !_OGRTransform(pThreadCT, b-a, dX+a, dY+a, dZ ? dZ+a : 0))
+      {
+         nFailed++;
+      }
+   }
+
+   return nFailed == 0;
 }
 
 
 //-----------------------------------------------------------------------------
 
+
 Mercator::Mercator()
 {
 
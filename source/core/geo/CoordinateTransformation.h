@@ -22,6 +22,8 @@
 
 #include "og.h"
 #include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
 
 //! \class CoordinateTransformation
 //! \author Martin Christen, martin.christen@fhnw.ch
@@ -52,17 +54,39 @@ public:
    bool Transform(double* dX, double* dY, double* dZ);
    bool TransformBackwards(double* dX, double* dY, double* dZ);
 
+   //! \brief Batch Transformation of nCount points (dZ may be 0).
+   //! Large batches are split across all OpenMP threads, every thread uses its own transformer.
+   //! Don't call this for the same object from several threads at the same time.
+   //! \return false if at least one point couldn't be transformed.
+   bool TransformArray(size_t nCount, double* dX, double* dY, double* dZ = 0);
+   bool TransformArrayBackwards(size_t nCount, double* dX, double* dY, double* dZ = 0);
+
+   //! Returns a new transformation with same source/dest, for use in another thread.
+   boost::shared_ptr<CoordinateTransformation> Clone() const;
+
+   //! Returns true if no proj4 transformation is involved (identity or WGS84 <-> Mercator in closed form).
+   //! In this case the transformation functions are thread safe.
+   bool IsThreadSafe() const {return _bIdentity || _bClosedForm;}
+
 protected:      
+   bool _TransformOGR(bool bForward, size_t nCount, double* dX, double* dY, double* dZ);
+   void _Forward(double& x, double& y, double clamp);
+   void _Backward(double& x, double& y);
+   void _DestroyThreadTransformations();
+
    unsigned int                  _nSourceEPSG;
    unsigned int                  _nDestEPSG;
    unsigned int                  _nDest2;
    bool                          _bIdentity;
+   bool                          _bClosedForm;  // source is WGS84 and dest is mercator: no proj4 required
 
 private:
    CoordinateTransformation(){}
    void*                         _pCT;       // hidden type: OGRCoordinateTransformation*
    void*                         _pCTBack;   // hidden type: OGRCoordinateTransformation*
-   
+   std::vector<void*>            _vThreadCT;       // per thread transformations (forward), index 0 unused
+   std::vector<void*>            _vThreadCTBack;   // per thread transformations (backward), index 0 unused
+
 };
 
 //! \class Mercator
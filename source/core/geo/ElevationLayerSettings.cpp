@@ -28,6 +28,7 @@ BeginPropertyMap(ElevationLayerSettings);
   XMLProperty(ElevationLayerSettings, "srs", _srs);
   XMLProperty(ElevationLayerSettings, "maxlod", _maxlod);
   XMLProperty(ElevationLayerSettings, "extent", _tilecoord);
+  XMLProperty(ElevationLayerSettings, "tileformat", _sTileFormat);
 EndPropertyMap(ElevationLayerSettings);
 //------------------------------------------------------------------------------
 
@@ -45,6 +46,7 @@ ElevationLayerSettings::ElevationLayerSettings()
    _tilecoord.push_back(0);
    _tilecoord.push_back(0);
    _tilecoord.push_back(0);
+   _sTileFormat = "json";
 }
 
 
@@ -101,7 +103,8 @@ bool ElevationLayerSettings::Save(const std::string& layerdir)
       jout << "   \"name\" : \"" << _sLayername << "\",\n";
       jout << "   \"type\" : \"" << _sLayertype << "\",\n";
       jout << "   \"maxlod\" : " << _maxlod << ",\n";
-      jout << "   \"extent\" : " << "[" << _tilecoord[0] << ", " << _tilecoord[1] << ", " << _tilecoord[2] << ", " << _tilecoord[3] << "]\n";
+      jout << "   \"extent\" : " << "[" << _tilecoord[0] << ", " << _tilecoord[1] << ", " << _tilecoord[2] << ", " << _tilecoord[3] << "],\n";
+      jout << "   \"tileformat\" : \"" << _sTileFormat << "\"\n";
       jout << "}\n";
    }
 
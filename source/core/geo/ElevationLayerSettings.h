@@ -34,10 +34,13 @@ public:
    void SetLayerName(const std::string& sLayername) {_sLayername = sLayername;} 
    void SetMaxLod(int maxlod) {_maxlod = maxlod;}
    void SetTileExtent(int64 x0, int64 y0, int64 x1, int64 y1) { _tilecoord[0] = x0; _tilecoord[1] = y0; _tilecoord[2] = x1; _tilecoord[3] = y1;}
+   // set tile format ("json" or "binary", see ElevationTile::WriteTile)
+   void SetTileFormat(const std::string& sTileFormat){_sTileFormat = sTileFormat;}
 
    std::string GetLayerName(){return _sLayername;}
    int GetMaxLod(){return _maxlod;}
    void GetTileExtent(int64& x0, int64& y0, int64& x1, int64& y1){x0 = _tilecoord[0]; y0 = _tilecoord[1]; x1 = _tilecoord[2]; y1 = _tilecoord[3];}
+   std::string GetTileFormat(){return _sTileFormat;}
 
    // Load from XML
    static boost::shared_ptr<ElevationLayerSettings> Load(const std::string& layerdir);
@@ -51,6 +54,7 @@ protected:
    int         _maxlod;
    std::string _srs;
    std::vector<int64> _tilecoord;
+   std::string _sTileFormat;
    
 
 private:
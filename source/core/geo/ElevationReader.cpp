@@ -32,6 +32,8 @@
 #include <cassert>
 #include <iostream>
 #include <sstream>
+#include <omp.h>
+#include <boost/shared_ptr.hpp>
 
 #define _pGDALDataset ((GDALDataset*)_pDataset)
 #define _pElvBand     ((GDALRasterBand*)_pElv) 
@@ -42,7 +44,6 @@ ElevationReader::ElevationReader()
 {
    _pDataset = 0;
    _pElv = 0;
-   _pBlockElv = 0;
    // In future, this values must be customized
    _maxElvValue = 12000;  // maximum value for elevation, if higher it is treated as NODATA
    _minElvValue = -8000;  // minimum value for elevation if smaller, it is treated as NODATA
@@ -61,12 +62,6 @@ void ElevationReader::_Free()
 {
    Close();
 
-   if (_pBlockElv)
-   {
-      free(_pBlockElv);
-      _pBlockElv = 0;
-   }
-
    _pElv = 0;
 }
 
@@ -167,8 +162,6 @@ bool ElevationReader::Open(std::string& sFilename, int nSourceEPSG, int nDestEPS
                   _nXBlocks = (_pElvBand->GetXSize() + _nBlockWidth - 1) / _nBlockWidth;
                   _nYBlocks = (_pElvBand->GetYSize() + _nBlockHeight - 1) / _nBlockHeight;
 
-                  _pBlockElv = malloc(_datatype_bytes * _nBlockWidth*_nBlockHeight);
-
                   bOk = true;
                }
             }
@@ -217,20 +210,33 @@ bool ElevationReader::Import(std::vector<ElevationPoint>& result, double& inout_
 
 //------------------------------------------------------------------------------
 
-void ElevationReader::_ReadBlock(int bx, int by, int& valid_width, int& valid_height)
+void ElevationReader::_ReadBlock(void* pBand, int bx, int by, void* pBuffer, int& valid_width, int& valid_height)
 {
-   _pElvBand->ReadBlock( bx, by, _pBlockElv );
+   GDALRasterBand* pRasterBand = (GDALRasterBand*)pBand;
+
+   if (pRasterBand == _pElvBand)
+   {
+      // the band of the shared dataset may be used by several threads
+#     pragma omp critical (ElevationReader_ReadBlock)
+      {
+         pRasterBand->ReadBlock( bx, by, pBuffer );
+      }
+   }
+   else
+   {
+      pRasterBand->ReadBlock( bx, by, pBuffer );
+   }
 
    // Compute the portion of the block that is valid
    // for partial edge blocks.
-   if( (bx+1) * _nBlockWidth > _pElvBand->GetXSize() )
-      valid_width = _pElvBand->GetXSize() - bx * _nBlockWidth;
+   if( (bx+1) * _nBlockWidth > pRasterBand->GetXSize() )
+      valid_width = pRasterBand->GetXSize() - bx * _nBlockWidth;
    else
       valid_width = _nBlockWidth;
 
-   if( (by+1) * _nBlockHeight > _pElvBand->GetYSize() )
+   if( (by+1) * _nBlockHeight > pRasterBand->GetYSize() )
    {
-      valid_height = _pElvBand->GetYSize() - by * _nBlockHeight;
+      valid_height = pRasterBand->GetYSize() - by * _nBlockHeight;
    }
    else
    {
@@ -240,6 +246,214 @@ void ElevationReader::_ReadBlock(int bx, int by, int& valid_width, int& valid_he
 
 //------------------------------------------------------------------------------
 
+namespace
+{
+   // buffers of one raster block
+   struct SBlockBuffer
+   {
+      std::vector<unsigned char> vRaw;   // block as read from GDAL
+      std::vector<double> vX, vY, vZ;    // valid points
+      std::vector<double> vOut;          // interleaved x,y,elevation
+      double xmin, ymin, xmax, ymax;
+   };
+
+   //---------------------------------------------------------------------------
+   // Collect valid points of a block. One instance per GDAL data type,
+   // so there is no type switch in the inner loop.
+   template<typename T>
+   void _CollectPoints(const T* pBlock, int nBlockWidth, int valid_width, int valid_height, int BaseX, int BaseY, const double* affine, double dNoDataValue, double dMinElv, double dMaxElv, SBlockBuffer& buffer)
+   {
+      for (int y=0;y<valid_height;y++)
+      {
+         const T* pRow = pBlock + y*nBlockWidth;
+         const double py = double(y+BaseY);
+
+         for (int x=0;x<valid_width;x++)
+         {
+            const double fz = (double)pRow[x];
+
+            // NODATA value check (invalid range is treated as NODATA too)
+            if (fz == dNoDataValue || fz > dMaxElv || fz < dMinElv)
+               continue;
+
+            const double px = double(x+BaseX);
+            buffer.vX.push_back(affine[0] + px*affine[1] + py*affine[2]);
+            buffer.vY.push_back(affine[3] + px*affine[4] + py*affine[5]);
+            buffer.vZ.push_back(fz);
+         }
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+// Blocks are processed in parallel: every thread reads blocks using its own
+// GDAL dataset, collects and transforms the points. The results are then
+// written in block order, so the output is the same as with a single thread.
+
+bool ElevationReader::_ImportRasterBlocks(std::ostream* pOut, std::vector<ElevationPoint>* pResult, size_t& size, double& inout_xmin, double& inout_ymin, double& inout_xmax, double& inout_ymax)
+{
+   size = 0;
+
+   int nThreads = omp_get_max_threads();
+   int nBlocks = _nXBlocks * _nYBlocks;
+
+   if (nThreads > nBlocks)
+      nThreads = nBlocks > 0 ? nBlocks : 1;
+
+   //---------------------------------------------------------------------------
+   // per thread datasets and transformations
+
+   std::vector<void*> vDatasets(nThreads, (void*)0);
+   std::vector<void*> vBands(nThreads, _pElv);
+   std::vector<boost::shared_ptr<CoordinateTransformation> > vCT(nThreads);
+
+   for (int t=1;t<nThreads;t++)
+   {
+      vDatasets[t] = (void*)GDALOpen(_sFilename.c_str(), GA_ReadOnly);
+      if (vDatasets[t])
+      {
+         vBands[t] = (void*)((GDALDataset*)vDatasets[t])->GetRasterBand(1);
+         if (!vBands[t])
+            vBands[t] = _pElv;
+      }
+   }
+
+   if (_nSourceEPSG != 0 && _nSourceEPSG != _nDestEPSG)
+   {
+      vCT[0] = boost::shared_ptr<CoordinateTransformation>(new CoordinateTransformation(_nSourceEPSG, _nDestEPSG));
+      for (int t=1;t<nThreads;t++)
+      {
+         vCT[t] = vCT[0]->IsThreadSafe() ? vCT[0] : vCT[0]->Clone();
+      }
+   }
+
+   //---------------------------------------------------------------------------
+   // blocks are processed in batches, results of a batch are kept in memory
+   // until they are written.
+
+   const int nBatchSize = 4*nThreads;
+   std::vector<SBlockBuffer> vBuffer(nBatchSize);
+
+   for (int nBatch = 0; nBatch < nBlocks; nBatch += nBatchSize)
+   {
+      int nBatchEnd = math::Min<int>(nBatch + nBatchSize, nBlocks);
+
+#     pragma omp parallel for schedule(dynamic) num_threads(nThreads)
+      for (int nBlock = nBatch; nBlock < nBatchEnd; nBlock++)
+      {
+         int t = omp_get_thread_num();
+         SBlockBuffer& buffer = vBuffer[nBlock-nBatch];
+         int iXBlock = nBlock % _nXBlocks;
+         int iYBlock = nBlock / _nXBlocks;
+         int valid_width, valid_height;
+
+         buffer.vRaw.resize(_datatype_bytes * _nBlockWidth * _nBlockHeight);
+         buffer.vX.clear();
+         buffer.vY.clear();
+         buffer.vZ.clear();
+
+         _ReadBlock(vBands[t], iXBlock, iYBlock, &buffer.vRaw[0], valid_width, valid_height);
+
+         int BaseX = _nBlockWidth * iXBlock;
+         int BaseY = _nBlockHeight * iYBlock;
+         const void* pBlock = &buffer.vRaw[0];
+
+         switch(_datatype)
+         {
+         case 1:  // GDT_UInt32
+            _CollectPoints<unsigned int>((const unsigned int*)pBlock, _nBlockWidth, valid_width, valid_height, BaseX, BaseY, _affineTransformation, _dNoDataValue, _minElvValue, _maxElvValue, buffer);
+            break;
+         case 2:  // GDT_Int32
+            _CollectPoints<int>((const int*)pBlock, _nBlockWidth, valid_width, valid_height, BaseX, BaseY, _affineTransformation, _dNoDataValue, _minElvValue, _maxElvValue, buffer);
+            break;
+         case 3:  // GDT_Float32
+            _CollectPoints<float>((const float*)pBlock, _nBlockWidth, valid_width, valid_height, BaseX, BaseY, _affineTransformation, _dNoDataValue, _minElvValue, _maxElvValue, buffer);
+            break;
+         case 4:  // GDT_Float64
+            _CollectPoints<double>((const double*)pBlock, _nBlockWidth, valid_width, valid_height, BaseX, BaseY, _affineTransformation, _dNoDataValue, _minElvValue, _maxElvValue, buffer);
+            break;
+         case 5:  // GDT_UInt16
+            _CollectPoints<unsigned short>((const unsigned short*)pBlock, _nBlockWidth, valid_width, valid_height, BaseX, BaseY, _affineTransformation, _dNoDataValue, _minElvValue, _maxElvValue, buffer);
+            break;
+         case 6:  // GDT_Int16
+            _CollectPoints<short>((const short*)pBlock, _nBlockWidth, valid_width, valid_height, BaseX, BaseY, _affineTransformation, _dNoDataValue, _minElvValue, _maxElvValue, buffer);
+            break;
+         default:
+            assert(false);
+         }
+
+         size_t nPoints = buffer.vX.size();
+
+         // Transform Points of this block:
+         if (vCT[t] && nPoints>0)
+         {
+            vCT[t]->TransformArray(nPoints, &buffer.vX[0], &buffer.vY[0]);
+         }
+
+         buffer.xmin = buffer.ymin = 1e20;
+         buffer.xmax = buffer.ymax = -1e20;
+         buffer.vOut.resize(3*nPoints);
+
+         for (size_t i=0;i<nPoints;i++)
+         {
+            buffer.vOut[3*i+0] = buffer.vX[i];
+            buffer.vOut[3*i+1] = buffer.vY[i];
+            buffer.vOut[3*i+2] = buffer.vZ[i];
+
+            buffer.xmax = math::Max<double>(buffer.xmax, buffer.vX[i]);
+            buffer.ymax = math::Max<double>(buffer.ymax, buffer.vY[i]);
+            buffer.xmin = math::Min<double>(buffer.xmin, buffer.vX[i]);
+            buffer.ymin = math::Min<double>(buffer.ymin, buffer.vY[i]);
+         }
+      }
+
+      // write results of this batch in block order
+      for (int nBlock = nBatch; nBlock < nBatchEnd; nBlock++)
+      {
+         const SBlockBuffer& buffer = vBuffer[nBlock-nBatch];
+         size_t nPoints = buffer.vOut.size() / 3;
+
+         if (nPoints == 0)
+            continue;
+
+         if (pOut)
+         {
+            pOut->write((const char*)&buffer.vOut[0], nPoints*3*sizeof(double));
+         }
+
+         if (pResult)
+         {
+            ElevationPoint pt;
+            pt.weight = 0;
+            for (size_t i=0;i<nPoints;i++)
+            {
+               pt.x = buffer.vOut[3*i+0];
+               pt.y = buffer.vOut[3*i+1];
+               pt.elevation = buffer.vOut[3*i+2];
+               pResult->push_back(pt);
+            }
+         }
+
+         size += nPoints;
+
+         inout_xmax = math::Max<double>(inout_xmax, buffer.xmax);
+         inout_ymax = math::Max<double>(inout_ymax, buffer.ymax);
+         inout_xmin = math::Min<double>(inout_xmin, buffer.xmin);
+         inout_ymin = math::Min<double>(inout_ymin, buffer.ymin);
+      }
+   }
+
+   for (int t=1;t<nThreads;t++)
+   {
+      if (vDatasets[t])
+         GDALClose((GDALDatasetH)vDatasets[t]);
+   }
+
+   return pOut ? pOut->good() : true;
+}
+
+//------------------------------------------------------------------------------
+
 bool ElevationReader::_ImportXYZ(std::vector<ElevationPoint>& result, double& inout_xmin, double& inout_ymin, double& inout_xmax, double& inout_ymax)
 {
    CoordinateTransformation* pCT = 0;
@@ -259,6 +473,7 @@ bool ElevationReader::_ImportXYZ(std::vector<ElevationPoint>& result, double& in
    int numColumns = 0;
    ElevationPoint pt;
    int nPointsWritten = 0;
+   std::vector<double> vX, vY;
 
    if (myfile.good())
    {
@@ -277,29 +492,15 @@ bool ElevationReader::_ImportXYZ(std::vector<ElevationPoint>& result, double& in
 
             if (vOut.size() >= 3 && vOut.size() == numColumns)
             {
-               double x = vOut[0];
-               double y = vOut[1];
-               double z = vOut[2];
-
-               if (pCT)
-               {
-                  pCT->Transform(&x, &y);
-               }
-
-               pt.x = x;
-               pt.y = y;
-               pt.elevation = z;
+               pt.x = vOut[0];
+               pt.y = vOut[1];
+               pt.elevation = vOut[2];
                pt.weight = 0; 
                result.push_back(pt);
+               vX.push_back(pt.x);
+               vY.push_back(pt.y);
 
                nPointsWritten++;
-
-               inout_xmin = math::Min<double>(inout_xmin, x);
-               inout_ymin = math::Min<double>(inout_ymin, y);
-               
-               inout_xmax = math::Max<double>(inout_xmax, x);
-               inout_ymax = math::Max<double>(inout_ymax, y);
- 
             }
          }
       }
@@ -307,6 +508,25 @@ bool ElevationReader::_ImportXYZ(std::vector<ElevationPoint>& result, double& in
    }
    myfile.close();
 
+   // transform all points at once
+   if (pCT && vX.size()>0)
+   {
+      pCT->TransformArray(vX.size(), &vX[0], &vY[0]);
+   }
+
+   for (size_t i=0;i<vX.size();i++)
+   {
+      ElevationPoint& cur = result[result.size()-vX.size()+i];
+      cur.x = vX[i];
+      cur.y = vY[i];
+
+      inout_xmin = math::Min<double>(inout_xmin, cur.x);
+      inout_ymin = math::Min<double>(inout_ymin, cur.y);
+
+      inout_xmax = math::Max<double>(inout_xmax, cur.x);
+      inout_ymax = math::Max<double>(inout_ymax, cur.y);
+   }
+
    if (pCT)
    {
       delete pCT;
@@ -319,141 +539,12 @@ bool ElevationReader::_ImportXYZ(std::vector<ElevationPoint>& result, double& in
 
 bool ElevationReader::_ImportRaster(std::vector<ElevationPoint>& result, double& inout_xmin, double& inout_ymin, double& inout_xmax, double& inout_ymax)
 {
-   int valid_width; int valid_height;
-   double fx,fy,fz;
-   unsigned int ui_value;
-   int i_value;
-   float f_value;
-   double d_value;
-   unsigned short us_value;
-   short s_value;
-
-   fz = 0;
-   CoordinateTransformation* pCT = 0;
-
-   if (_nSourceEPSG != 0)
-   {
-      if (_nSourceEPSG != _nDestEPSG)
-         pCT = new CoordinateTransformation(_nSourceEPSG, _nDestEPSG);
-   }
-
-   //---------------------------------------------------------------------------
+   size_t size;
 
    result.clear();
    result.reserve(_nRasterSizeX*_nRasterSizeY);
 
-
-   ElevationPoint pt;
-
-   for(int iYBlock = 0; iYBlock < _nYBlocks; iYBlock++ )
-   {
-      for(int iXBlock = 0; iXBlock < _nXBlocks; iXBlock++ )
-      {
-         _ReadBlock(iXBlock, iYBlock, valid_width, valid_height);
-
-         int BaseX = _nBlockWidth * iXBlock;
-         int BaseY = _nBlockHeight * iYBlock;
-
-         for (int y=0;y<valid_height;y++)
-         {
-            for (int x=0;x<valid_width;x++)
-            {
-               bool bNoData = true;
-               GetSourceCoord(double(x+BaseX), double(y+BaseY), &fx, &fy);
-               switch(_datatype)
-               {
-               case 1:  // GDT_UInt32
-                  ui_value = ((unsigned int*)_pBlockElv)[y*_nBlockWidth+x];
-                  if (ui_value!=_dNoDataValue)
-                  {
-                     fz = (double) ui_value;
-                     bNoData = false;
-                  }
-                  break;
-               case 2:  // GDT_Int32
-                  i_value = ((int*)_pBlockElv)[y*_nBlockWidth+x];
-                  if (i_value!=_dNoDataValue)
-                  {
-                     fz = (double) i_value;
-                     bNoData = false;
-                  }
-                  break;
-               case 3:  // GDT_Float32
-                  f_value = ((float*)_pBlockElv)[y*_nBlockWidth+x];
-                  if (f_value!=_dNoDataValue)
-                  {
-                     fz = (double) f_value;
-                     bNoData = false;
-                  }
-                  break;
-               case 4:  // GDT_Float64
-                  d_value = ((double*)_pBlockElv)[y*_nBlockWidth+x];
-                  if (d_value!=_dNoDataValue)
-                  {
-                     fz = d_value;
-                     bNoData = false;
-                  }
-                  break;
-               case 5: 
-                  {
-                     unsigned short* pElvData = ((unsigned short*)_pBlockElv);
-                     us_value = pElvData[y*_nBlockWidth+x];
-                     if (us_value!=_dNoDataValue)
-                     {
-                        fz = (double) us_value;
-                        bNoData = false;
-                     }
-                  }
-                  break;
-               case 6:  
-                  {
-                     short* pElvData = ((short*)_pBlockElv);
-                     s_value = pElvData[y*_nBlockWidth+x];
-                     if (s_value!=_dNoDataValue)
-                     {
-                        fz = (double) s_value;
-                        bNoData = false;
-                     }
-                  }
-                  break;
-
-               default:
-                  assert(false);
-               }
-
-               // further NODATA value check:
-               if (fz > _maxElvValue || fz < _minElvValue)
-               {
-                   bNoData = true;
-               }
-
-               // Transform Point:
-
-               if (!bNoData)
-               {
-
-                  if (pCT)
-                  {  
-                     pCT->Transform(&fx, &fy);
-                  }
-
-                  pt.x = fx;
-                  pt.y = fy;
-                  pt.elevation = fz;
-                  pt.weight = 0;
-                  result.push_back(pt);
-
-                  inout_xmax = math::Max<double>(inout_xmax, fx);
-                  inout_ymax = math::Max<double>(inout_ymax, fy);
-                  inout_xmin = math::Min<double>(inout_xmin, fx);
-                  inout_ymin = math::Min<double>(inout_ymin, fy);
-               }
-            }
-         }
-      }
-   }
-
-   return true;
+   return _ImportRasterBlocks(0, &result, size, inout_xmin, inout_ymin, inout_xmax, inout_ymax);
 }
 
 //------------------------------------------------------------------------------
@@ -464,15 +555,6 @@ bool ElevationReader::_ImportRaster(std::vector<ElevationPoint>& result, double&
    _numPts = 0;
    _curPts = 0;
 
-   int valid_width; int valid_height;
-   double fx,fy,fz;
-   unsigned int ui_value;
-   int i_value;
-   float f_value;
-   double d_value;
-   unsigned short us_value;
-   short s_value;
-
    std::ofstream ofs(sFilename.c_str(), std::ios::binary);
 
    if (!ofs.good())
@@ -480,142 +562,13 @@ bool ElevationReader::_ImportRaster(std::vector<ElevationPoint>& result, double&
       return false;
    }
 
-   size = 0;
-   fz = 0;
-
-   CoordinateTransformation* pCT = 0;
-
-   if (_nSourceEPSG != 0)
-   {
-      if (_nSourceEPSG != _nDestEPSG)
-         pCT = new CoordinateTransformation(_nSourceEPSG, _nDestEPSG);
-   }
-
-   //---------------------------------------------------------------------------
-
-   ElevationPoint pt;
-
-   for(int iYBlock = 0; iYBlock < _nYBlocks; iYBlock++ )
-   {
-      for(int iXBlock = 0; iXBlock < _nXBlocks; iXBlock++ )
-      {
-         _ReadBlock(iXBlock, iYBlock, valid_width, valid_height);
-
-         int BaseX = _nBlockWidth * iXBlock;
-         int BaseY = _nBlockHeight * iYBlock;
-
-         for (int y=0;y<valid_height;y++)
-         {
-            for (int x=0;x<valid_width;x++)
-            {
-               bool bNoData = true;
-               GetSourceCoord(double(x+BaseX), double(y+BaseY), &fx, &fy);
-               switch(_datatype)
-               {
-               case 1:  // GDT_UInt32
-                  ui_value = ((unsigned int*)_pBlockElv)[y*_nBlockWidth+x];
-                  if (ui_value!=_dNoDataValue)
-                  {
-                     fz = (double) ui_value;
-                     bNoData = false;
-                  }
-                  break;
-               case 2:  // GDT_Int32
-                  i_value = ((int*)_pBlockElv)[y*_nBlockWidth+x];
-                  if (i_value!=_dNoDataValue)
-                  {
-                     fz = (double) i_value;
-                     bNoData = false;
-                  }
-                  break;
-               case 3:  // GDT_Float32
-                  f_value = ((float*)_pBlockElv)[y*_nBlockWidth+x];
-                  if (f_value!=_dNoDataValue)
-                  {
-                     fz = (double) f_value;
-                     bNoData = false;
-                  }
-                  break;
-               case 4:  // GDT_Float64
-                  d_value = ((double*)_pBlockElv)[y*_nBlockWidth+x];
-                  if (d_value!=_dNoDataValue)
-                  {
-                     fz = d_value;
-                     bNoData = false;
-                  }
-                  break;
-               case 5: 
-                  {
-                     unsigned short* pElvData = ((unsigned short*)_pBlockElv);
-                     us_value = pElvData[y*_nBlockWidth+x];
-                     if (us_value!=_dNoDataValue)
-                     {
-                        fz = (double) us_value;
-                        bNoData = false;
-                     }
-                  }
-                  break;
-               case 6:  
-                  {
-                     short* pElvData = ((short*)_pBlockElv);
-                     s_value = pElvData[y*_nBlockWidth+x];
-                     if (s_value!=_dNoDataValue)
-                     {
-                        fz = (double) s_value;
-                        bNoData = false;
-                     }
-                  }
-                  break;
-
-               default:
-                  assert(false);
-               }
-
-               // further NODATA value check:
-               if (fz > _maxElvValue || fz < _minElvValue)
-               {
-                   bNoData = true;
-               }
-
-               // Transform Point:
-
-               if (!bNoData)
-               {
-
-                  if (pCT)
-                  {  
-                     pCT->Transform(&fx, &fy);
-                  }
-
-                  pt.x = fx;
-                  pt.y = fy;
-                  pt.elevation = fz;
-                  pt.weight = 0;
-
-                  ofs.write((const char*)&pt.x, sizeof(double));
-                  ofs.write((const char*)&pt.y, sizeof(double));
-                  ofs.write((const char*)&pt.elevation, sizeof(double));
-                 
-
-                  // append pt
-
-                  size++;
-
-                  inout_xmax = math::Max<double>(inout_xmax, fx);
-                  inout_ymax = math::Max<double>(inout_ymax, fy);
-                  inout_xmin = math::Min<double>(inout_xmin, fx);
-                  inout_ymin = math::Min<double>(inout_ymin, fy);
-               }
-            }
-         }
-      }
-   }
+   bool bOk = _ImportRasterBlocks(&ofs, 0, size, inout_xmin, inout_ymin, inout_xmax, inout_ymax);
 
    ofs.close();
 
    _numPts = size;
 
-   return true;
+   return bOk;
  }
 
  //------------------------------------------------------------------------------
@@ -27,6 +27,7 @@
 #include "og.h"
 #include <string>
 #include <vector>
+#include <iosfwd>
 #include "math/ElevationPoint.h"
 
 //! \class ElevationReader
@@ -59,7 +60,9 @@ protected:
    bool _ImportRaster(std::vector<ElevationPoint>& result, double& inout_xmin, double& inout_ymin, double& inout_xmax, double& inout_ymax);
    
    void _Free();
-   void _ReadBlock(int bx, int by, int& valid_width, int& valid_height);
+   void _ReadBlock(void* pBand, int bx, int by, void* pBuffer, int& valid_width, int& valid_height);
+   // parallel raster import, points are written to pOut and/or appended to pResult
+   bool _ImportRasterBlocks(std::ostream* pOut, std::vector<ElevationPoint>* pResult, size_t& size, double& inout_xmin, double& inout_ymin, double& inout_xmax, double& inout_ymax);
 
    inline void GetSourcePixel(double x_src, double y_src, double* x, double* y)
    {
@@ -83,7 +86,6 @@ private:
 
    void*          _pDataset;
    void*          _pElv;
-   void*          _pBlockElv;
    double         _dNoDataValue;
    int            _datatype;
    int            _datatype_bytes;
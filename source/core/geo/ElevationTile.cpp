@@ -22,6 +22,10 @@
 #include <sstream>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <float.h>
 
 //------------------------------------------------------------------------------
 
@@ -251,6 +255,45 @@ std::string ElevationTile::CreateOBJ(double xmin, double ymin, double xmax, doub
 
 //------------------------------------------------------------------------------
 
+namespace
+{
+   // Append number formatted like std::ostream with the specified precision
+   // (default floatfield is "%g"), without the overhead of a stream.
+   inline void _AppendNumber(std::string& s, double value, int precision)
+   {
+      char buffer[64];
+      int len = sprintf(buffer, "%.*g", precision, value);
+      if (len>0)
+      {
+         s.append(buffer, len);
+      }
+   }
+
+   //---------------------------------------------------------------------------
+
+   inline void _AppendNumber(std::string& s, int value)
+   {
+      char buffer[16];
+      char* p = buffer + sizeof(buffer);
+      unsigned int v = value < 0 ? 0u-(unsigned int)value : (unsigned int)value;
+
+      do
+      {
+         *--p = char('0' + v % 10);
+         v /= 10;
+      } while (v);
+
+      if (value < 0)
+      {
+         *--p = '-';
+      }
+
+      s.append(p, buffer + sizeof(buffer) - p);
+   }
+}
+
+//------------------------------------------------------------------------------
+
 std::string ElevationTile::CreateJSON()
 {
    // 1) Create Triangulation (with curtain)
@@ -258,52 +301,272 @@ std::string ElevationTile::CreateJSON()
 
    _PrecomputeTriangulation(true); // this calculates: _idxcurtain; _lstElevationPointWGS84; _lstTexCoord; _lstIndices; _vOffset; _bbmin; _bbmax;
 
-   std::ostringstream of;
-   of.precision(FLT_DIG);  // floating point precision is required vertices
-
+   // floating point precision is required vertices
+   std::string of;
+   of.reserve(64 + 64*_lstElevationPointWGS84.size() + 8*_lstIndices.size());
 
-   of << "{\n";
-   of << "   \"VertexSemantic\"  :  \"pt\",\n";
-   of << "   \"Vertices\" : [ ";
+   of += "{\n";
+   of += "   \"VertexSemantic\"  :  \"pt\",\n";
+   of += "   \"Vertices\" : [ ";
 
    for (size_t i=0;i<_lstElevationPointWGS84.size();i++)
    {
-      of << _lstElevationPointWGS84[i].x << ", ";
-      of << _lstElevationPointWGS84[i].y << ", ";
-      of << _lstElevationPointWGS84[i].z << ", ";
-      of << _lstTexCoord[i].x << ", ";
-      of << _lstTexCoord[i].y;
+      _AppendNumber(of, _lstElevationPointWGS84[i].x, FLT_DIG); of += ", ";
+      _AppendNumber(of, _lstElevationPointWGS84[i].y, FLT_DIG); of += ", ";
+      _AppendNumber(of, _lstElevationPointWGS84[i].z, FLT_DIG); of += ", ";
+      _AppendNumber(of, _lstTexCoord[i].x, FLT_DIG); of += ", ";
+      _AppendNumber(of, _lstTexCoord[i].y, FLT_DIG);
       if (i!= _lstElevationPointWGS84.size()-1)
       {
-         of << ", ";
+         of += ", ";
       }
    }
-   of << " ],\n";
-   of << "   \"IndexSemantic\"  :  \"TRIANGLES\",\n";
-   of << "   \"Indices\"  : [ ";
+   of += " ],\n";
+   of += "   \"IndexSemantic\"  :  \"TRIANGLES\",\n";
+   of += "   \"Indices\"  : [ ";
 
    for (size_t i=0;i<_lstIndices.size();i++)
    {
-      of << _lstIndices[i];
+      _AppendNumber(of, _lstIndices[i]);
       if (i != _lstIndices.size()-1)
       {
-         of << ", ";
+         of += ", ";
       }
    }
 
-   of << "],\n";
+   of += "],\n";
 
    // virtual camera offset and bounding box (must be stored in double precision!!)
-   of.precision(DBL_DIG);
-   of << "   \"Offset\"  :  [ " << _vOffset.x << ", " << _vOffset.y << ", " << _vOffset.z << "],\n";  
+   of += "   \"Offset\"  :  [ ";
+   _AppendNumber(of, _vOffset.x, DBL_DIG); of += ", ";
+   _AppendNumber(of, _vOffset.y, DBL_DIG); of += ", ";
+   _AppendNumber(of, _vOffset.z, DBL_DIG); of += "],\n";
       
-   of << "   \"BoundingBox\" : [[ " << _bbmin.x << ", " << _bbmin.y << ", " << _bbmin.z << " ],[ "
-                                       << _bbmax.x << ", " << _bbmax.y << ", " << _bbmax.z << " ]],\n";
-   of.precision(FLT_DIG);
-   of << "   \"CurtainIndex\" : " << _idxcurtain << "\n";
-   of << "}\n";   
+   of += "   \"BoundingBox\" : [[ ";
+   _AppendNumber(of, _bbmin.x, DBL_DIG); of += ", ";
+   _AppendNumber(of, _bbmin.y, DBL_DIG); of += ", ";
+   _AppendNumber(of, _bbmin.z, DBL_DIG); of += " ],[ ";
+   _AppendNumber(of, _bbmax.x, DBL_DIG); of += ", ";
+   _AppendNumber(of, _bbmax.y, DBL_DIG); of += ", ";
+   _AppendNumber(of, _bbmax.z, DBL_DIG); of += " ]],\n";
+   of += "   \"CurtainIndex\" : ";
+   _AppendNumber(of, _idxcurtain);
+   of += "\n";
+   of += "}\n";   
+
+   return of;
+}
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+   // little endian output for binary tiles
+
+   inline void _Put32(std::vector<unsigned char>& v, unsigned int value)
+   {
+      v.push_back((unsigned char)(value & 0xff));
+      v.push_back((unsigned char)((value >> 8) & 0xff));
+      v.push_back((unsigned char)((value >> 16) & 0xff));
+      v.push_back((unsigned char)((value >> 24) & 0xff));
+   }
+
+   //---------------------------------------------------------------------------
+
+   inline void _Put16(std::vector<unsigned char>& v, unsigned int value)
+   {
+      v.push_back((unsigned char)(value & 0xff));
+      v.push_back((unsigned char)((value >> 8) & 0xff));
+   }
+
+   //---------------------------------------------------------------------------
+
+   inline void _PutFloat(std::vector<unsigned char>& v, float value)
+   {
+      unsigned int bits;
+      memcpy(&bits, &value, sizeof(float));
+      _Put32(v, bits);
+   }
 
-   return of.str();
+   //---------------------------------------------------------------------------
+
+   inline void _PutDouble(std::vector<unsigned char>& v, double value)
+   {
+      uint64 bits;
+      memcpy(&bits, &value, sizeof(double));
+      _Put32(v, (unsigned int)(bits & 0xffffffff));
+      _Put32(v, (unsigned int)(bits >> 32));
+   }
+
+   //---------------------------------------------------------------------------
+   // variable length (7 bits per byte) zig-zag encoded difference
+   inline void _PutDelta(std::vector<unsigned char>& v, int value, int previous)
+   {
+      int d = value - previous;
+      unsigned int z = (d < 0) ? ((0u-(unsigned int)d) << 1) - 1 : ((unsigned int)d << 1);
+
+      while (z >= 0x80)
+      {
+         v.push_back((unsigned char)((z & 0x7f) | 0x80));
+         z >>= 7;
+      }
+      v.push_back((unsigned char)z);
+   }
+
+   //---------------------------------------------------------------------------
+
+   inline void _PutIndexList(std::vector<unsigned char>& v, const std::vector<int>& vIndices)
+   {
+      _Put32(v, (unsigned int)vIndices.size());
+      int previous = 0;
+      for (size_t i=0;i<vIndices.size();i++)
+      {
+         _PutDelta(v, vIndices[i], previous);
+         previous = vIndices[i];
+      }
+   }
+
+   //---------------------------------------------------------------------------
+
+   inline unsigned int _Quantize(double value, double minvalue, double maxvalue)
+   {
+      if (maxvalue <= minvalue)
+      {
+         return 0;
+      }
+
+      double q = (value - minvalue) / (maxvalue - minvalue) * 65535.0 + 0.5;
+      if (q < 0.0) return 0;
+      if (q > 65535.0) return 65535;
+      return (unsigned int)q;
+   }
+
+   //---------------------------------------------------------------------------
+   // edge vertex, sorted along edge
+   struct SEdgeVertex
+   {
+      float t;
+      int   idx;
+      bool operator<(const SEdgeVertex& other) const { return t < other.t || (t == other.t && idx < other.idx); }
+   };
+}
+
+//------------------------------------------------------------------------------
+
+void ElevationTile::CreateBinary(std::vector<unsigned char>& vData)
+{
+   _PrecomputeTriangulation(true); // this calculates: _idxcurtain; _lstElevationPointWGS84; _lstTexCoord; _lstIndices; _vOffset; _bbmin; _bbmax;
+
+   const unsigned int n = (unsigned int)_lstElevationPointWGS84.size();
+   const float edgeepsilon = 1e-6f;
+
+   // quantization box (relative to offset, including curtain)
+   vec3<float> qmin(1e30f, 1e30f, 1e30f);
+   vec3<float> qmax(-1e30f, -1e30f, -1e30f);
+   for (unsigned int i=0;i<n;i++)
+   {
+      const vec3<float>& p = _lstElevationPointWGS84[i];
+      if (p.x < qmin.x) qmin.x = p.x;
+      if (p.y < qmin.y) qmin.y = p.y;
+      if (p.z < qmin.z) qmin.z = p.z;
+      if (p.x > qmax.x) qmax.x = p.x;
+      if (p.y > qmax.y) qmax.y = p.y;
+      if (p.z > qmax.z) qmax.z = p.z;
+   }
+   if (n == 0)
+   {
+      qmin = qmax = vec3<float>(0,0,0);
+   }
+
+   // vertices on tile edges (used for stitching adjacent tiles), curtain is not included.
+   std::vector<SEdgeVertex> vEdge[4]; // west, south, east, north
+   for (int i=0;i<_idxcurtain && i<(int)n;i++)
+   {
+      SEdgeVertex ev;
+      ev.idx = i;
+      const vec2<float>& t = _lstTexCoord[i];
+      if (fabs(t.x) < edgeepsilon)       { ev.t = t.y; vEdge[0].push_back(ev); }
+      if (fabs(t.y) < edgeepsilon)       { ev.t = t.x; vEdge[1].push_back(ev); }
+      if (fabs(t.x - 1.0f) < edgeepsilon) { ev.t = t.y; vEdge[2].push_back(ev); }
+      if (fabs(t.y - 1.0f) < edgeepsilon) { ev.t = t.x; vEdge[3].push_back(ev); }
+   }
+
+   vData.clear();
+   vData.reserve(128 + n*10 + _lstIndices.size()*2);
+
+   // [0] header
+   vData.push_back('O'); vData.push_back('W'); vData.push_back('G'); vData.push_back('E');
+   _Put32(vData, 1);                            // version
+   _PutDouble(vData, _vOffset.x); _PutDouble(vData, _vOffset.y); _PutDouble(vData, _vOffset.z);
+   _PutDouble(vData, _bbmin.x); _PutDouble(vData, _bbmin.y); _PutDouble(vData, _bbmin.z);
+   _PutDouble(vData, _bbmax.x); _PutDouble(vData, _bbmax.y); _PutDouble(vData, _bbmax.z);
+   _PutFloat(vData, qmin.x); _PutFloat(vData, qmin.y); _PutFloat(vData, qmin.z);
+   _PutFloat(vData, qmax.x); _PutFloat(vData, qmax.y); _PutFloat(vData, qmax.z);
+   _Put32(vData, n);
+   _Put32(vData, (unsigned int)_idxcurtain);
+
+   // [1] quantized positions (relative to offset) and texture coordinates, one array per component
+   for (unsigned int i=0;i<n;i++) _Put16(vData, _Quantize(_lstElevationPointWGS84[i].x, qmin.x, qmax.x));
+   for (unsigned int i=0;i<n;i++) _Put16(vData, _Quantize(_lstElevationPointWGS84[i].y, qmin.y, qmax.y));
+   for (unsigned int i=0;i<n;i++) _Put16(vData, _Quantize(_lstElevationPointWGS84[i].z, qmin.z, qmax.z));
+   for (unsigned int i=0;i<n;i++) _Put16(vData, _Quantize(_lstTexCoord[i].x, 0.0, 1.0));
+   for (unsigned int i=0;i<n;i++) _Put16(vData, _Quantize(_lstTexCoord[i].y, 0.0, 1.0));
+
+   // [2] triangle indices
+   _PutIndexList(vData, _lstIndices);
+
+   // [3] edge vertices: west, south, east, north
+   for (int e=0;e<4;e++)
+   {
+      std::sort(vEdge[e].begin(), vEdge[e].end());
+      std::vector<int> vIndices(vEdge[e].size());
+      for (size_t i=0;i<vEdge[e].size();i++)
+      {
+         vIndices[i] = vEdge[e][i].idx;
+      }
+      _PutIndexList(vData, vIndices);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+bool ElevationTile::WriteTile(const std::string& sFilename, const std::string& sFormat)
+{
+   std::ofstream fout(sFilename.c_str(), std::ios::binary);
+   if (!fout.good())
+   {
+      return false;
+   }
+
+   if (sFormat == "binary")
+   {
+      std::vector<unsigned char> vData;
+      CreateBinary(vData);
+      if (vData.size()>0)
+      {
+         fout.write((const char*)&vData[0], vData.size());
+      }
+   }
+   else
+   {
+      std::string datastr = CreateJSON();
+      fout.write(datastr.c_str(), datastr.size());
+   }
+
+   fout.close();
+   return !fout.fail();
+}
+
+//------------------------------------------------------------------------------
+
+std::string ElevationTile::GetFileExtension(const std::string& sFormat)
+{
+   if (sFormat == "binary")
+   {
+      return ".qmesh";
+   }
+
+   return ".json";
 }
 
 //------------------------------------------------------------------------------
@@ -348,10 +611,8 @@ boost::shared_ptr<math::DelaunayTriangulation> ElevationTile::CreateTriangulatio
       qTriangulation->InsertPoint(_ptsWest[i]);
    }
 
-   for (size_t i=0;i<_ptsMiddle.size();i++)
-   {
-      qTriangulation->InsertPoint(_ptsMiddle[i]);
-   }
+   // (3) Insert inner points as batch
+   qTriangulation->InsertPoints(_ptsMiddle);
    
    return qTriangulation;
 }
@@ -26,6 +26,7 @@
 #include "math/vec3.h"
 
 #include <string>
+#include <vector>
 
 #include <boost/shared_ptr.hpp>
 
@@ -58,6 +59,15 @@ public:
    // create JSON tile:
    std::string CreateJSON();
 
+   // create binary tile (quantized mesh, see documentation for the layout):
+   void CreateBinary(std::vector<unsigned char>& vData);
+
+   // write tile in specified format ("json" or "binary"), returns true on success
+   bool WriteTile(const std::string& sFilename, const std::string& sFormat);
+
+   // file extension of tiles in specified format ("json": ".json", "binary": ".qmesh")
+   static std::string GetFileExtension(const std::string& sFormat);
+
    // write tile binary, returns true on success
    bool WriteBinary(const std::string& sTempfilename);
 
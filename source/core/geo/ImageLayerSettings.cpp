@@ -29,6 +29,8 @@ BeginPropertyMap(ImageLayerSettings);
   XMLProperty(ImageLayerSettings, "maxlod", _maxlod);
   XMLProperty(ImageLayerSettings, "extent", _tilecoord);
   XMLProperty(ImageLayerSettings, "format", _sFormat);
+  XMLProperty(ImageLayerSettings, "tilestore", _sTileStore);
+  XMLProperty(ImageLayerSettings, "occupancy", _bOccupancy);
 EndPropertyMap(ImageLayerSettings);
 //------------------------------------------------------------------------------
 
@@ -41,6 +43,8 @@ ImageLayerSettings::ImageLayerSettings()
    //_sLayername; // empty
    _sLayertype = "image";
    _sFormat = "png";
+   _sTileStore = "directory";
+   _bOccupancy = false;
    _maxlod = 0;
    _srs = "EPSG:3857";
    _tilecoord.push_back(0);
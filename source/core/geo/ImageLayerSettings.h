@@ -36,9 +36,15 @@ public:
    void SetTileExtent(int64 x0, int64 y0, int64 x1, int64 y1) { _tilecoord[0] = x0; _tilecoord[1] = y0; _tilecoord[2] = x1; _tilecoord[3] = y1;}
    // set format (short form: "png" or "jpg")
    void SetFormat(const std::string& sFormat){_sFormat = sFormat;}
+   // set tile store ("directory" or "pack", see ITileStore)
+   void SetTileStore(const std::string& sTileStore){_sTileStore = sTileStore;}
+   // record empty and uniform tiles in an occupancy index instead of writing them (see TileOccupancy)
+   void SetOccupancyIndex(bool bOccupancy){_bOccupancy = bOccupancy;}
 
    std::string GetLayerName(){return _sLayername;}
    std::string GetFormat(){return _sFormat;}
+   std::string GetTileStore(){return _sTileStore;}
+   bool GetOccupancyIndex(){return _bOccupancy;}
    int GetMaxLod(){return _maxlod;}
    void GetTileExtent(int64& x0, int64& y0, int64& x1, int64& y1){x0 = _tilecoord[0]; y0 = _tilecoord[1]; x1 = _tilecoord[2]; y1 = _tilecoord[3];}
 
@@ -55,6 +61,8 @@ protected:
    std::string _srs;
    std::vector<int64> _tilecoord;
    std::string  _sFormat;
+   std::string  _sTileStore;
+   bool         _bOccupancy;
    
 
 private:
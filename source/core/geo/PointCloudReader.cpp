@@ -10,13 +10,290 @@
 #include "io/FileSystem.h"
 #include "xml/xml.h"
 #include <boost/tokenizer.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/exceptions.hpp>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <locale.h>
+#ifdef OS_MACOSX
+#include <xlocale.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+//-----------------------------------------------------------------------------
+
+namespace
+{
+   const int64 TEXT_BLOCK = 16*1024*1024;    // bytes of ASCII data parsed per batch
+   const int64 TEXT_PART = 256*1024;         // minimal number of bytes parsed by one thread
+   const int64 LAS_BATCH = 262144;           // LAS records per batch
+
+   const double s_pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                              1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+   //--------------------------------------------------------------------------
+   // strtod in the "C" locale, so the decimal point is '.' regardless of the
+   // locale set by the application.
+#ifdef OS_WINDOWS
+   const _locale_t s_cLocale = _create_locale(LC_NUMERIC, "C");
+
+   inline double _StrtodC(const char* s)
+   {
+      return _strtod_l(s, 0, s_cLocale);
+   }
+#else
+   const locale_t s_cLocale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+
+   inline double _StrtodC(const char* s)
+   {
+      return strtod_l(s, 0, s_cLocale);
+   }
+#endif
+
+   //--------------------------------------------------------------------------
+   // tokens for value separation in ASCII point cloud: " ,\t;"
+   inline bool _IsSeparator(char c)
+   {
+      return c == ' ' || c == ',' || c == '\t' || c == ';';
+   }
+
+   inline bool _IsDigit(char c)
+   {
+      return c >= '0' && c <= '9';
+   }
+
+   //--------------------------------------------------------------------------
+   // Locale independent number parser. Numbers with up to 15 significant digits
+   // and a small exponent (all coordinates in practice) are converted exactly
+   // without strtod, all other numbers with strtod in the "C" locale.
+   // Returns false if there is no number at p.
+   inline bool _ParseDouble(const char*& p, const char* end, double& value)
+   {
+      const char* start = p;
+      bool bNeg = false;
+      if (p < end && (*p == '-' || *p == '+'))
+      {
+         bNeg = (*p == '-');
+         p++;
+      }
+
+      uint64 mantissa = 0;
+      int digits = 0;
+      int exp10 = 0;
+      bool bDigits = false;
+      while (p < end && _IsDigit(*p))
+      {
+         if (digits < 19)
+         {
+            mantissa = mantissa*10 + (*p - '0');
+            if (mantissa != 0) digits++;
+         }
+         else
+         {
+            exp10++;
+         }
+         bDigits = true;
+         p++;
+      }
+      if (p < end && *p == '.')
+      {
+         p++;
+         while (p < end && _IsDigit(*p))
+         {
+            if (digits < 19)
+            {
+               mantissa = mantissa*10 + (*p - '0');
+               if (mantissa != 0) digits++;
+               exp10--;
+            }
+            bDigits = true;
+            p++;
+         }
+      }
+      if (!bDigits)
+      {
+         p = start;
+         return false;
+      }
+      if (p < end && (*p == 'e' || *p == 'E'))
+      {
+         const char* e = p++;
+         bool bExpNeg = false;
+         if (p < end && (*p == '-' || *p == '+'))
+         {
+            bExpNeg = (*p == '-');
+            p++;
+         }
+         if (p < end && _IsDigit(*p))
+         {
+            int ev = 0;
+            while (p < end && _IsDigit(*p))
+            {
+               if (ev < 10000) ev = ev*10 + (*p - '0');
+               p++;
+            }
+            exp10 += bExpNeg ? -ev : ev;
+         }
+         else
+         {
+            p = e;
+         }
+      }
+
+      if (mantissa <= (ULLCONST(1) << 53) && exp10 >= -22 && exp10 <= 22)
+      {
+         double v = double(mantissa);
+         v = exp10 < 0 ? v / s_pow10[-exp10] : v * s_pow10[exp10];
+         value = bNeg ? -v : v;
+      }
+      else
+      {
+         std::string sToken(start, p);
+         value = _StrtodC(sToken.c_str());
+      }
+      return true;
+   }
+
+   //--------------------------------------------------------------------------
+   // Parses values of one line [p,end). Returns number of values, -1 if the line is not numeric.
+   inline int _ParseLine(const char* p, const char* end, double* values, int nMaxValues)
+   {
+      int n = 0;
+      for (;;)
+      {
+         while (p < end && _IsSeparator(*p)) p++;
+         if (p >= end)
+            break;
+         if (n == nMaxValues || !_ParseDouble(p, end, values[n]))
+            return -1;
+         if (p < end && !_IsSeparator(*p))
+            return -1;
+         n++;
+      }
+      return n;
+   }
+
+   //--------------------------------------------------------------------------
+   // end of line starting at p (without \r), next line in out_next
+   inline const char* _LineEnd(const char* p, const char* end, const char*& out_next)
+   {
+      const char* eol = (const char*)memchr(p, '\n', end-p);
+      if (!eol)
+      {
+         eol = end;
+         out_next = end;
+      }
+      else
+      {
+         out_next = eol+1;
+      }
+      if (eol > p && eol[-1] == '\r')
+         eol--;
+      return eol;
+   }
+
+   //--------------------------------------------------------------------------
+   inline int _NumColumns(PointCloudType pct)
+   {
+      switch (pct)
+      {
+      case PCT_XYZ:     return 3;
+      case PCT_XYZI:    return 4;
+      case PCT_XYZRGB:  return 6;
+      case PCT_XYZIRGB: return 7;
+      default:          return 0;
+      }
+   }
+
+   //--------------------------------------------------------------------------
+   void _ParseLines(const char* p, const char* end, PointCloudType pct, std::vector<CloudPoint>& vPoints)
+   {
+      double v[8];
+      int nColumns = _NumColumns(pct);
+      CloudPoint point;
+
+      while (p < end)
+      {
+         const char* next;
+         const char* eol = _LineEnd(p, end, next);
+         int n = _ParseLine(p, eol, v, 8);
+         p = next;
+
+         if (n < nColumns)
+            continue;
+
+         point.x = v[0];
+         point.y = v[1];
+         point.elevation = v[2];
+
+         if (pct == PCT_XYZI)
+         {
+            point.intensity = (int)v[3];
+         }
+         else if (pct == PCT_XYZRGB)
+         {
+            point.r = (unsigned char)v[3];
+            point.g = (unsigned char)v[4];
+            point.b = (unsigned char)v[5];
+         }
+         else if (pct == PCT_XYZIRGB)
+         {
+            point.intensity = (int)v[3];
+            point.r = (unsigned char)v[4];
+            point.g = (unsigned char)v[5];
+            point.b = (unsigned char)v[6];
+         }
+         vPoints.push_back(point);
+      }
+   }
+
+   //--------------------------------------------------------------------------
+   template<typename T>
+   inline T _Get(const unsigned char* p)
+   {
+      T v;
+      memcpy(&v, p, sizeof(T));
+      return v;
+   }
+
+   // offset of rgb in LAS point record, -1 if format has no color
+   inline int _LASColorOffset(int format)
+   {
+      switch (format)
+      {
+      case 2: return 20;
+      case 3: return 28;
+      case 7: return 30;
+      case 8: return 30;
+      default: return -1;
+      }
+   }
+}
 
 //-----------------------------------------------------------------------------
 
 PointCloudReader::PointCloudReader()
 {
-   _line.resize(4096);
-   _separators = " ,\t;"; // tokens for value separation in ASCII point cloud
+   _nFileSize = 0;
+   _nPos = 0;
+   _nSourceEPSG = 0;
+   _pct = PCT_INVALID;
+   _ptsread = 0;
+   _bLAS = false;
+   _nLASFormat = 0;
+   _nLASRecordLength = 0;
+   _nLASPoints = 0;
+   _nColorShift = 0;
+   _nBufferPos = 0;
+   for (int i=0;i<3;i++)
+   {
+      _scale[i] = 1.0;
+      _offset[i] = 0.0;
+   }
 }
 
 //-----------------------------------------------------------------------------
@@ -30,97 +307,256 @@ PointCloudReader::~PointCloudReader()
 
 bool PointCloudReader::Open(const std::string& sFilename, int nSourceEPSG)
 {
-   if (_ifstream.is_open())
-   {
-      _ifstream.close();
-   }
+   using namespace boost::interprocess;
+
+   Close();
 
    _nSourceEPSG = nSourceEPSG;
    _sFilenameA = sFilename;
-   _ptsread = 0;
 
-   _ifstream.open(sFilename.c_str());
+   std::ifstream ifs(sFilename.c_str(), std::ios::binary);
+   if (!ifs.good())
+      return false;
+   ifs.seekg(0, std::ios::end);
+   _nFileSize = (int64)ifs.tellg();
+   ifs.close();
+
+   if (_nFileSize <= 0)
+      return false;
 
+   try
+   {
+      _qFile = boost::shared_ptr<file_mapping>(new file_mapping(sFilename.c_str(), read_only));
+   }
+   catch (interprocess_exception&)
+   {
+      _qFile.reset();
+      return false;
+   }
+
+   if (_nFileSize >= 4)
+   {
+      mapped_region region(*_qFile, read_only, 0, 4);
+      _bLAS = (memcmp(region.get_address(), "LASF", 4) == 0);
+   }
+
+   if (_bLAS)
+   {
+      return _OpenLAS();
+   }
+
+   return true;
+}
+
+//-----------------------------------------------------------------------------
+
+bool PointCloudReader::_OpenLAS()
+{
+   using namespace boost::interprocess;
+
+   if (_nFileSize < 227)
+      return false;
+
+   int64 nHeader = math::Min<int64>(_nFileSize, 375);
+   mapped_region region(*_qFile, read_only, 0, (std::size_t)nHeader);
+   const unsigned char* h = (const unsigned char*)region.get_address();
+
+   int versionMinor = h[25];
+   unsigned short headerSize = _Get<unsigned short>(h+94);
+   _nPos = _Get<unsigned int>(h+96);
+   // bits 7 and 6 of the point format are set by LASzip for compressed files (LAZ)
+   if (h[104] & 0xc0)
+   {
+      std::cout << "Compressed LAS (LAZ) files are not supported: " << _sFilenameA << "\n";
+      _pct = PCT_INVALID;
+      return false;
+   }
+   _nLASFormat = h[104];
+   _nLASRecordLength = _Get<unsigned short>(h+105);
+   _nLASPoints = _Get<unsigned int>(h+107);
+   for (int i=0;i<3;i++)
+   {
+      _scale[i] = _Get<double>(h+131+8*i);
+      _offset[i] = _Get<double>(h+155+8*i);
+   }
+   if (_nLASPoints == 0 && versionMinor >= 4 && headerSize >= 375 && nHeader >= 255)
+   {
+      _nLASPoints = (int64)_Get<uint64>(h+247);
+   }
 
-   return _ifstream.good();
+   if ((_nLASFormat > 3 && _nLASFormat < 6) || _nLASFormat > 8 || _nLASRecordLength < 20 || _nPos >= _nFileSize)
+   {
+      _pct = PCT_INVALID;
+      return false;
+   }
+   _nLASPoints = math::Min<int64>(_nLASPoints, (_nFileSize - _nPos) / _nLASRecordLength);
+
+   int colorOffset = _LASColorOffset(_nLASFormat);
+   _pct = colorOffset < 0 ? PCT_XYZI : PCT_XYZIRGB;
+
+   // colors are 16 bit by specification, but many writers store 8 bit values
+   _nColorShift = 0;
+   if (colorOffset >= 0 && _nLASPoints > 0 && colorOffset + 6 <= _nLASRecordLength)
+   {
+      int64 nCheck = math::Min<int64>(_nLASPoints, 1000);
+      mapped_region records(*_qFile, read_only, _nPos, (std::size_t)(nCheck*_nLASRecordLength));
+      const unsigned char* p = (const unsigned char*)records.get_address();
+      for (int64 i=0;i<nCheck && _nColorShift == 0;i++)
+      {
+         const unsigned char* rgb = p + i*_nLASRecordLength + colorOffset;
+         if (_Get<unsigned short>(rgb) > 255 || _Get<unsigned short>(rgb+2) > 255 || _Get<unsigned short>(rgb+4) > 255)
+         {
+            _nColorShift = 8;
+         }
+      }
+   }
+
+   return true;
 }
 
 //-----------------------------------------------------------------------------
 
 void PointCloudReader::Close()
 {
-   _ifstream.close();
+   _qFile.reset();
+   _nFileSize = 0;
+   _nPos = 0;
+   _ptsread = 0;
+   _pct = PCT_INVALID;
+   _bLAS = false;
+   _vBuffer.clear();
+   _nBufferPos = 0;
 }
 
 //-----------------------------------------------------------------------------
 
 bool PointCloudReader::ReadPoint(CloudPoint& point)
 {
-   char* line = &_line[0];
-   std::vector<double> vOut;
+   if (_nBufferPos >= _vBuffer.size())
+   {
+      _nBufferPos = 0;
+      if (!ReadPoints(_vBuffer))
+         return false;
+   }
+
+   point = _vBuffer[_nBufferPos++];
+   return true;
+}
+
+//-----------------------------------------------------------------------------
+
+bool PointCloudReader::ReadPoints(std::vector<CloudPoint>& vPoints)
+{
+   vPoints.clear();
+
+   if (!_qFile)
+      return false;
+
+   try
+   {
+      return _bLAS ? _ReadLAS(vPoints) : _ReadText(vPoints);
+   }
+   catch (boost::interprocess::interprocess_exception&)
+   {
+      return false;
+   }
+}
+
+//-----------------------------------------------------------------------------
+
+bool PointCloudReader::_ReadText(std::vector<CloudPoint>& vPoints)
+{
+   using namespace boost::interprocess;
 
-   while (!_ifstream.eof())
+   while (_nPos < _nFileSize)
    {
-      _ifstream.getline(line, 4095);
-      std::string string_line(line);
-      Tokenize(string_line, _separators, vOut);
-      size_t numColumns = vOut.size();
+      int64 nSize = math::Min<int64>(TEXT_BLOCK, _nFileSize - _nPos);
+      mapped_region region(*_qFile, read_only, _nPos, (std::size_t)nSize);
+      const char* pBegin = (const char*)region.get_address();
+      const char* pEnd = pBegin + nSize;
 
-      if (_ptsread == 0) // first point!
+      // block ends after the last complete line
+      if (_nPos + nSize < _nFileSize)
       {
-         if (numColumns == 3)
-         {
-            // Reading XYZ Point Cloud
-            _pct = PCT_XYZ;
-         }
-         if (numColumns == 4)
-         {
-            // Reading XYZI Point Cloud
-            _pct = PCT_XYZI;
-         }
-         else if (numColumns == 6)
-         {
-            // Reading XYZRGB Point Cloud!
-            _pct = PCT_XYZRGB;
-         }
-         else if (numColumns == 7)
-         {
-            // Reading XYZIRGB Point Cloud!
-            _pct = PCT_XYZIRGB;
-         }
-         else
+         const char* p = pEnd;
+         while (p > pBegin && p[-1] != '\n') p--;
+         if (p > pBegin)
+            pEnd = p;
+      }
+      _nPos += pEnd - pBegin;
+
+      // point cloud type is defined by the first numeric line
+      if (_pct == PCT_INVALID)
+      {
+         const char* p = pBegin;
+         while (p < pEnd && _pct == PCT_INVALID)
          {
-             // pc is not valid!
-            _pct = PCT_INVALID;
-            return false;
+            double v[8];
+            const char* next;
+            const char* eol = _LineEnd(p, pEnd, next);
+            int n = _ParseLine(p, eol, v, 8);
+            p = next;
+
+            if (n == 3)
+               _pct = PCT_XYZ;
+            else if (n == 4)
+               _pct = PCT_XYZI;
+            else if (n == 6)
+               _pct = PCT_XYZRGB;
+            else if (n == 7)
+               _pct = PCT_XYZIRGB;
+            else if (n > 0)
+            {
+               // pc is not valid!
+               _nPos = _nFileSize;
+               return false;
+            }
          }
+         if (_pct == PCT_INVALID)
+            continue;
       }
 
-      if (vOut.size() >= 3 && vOut.size() == numColumns)
+      // split block at line boundaries, every part is parsed by one thread
+      int nParts = 1;
+#ifdef _OPENMP
+      nParts = omp_get_max_threads();
+#endif
+      nParts = (int)math::Max<int64>(1, math::Min<int64>(nParts, (pEnd-pBegin) / TEXT_PART));
+
+      std::vector<const char*> vBounds(nParts+1);
+      vBounds[0] = pBegin;
+      vBounds[nParts] = pEnd;
+      for (int k=1;k<nParts;k++)
       {
-         point.x = vOut[0];
-         point.y = vOut[1];
-         point.elevation = vOut[2];
+         const char* p = pBegin + (pEnd-pBegin)*k/nParts;
+         if (p < vBounds[k-1]) p = vBounds[k-1];
+         const char* eol = (const char*)memchr(p, '\n', pEnd-p);
+         vBounds[k] = eol ? eol+1 : pEnd;
+      }
 
-         if (_pct == PCT_XYZI)
-         {
-            point.intensity = (int)vOut[3];
-         }
-         else if (_pct == PCT_XYZRGB)
-         {
-            point.r = (unsigned char)vOut[3];
-            point.g = (unsigned char)vOut[4];
-            point.b = (unsigned char)vOut[5];
-         }
-         else if (_pct == PCT_XYZIRGB)
-         {
-            point.intensity = (int)vOut[3];
-            point.r = (unsigned char)vOut[4];
-            point.g = (unsigned char)vOut[5];
-            point.b = (unsigned char)vOut[6];
-         }
+      std::vector<std::vector<CloudPoint> > vParts(nParts);
+      PointCloudType pct = _pct;
+#     pragma omp parallel for
+      for (int k=0;k<nParts;k++)
+      {
+         vParts[k].reserve((vBounds[k+1]-vBounds[k]) / 24);
+         _ParseLines(vBounds[k], vBounds[k+1], pct, vParts[k]);
+      }
 
-         _ptsread++;
+      size_t nPoints = 0;
+      for (int k=0;k<nParts;k++)
+      {
+         nPoints += vParts[k].size();
+      }
+      vPoints.reserve(nPoints);
+      for (int k=0;k<nParts;k++)
+      {
+         vPoints.insert(vPoints.end(), vParts[k].begin(), vParts[k].end());
+      }
+
+      if (nPoints > 0)
+      {
+         _ptsread += nPoints;
          return true;
       }
    }
@@ -128,6 +564,49 @@ bool PointCloudReader::ReadPoint(CloudPoint& point)
    return false;
 }
 
+//-----------------------------------------------------------------------------
+
+bool PointCloudReader::_ReadLAS(std::vector<CloudPoint>& vPoints)
+{
+   using namespace boost::interprocess;
+
+   if ((int64)_ptsread >= _nLASPoints)
+      return false;
+
+   int64 n = math::Min<int64>(LAS_BATCH, _nLASPoints - (int64)_ptsread);
+   mapped_region region(*_qFile, read_only, _nPos, (std::size_t)(n*_nLASRecordLength));
+   const unsigned char* pData = (const unsigned char*)region.get_address();
+
+   vPoints.resize((size_t)n);
+
+   int colorOffset = _LASColorOffset(_nLASFormat);
+   if (colorOffset + 6 > _nLASRecordLength)
+      colorOffset = -1;
+   int recordLength = _nLASRecordLength;
+   int colorShift = _nColorShift;
+
+#  pragma omp parallel for
+   for (int i=0;i<(int)n;i++)
+   {
+      const unsigned char* rec = pData + (size_t)i*recordLength;
+      CloudPoint& point = vPoints[i];
+      point.x = _Get<int>(rec) * _scale[0] + _offset[0];
+      point.y = _Get<int>(rec+4) * _scale[1] + _offset[1];
+      point.elevation = _Get<int>(rec+8) * _scale[2] + _offset[2];
+      point.intensity = _Get<unsigned short>(rec+12);
+      if (colorOffset >= 0)
+      {
+         point.r = (unsigned char)(_Get<unsigned short>(rec+colorOffset) >> colorShift);
+         point.g = (unsigned char)(_Get<unsigned short>(rec+colorOffset+2) >> colorShift);
+         point.b = (unsigned char)(_Get<unsigned short>(rec+colorOffset+4) >> colorShift);
+      }
+   }
+
+   _nPos += n*_nLASRecordLength;
+   _ptsread += (size_t)n;
+   return true;
+}
+
 //------------------------------------------------------------------------------
 
 
@@ -24,8 +24,11 @@
 #include <vector>
 #include <iostream>
 #include <fstream>
+#include <boost/shared_ptr.hpp>
 #include "math/CloudPoint.h"
 
+namespace boost { namespace interprocess { class file_mapping; } }
+
 enum PointCloudType
 {
    PCT_INVALID,   // invalid data!
@@ -38,6 +41,9 @@ enum PointCloudType
 //-----------------------------------------------------------------------------
 
 //! \class PointCloudReader
+//! \brief Reads ASCII point clouds (x y z [i] [r g b], one point per line) or LAS files (point formats 0-3, 6-8).
+//! The file is memory mapped and read in blocks. Every block is split at line
+//! boundaries and parsed by all threads.
 //! \author Martin Christen, martin.christen@fhnw.ch
 class OPENGLOBE_API PointCloudReader
 {
@@ -53,20 +59,40 @@ public:
 
    // Reads next point (normalized mercator coordinates + orthometric elevation). Returns false when all points are read.
    bool ReadPoint(CloudPoint& point);
+
+   //! Reads next batch of points (replaces content of vPoints). Returns false when all points are read.
+   bool ReadPoints(std::vector<CloudPoint>& vPoints);
  
    //! Get Point Cloud type (valid after reading first point)
    PointCloudType GetPointCloudtype(){return _pct;}
 
 
 private:
-   std::ifstream  _ifstream;
+   bool _OpenLAS();
+   bool _ReadText(std::vector<CloudPoint>& vPoints);
+   bool _ReadLAS(std::vector<CloudPoint>& vPoints);
+
+   boost::shared_ptr<boost::interprocess::file_mapping> _qFile;
+   int64          _nFileSize;
+   int64          _nPos;         // current position in file
    int            _nSourceEPSG;
    std::string    _sFilenameA;
    PointCloudType _pct;
-   std::string    _line;
-   std::string    _separators;
    size_t         _ptsread;
 
+   // LAS
+   bool           _bLAS;
+   int            _nLASFormat;
+   int            _nLASRecordLength;
+   int64          _nLASPoints;
+   double         _scale[3];
+   double         _offset[3];
+   int            _nColorShift;  // 8 for 16 bit colors
+
+   // buffered batch for ReadPoint
+   std::vector<CloudPoint> _vBuffer;
+   size_t         _nBufferPos;
+
 };
 
 #endif
\ No newline at end of file
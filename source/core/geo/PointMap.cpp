@@ -19,6 +19,11 @@
 #ifdef _USE_POINTS
 
 #include "PointMap.h"
+#include <boost/unordered_map.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <cstring>
 
 #pragma warning (disable : 4290 )
 #pragma warning (disable : 4250 )
@@ -56,6 +61,12 @@ struct cmp : public std::less<key_type>
 typedef stxxl::map<key_type, data_type, cmp, BLOCK_SIZE, BLOCK_SIZE> map_type;
 typedef map_type::iterator map_iterator;
 
+// point record in run and cell files: x,y,elevation (double), r,g,b (unsigned char), intensity (int)
+#define POINT_RECORD_SIZE (3*sizeof(double) + 3*sizeof(unsigned char) + sizeof(int))
+#define CHUNK_POINTS 1024
+#define CHUNK_SIZE (CHUNK_POINTS*POINT_RECORD_SIZE)
+#define NUM_RUNS 64
+
 class PointMap_private
 {
 public:
@@ -64,6 +75,7 @@ public:
    {  
       _index = new map_type(CACHE_SIZE * BLOCK_SIZE / 2, CACHE_SIZE * BLOCK_SIZE / 2);
       _resetiterator = true;
+      _vRuns.resize(NUM_RUNS);
    }
    // dtor
    virtual ~PointMap_private()
@@ -72,16 +84,278 @@ public:
       {
          delete _index;
       }
+      RemoveRuns();
+   }
+
+   //---------------------------------------------------------------------------
+   // chunk of points of one cell
+   struct SChunk
+   {
+      int64          key;
+      unsigned int   count;
+   };
+
+   // chunk read from a run file (offset in merge window)
+   struct SSegment
+   {
+      std::streamoff offset;
+      unsigned int   count;
+   };
+
+   struct SKeyOrder
+   {
+      SKeyOrder(const std::vector<int64>& vKeys) : _vKeys(vKeys) {}
+      bool operator()(size_t a, size_t b) const { return _vKeys[a] < _vKeys[b]; }
+      const std::vector<int64>& _vKeys;
+   };
+
+   //---------------------------------------------------------------------------
+   void AllocatePool()
+   {
+      size_t nChunks = _nMemoryLimit / CHUNK_SIZE;
+      if (nChunks < 16) nChunks = 16;
+      _vPool.resize(nChunks*CHUNK_SIZE);
+      _vChunks.resize(nChunks);
+      ReleaseChunks();
+   }
+
+   void ReleaseChunks()
+   {
+      _mapActive.clear();
+      _vFree.resize(_vChunks.size());
+      for (size_t i=0;i<_vChunks.size();i++)
+      {
+         _vFree[i] = int(_vChunks.size()-1-i);
+      }
+   }
+
+   //---------------------------------------------------------------------------
+   // append point record to chunk of key
+   void Add(int64 key, const CloudPoint& pt)
+   {
+      if (_vChunks.size() == 0)
+      {
+         AllocatePool();   // first point
+      }
+
+      int c;
+      boost::unordered_map<int64, int>::iterator it = _mapActive.find(key);
+      if (it != _mapActive.end())
+      {
+         c = it->second;
+      }
+      else
+      {
+         if (_vFree.size() == 0)
+         {
+            SpillAll(); // pool exhausted
+         }
+         c = _vFree.back();
+         _vFree.pop_back();
+         _vChunks[c].key = key;
+         _vChunks[c].count = 0;
+         _mapActive.insert(std::pair<int64, int>(key, c));
+      }
+
+      SChunk& chunk = _vChunks[c];
+      char* rec = &_vPool[c*CHUNK_SIZE + chunk.count*POINT_RECORD_SIZE];
+      memcpy(rec, &pt.x, sizeof(double)); rec += sizeof(double);
+      memcpy(rec, &pt.y, sizeof(double)); rec += sizeof(double);
+      memcpy(rec, &pt.elevation, sizeof(double)); rec += sizeof(double);
+      *rec++ = (char)pt.r;
+      *rec++ = (char)pt.g;
+      *rec++ = (char)pt.b;
+      memcpy(rec, &pt.intensity, sizeof(int));
+      chunk.count++;
+
+      if (chunk.count == CHUNK_POINTS)
+      {
+         Spill(c);
+         chunk.count = 0;  // chunk stays assigned to this key
+      }
+   }
+
+   //---------------------------------------------------------------------------
+   // write chunk to its run file: key (int64), count (unsigned int), records
+   void Spill(int c)
+   {
+      SChunk& chunk = _vChunks[c];
+      if (chunk.count == 0)
+         return;
+
+      std::ofstream& run = _OpenRun(_Run(chunk.key));
+      run.write((const char*)&chunk.key, sizeof(int64));
+      run.write((const char*)&chunk.count, sizeof(unsigned int));
+      run.write(&_vPool[c*CHUNK_SIZE], chunk.count*POINT_RECORD_SIZE);
+   }
+
+   void SpillAll()
+   {
+      boost::unordered_map<int64, int>::iterator it;
+      for (it = _mapActive.begin(); it != _mapActive.end(); ++it)
+      {
+         Spill(it->second);
+      }
+      ReleaseChunks();
+   }
+
+   //---------------------------------------------------------------------------
+   // merge run files into cell files. Keys of written cells are appended to vKeys.
+   // A run is read sequentially in windows of the pool size, every cell file is
+   // opened once per window (usually once per run).
+   void Merge(const std::string& path, int lod, int64 pow, int64 dpow, std::vector<int64>& vKeys)
+   {
+      if (_vChunks.size() == 0)
+         return;
+
+      SpillAll();
+
+      std::set<int64> setColumns;   // existing directories path/lod/i
+      std::vector<SSegment> vWindow;
+      std::vector<int64> vWindowKeys;
+
+      for (int r=0;r<NUM_RUNS;r++)
+      {
+         if (!_vRuns[r])
+            continue;
+
+         _vRuns[r]->close();
+         _vRuns[r].reset();
+
+         std::string sRunFile = _RunFilename(r);
+         std::ifstream in(sRunFile.c_str(), std::ios::binary);
+
+         int64 key;
+         SSegment segment;
+         bool bPending = false;   // segment header read, data not yet in window
+         bool bEof = false;
+         while (!bEof)
+         {
+            // fill window (pool memory is free now)
+            size_t nUsed = 0;
+            vWindow.clear();
+            vWindowKeys.clear();
+            for (;;)
+            {
+               if (!bPending && (!in.read((char*)&key, sizeof(int64)) || !in.read((char*)&segment.count, sizeof(unsigned int))))
+               {
+                  bEof = true;
+                  break;
+               }
+               bPending = false;
+               size_t nSize = segment.count*POINT_RECORD_SIZE;
+               if (nUsed + nSize > _vPool.size())
+               {
+                  bPending = true;   // segment goes to next window
+                  break;
+               }
+               in.read(&_vPool[nUsed], nSize);
+               segment.offset = (std::streamoff)nUsed;
+               nUsed += nSize;
+               vWindow.push_back(segment);
+               vWindowKeys.push_back(key);
+            }
+
+            // segments of window ordered by key (order of points is kept)
+            std::vector<size_t> vOrder(vWindow.size());
+            for (size_t s=0;s<vOrder.size();s++)
+            {
+               vOrder[s] = s;
+            }
+            std::stable_sort(vOrder.begin(), vOrder.end(), SKeyOrder(vWindowKeys));
+
+            size_t s = 0;
+            while (s < vOrder.size())
+            {
+               int64 i,j,k;
+               int64 key = vWindowKeys[vOrder[s]];
+               k = key / dpow;
+               j = (key - dpow*k) / pow;
+               i = key - dpow*k - j*pow;
+
+               std::ostringstream oss;
+               oss << path << lod << "/" << i << "/" << j << "-" << k << ".dat";
+               std::string sFilename = oss.str();
+
+               if (setColumns.find(i) == setColumns.end())
+               {
+                  FileSystem::makeallsubdirs(sFilename);
+                  setColumns.insert(i);
+               }
+
+               std::ofstream of(sFilename.c_str(), std::ios::app|std::ios::binary);
+               while (s < vOrder.size() && vWindowKeys[vOrder[s]] == key)
+               {
+                  const SSegment& segment = vWindow[vOrder[s]];
+                  of.write(&_vPool[(size_t)segment.offset], segment.count*POINT_RECORD_SIZE);
+                  s++;
+               }
+               of.close();
+
+               vKeys.push_back(key);
+            }
+         }
+
+         in.close();
+         FileSystem::rm(sRunFile);
+      }
+   }
+
+   //---------------------------------------------------------------------------
+   void RemoveRuns()
+   {
+      for (int r=0;r<NUM_RUNS;r++)
+      {
+         if (_vRuns[r])
+         {
+            _vRuns[r]->close();
+            _vRuns[r].reset();
+            FileSystem::rm(_RunFilename(r));
+         }
+      }
    }
+
    // map
    map_type* _index;
    bool      _resetiterator;
    map_iterator _it;
+
+   // partitioner
+   std::string                               _sRunPrefix;
+   size_t                                    _nMemoryLimit;
+   std::vector<char>                         _vPool;       // chunk data
+   std::vector<SChunk>                       _vChunks;
+   std::vector<int>                          _vFree;       // unused chunks
+   boost::unordered_map<int64, int>          _mapActive;   // key -> chunk
+   std::vector<boost::shared_ptr<std::ofstream> > _vRuns;
+   std::vector<int64>                        _vKeys;       // keys of exported cells
+
+private:
+   int _Run(int64 key)
+   {
+      return int(uint64(key) % NUM_RUNS);
+   }
+
+   std::string _RunFilename(int r)
+   {
+      std::ostringstream oss;
+      oss << _sRunPrefix << ".run" << r;
+      return oss.str();
+   }
+
+   std::ofstream& _OpenRun(int r)
+   {
+      if (!_vRuns[r])
+      {
+         _vRuns[r] = boost::shared_ptr<std::ofstream>(new std::ofstream(_RunFilename(r).c_str(), std::ios::binary|std::ios::trunc));
+      }
+      return *_vRuns[r];
+   }
    
 };
 
 //------------------------------------------------------------------------
-PointMap::PointMap(int levelofdetail)
+PointMap::PointMap(int levelofdetail, const std::string& sRunPrefix, size_t nMemoryLimit)
 {
    _numpts = 0;
    _numkeys = 0;
@@ -89,8 +363,13 @@ PointMap::PointMap(int levelofdetail)
    _pow = int64(1) << _lod; 
    _dpow = _pow * _pow;
    _pPriv = new PointMap_private();
-
-   
+   _pPriv->_sRunPrefix = sRunPrefix;
+   if (_pPriv->_sRunPrefix.empty())
+   {
+      boost::filesystem::path p = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("pointmap-%%%%-%%%%-%%%%");
+      _pPriv->_sRunPrefix = p.string();
+   }
+   _pPriv->_nMemoryLimit = nMemoryLimit;
 }
 //------------------------------------------------------------------------
 PointMap::~PointMap()
@@ -104,9 +383,9 @@ PointMap::~PointMap()
 //------------------------------------------------------------------------
 void PointMap::Clear()
 {
-   _map.clear();
+   _pPriv->ReleaseChunks();
+   _pPriv->RemoveRuns();
    _numpts = 0;
-   _numkeys = 0;
 }
 //------------------------------------------------------------------------
 void PointMap::AddPoint(int64 i, int64 j, int64 k, const CloudPoint& pt)
@@ -114,24 +393,7 @@ void PointMap::AddPoint(int64 i, int64 j, int64 k, const CloudPoint& pt)
    int64 key = _dpow*k + _pow*j + i;
 
    _numpts++;
-   
-   std::map<int64, std::list<CloudPoint> >::iterator it;
-   it = _map.find(key);
-   if (it != _map.end())
-   {
-      // this key already exists, append point
-      it->second.push_back(pt);
-   }
-   else
-   {
-      // this key doesn't exist yet. create new entry
-      std::list<CloudPoint> newList;
-      newList.push_back(pt);
-      _map.insert(std::pair<int64, std::list<CloudPoint> >(key, newList));
-      _numkeys++;
-
-      _pPriv->_index->insert(std::pair<int64,unsigned int>(key, 0));
-   }
+   _pPriv->Add(key, pt);
 }
 //------------------------------------------------------------------------
 size_t PointMap::GetNumPoints()
@@ -142,78 +404,22 @@ size_t PointMap::GetNumPoints()
 
 void PointMap::ExportData(const std::string& path)
 {
-   std::map<int64, std::list<CloudPoint> >::iterator it = _map.begin();
-
-   while (it != _map.end())
-   {
-      int64 key = it->first;
-      int64 i,j,k;
-
-      k = key / _dpow;
-      j = (key - _dpow*k) / _pow;
-      i = key - _dpow*k - j*_pow;
-
-      //std::string sOctocode = Octocode::IndexToOctocode(i,j,k,_lod);
-      //create or open existing file: path/lod/x/y-z.json
-
-      std::ostringstream oss;
-      oss << path << _lod << "/" << i << "/" << j << "-" << k << ".dat";
-      std::string sFilename = oss.str();
-
-
-      std::ofstream of;
-
+   _pPriv->Merge(path, _lod, _pow, _dpow, _pPriv->_vKeys);
 
-      if (FileSystem::FileExists(sFilename))
-      {
-         of.open(sFilename.c_str(), std::ios::app|std::ios::binary);
-      }
-      else
-      {
-         FileSystem::makeallsubdirs(sFilename);
-         of.open(sFilename.c_str(), std::ios::binary);
-      }
-
-      of.precision(17);
-
-      std::list<CloudPoint>& lstCloudPoints = it->second;
-
-      std::list<CloudPoint>::iterator jt = lstCloudPoints.begin();
-      while (jt != lstCloudPoints.end())
-      {
-         of.write((char*)&jt->x, sizeof(double));
-         of.write((char*)&jt->y, sizeof(double));
-         of.write((char*)&jt->elevation, sizeof(double));
-         of.write((char*)&jt->r, sizeof(unsigned char));
-         of.write((char*)&jt->g, sizeof(unsigned char));
-         of.write((char*)&jt->b, sizeof(unsigned char));
-         of.write((char*)&jt->intensity, sizeof(int));
-
-         jt++;
-      }
-
-      of.close();
-
-      ++it;
-   }
+   std::sort(_pPriv->_vKeys.begin(), _pPriv->_vKeys.end());
+   _pPriv->_vKeys.erase(std::unique(_pPriv->_vKeys.begin(), _pPriv->_vKeys.end()), _pPriv->_vKeys.end());
+   _numkeys = _pPriv->_vKeys.size();
 }
 
 //------------------------------------------------------------------------
 
 void PointMap::ExportIndex(const std::string& sFilename)
 {
-   map_iterator it = _pPriv->_index->begin();
-
    std::ofstream of(sFilename.c_str(), std::ios::binary);
   
-   if (of.good())
+   if (of.good() && _pPriv->_vKeys.size()>0)
    {
-      while (it != _pPriv->_index->end())
-      {
-         int64 elm = it->first;
-         of.write((char*)&elm, sizeof(int64));
-         it++;
-      }
+      of.write((const char*)&_pPriv->_vKeys[0], _pPriv->_vKeys.size()*sizeof(int64));
    }
 
    of.close();
@@ -35,17 +35,23 @@
 //------------------------------------------------------------------------
 class PointMap_private;
 
+// Partitions points into octree cells (voxels) at a level of detail.
+// Points are stored in fixed-size chunks from a pool (one chunk per active cell),
+// full chunks are spilled to one of a few run files. ExportData merges the runs
+// into the cell files, so every cell file is opened once per export.
+// Memory is bounded by the chunk pool, independent of the number of cells.
+
 class OPENGLOBE_API PointMap
 {
 public:
   
-   // ctor
-   PointMap(int levelofdetail);
+   // ctor. Run files are created as <sRunPrefix>.run<n> (default: temp directory of the system).
+   PointMap(int levelofdetail, const std::string& sRunPrefix = std::string(), size_t nMemoryLimit = 256*1024*1024);
 
    // dtor
    virtual ~PointMap();
    
-   // clear all point data (free mem). Index is not cleared.
+   // clear all point data (free mem, remove run files). Index is not cleared.
    void Clear();
 
    // add a point
@@ -54,7 +60,7 @@ public:
    // get number of points
    size_t GetNumPoints();
 
-   // export data
+   // merge all points added so far into cell files path/lod/i/j-k.dat (appending to existing files)
    void ExportData(const std::string& path);
 
    // export index list to file
@@ -71,7 +77,6 @@ public:
 private:
    PointMap(){}
    PointMap_private* _pPriv;
-   std::map<int64, std::list<CloudPoint> > _map;
    size_t _numpts;
    size_t _numkeys;
    int _lod;
@@ -0,0 +1,225 @@
+/*******************************************************************************
+#      ____               __          __  _      _____ _       _               #
+#     / __ \              \ \        / / | |    / ____| |     | |              #
+#    | |  | |_ __   ___ _ __ \  /\  / /__| |__ | |  __| | ___ | |__   ___      #
+#    | |  | | '_ \ / _ \ '_ \ \/  \/ / _ \ '_ \| | |_ | |/ _ \| '_ \ / _ \     #
+#    | |__| | |_) |  __/ | | \  /\  /  __/ |_) | |__| | | (_) | |_) |  __/     #
+#     \____/| .__/ \___|_| |_|\/  \/ \___|_.__/ \_____|_|\___/|_.__/ \___|     #
+#           | |                                                                #
+#           |_|                                                                #
+#                                                                              #
+#                                (c) 2011 by                                   #
+#           University of Applied Sciences Northwestern Switzerland            #
+#                     Institute of Geomatics Engineering                       #
+#                           martin.christen@fhnw.ch                            #
+********************************************************************************
+*     Licensed under MIT License. Read the file LICENSE for more information   *
+*******************************************************************************/
+
+#include "RasterBlockCache.h"
+
+#include <gdal.h>
+#include <gdal_priv.h>
+#include <cstring>
+
+#define _pGDALDataset ((GDALDataset*)_pDataset)
+
+//-----------------------------------------------------------------------------
+
+RasterBlockCache::RasterBlockCache(const DataSetInfo& oDataset, size_t nMaxCacheSize, int nBlockSize)
+{
+   _pDataset = 0;
+   _nSizeX = oDataset.nSizeX;
+   _nSizeY = oDataset.nSizeY;
+   _nBlockSize = math::Max<int>(nBlockSize, 16);
+   _nBlocksX = (_nSizeX + _nBlockSize - 1) / _nBlockSize;
+   _nBlocksY = (_nSizeY + _nBlockSize - 1) / _nBlockSize;
+   _nMaxCacheSize = nMaxCacheSize;
+   _nCacheSize = 0;
+
+   if (!oDataset.bGood)  // invalid dataset
+   {
+      return;
+   }
+
+   // currently only datasets with 3 bands (RGB) are supported
+   if (oDataset.nBands != 3)
+   {
+      return;
+   } 
+
+   _pDataset = (void*)GDALOpen(oDataset.sFilename.c_str(), GA_ReadOnly);
+}
+
+//-----------------------------------------------------------------------------
+
+RasterBlockCache::~RasterBlockCache()
+{
+   _Free();
+}
+
+//-----------------------------------------------------------------------------
+
+void RasterBlockCache::_Free()
+{
+   if (_pDataset)
+   {
+      GDALClose(_pGDALDataset);
+      _pDataset = 0;
+   }
+
+   _mapBlocks.clear();
+   _lstLRU.clear();
+   _nCacheSize = 0;
+}
+
+//-----------------------------------------------------------------------------
+
+size_t RasterBlockCache::GetCacheSize()
+{
+   boost::mutex::scoped_lock lock(_mutexCache);
+   return _nCacheSize;
+}
+
+//-----------------------------------------------------------------------------
+
+bool RasterBlockCache::_ReadBlock(int bx, int by, CacheEntry& entry)
+{
+   int x0 = bx*_nBlockSize;
+   int y0 = by*_nBlockSize;
+   entry.nWidth = math::Min<int>(_nBlockSize, _nSizeX - x0);
+   entry.nHeight = math::Min<int>(_nBlockSize, _nSizeY - y0);
+   entry.vData = boost::shared_array<unsigned char>(new unsigned char[3*entry.nWidth*entry.nHeight]);
+
+   // GDAL datasets are not thread safe: serialize access to the file handle
+   boost::mutex::scoped_lock lock(_mutexIO);
+
+   CPLErr err = _pGDALDataset->RasterIO(
+      GF_Read,                      // eRWFlag
+      x0,                           // nXOff
+      y0,                           // nYOff
+      entry.nWidth,                 // nXSize
+      entry.nHeight,                // nYSize
+      (void*)entry.vData.get(),     // pData
+      entry.nWidth,                 // nBufXSize
+      entry.nHeight,                // nBufYSize
+      GDT_Byte,                     // eBufType
+      3,                            // nBandCount
+      NULL,                         // panBandMap (1,2,3)
+      3,                            // nPixelSpace
+      3*entry.nWidth,               // nLineSpace
+      1                             // nBandSpace
+      );
+
+   return err == CE_None;
+}
+
+//-----------------------------------------------------------------------------
+
+bool RasterBlockCache::_GetBlock(int bx, int by, CacheEntry& entry)
+{
+   int64 key = int64(by)*int64(_nBlocksX)+int64(bx);
+
+   {
+      boost::mutex::scoped_lock lock(_mutexCache);
+      std::map<int64, CacheEntry>::iterator it = _mapBlocks.find(key);
+      if (it != _mapBlocks.end())
+      {
+         // move to front of LRU list
+         _lstLRU.splice(_lstLRU.begin(), _lstLRU, it->second.itLRU);
+         entry = it->second;
+         return true;
+      }
+   }
+
+   // cache miss: read block without holding the cache lock
+   CacheEntry newentry;
+   if (!_ReadBlock(bx, by, newentry))
+   {
+      return false;
+   }
+
+   boost::mutex::scoped_lock lock(_mutexCache);
+
+   // another thread may have loaded the same block in the meantime
+   std::map<int64, CacheEntry>::iterator it = _mapBlocks.find(key);
+   if (it != _mapBlocks.end())
+   {
+      _lstLRU.splice(_lstLRU.begin(), _lstLRU, it->second.itLRU);
+      entry = it->second;
+      return true;
+   }
+
+   size_t nBytes = 3*size_t(newentry.nWidth)*size_t(newentry.nHeight);
+
+   // evict least recently used blocks. Blocks still referenced by a reader
+   // stay valid because they are reference counted.
+   while (!_lstLRU.empty() && _nCacheSize + nBytes > _nMaxCacheSize)
+   {
+      std::map<int64, CacheEntry>::iterator itOld = _mapBlocks.find(_lstLRU.back());
+      _nCacheSize -= 3*size_t(itOld->second.nWidth)*size_t(itOld->second.nHeight);
+      _mapBlocks.erase(itOld);
+      _lstLRU.pop_back();
+   }
+
+   _lstLRU.push_front(key);
+   newentry.itLRU = _lstLRU.begin();
+   _mapBlocks[key] = newentry;
+   _nCacheSize += nBytes;
+
+   entry = newentry;
+   return true;
+}
+
+//-----------------------------------------------------------------------------
+
+boost::shared_array<unsigned char> RasterBlockCache::ReadWindowRGB(int x0, int y0, int x1, int y1)
+{
+   boost::shared_array<unsigned char> vWindow;
+
+   if (!_pDataset || x0 > x1 || y0 > y1 || 
+       x0 < 0 || y0 < 0 || x1 >= _nSizeX || y1 >= _nSizeY)
+   {
+      return vWindow;
+   }
+
+   int nWidth = x1-x0+1;
+   int nHeight = y1-y0+1;
+   vWindow = boost::shared_array<unsigned char>(new unsigned char[3*size_t(nWidth)*size_t(nHeight)]);
+   unsigned char* pWindow = vWindow.get();
+
+   int bx0 = x0 / _nBlockSize;
+   int by0 = y0 / _nBlockSize;
+   int bx1 = x1 / _nBlockSize;
+   int by1 = y1 / _nBlockSize;
+
+   for (int by=by0;by<=by1;++by)
+   {
+      for (int bx=bx0;bx<=bx1;++bx)
+      {
+         CacheEntry entry;
+         if (!_GetBlock(bx, by, entry))
+         {
+            return boost::shared_array<unsigned char>();
+         }
+
+         // intersection of block and window (image coords)
+         int ix0 = math::Max<int>(x0, bx*_nBlockSize);
+         int iy0 = math::Max<int>(y0, by*_nBlockSize);
+         int ix1 = math::Min<int>(x1, bx*_nBlockSize+entry.nWidth-1);
+         int iy1 = math::Min<int>(y1, by*_nBlockSize+entry.nHeight-1);
+         size_t nRowBytes = 3*size_t(ix1-ix0+1);
+
+         for (int y=iy0;y<=iy1;++y)
+         {
+            const unsigned char* pSrc = entry.vData.get() + 3*(size_t(y-by*_nBlockSize)*size_t(entry.nWidth)+size_t(ix0-bx*_nBlockSize));
+            unsigned char* pDst = pWindow + 3*(size_t(y-y0)*size_t(nWidth)+size_t(ix0-x0));
+            memcpy(pDst, pSrc, nRowBytes);
+         }
+      }
+   }
+
+   return vWindow;
+}
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,85 @@
+/*******************************************************************************
+#      ____               __          __  _      _____ _       _               #
+#     / __ \              \ \        / / | |    / ____| |     | |              #
+#    | |  | |_ __   ___ _ __ \  /\  / /__| |__ | |  __| | ___ | |__   ___      #
+#    | |  | | '_ \ / _ \ '_ \ \/  \/ / _ \ '_ \| | |_ | |/ _ \| '_ \ / _ \     #
+#    | |__| | |_) |  __/ | | \  /\  /  __/ |_) | |__| | | (_) | |_) |  __/     #
+#     \____/| .__/ \___|_| |_|\/  \/ \___|_.__/ \_____|_|\___/|_.__/ \___|     #
+#           | |                                                                #
+#           |_|                                                                #
+#                                                                              #
+#                                (c) 2011 by                                   #
+#           University of Applied Sciences Northwestern Switzerland            #
+#                     Institute of Geomatics Engineering                       #
+#                           martin.christen@fhnw.ch                            #
+********************************************************************************
+*     Licensed under MIT License. Read the file LICENSE for more information   *
+*******************************************************************************/
+
+#ifndef _RASTERBLOCKCACHE_H
+#define _RASTERBLOCKCACHE_H
+
+#include "og.h"
+#include "ogprocess.h"
+#include <boost/shared_array.hpp>
+#include <boost/thread/mutex.hpp>
+#include <list>
+#include <map>
+
+//-----------------------------------------------------------------------------
+// Windowed reader for large GDAL RGB rasters. Instead of loading the whole
+// image into memory, square blocks are read on demand and kept in a bounded
+// LRU cache. Peak memory is therefore limited by the cache size and not by
+// the size of the image. All public functions are thread safe.
+//-----------------------------------------------------------------------------
+
+//! \class RasterBlockCache
+class OPENGLOBE_API RasterBlockCache
+{
+public:
+   //! Open dataset for windowed reading.
+   //! \param oDataset dataset info (see ProcessingUtils::RetrieveDatasetInfo)
+   //! \param nMaxCacheSize maximum size of cached blocks in bytes
+   //! \param nBlockSize width/height of a cache block in pixels
+   RasterBlockCache(const DataSetInfo& oDataset, size_t nMaxCacheSize, int nBlockSize = 512);
+   virtual ~RasterBlockCache();
+
+   //! Returns true if the dataset could be opened (currently 3 band RGB only)
+   bool IsGood() { return _pDataset != 0; }
+
+   //! Read window [x0,x1]x[y0,y1] (inclusive pixel coords) as RGB (3 bytes per pixel, line size 3*(x1-x0+1))
+   //! The window must be inside the image. Returns empty array on failure.
+   boost::shared_array<unsigned char> ReadWindowRGB(int x0, int y0, int x1, int y1);
+
+   //! Returns current size of all cached blocks in bytes
+   size_t GetCacheSize();
+
+protected:
+   struct CacheEntry
+   {
+      boost::shared_array<unsigned char> vData;
+      int nWidth;
+      int nHeight;
+      std::list<int64>::iterator itLRU;
+   };
+
+   bool _GetBlock(int bx, int by, CacheEntry& entry);
+   bool _ReadBlock(int bx, int by, CacheEntry& entry);
+   void _Free();
+
+private:
+   void*                         _pDataset;  // hidden type: GDALDataset*
+   int                           _nSizeX;
+   int                           _nSizeY;
+   int                           _nBlockSize;
+   int                           _nBlocksX;
+   int                           _nBlocksY;
+   size_t                        _nMaxCacheSize;
+   size_t                        _nCacheSize;
+   std::map<int64, CacheEntry>   _mapBlocks;
+   std::list<int64>              _lstLRU;    // front: most recently used
+   boost::mutex                  _mutexCache;
+   boost::mutex                  _mutexIO;
+};
+
+#endif
@@ -28,6 +28,7 @@ ImageObject::ImageObject()
    _ePixelFormat = Img::PixelFormat_unknown; 
    _width = 0;
    _height = 0;
+   _nCapacity = 0;
 }
 
 //----------------------------------------------------------------------------
@@ -71,8 +72,15 @@ void ImageObject::AllocateImage(unsigned int w, unsigned int h, Img::PixelFormat
    _ePixelFormat = ePixelFormat;
    
    bpp = _bpp();
-   
-   _qData = boost::shared_array<unsigned char>(new unsigned char[w*h*bpp]); 
+
+   size_t nSize = size_t(w)*size_t(h)*size_t(bpp);
+
+   // reuse buffer if nobody else holds a reference to it
+   if (!_qData || !_qData.unique() || _nCapacity < nSize)
+   {
+      _qData = boost::shared_array<unsigned char>(new unsigned char[nSize]); 
+      _nCapacity = nSize;
+   }
 }
 //------------------------------------------------------------------------------
 void ImageObject::_RGB_RGBA(unsigned char*  input)
@@ -392,6 +400,7 @@ Raw32ImageObject::Raw32ImageObject()
 {
    _width = 0;
    _height = 0;
+   _nCapacity = 0;
 }
 
 //----------------------------------------------------------------------------
@@ -407,19 +416,24 @@ void Raw32ImageObject::AllocateImage(unsigned int w, unsigned int h)
 {
    _width = w;
    _height = h;
-   
-   _qData = boost::shared_array<float>(new float[w*h]); 
+
+   size_t nSize = size_t(w)*size_t(h);
+
+   // reuse buffer if nobody else holds a reference to it
+   if (!_qData || !_qData.unique() || _nCapacity < nSize)
+   {
+      _qData = boost::shared_array<float>(new float[nSize]); 
+      _nCapacity = nSize;
+   }
 }
 
 //------------------------------------------------------------------------------
 
 void Raw32ImageObject::AllocateImage(unsigned int w, unsigned int h, float defaultValue)
 {
-   _width = w;
-   _height = h;
-   
-   _qData = boost::shared_array<float>(new float[w*h]);
-   for(size_t i = 0; i < w*h; i++)
+   AllocateImage(w, h);
+
+   for(size_t i = 0; i < size_t(w)*size_t(h); i++)
    {
       _qData[i] = defaultValue;
    }
@@ -45,7 +45,7 @@ public:
    ImageObject();
    virtual ~ImageObject();
    
-   //! \brief Allocate Image Data
+   //! \brief Allocate Image Data. The current buffer is reused if it is large enough and not referenced elsewhere.
    void AllocateImage(unsigned int w, unsigned int h, Img::PixelFormat ePixelFormat);   
    
    //! \brief Retrieve Pixel Format
@@ -90,6 +90,7 @@ protected:
 
    
    boost::shared_array<unsigned char> _qData; 
+   size_t _nCapacity;   // size of _qData in bytes
    Img::PixelFormat _ePixelFormat; 
    unsigned int _width;
    unsigned int _height; 
@@ -102,7 +103,7 @@ public:
    Raw32ImageObject();
    virtual ~Raw32ImageObject();
    
-   //! \brief Allocate Image Data
+   //! \brief Allocate Image Data. The current buffer is reused if it is large enough and not referenced elsewhere.
    void AllocateImage(unsigned int w, unsigned int h);
    void AllocateImage(unsigned int w, unsigned int h, float defaultValue);
    void Fill(float*  input);
@@ -116,6 +117,7 @@ public:
    boost::shared_array<float> GetRawData() { return _qData;}
 protected:
    boost::shared_array<float> _qData; 
+   size_t _nCapacity;   // number of floats in _qData
    unsigned int _width;
    unsigned int _height; 
 };
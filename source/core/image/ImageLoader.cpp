@@ -22,6 +22,7 @@
 #include "string/StringUtils.h"
 #include <fstream>
 #include <cassert>
+#include <cstring>
 
 #define STBI_NO_HDR
 #include "stb_image.c"
@@ -32,32 +33,66 @@
 
 //------------------------------------------------------------------------------
 
-bool ImageLoader::LoadFromDisk(Img::FileFormat eFormat, const std::string& sFilename, Img::PixelFormat eDestPixelFormat, ImageObject& outputimage)
+namespace
 {
-   std::vector<unsigned char> vecData;
-   std::ifstream ifs;
-   
+   // open file for binary reading and retrieve its size
+   bool _OpenFile(const std::string& sFilename, std::ifstream& ifs, size_t& nSize)
+   {
 #ifdef OS_WINDOWS
-   std::wstring sFilenameW = StringUtils::Utf8_To_wstring(sFilename);
-   ifs.open(sFilenameW.c_str(), std::ios::in | std::ios::binary);
+      std::wstring sFilenameW = StringUtils::Utf8_To_wstring(sFilename);
+      ifs.open(sFilenameW.c_str(), std::ios::in | std::ios::binary);
 #else
-   ifs.open(sFilename.c_str(), std::ios::in | std::ios::binary);
+      ifs.open(sFilename.c_str(), std::ios::in | std::ios::binary);
 #endif
-   if (ifs.good())
-   {
-      unsigned char s;
-      while (!ifs.eof())
-      {  
-         ifs.read((char*)&s, 1);
-         vecData.push_back(s);  
+      if (!ifs.good())
+      {
+         return false;
       }
+
+      ifs.seekg(0, std::ios::end);
+      std::streamoff end = ifs.tellg();
+      ifs.seekg(0, std::ios::beg);
+
+      if (end < 0)
+      {
+         return false;
+      }
+
+      nSize = size_t(end);
+      return true;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+bool ImageLoader::LoadFromDisk(Img::FileFormat eFormat, const std::string& sFilename, Img::PixelFormat eDestPixelFormat, ImageObject& outputimage)
+{
+   std::vector<unsigned char> vecData;
+   return LoadFromDisk(eFormat, sFilename, eDestPixelFormat, outputimage, vecData);
+}
+
+//------------------------------------------------------------------------------
+
+bool ImageLoader::LoadFromDisk(Img::FileFormat eFormat, const std::string& sFilename, Img::PixelFormat eDestPixelFormat, ImageObject& outputimage, std::vector<unsigned char>& vBuffer)
+{
+   std::ifstream ifs;
+   size_t nSize;
+
+   if (!_OpenFile(sFilename, ifs, nSize) || nSize == 0)
+   {
+      return false;
    }
-   else
+
+   // read whole file at once
+   vBuffer.resize(nSize);
+   ifs.read((char*)&vBuffer[0], nSize);
+
+   if (size_t(ifs.gcount()) != nSize)
    {
       return false;
    }
    
-   return ImageLoader::LoadFromMemory(eFormat, &vecData[0], vecData.size(), eDestPixelFormat, outputimage);
+   return ImageLoader::LoadFromMemory(eFormat, &vBuffer[0], (unsigned int)nSize, eDestPixelFormat, outputimage);
 }
 
 //------------------------------------------------------------------------------
@@ -65,36 +100,44 @@ bool ImageLoader::LoadFromDisk(Img::FileFormat eFormat, const std::string& sFile
 bool ImageLoader::LoadRaw32FromDisk(const std::string& sFilename, int w, int h,  Raw32ImageObject& outputdata)
 {
    std::ifstream ifs;
-   
-#ifdef OS_WINDOWS
-   std::wstring sFilenameW = StringUtils::Utf8_To_wstring(sFilename);
-   ifs.open(sFilenameW.c_str(), std::ios::binary);
-#else
-   ifs.open(sFilename.c_str(), std::ios::binary);
-#endif
+   size_t nSize;
+
+   if (!_OpenFile(sFilename, ifs, nSize))
+   {
+      return false;
+   }
+
    outputdata.AllocateImage(w,h);
-      int offset = 0;
-      if (ifs.good())
-      {
-         while (!ifs.eof())
-         {
-                     
-            float value;
-            ifs.read((char*)&(value), sizeof(float));
-            if (!ifs.eof())
-            {
-               outputdata.SetValue(offset, value);
-            }
-            offset++;
-         }
-         ifs.close();
-         return true;
-      }
-      else
-      {
-         ifs.close();
-         return false;
-      }
+
+   // read values directly into image
+   size_t nValues = nSize / sizeof(float);
+   if (nValues > size_t(w)*size_t(h))
+   {
+      nValues = size_t(w)*size_t(h);
+   }
+
+   if (nValues > 0)
+   {
+      ifs.read((char*)outputdata.GetRawData().get(), nValues*sizeof(float));
+   }
+
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool ImageLoader::LoadRaw32FromMemory(const unsigned char* pData, const size_t nSize, int w, int h, Raw32ImageObject& outputdata)
+{
+   outputdata.AllocateImage(w,h);
+
+   size_t nValues = nSize / sizeof(float);
+   if (nValues > size_t(w)*size_t(h))
+   {
+      nValues = size_t(w)*size_t(h);
+   }
+
+   memcpy(outputdata.GetRawData().get(), pData, nValues*sizeof(float));
+   return true;
 }
 
 //------------------------------------------------------------------------------
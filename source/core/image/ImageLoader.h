@@ -20,6 +20,7 @@
 #define _IMAGELOADER_H
 
 #include "ImageHandler.h"
+#include <vector>
 
 /*
    Example Code:
@@ -62,7 +63,10 @@ public:
    virtual ~ImageLoader() {}
    // synchrousous loading from disk
    static bool LoadFromDisk(Img::FileFormat eFormat, const std::string& sFilename, Img::PixelFormat eDestPixelFormat, ImageObject& outputimage);
+   // loading from disk using a reusable file buffer. Decoding into outputimage reuses its memory too.
+   static bool LoadFromDisk(Img::FileFormat eFormat, const std::string& sFilename, Img::PixelFormat eDestPixelFormat, ImageObject& outputimage, std::vector<unsigned char>& vBuffer);
    static bool LoadRaw32FromDisk(const std::string& sFilename, int w, int h,  Raw32ImageObject& outputdata);
+   static bool LoadRaw32FromMemory(const unsigned char* pData, const size_t nSize, int w, int h, Raw32ImageObject& outputdata);
    
    // decompress from memory
    static bool LoadFromMemory(Img::FileFormat eFormat, const unsigned char* pData, const unsigned int nSize, Img::PixelFormat eDestPixelFormat, ImageObject& outputimage);   
@@ -24,6 +24,7 @@
 #include "image/JPEGHandler.h"
 
 #include <fstream>
+#include <cstdlib>
 
 //------------------------------------------------------------------------------
 
@@ -47,6 +48,22 @@ bool ImageWriter::WritePNG(const std::string& sFilename, unsigned char* buffer_r
 
 
 
+//------------------------------------------------------------------------------
+
+bool ImageWriter::EncodePNG(unsigned char* buffer_rbga, int width, int height, std::vector<unsigned char>& vOut)
+{
+   int len;
+   unsigned char* png = stbi_write_png_to_mem(buffer_rbga, 4*width, width, height, 4, &len);
+   if (!png)
+   {
+      return false;
+   }
+
+   vOut.assign(png, png+len);
+   free(png);
+   return true;
+}
+
 //------------------------------------------------------------------------------
 
 bool ImageWriter::WritePNG(const std::string& sFilename, ImageObject& image)
@@ -22,6 +22,7 @@
 #include "og.h"
 #include "image/ImageHandler.h"
 #include <string>
+#include <vector>
 
 class OPENGLOBE_API ImageWriter
 {
@@ -32,6 +33,9 @@ public:
    // write rgba buffer to PNG
    static bool WritePNG(const std::string& sFilename, unsigned char* buffer_rbga, int width, int height);
 
+   // encode rgba buffer to PNG in memory
+   static bool EncodePNG(unsigned char* buffer_rbga, int width, int height, std::vector<unsigned char>& vOut);
+
    // write imageobject to PNG (currently only RGBA images are supported)
    static bool WritePNG(const std::string& sFilename, ImageObject& image);
 
@@ -0,0 +1,383 @@
+/*******************************************************************************
+#      ____               __          __  _      _____ _       _               #
+#     / __ \              \ \        / / | |    / ____| |     | |              #
+#    | |  | |_ __   ___ _ __ \  /\  / /__| |__ | |  __| | ___ | |__   ___      #
+#    | |  | | '_ \ / _ \ '_ \ \/  \/ / _ \ '_ \| | |_ | |/ _ \| '_ \ / _ \     #
+#    | |__| | |_) |  __/ | | \  /\  /  __/ |_) | |__| | | (_) | |_) |  __/     #
+#     \____/| .__/ \___|_| |_|\/  \/ \___|_.__/ \_____|_|\___/|_.__/ \___|     #
+#           | |                                                                #
+#           |_|                                                                #
+#                                                                              #
+#                                (c) 2011 by                                   #
+#           University of Applied Sciences Northwestern Switzerland            #
+#                     Institute of Geomatics Engineering                       #
+#                           martin.christen@fhnw.ch                            #
+********************************************************************************
+*     Licensed under MIT License. Read the file LICENSE for more information   *
+*******************************************************************************/
+
+#include "FileLock.h"
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <set>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef OS_WINDOWS
+#include <share.h>
+#include <io.h>
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <unistd.h>
+#include <sys/file.h>
+#include <errno.h>
+#endif
+
+//------------------------------------------------------------------------------
+// lock mechanism implemented according to:
+// http://www.dwheeler.com/secure-programs/Secure-Programs-HOWTO/avoid-race.html
+// http://wiki.lustre.org/index.php/Architecture_-_External_File_Locking
+//------------------------------------------------------------------------------
+
+namespace
+{
+   // Retry delays in microseconds. A lock held by another process is polled
+   // starting at _nMinBackoff, doubling up to _nMaxBackoff.
+   const unsigned int _nMinBackoff = 50;
+   const unsigned int _nMaxBackoff = 100000;
+
+   //---------------------------------------------------------------------------
+
+   void _Backoff(unsigned int& nWait)
+   {
+#     ifdef OS_WINDOWS
+         Sleep((nWait + 999) / 1000);
+#     else
+         usleep(nWait);
+#     endif
+      nWait = std::min<unsigned int>(2*nWait, _nMaxBackoff);
+   }
+
+   //---------------------------------------------------------------------------
+   // Threads of this process only: the set of locked file names. Waiting for a
+   // file never blocks threads locking other files, so locks may be nested as
+   // long as all threads take them in the same order.
+
+   class ProcessFileLock : public IFileLock
+   {
+   public:
+      virtual int Lock(const std::string& file)
+      {
+         boost::mutex::scoped_lock lock(_mutex);
+         while (_setLocked.find(file) != _setLocked.end())
+         {
+            _condUnlocked.wait(lock);
+         }
+         _setLocked.insert(file);
+         return 0;
+      }
+
+      virtual void Unlock(const std::string& file, int handle)
+      {
+         if (handle == -1)
+            return;
+         boost::mutex::scoped_lock lock(_mutex);
+         _setLocked.erase(file);
+         _condUnlocked.notify_all();
+      }
+
+   protected:
+      boost::mutex               _mutex;
+      boost::condition_variable  _condUnlocked;
+      std::set<std::string>      _setLocked;
+   };
+
+   //---------------------------------------------------------------------------
+
+   class HostFileLock : public IFileLock
+   {
+   public:
+#ifdef OS_WINDOWS
+      // A lock file opened without sharing is exclusive, it is deleted on close.
+      virtual int Lock(const std::string& file)
+      {
+         std::string sLockFile = file + ".lock";
+         unsigned int nWait = _nMinBackoff;
+
+         int fd = _sopen(sLockFile.c_str(), _O_CREAT|_O_RDWR|_O_TEMPORARY, _SH_DENYRW, _S_IREAD|_S_IWRITE);
+         while (fd == -1)
+         {
+            _Backoff(nWait);
+            fd = _sopen(sLockFile.c_str(), _O_CREAT|_O_RDWR|_O_TEMPORARY, _SH_DENYRW, _S_IREAD|_S_IWRITE);
+         }
+
+         return fd;
+      }
+
+      virtual void Unlock(const std::string& file, int handle)
+      {
+         if (handle == -1)
+            return;
+         _close(handle);
+      }
+#else
+      // flock blocks in the kernel until the owner releases the lock. The owner
+      // removes the lock file before unlocking, so after acquiring the lock
+      // we check that the file we locked is still the one in the directory.
+      virtual int Lock(const std::string& file)
+      {
+         std::string sLockFile = file + ".lock";
+         unsigned int nWait = _nMinBackoff;
+
+         while (true)
+         {
+            int fd = open(sLockFile.c_str(), O_CREAT|O_RDWR, 0660);
+            if (fd == -1)
+            {
+               // directory may not exist yet
+               _Backoff(nWait);
+               continue;
+            }
+
+            if (flock(fd, LOCK_EX) == 0)
+            {
+               struct stat st_fd, st_path;
+               if (fstat(fd, &st_fd) == 0 && stat(sLockFile.c_str(), &st_path) == 0 &&
+                   st_fd.st_dev == st_path.st_dev && st_fd.st_ino == st_path.st_ino)
+               {
+                  return fd;
+               }
+            }
+
+            close(fd);
+         }
+      }
+
+      virtual void Unlock(const std::string& file, int handle)
+      {
+         if (handle == -1)
+            return;
+         std::string sLockFile = file + ".lock";
+         unlink(sLockFile.c_str());
+         close(handle);
+      }
+#endif
+   };
+
+   //---------------------------------------------------------------------------
+
+   class LockfileFileLock : public IFileLock
+   {
+   public:
+      virtual int Lock(const std::string& file)
+      {
+         std::string sLockFile = file + ".lock";
+         unsigned int nWait = _nMinBackoff;
+
+         int fd = open(sLockFile.c_str(), O_CREAT|O_EXCL|O_RDWR, 0660);
+         while (fd == -1)
+         {
+            _Backoff(nWait);
+            fd = open(sLockFile.c_str(), O_CREAT|O_EXCL|O_RDWR, 0660);
+         }
+
+         return fd;
+      }
+
+      virtual void Unlock(const std::string& file, int handle)
+      {
+         if (handle == -1)
+            return;
+         std::string sLockFile = file + ".lock";
+         close(handle);
+         unlink(sLockFile.c_str());
+      }
+   };
+}
+
+//------------------------------------------------------------------------------
+
+boost::shared_ptr<IFileLock> IFileLock::Create(EFileLockBackend eBackend)
+{
+   switch (eBackend)
+   {
+   case FILELOCK_PROCESS:
+      return boost::shared_ptr<IFileLock>(new ProcessFileLock());
+   case FILELOCK_HOST:
+      return boost::shared_ptr<IFileLock>(new HostFileLock());
+   case FILELOCK_LOCKFILE:
+   default:
+      return boost::shared_ptr<IFileLock>(new LockfileFileLock());
+   }
+}
+
+//------------------------------------------------------------------------------
+
+bool IFileLock::ParseBackend(const std::string& sName, EFileLockBackend& eBackend)
+{
+   if (sName == "process")
+      eBackend = FILELOCK_PROCESS;
+   else if (sName == "host")
+      eBackend = FILELOCK_HOST;
+   else if (sName == "lockfile")
+      eBackend = FILELOCK_LOCKFILE;
+   else
+      return false;
+
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+#ifdef OS_WINDOWS
+namespace
+{
+   // A byte far beyond the end of the file is locked, so readers are not blocked.
+   void _InitLockRegion(OVERLAPPED& ov)
+   {
+      memset(&ov, 0, sizeof(OVERLAPPED));
+      ov.Offset = 0xFFFFFFFE;
+      ov.OffsetHigh = 0x7FFFFFFF;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+LockedFile::LockedFile(const std::string& sFilename)
+{
+   _fd = _sopen(sFilename.c_str(), _O_RDWR|_O_CREAT|_O_BINARY, _SH_DENYNO, _S_IREAD|_S_IWRITE);
+   if (_fd == -1)
+      return;
+
+   OVERLAPPED ov;
+   _InitLockRegion(ov);
+   if (!LockFileEx((HANDLE)_get_osfhandle(_fd), LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &ov))
+   {
+      _close(_fd);
+      _fd = -1;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+LockedFile::~LockedFile()
+{
+   if (_fd == -1)
+      return;
+
+   OVERLAPPED ov;
+   _InitLockRegion(ov);
+   UnlockFileEx((HANDLE)_get_osfhandle(_fd), 0, 1, 0, &ov);
+   _close(_fd);
+}
+
+//------------------------------------------------------------------------------
+
+int64 LockedFile::GetSize()
+{
+   return _filelengthi64(_fd);
+}
+
+//------------------------------------------------------------------------------
+
+bool LockedFile::ReadAt(int64 offset, void* pData, size_t nSize)
+{
+   if (_lseeki64(_fd, offset, SEEK_SET) != offset)
+      return false;
+   return _read(_fd, pData, (unsigned int)nSize) == (int)nSize;
+}
+
+//------------------------------------------------------------------------------
+
+bool LockedFile::WriteAt(int64 offset, const void* pData, size_t nSize)
+{
+   if (_lseeki64(_fd, offset, SEEK_SET) != offset)
+      return false;
+   return _write(_fd, pData, (unsigned int)nSize) == (int)nSize;
+}
+
+#else
+
+//------------------------------------------------------------------------------
+// flock is bound to this descriptor. Unlike fcntl locks it is not released
+// when another descriptor of the file is closed.
+
+LockedFile::LockedFile(const std::string& sFilename)
+{
+   _fd = open(sFilename.c_str(), O_RDWR|O_CREAT, 0660);
+   if (_fd == -1)
+      return;
+
+   while (flock(_fd, LOCK_EX) != 0)
+   {
+      if (errno != EINTR)
+      {
+         close(_fd);
+         _fd = -1;
+         return;
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+
+LockedFile::~LockedFile()
+{
+   if (_fd == -1)
+      return;
+
+   flock(_fd, LOCK_UN);
+   close(_fd);
+}
+
+//------------------------------------------------------------------------------
+
+int64 LockedFile::GetSize()
+{
+   struct stat st;
+   if (fstat(_fd, &st) != 0)
+      return -1;
+   return (int64)st.st_size;
+}
+
+//------------------------------------------------------------------------------
+
+bool LockedFile::ReadAt(int64 offset, void* pData, size_t nSize)
+{
+   unsigned char* p = (unsigned char*)pData;
+   while (nSize > 0)
+   {
+      ssize_t n = pread(_fd, p, nSize, (off_t)offset);
+      if (n <= 0)
+         return false;
+      p += n;
+      offset += n;
+      nSize -= (size_t)n;
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool LockedFile::WriteAt(int64 offset, const void* pData, size_t nSize)
+{
+   const unsigned char* p = (const unsigned char*)pData;
+   while (nSize > 0)
+   {
+      ssize_t n = pwrite(_fd, p, nSize, (off_t)offset);
+      if (n <= 0)
+         return false;
+      p += n;
+      offset += n;
+      nSize -= (size_t)n;
+   }
+   return true;
+}
+
+#endif
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,98 @@
+/*******************************************************************************
+#      ____               __          __  _      _____ _       _               #
+#     / __ \              \ \        / / | |    / ____| |     | |              #
+#    | |  | |_ __   ___ _ __ \  /\  / /__| |__ | |  __| | ___ | |__   ___      #
+#    | |  | | '_ \ / _ \ '_ \ \/  \/ / _ \ '_ \| | |_ | |/ _ \| '_ \ / _ \     #
+#    | |__| | |_) |  __/ | | \  /\  /  __/ |_) | |__| | | (_) | |_) |  __/     #
+#     \____/| .__/ \___|_| |_|\/  \/ \___|_.__/ \_____|_|\___/|_.__/ \___|     #
+#           | |                                                                #
+#           |_|                                                                #
+#                                                                              #
+#                                (c) 2011 by                                   #
+#           University of Applied Sciences Northwestern Switzerland            #
+#                     Institute of Geomatics Engineering                       #
+#                           martin.christen@fhnw.ch                            #
+********************************************************************************
+*     Licensed under MIT License. Read the file LICENSE for more information   *
+*******************************************************************************/
+
+#ifndef _FILELOCK_H
+#define _FILELOCK_H
+
+#include "og.h"
+#include <string>
+#include <boost/shared_ptr.hpp>
+
+//------------------------------------------------------------------------------
+//! Backend used to exclude other processes from a locked file.
+enum EFileLockBackend
+{
+   FILELOCK_PROCESS,    // threads of this process only (set of locked files)
+   FILELOCK_HOST,       // processes on the same host (flock on the lock file)
+   FILELOCK_LOCKFILE,   // processes on several hosts sharing a filesystem (exclusive lock file)
+};
+
+//------------------------------------------------------------------------------
+/*!
+* \brief Interface for file locks.
+* A lock excludes all other threads and processes (as far as the backend
+* reaches) from the file, and nothing else: locks of different files never
+* wait for each other. A thread may therefore hold several locks, provided
+* every thread acquires them in the same order. Locks are not recursive.
+* Use IFileLock::Create to create a file lock.
+*/
+class OPENGLOBE_API IFileLock
+{
+public:
+   IFileLock() {}
+   virtual ~IFileLock() {}
+
+   //! \brief Exclusively lock file, wait until it is available. The file doesn't need to exist.
+   //! \return handle for Unlock.
+   virtual int Lock(const std::string& file) = 0;
+
+   //! \brief Unlock a file previously locked with Lock.
+   virtual void Unlock(const std::string& file, int handle) = 0;
+
+   //! \brief Create file lock with specified backend.
+   static boost::shared_ptr<IFileLock> Create(EFileLockBackend eBackend);
+
+   //! \brief Parse backend name ("process", "host" or "lockfile"). Returns false if name is unknown.
+   static bool ParseBackend(const std::string& sName, EFileLockBackend& eBackend);
+};
+
+//------------------------------------------------------------------------------
+/*!
+* \brief File opened for writing and locked exclusively against other processes
+* on this host (flock, LockFileEx on Windows) until it is destroyed.
+* The lock doesn't use FileSystem::Lock and doesn't block readers. Threads of one
+* process are not excluded, serialize them with a mutex. Use it for short appends
+* to files shared by all processes (e.g. pack files, indices) while a tile is locked.
+*/
+class OPENGLOBE_API LockedFile
+{
+public:
+   //! \brief Open (create if necessary) and lock file. Waits until the lock is available.
+   LockedFile(const std::string& sFilename);
+   virtual ~LockedFile();
+
+   //! \brief Returns true if the file is open and locked.
+   bool IsGood() { return _fd != -1; }
+
+   //! \brief Returns size of file in bytes, -1 on failure.
+   int64 GetSize();
+
+   //! \brief Read nSize bytes at offset. Returns false on failure.
+   bool ReadAt(int64 offset, void* pData, size_t nSize);
+
+   //! \brief Write nSize bytes at offset. Returns false on failure.
+   bool WriteAt(int64 offset, const void* pData, size_t nSize);
+
+private:
+   LockedFile(const LockedFile&);
+   LockedFile& operator=(const LockedFile&);
+
+   int _fd;
+};
+
+#endif
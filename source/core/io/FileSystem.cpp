@@ -358,43 +358,27 @@ std::vector<std::string> FileSystem::LinesToVector(const std::string& sPath)
    return vOut;
 }
 //------------------------------------------------------------------------------
-// lock mechanism implemented according to:
-// http://www.dwheeler.com/secure-programs/Secure-Programs-HOWTO/avoid-race.html
-// http://wiki.lustre.org/index.php/Architecture_-_External_File_Locking
 
-int FileSystem::Lock(const std::string& file)
+namespace
 {
-   std::string sLockFile = file + ".lock";
-
-  
-   int open_flags =  O_CREAT|O_EXCL;
-
-   int fd = -1;
-   
-   fd = open (sLockFile.c_str(), open_flags, 660);
-   while (fd == -1)
-   {
-
-#     ifdef OS_WINDOWS
-         Sleep(1);
-#     else
-         sleep(1);
-#     endif
+   boost::shared_ptr<IFileLock> _qFileLock = IFileLock::Create(FILELOCK_LOCKFILE);
+}
 
-      fd = open (sLockFile.c_str(), open_flags, 660);
-   }
+//------------------------------------------------------------------------------
 
-   return fd;
+int FileSystem::Lock(const std::string& file)
+{
+   return _qFileLock->Lock(file);
 }
 //------------------------------------------------------------------------------
 void FileSystem::Unlock(const std::string& file, int handle)
 {
-   if (handle == -1)
-	  return;
-   std::string sLockFile = file + ".lock";
-   close(handle);
-   unlink(sLockFile.c_str());
-   
+   _qFileLock->Unlock(file, handle);
+}
+//------------------------------------------------------------------------------
+void FileSystem::SetLockBackend(EFileLockBackend eBackend)
+{
+   _qFileLock = IFileLock::Create(eBackend);
 }
 //------------------------------------------------------------------------------
 std::string FileSystem::GetCWD()
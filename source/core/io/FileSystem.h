@@ -20,6 +20,7 @@
 #define _FILESYSTEM_H_
 
 #include "og.h"
+#include "FileLock.h"
 #include <cassert>
 #include <vector>
 #include <string>
@@ -119,10 +120,12 @@ public:
    static std::vector<std::string> LinesToVector(const std::string& sPath);
    //---------------------------------------------------------------------------
    /*!
-   * \brief Exclusively locks a file by creating an exclusive locking file. 
+   * \brief Exclusively locks a file using the backend set with SetLockBackend.
    * The file may not exist yet when this function is called! In this case it locks the "future" file.
    * If file is already locked, waits until the file can be accessed.
-   * This function can be used on clusters.
+   * The default backend (FILELOCK_LOCKFILE) can be used on clusters.
+   * Locks are not recursive. Do not lock a second file while holding a lock unless
+   * all callers lock the two files in the same order.
    * \param file the filename of the file to be locked.
    * \return handle
    */
@@ -135,6 +138,12 @@ public:
    */
    static   void Unlock(const std::string& file, int handle);
    //---------------------------------------------------------------------------
+   /*!
+   * \brief Select lock backend used by Lock and Unlock. Call before any file is locked.
+   * \param eBackend FILELOCK_PROCESS, FILELOCK_HOST or FILELOCK_LOCKFILE (default)
+   */
+   static   void SetLockBackend(EFileLockBackend eBackend);
+   //---------------------------------------------------------------------------
    //! \brief Retrieve current working directory
    static std::string GetCWD();
 };
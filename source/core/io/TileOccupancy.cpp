@@ -0,0 +1,198 @@
+/*******************************************************************************
+#      ____               __          __  _      _____ _       _               #
+#     / __ \              \ \        / / | |    / ____| |     | |              #
+#    | |  | |_ __   ___ _ __ \  /\  / /__| |__ | |  __| | ___ | |__   ___      #
+#    | |  | | '_ \ / _ \ '_ \ \/  \/ / _ \ '_ \| | |_ | |/ _ \| '_ \ / _ \     #
+#    | |__| | |_) |  __/ | | \  /\  /  __/ |_) | |__| | | (_) | |_) |  __/     #
+#     \____/| .__/ \___|_| |_|\/  \/ \___|_.__/ \_____|_|\___/|_.__/ \___|     #
+#           | |                                                                #
+#           |_|                                                                #
+#                                                                              #
+#                                (c) 2011 by                                   #
+#           University of Applied Sciences Northwestern Switzerland            #
+#                     Institute of Geomatics Engineering                       #
+#                           martin.christen@fhnw.ch                            #
+********************************************************************************
+*     Licensed under MIT License. Read the file LICENSE for more information   *
+*******************************************************************************/
+
+#include "TileOccupancy.h"
+#include "FileSystem.h"
+#include "FileLock.h"
+#include <fstream>
+#include <sstream>
+#include <cstring>
+
+//------------------------------------------------------------------------------
+
+TileOccupancy::TileOccupancy(const std::string& sTileDir, int lod)
+   : _nLoaded(0)
+{
+   std::ostringstream oss;
+   oss << sTileDir << lod << "/occupancy.idx";
+   _sFilename = oss.str();
+}
+
+//------------------------------------------------------------------------------
+
+TileOccupancy::~TileOccupancy()
+{
+   Flush();
+}
+
+//------------------------------------------------------------------------------
+
+bool TileOccupancy::Load()
+{
+   boost::mutex::scoped_lock lock(_mutex);
+
+   std::ifstream ifs(_sFilename.c_str(), std::ios::in | std::ios::binary);
+   if (!ifs.good())
+      return false;
+
+   // only complete records are used.
+   ifs.seekg(0, std::ios::end);
+   int64 nSize = (int64)ifs.tellg();
+   if (nSize <= _nLoaded)
+      return true;
+
+   size_t nRecords = size_t(nSize - _nLoaded) / sizeof(SOccupancyRecord);
+   if (nRecords == 0)
+      return true;
+
+   std::vector<SOccupancyRecord> vRecords(nRecords);
+   ifs.seekg((std::streamoff)_nLoaded, std::ios::beg);
+   ifs.read((char*)&vRecords[0], (std::streamsize)(nRecords*sizeof(SOccupancyRecord)));
+   if (ifs.fail())
+      return true;
+
+   _nLoaded += nRecords*sizeof(SOccupancyRecord);
+
+   for (size_t i=0;i<nRecords;i++)
+   {
+      _index[vRecords[i].key] = vRecords[i];
+   }
+
+   // records of this process which are not yet written
+   for (size_t i=0;i<_vPending.size();i++)
+   {
+      _index[_vPending[i].key] = _vPending[i];
+   }
+
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+TileOccupancy::ETileState TileOccupancy::GetState(int64 x, int64 y, unsigned int* pValue)
+{
+   boost::mutex::scoped_lock lock(_mutex);
+
+   std::map<int64, SOccupancyRecord>::iterator it = _index.find(_Key(x, y));
+   if (it == _index.end())
+      return TILE_DATA;
+
+   if (pValue)
+   {
+      *pValue = it->second.value;
+   }
+
+   return (ETileState)it->second.state;
+}
+
+//------------------------------------------------------------------------------
+
+void TileOccupancy::SetState(int64 x, int64 y, ETileState eState, unsigned int value)
+{
+   SOccupancyRecord record;
+   record.key = _Key(x, y);
+   record.state = (unsigned int)eState;
+   record.value = value;
+
+   boost::mutex::scoped_lock lock(_mutex);
+   _index[record.key] = record;
+   _vPending.push_back(record);
+}
+
+//------------------------------------------------------------------------------
+
+bool TileOccupancy::Flush()
+{
+   boost::mutex::scoped_lock lock(_mutex);
+
+   if (_vPending.size() == 0)
+      return true;
+
+   // The index is locked with its own lock (not FileSystem::Lock), because
+   // callers flush while they hold a tile lock.
+   LockedFile file(_sFilename);
+   if (!file.IsGood())
+   {
+      // levels of detail below the layer are not created by createlayer
+      FileSystem::makeallsubdirs(_sFilename);
+      LockedFile retry(_sFilename);
+      if (!retry.IsGood())
+         return false;
+      return _Append(retry);
+   }
+
+   return _Append(file);
+}
+
+//------------------------------------------------------------------------------
+
+bool TileOccupancy::_Append(LockedFile& file)
+{
+   // drop the incomplete record of a process which crashed while writing.
+   int64 nSize = file.GetSize();
+   if (nSize < 0)
+      return false;
+   nSize -= nSize % (int64)sizeof(SOccupancyRecord);
+
+   bool bResult = file.WriteAt(nSize, &_vPending[0], _vPending.size()*sizeof(SOccupancyRecord));
+
+   if (bResult)
+   {
+      _vPending.clear();
+   }
+
+   return bResult;
+}
+
+//------------------------------------------------------------------------------
+
+TileOccupancy::ETileState TileOccupancy::Classify(const void* pPixels, size_t nPixels, unsigned int emptyValue, unsigned int& value)
+{
+   const unsigned char* p = (const unsigned char*)pPixels;
+   value = PixelValue(p);
+
+   for (size_t i=1;i<nPixels;i++)
+   {
+      if (memcmp(p, p + 4*i, 4) != 0)
+         return TILE_DATA;
+   }
+
+   return value == emptyValue ? TILE_EMPTY : TILE_UNIFORM;
+}
+
+//------------------------------------------------------------------------------
+
+void TileOccupancy::Fill(void* pPixels, size_t nPixels, unsigned int value)
+{
+   unsigned char* p = (unsigned char*)pPixels;
+   for (size_t i=0;i<nPixels;i++)
+   {
+      memcpy(p + 4*i, &value, 4);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+unsigned int TileOccupancy::PixelValue(const void* pPixel)
+{
+   unsigned int value;
+   memcpy(&value, pPixel, 4);
+   return value;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,100 @@
+/*******************************************************************************
+#      ____               __          __  _      _____ _       _               #
+#     / __ \              \ \        / / | |    / ____| |     | |              #
+#    | |  | |_ __   ___ _ __ \  /\  / /__| |__ | |  __| | ___ | |__   ___      #
+#    | |  | | '_ \ / _ \ '_ \ \/  \/ / _ \ '_ \| | |_ | |/ _ \| '_ \ / _ \     #
+#    | |__| | |_) |  __/ | | \  /\  /  __/ |_) | |__| | | (_) | |_) |  __/     #
+#     \____/| .__/ \___|_| |_|\/  \/ \___|_.__/ \_____|_|\___/|_.__/ \___|     #
+#           | |                                                                #
+#           |_|                                                                #
+#                                                                              #
+#                                (c) 2011 by                                   #
+#           University of Applied Sciences Northwestern Switzerland            #
+#                     Institute of Geomatics Engineering                       #
+#                           martin.christen@fhnw.ch                            #
+********************************************************************************
+*     Licensed under MIT License. Read the file LICENSE for more information   *
+*******************************************************************************/
+
+#ifndef _TILEOCCUPANCY_H
+#define _TILEOCCUPANCY_H
+
+#include "og.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <boost/thread/mutex.hpp>
+
+class LockedFile;
+
+//------------------------------------------------------------------------------
+/*!
+* \brief Occupancy index of one level of detail of a tile layer.
+* Tiles without data (empty) or with a single pixel value (uniform) are recorded
+* in the index instead of being written to the tile store, a stored tile which
+* becomes empty or uniform is removed from it. Tiles which are not in the index
+* are in the tile store (if they exist at all), so tools which don't know the
+* index still work. The index is stored in <tiledir><lod>/occupancy.idx,
+* an append-only sequence of records, the last record of a tile is valid.
+* Records are buffered and appended on Flush() while the index file is locked
+* (LockedFile, so Flush can be called while a tile is locked with FileSystem::Lock),
+* so several processes can write the same index. Load() reads the records
+* appended since the last call.
+* Pixels are 4 bytes (rgba or float), the value of a uniform tile is the pixel.
+*/
+class OPENGLOBE_API TileOccupancy
+{
+public:
+   enum ETileState
+   {
+      TILE_EMPTY = 0,   // no data, not in tile store
+      TILE_DATA = 1,    // tile is in tile store (or doesn't exist)
+      TILE_UNIFORM = 2, // all pixels have the same value, not in tile store
+   };
+
+   //! \brief Create occupancy index for level of detail lod of tiles in (delimited) directory sTileDir.
+   TileOccupancy(const std::string& sTileDir, int lod);
+
+   //! \brief Destructor. Writes remaining records (see Flush).
+   virtual ~TileOccupancy();
+
+   //! \brief Load the records written (by all processes) since the last call. Returns false if there is no index file.
+   bool Load();
+
+   //! \brief Returns state of tile and the pixel value of uniform tiles. Tiles which are not in the index are TILE_DATA.
+   ETileState GetState(int64 x, int64 y, unsigned int* pValue = 0);
+
+   //! \brief Record state of tile. This is thread safe. Records are written on Flush().
+   void SetState(int64 x, int64 y, ETileState eState, unsigned int value = 0);
+
+   //! \brief Append all recorded states to the index file.
+   bool Flush();
+
+   //! \brief Returns TILE_EMPTY if all pixels are emptyValue, TILE_UNIFORM (and the pixel value) if all pixels are equal, TILE_DATA otherwise.
+   static ETileState Classify(const void* pPixels, size_t nPixels, unsigned int emptyValue, unsigned int& value);
+
+   //! \brief Set all pixels to value (create uniform tile).
+   static void Fill(void* pPixels, size_t nPixels, unsigned int value);
+
+   //! \brief Returns the 4 bytes of a pixel as value.
+   static unsigned int PixelValue(const void* pPixel);
+
+protected:
+   struct SOccupancyRecord
+   {
+      int64          key;     // (x << 32) | y
+      unsigned int   state;
+      unsigned int   value;
+   };
+
+   static int64 _Key(int64 x, int64 y) { return (x << 32) | y; }
+   bool _Append(LockedFile& file);
+
+   std::string _sFilename;
+   int64 _nLoaded;   // bytes of index file already loaded
+   std::map<int64, SOccupancyRecord> _index;
+   std::vector<SOccupancyRecord> _vPending;
+   boost::mutex _mutex;
+};
+
+#endif
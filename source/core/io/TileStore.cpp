@@ -0,0 +1,388 @@
+/*******************************************************************************
+#      ____               __          __  _      _____ _       _               #
+#     / __ \              \ \        / / | |    / ____| |     | |              #
+#    | |  | |_ __   ___ _ __ \  /\  / /__| |__ | |  __| | ___ | |__   ___      #
+#    | |  | | '_ \ / _ \ '_ \ \/  \/ / _ \ '_ \| | |_ | |/ _ \| '_ \ / _ \     #
+#    | |__| | |_) |  __/ | | \  /\  /  __/ |_) | |__| | | (_) | |_) |  __/     #
+#     \____/| .__/ \___|_| |_|\/  \/ \___|_.__/ \_____|_|\___/|_.__/ \___|     #
+#           | |                                                                #
+#           |_|                                                                #
+#                                                                              #
+#                                (c) 2011 by                                   #
+#           University of Applied Sciences Northwestern Switzerland            #
+#                     Institute of Geomatics Engineering                       #
+#                           martin.christen@fhnw.ch                            #
+********************************************************************************
+*     Licensed under MIT License. Read the file LICENSE for more information   *
+*******************************************************************************/
+
+#include "TileStore.h"
+#include "FileSystem.h"
+#include "FileLock.h"
+#include <boost/thread/mutex.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/exceptions.hpp>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <cstring>
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+   //---------------------------------------------------------------------------
+   // size of file in bytes, -1 if file doesn't exist
+   int64 _FileSize(const std::string& sFilename)
+   {
+      std::ifstream ifs(sFilename.c_str(), std::ios::in|std::ios::binary);
+      if (!ifs.good())
+         return -1;
+      ifs.seekg(0, std::ios::end);
+      return (int64)ifs.tellg();
+   }
+
+   //---------------------------------------------------------------------------
+   // One file per tile: <tiledir><lod>/<x>/<y><ext>
+
+   class DirectoryTileStore : public ITileStore
+   {
+   public:
+      DirectoryTileStore(const std::string& sTileDir, const std::string& sExtension)
+         : _sTileDir(sTileDir), _sExtension(sExtension) {}
+      virtual ~DirectoryTileStore() {}
+
+      virtual bool Exists(int lod, int64 x, int64 y)
+      {
+         return FileSystem::FileExists(GetTileName(lod, x, y));
+      }
+
+      virtual bool Read(int lod, int64 x, int64 y, std::vector<unsigned char>& vData)
+      {
+         return FileSystem::FileToMemory(GetTileName(lod, x, y), vData);
+      }
+
+      virtual bool Write(int lod, int64 x, int64 y, const unsigned char* pData, size_t nSize)
+      {
+         std::ofstream off(GetTileName(lod, x, y).c_str(), std::ios::out | std::ios::binary);
+         if (off.good())
+         {
+            off.write((const char*)pData, (std::streamsize)nSize);
+            off.close();
+            return true;
+         }
+         return false;
+      }
+
+      virtual bool Remove(int lod, int64 x, int64 y)
+      {
+         std::string sTilefile = GetTileName(lod, x, y);
+         return !FileSystem::FileExists(sTilefile) || FileSystem::rm(sTilefile);
+      }
+
+      virtual std::string GetTileName(int lod, int64 x, int64 y)
+      {
+         std::ostringstream oss;
+         oss << _sTileDir << lod << "/" << x << "/" << y << _sExtension;
+         return oss.str();
+      }
+
+      virtual bool NeedsColumnDirectories() { return true; }
+
+   protected:
+      std::string _sTileDir;
+      std::string _sExtension;
+   };
+
+   //---------------------------------------------------------------------------
+   // Pack file: sequence of records (SPackRecord followed by tile data).
+   // Records are only appended, the last record of a tile is valid, a record
+   // without data removes the tile. Writers
+   // lock the pack file itself (LockedFile), readers don't: a record which is
+   // still being written is indexed as soon as it is complete. The pack lock 
+   // is not taken with FileSystem::Lock, so writing while a tile is locked
+   // doesn't nest file locks.
+
+   const unsigned int _nPackMagic = 0x5447574f;   // "OWGT"
+
+   struct SPackRecord
+   {
+      unsigned int   magic;
+      unsigned int   size;    // size of tile data in bytes
+      int64          key;     // quadkey of tile (2 bits per level of detail)
+   };
+
+   struct SPackEntry
+   {
+      int64          offset;  // offset of tile data in pack file
+      unsigned int   size;
+   };
+
+   //---------------------------------------------------------------------------
+
+   class PackFile
+   {
+   public:
+      PackFile(const std::string& sFilename)
+         : _sFilename(sFilename), _nScanned(0), _nMapped(0) {}
+
+      bool Exists(int64 key)
+      {
+         boost::mutex::scoped_lock lock(_mutex);
+         const SPackEntry* pEntry = _Find(key);
+         return pEntry && pEntry->size > 0;
+      }
+
+      bool Read(int64 key, std::vector<unsigned char>& vData)
+      {
+         boost::mutex::scoped_lock lock(_mutex);
+
+         // another process may have appended a newer record of this tile
+         _Update();
+
+         const SPackEntry* pEntry = _Find(key);
+         if (!pEntry || pEntry->size == 0)
+            return false;
+
+         vData.resize(pEntry->size);
+         return _ReadAt(pEntry->offset, &vData[0], pEntry->size);
+      }
+
+      bool Write(int64 key, const unsigned char* pData, size_t nSize)
+      {
+         boost::mutex::scoped_lock lock(_mutex);
+
+         LockedFile file(_sFilename);
+         if (!file.IsGood())
+            return false;
+
+         // append after last complete record. This also overwrites the
+         // incomplete record of a process which crashed while writing.
+         _Update(&file);
+
+         SPackRecord record;
+         record.magic = _nPackMagic;
+         record.size = (unsigned int)nSize;
+         record.key = key;
+
+         bool bResult = file.WriteAt(_nScanned, &record, sizeof(SPackRecord)) &&
+                        file.WriteAt(_nScanned + sizeof(SPackRecord), pData, nSize);
+
+         if (bResult)
+         {
+            SPackEntry& entry = _index[key];
+            entry.offset = _nScanned + sizeof(SPackRecord);
+            entry.size = record.size;
+            _nScanned = entry.offset + nSize;
+         }
+
+         return bResult;
+      }
+
+   protected:
+      // find tile, index records written by other processes if not found.
+      const SPackEntry* _Find(int64 key)
+      {
+         std::map<int64, SPackEntry>::iterator it = _index.find(key);
+         if (it == _index.end())
+         {
+            _Update();
+            it = _index.find(key);
+            if (it == _index.end())
+               return 0;
+         }
+         return &(it->second);
+      }
+
+      // index all complete records after _nScanned. With a locked file the records
+      // are read through it, no other descriptor of the file is opened.
+      void _Update(LockedFile* pFile = 0)
+      {
+         int64 nSize = pFile ? pFile->GetSize() : _FileSize(_sFilename);
+         if (nSize <= _nScanned)
+            return;
+
+         if (!pFile && nSize > _nMapped)
+            _Map(nSize);
+
+         SPackRecord record;
+         while (_nScanned + (int64)sizeof(SPackRecord) <= nSize)
+         {
+            bool bRead = pFile ? pFile->ReadAt(_nScanned, &record, sizeof(SPackRecord)) : _ReadAt(_nScanned, &record, sizeof(SPackRecord));
+            if (!bRead || record.magic != _nPackMagic)
+               break;
+
+            int64 nEnd = _nScanned + sizeof(SPackRecord) + record.size;
+            if (nEnd > nSize)
+               break;
+
+            SPackEntry& entry = _index[record.key];
+            entry.offset = _nScanned + sizeof(SPackRecord);
+            entry.size = record.size;
+            _nScanned = nEnd;
+         }
+      }
+
+      // map first nSize bytes of pack file. If this fails, data is read without mapping.
+      void _Map(int64 nSize)
+      {
+         _qRegion.reset();
+         _qMapping.reset();
+         _nMapped = 0;
+
+         try
+         {
+            _qMapping = boost::shared_ptr<boost::interprocess::file_mapping>(new boost::interprocess::file_mapping(_sFilename.c_str(), boost::interprocess::read_only));
+            _qRegion = boost::shared_ptr<boost::interprocess::mapped_region>(new boost::interprocess::mapped_region(*_qMapping, boost::interprocess::read_only, 0, (size_t)nSize));
+            _nMapped = nSize;
+         }
+         catch (boost::interprocess::interprocess_exception&)
+         {
+            _qRegion.reset();
+            _qMapping.reset();
+         }
+      }
+
+      bool _ReadAt(int64 offset, void* pData, size_t nSize)
+      {
+         if (offset + (int64)nSize > _nMapped)
+         {
+            _Map(_FileSize(_sFilename));
+         }
+
+         if (offset + (int64)nSize <= _nMapped)
+         {
+            memcpy(pData, (const unsigned char*)_qRegion->get_address() + offset, nSize);
+            return true;
+         }
+
+         std::ifstream ifs(_sFilename.c_str(), std::ios::in | std::ios::binary);
+         if (!ifs.good())
+            return false;
+         ifs.seekg((std::streamoff)offset);
+         ifs.read((char*)pData, (std::streamsize)nSize);
+         return !ifs.fail();
+      }
+
+      boost::mutex _mutex;
+      std::string _sFilename;
+      std::map<int64, SPackEntry> _index;
+      int64 _nScanned;
+      int64 _nMapped;
+      boost::shared_ptr<boost::interprocess::file_mapping> _qMapping;
+      boost::shared_ptr<boost::interprocess::mapped_region> _qRegion;
+   };
+
+   //---------------------------------------------------------------------------
+   // Pack files per level of detail and block of tiles: <tiledir><lod>/<bx>_<by><ext>.pack
+
+   class PackTileStore : public ITileStore
+   {
+   public:
+      PackTileStore(const std::string& sTileDir, const std::string& sExtension)
+         : _sTileDir(sTileDir), _sExtension(sExtension) {}
+      virtual ~PackTileStore() {}
+
+      virtual bool Exists(int lod, int64 x, int64 y)
+      {
+         return _GetPack(lod, x, y)->Exists(_QuadKey(x, y));
+      }
+
+      virtual bool Read(int lod, int64 x, int64 y, std::vector<unsigned char>& vData)
+      {
+         return _GetPack(lod, x, y)->Read(_QuadKey(x, y), vData);
+      }
+
+      virtual bool Write(int lod, int64 x, int64 y, const unsigned char* pData, size_t nSize)
+      {
+         return _GetPack(lod, x, y)->Write(_QuadKey(x, y), pData, nSize);
+      }
+
+      virtual bool Remove(int lod, int64 x, int64 y)
+      {
+         boost::shared_ptr<PackFile> qPack = _GetPack(lod, x, y);
+         int64 key = _QuadKey(x, y);
+         return !qPack->Exists(key) || qPack->Write(key, 0, 0);
+      }
+
+      virtual std::string GetTileName(int lod, int64 x, int64 y)
+      {
+         std::ostringstream oss;
+         oss << _sTileDir << lod << "/" << x << "_" << y << _sExtension;
+         return oss.str();
+      }
+
+      virtual bool NeedsColumnDirectories() { return false; }
+
+   protected:
+      enum
+      {
+         BLOCKBITS = 6,       // 64x64 tiles per pack file
+         MAXOPENPACKS = 256,  // unused packs are closed when more packs are open
+      };
+
+      static int64 _QuadKey(int64 x, int64 y)
+      {
+         int64 key = 0;
+         for (int i=0;i<31;i++)
+         {
+            key |= ((x >> i) & 1) << (2*i);
+            key |= ((y >> i) & 1) << (2*i+1);
+         }
+         return key;
+      }
+
+      boost::shared_ptr<PackFile> _GetPack(int lod, int64 x, int64 y)
+      {
+         std::ostringstream oss;
+         oss << _sTileDir << lod << "/" << (x >> BLOCKBITS) << "_" << (y >> BLOCKBITS) << _sExtension << ".pack";
+         std::string sFilename = oss.str();
+
+         boost::mutex::scoped_lock lock(_mutex);
+
+         std::map<std::string, boost::shared_ptr<PackFile> >::iterator it = _packs.find(sFilename);
+         if (it != _packs.end())
+            return it->second;
+
+         if (_packs.size() >= MAXOPENPACKS)
+         {
+            it = _packs.begin();
+            while (it != _packs.end())
+            {
+               if (it->second.unique())
+                  _packs.erase(it++);
+               else
+                  ++it;
+            }
+         }
+
+         boost::shared_ptr<PackFile> qPack(new PackFile(sFilename));
+         _packs[sFilename] = qPack;
+         return qPack;
+      }
+
+      std::string _sTileDir;
+      std::string _sExtension;
+      boost::mutex _mutex;
+      std::map<std::string, boost::shared_ptr<PackFile> > _packs;
+   };
+}
+
+//------------------------------------------------------------------------------
+
+boost::shared_ptr<ITileStore> ITileStore::Create(const std::string& sType, const std::string& sTileDir, const std::string& sExtension)
+{
+   if (sType == "directory")
+   {
+      return boost::shared_ptr<ITileStore>(new DirectoryTileStore(sTileDir, sExtension));
+   }
+   else if (sType == "pack")
+   {
+      return boost::shared_ptr<ITileStore>(new PackTileStore(sTileDir, sExtension));
+   }
+
+   return boost::shared_ptr<ITileStore>();
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,66 @@
+/*******************************************************************************
+#      ____               __          __  _      _____ _       _               #
+#     / __ \              \ \        / / | |    / ____| |     | |              #
+#    | |  | |_ __   ___ _ __ \  /\  / /__| |__ | |  __| | ___ | |__   ___      #
+#    | |  | | '_ \ / _ \ '_ \ \/  \/ / _ \ '_ \| | |_ | |/ _ \| '_ \ / _ \     #
+#    | |__| | |_) |  __/ | | \  /\  /  __/ |_) | |__| | | (_) | |_) |  __/     #
+#     \____/| .__/ \___|_| |_|\/  \/ \___|_.__/ \_____|_|\___/|_.__/ \___|     #
+#           | |                                                                #
+#           |_|                                                                #
+#                                                                              #
+#                                (c) 2011 by                                   #
+#           University of Applied Sciences Northwestern Switzerland            #
+#                     Institute of Geomatics Engineering                       #
+#                           martin.christen@fhnw.ch                            #
+********************************************************************************
+*     Licensed under MIT License. Read the file LICENSE for more information   *
+*******************************************************************************/
+
+#ifndef _TILESTORE_H
+#define _TILESTORE_H
+
+#include "og.h"
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+//------------------------------------------------------------------------------
+/*!
+* \brief Interface for storing encoded tiles (png, jpg, raw, ...) of a layer.
+* Available stores:
+*    "directory": one file per tile: <tiledir><lod>/<x>/<y><ext> (default)
+*    "pack":      append-only pack files per level of detail and block of
+*                 64x64 tiles: <tiledir><lod>/<bx>_<by><ext>.pack
+* Stores are thread safe. Tiles written by other processes are visible.
+* Use ITileStore::Create to create a tile store.
+*/
+class OPENGLOBE_API ITileStore
+{
+public:
+   ITileStore() {}
+   virtual ~ITileStore() {}
+
+   //! \brief Returns true if tile exists.
+   virtual bool Exists(int lod, int64 x, int64 y) = 0;
+
+   //! \brief Read tile data. Returns false if tile doesn't exist.
+   virtual bool Read(int lod, int64 x, int64 y, std::vector<unsigned char>& vData) = 0;
+
+   //! \brief Write (or replace) tile data.
+   virtual bool Write(int lod, int64 x, int64 y, const unsigned char* pData, size_t nSize) = 0;
+
+   //! \brief Remove tile. Returns true if the tile doesn't exist afterwards.
+   virtual bool Remove(int lod, int64 x, int64 y) = 0;
+
+   //! \brief Name of tile. This is an existing file for the directory store. Use it to lock tiles with FileSystem::Lock.
+   virtual std::string GetTileName(int lod, int64 x, int64 y) = 0;
+
+   //! \brief Returns true if this store needs a directory per column of tiles (see createlayer).
+   virtual bool NeedsColumnDirectories() = 0;
+
+   //! \brief Create tile store of specified type ("directory" or "pack") for tiles with specified extension (".png").
+   //! \return the store or an empty pointer if type is unknown.
+   static boost::shared_ptr<ITileStore> Create(const std::string& sType, const std::string& sTileDir, const std::string& sExtension);
+};
+
+#endif
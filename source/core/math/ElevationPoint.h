@@ -27,7 +27,9 @@ public:
    ElevationPoint();
    ElevationPoint(const ElevationPoint& cp);
 
-   virtual ~ElevationPoint();
+   // not virtual: elevation points are stored by value in large arrays
+   // and in every vertex of a triangulation.
+   ~ElevationPoint();
    
    double x,y;
    double elevation;
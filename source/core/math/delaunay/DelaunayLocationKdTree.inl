@@ -6,7 +6,8 @@ namespace math
    class DelaunayLocationKdTreeHierarchy : public IDelaunayLocationStructure
    {
    public:
-      DelaunayLocationKdTreeHierarchy(double xmin, double ymin, double xmax, double ymax) 
+      DelaunayLocationKdTreeHierarchy(DelaunayMesh* pMesh, double xmin, double ymin, double xmax, double ymax) 
+         : IDelaunayLocationStructure(pMesh)
       { 
          _xmin = xmin, _ymin = ymin, _xmax = xmax, _ymax = ymax;
       }
@@ -17,34 +18,35 @@ namespace math
 
       //-----------------------------------------------------------------------
 
-      virtual void AddTriangle(DelaunayTriangle* pTriangle) 
+      virtual void AddTriangle(int nTriangle) 
       {
       }
 
       //-----------------------------------------------------------------------
 
-      virtual void RemoveTriangle(DelaunayTriangle* pTriangle)
+      virtual void RemoveTriangle(int nTriangle)
       {
 
       }
 
       //-----------------------------------------------------------------------
 
-      virtual DelaunayTriangle* GetTriangleAt(double x, double y, ePointTriangleRelation& eRelation)
+      virtual int GetTriangleAt(double x, double y, ePointTriangleRelation& eRelation)
       {
-         return 0;
+         eRelation = PointTriangle_Invalid;
+         return -1;
       }
 
       //-----------------------------------------------------------------------
 
-      virtual void Traverse(boost::function<void(DelaunayTriangle*)> callback)
+      virtual void Traverse(boost::function<void(int)> callback)
       {
 
       }
 
       //-----------------------------------------------------------------------
 
-      virtual void SpatialTraverse(double xmin, double ymin, double xmax, double ymax, boost::function<void(DelaunayTriangle*)> callback)
+      virtual void SpatialTraverse(double xmin, double ymin, double xmax, double ymax, boost::function<void(int)> callback)
       {
 
       }
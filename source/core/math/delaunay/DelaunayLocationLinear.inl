@@ -1,4 +1,3 @@
-
 #include <boost/foreach.hpp>
 
 namespace math
@@ -6,103 +5,87 @@ namespace math
    class OPENGLOBE_API DelaunayLocationLinear : public IDelaunayLocationStructure
    {
    public:
-      DelaunayLocationLinear() {}
+      DelaunayLocationLinear(DelaunayMesh* pMesh) : IDelaunayLocationStructure(pMesh) {}
       virtual ~DelaunayLocationLinear(){}
 
       //-----------------------------------------------------------------------
    protected:
 
-      virtual void AddTriangle(DelaunayTriangle* pTriangle) 
+      virtual void AddTriangle(int nTriangle) 
       {
-         _lstTriangles.insert(pTriangle);
+         _pMesh->SetLocationIndex(nTriangle, (int)_lstTriangles.size());
+         _lstTriangles.push_back(nTriangle);
       }
 
       //-----------------------------------------------------------------------
 
-      virtual void RemoveTriangle(DelaunayTriangle* pTriangle)
+      virtual void RemoveTriangle(int nTriangle)
       {
-         std::set<DelaunayTriangle*>::iterator it = _lstTriangles.find(pTriangle);
-         if (it != _lstTriangles.end())
+         // swap with last triangle, so removal doesn't need to search
+         int nIndex = _pMesh->GetLocationIndex(nTriangle);
+         if (nIndex >= 0 && nIndex < (int)_lstTriangles.size() && _lstTriangles[nIndex] == nTriangle)
          {
-            _lstTriangles.erase(it);
+            int nLast = _lstTriangles.back();
+            _lstTriangles[nIndex] = nLast;
+            _pMesh->SetLocationIndex(nLast, nIndex);
+            _lstTriangles.pop_back();
+            _pMesh->SetLocationIndex(nTriangle, -1);
          }
       }
 
       //-----------------------------------------------------------------------
 
-      virtual DelaunayTriangle* GetTriangleAt(double x, double y, ePointTriangleRelation& eRelation)
+      virtual int GetTriangleAt(double x, double y, ePointTriangleRelation& eRelation)
       {
          eRelation = PointTriangle_Invalid;
-         DelaunayVertex tmpVertex(x,y);
 
-         BOOST_FOREACH( DelaunayTriangle* pTri, _lstTriangles )
+         BOOST_FOREACH( int nTri, _lstTriangles )
          {
-            eRelation = GetPointTriangleRelationRobust(&tmpVertex,pTri, _dEpsilon);
+            double px = x, py = y;
+            eRelation = _pMesh->GetPointTriangleRelationRobust(px, py, nTri, _dEpsilon);
             if (eRelation != PointTriangle_Outside)
             {
-               return pTri;
+               return nTri;
             }
          }
 
-         return 0;
-
-
-         /*
-         std::set<DelaunayTriangle*>::iterator it = _lstTriangles.begin();
-
-         DelaunayVertex tmpVertex(x,y);
-
-         while (it != _lstTriangles.end())
-         {
-            eRelation = GetPointTriangleRelationRobust(&tmpVertex,(*it));
-
-            if (eRelation != PointTriangle_Outside && eRelation != PointTriangle_Invalid)
-            {
-               return *it;
-            }
-
-            it++;
-         }
-         */
-
-         return 0;
+         return -1;
       }
 
       //-----------------------------------------------------------------------
 
-      virtual void Traverse(boost::function<void(DelaunayTriangle*)> callback)
+      virtual void Traverse(boost::function<void(int)> callback)
       {
-         std::set<DelaunayTriangle*>::iterator it = _lstTriangles.begin();
-         while (it != _lstTriangles.end())
+         for (size_t i=0;i<_lstTriangles.size();i++)
          {
-            callback(*it); 
-            ++it;
+            callback(_lstTriangles[i]);
          }
       }
 
       //-----------------------------------------------------------------------
 
-      virtual void SpatialTraverse(double xmin, double ymin, double xmax, double ymax, boost::function<void(DelaunayTriangle*)> callback)
+      virtual void SpatialTraverse(double xmin, double ymin, double xmax, double ymax, boost::function<void(int)> callback)
       {
-         std::set<DelaunayTriangle*>::iterator it = _lstTriangles.begin();
-         while (it != _lstTriangles.end())
+         for (size_t i=0;i<_lstTriangles.size();i++)
          {
-            DelaunayVertex* v0 = (*it)->GetVertex(0);
-            DelaunayVertex* v1 = (*it)->GetVertex(1);
-            DelaunayVertex* v2 = (*it)->GetVertex(2);
+            int nTri = _lstTriangles[i];
 
-            if ((v0->GetElevationPoint().x >= xmin && v0->GetElevationPoint().x <= xmax && v0->GetElevationPoint().y >= ymin && v0->GetElevationPoint().y <= ymax) ||
-               (v1->GetElevationPoint().x >= xmin && v1->GetElevationPoint().x <= xmax && v1->GetElevationPoint().y >= ymin && v1->GetElevationPoint().y <= ymax) ||
-               (v2->GetElevationPoint().x >= xmin && v2->GetElevationPoint().x <= xmax && v2->GetElevationPoint().y >= ymin && v2->GetElevationPoint().y <= ymax))
+            for (int v=0;v<3;v++)
             {
-               callback(*it); 
+               int nVertex = _pMesh->GetVertex(nTri, v);
+               double x = _pMesh->x(nVertex);
+               double y = _pMesh->y(nVertex);
+
+               if (x >= xmin && x <= xmax && y >= ymin && y <= ymax)
+               {
+                  callback(nTri); 
+                  break;
+               }
             }
-            ++it;
          }
       }
 
    protected:
-      std::set<DelaunayTriangle*>  _lstTriangles;
+      std::vector<int>  _lstTriangles; // dense, triangles know their index
    };
 }
-
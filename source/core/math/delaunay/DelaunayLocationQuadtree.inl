@@ -53,16 +53,16 @@ namespace math
 
       //-----------------------------------------------------------------------
 
-      inline bool TriangleInRect(DelaunayTriangle* pTri, double xmin, double ymin, double xmax, double ymax)
+      inline bool TriangleInRect(const DelaunayMesh* pMesh, int nTri, double xmin, double ymin, double xmax, double ymax)
       {
-         assert(pTri);
+         assert(nTri != -1);
 
-         const ElevationPoint& PA = pTri->GetVertex(0)->GetElevationPoint();
-         bool bA = PointInRect(PA.x, PA.y, xmin, ymin, xmax, ymax);
-         const ElevationPoint& PB = pTri->GetVertex(1)->GetElevationPoint();
-         bool bB = PointInRect(PB.x, PB.y, xmin, ymin, xmax, ymax);
-         const ElevationPoint& PC = pTri->GetVertex(2)->GetElevationPoint();
-         bool bC = PointInRect(PC.x, PC.y, xmin, ymin, xmax, ymax);
+         int A = pMesh->GetVertex(nTri, 0);
+         bool bA = PointInRect(pMesh->x(A), pMesh->y(A), xmin, ymin, xmax, ymax);
+         int B = pMesh->GetVertex(nTri, 1);
+         bool bB = PointInRect(pMesh->x(B), pMesh->y(B), xmin, ymin, xmax, ymax);
+         int C = pMesh->GetVertex(nTri, 2);
+         bool bC = PointInRect(pMesh->x(C), pMesh->y(C), xmin, ymin, xmax, ymax);
 
          return (bA && bB && bC);
       }
@@ -75,8 +75,8 @@ namespace math
 
          //-----------------------------------------------------------------------
 
-         QuadtreeNode(int nDepth)
-            : _nDepth(nDepth)
+         QuadtreeNode(DelaunayMesh* pMesh, int nDepth)
+            : _pMesh(pMesh), _nDepth(nDepth)
          {
             _child[0] =  _child[1] = _child[2] = _child[3] = 0;
             _xmin = _ymin = _xmax = _ymax = 0.0;
@@ -84,8 +84,8 @@ namespace math
 
          //-----------------------------------------------------------------------
 
-         QuadtreeNode(int nDepth, double xmin, double ymin, double xmax, double ymax)
-            : _nDepth(nDepth)
+         QuadtreeNode(DelaunayMesh* pMesh, int nDepth, double xmin, double ymin, double xmax, double ymax)
+            : _pMesh(pMesh), _nDepth(nDepth)
          {
             _child[0] =  _child[1] = _child[2] = _child[3] = 0;
             _xmin = xmin;
@@ -155,15 +155,15 @@ namespace math
 
          //--------------------------------------------------------------------
 
-         bool TriangleFitsInside(DelaunayTriangle* pTri, int nChild)
+         bool TriangleFitsInside(int nTri, int nChild)
          {
-            assert(pTri);
+            assert(nTri != -1);
             assert(nChild<=3 && nChild>=0);
 
             double xmin, ymin, xmax, ymax;
             GetChildRectangle(nChild, xmin, ymin, xmax, ymax);
 
-            return TriangleInRect(pTri, xmin, ymin, xmax, ymax); 
+            return TriangleInRect(_pMesh, nTri, xmin, ymin, xmax, ymax); 
          }
 
          //--------------------------------------------------------------------
@@ -190,126 +190,123 @@ namespace math
             {
                double xmin, ymin, xmax, ymax;
                GetChildRectangle(nChild, xmin, ymin, xmax, ymax);
-               _child[nChild] = new QuadtreeNode(_nDepth+1, xmin, ymin, xmax, ymax); 
+               _child[nChild] = new QuadtreeNode(_pMesh, _nDepth+1, xmin, ymin, xmax, ymax); 
             }
          }
 
          //--------------------------------------------------------------------
 
-         void InsertTriangle(DelaunayTriangle* pTri, const int nMaxDepth, std::map<DelaunayTriangle*, QuadtreeNode*>* pMap)
+         void InsertTriangle(int nTri, const int nMaxDepth, std::map<int, QuadtreeNode*>* pMap)
          {
-            if (TriangleFitsInside(pTri, 0))
+            if (TriangleFitsInside(nTri, 0))
             {
                if (_nDepth < nMaxDepth)
                {
                   CreateChildIfNecessary(0);
-                  _child[0]->InsertTriangle(pTri, nMaxDepth, pMap);
+                  _child[0]->InsertTriangle(nTri, nMaxDepth, pMap);
                }
                else
                {
-                  _lstTriangles.insert(pTri);
-                  pMap->insert(std::pair<DelaunayTriangle*, QuadtreeNode*>(pTri, this));
+                  _lstTriangles.insert(nTri);
+                  pMap->insert(std::pair<int, QuadtreeNode*>(nTri, this));
                }  
             }
-            else if (TriangleFitsInside(pTri, 1))
+            else if (TriangleFitsInside(nTri, 1))
             {
                if (_nDepth < nMaxDepth)
                {
                   CreateChildIfNecessary(1);
-                  _child[1]->InsertTriangle(pTri, nMaxDepth, pMap);
+                  _child[1]->InsertTriangle(nTri, nMaxDepth, pMap);
                }
                else
                {
-                  _lstTriangles.insert(pTri);
-                  pMap->insert(std::pair<DelaunayTriangle*, QuadtreeNode*>(pTri, this));
+                  _lstTriangles.insert(nTri);
+                  pMap->insert(std::pair<int, QuadtreeNode*>(nTri, this));
                }
             }
-            else if (TriangleFitsInside(pTri, 2))
+            else if (TriangleFitsInside(nTri, 2))
             {
                if (_nDepth < nMaxDepth)
                {
                   CreateChildIfNecessary(2);
-                  _child[2]->InsertTriangle(pTri, nMaxDepth, pMap);
+                  _child[2]->InsertTriangle(nTri, nMaxDepth, pMap);
                }
                else
                {
-                  _lstTriangles.insert(pTri);
-                  pMap->insert(std::pair<DelaunayTriangle*, QuadtreeNode*>(pTri, this));
+                  _lstTriangles.insert(nTri);
+                  pMap->insert(std::pair<int, QuadtreeNode*>(nTri, this));
                }
             }
-            else if (TriangleFitsInside(pTri, 3))
+            else if (TriangleFitsInside(nTri, 3))
             {
                if (_nDepth < nMaxDepth)
                {
                   CreateChildIfNecessary(3);
-                  _child[3]->InsertTriangle(pTri, nMaxDepth, pMap);
+                  _child[3]->InsertTriangle(nTri, nMaxDepth, pMap);
                }
                else
                {
-                  _lstTriangles.insert(pTri);
-                  pMap->insert(std::pair<DelaunayTriangle*, QuadtreeNode*>(pTri, this));
+                  _lstTriangles.insert(nTri);
+                  pMap->insert(std::pair<int, QuadtreeNode*>(nTri, this));
                }
             }
             else
             {
                // doesn't fit in a child cell, put it in current cell!
-               _lstTriangles.insert(pTri);
-               pMap->insert(std::pair<DelaunayTriangle*, QuadtreeNode*>(pTri, this));
+               _lstTriangles.insert(nTri);
+               pMap->insert(std::pair<int, QuadtreeNode*>(nTri, this));
             }
          }
          //--------------------------------------------------------------------
 
-         void GetTriangleAt(double x, double y, DelaunayTriangle*& out_pTriangle, ePointTriangleRelation& out_eRelation, const double epsilon)
+         void GetTriangleAt(double x, double y, int& out_nTriangle, ePointTriangleRelation& out_eRelation, const double epsilon)
          {
-            if (out_pTriangle != 0) // found triangle ?
+            if (out_nTriangle != -1) // found triangle ?
                return;
 
             // Test if Triangle is in current list...
-            { // local scope intentional
-               DelaunayVertex tmpVertex(x,y);
+            BOOST_FOREACH( int nTri, _lstTriangles )
+            {
+               double px = x, py = y;
+               out_eRelation = _pMesh->GetPointTriangleRelationRobust(px, py, nTri, epsilon);
 
-               BOOST_FOREACH( DelaunayTriangle* pTri, _lstTriangles )
+               if (out_eRelation != PointTriangle_Outside)
                {
-                  out_eRelation = GetPointTriangleRelationRobust(&tmpVertex,pTri, epsilon);
-
-                  if (out_eRelation != PointTriangle_Outside)
-                  {
-                     out_pTriangle = pTri;
-                     return;
-                  }
+                  out_nTriangle = nTri;
+                  return;
                }
             }
 
             if (PointFitsInside(x, y, 0))
             {
-               _child[0]->GetTriangleAt(x,y,out_pTriangle, out_eRelation, epsilon);
+               _child[0]->GetTriangleAt(x,y,out_nTriangle, out_eRelation, epsilon);
             }
             
             if (PointFitsInside(x, y, 1))
             {
-               _child[1]->GetTriangleAt(x,y,out_pTriangle, out_eRelation, epsilon);
+               _child[1]->GetTriangleAt(x,y,out_nTriangle, out_eRelation, epsilon);
             }
             
             if (PointFitsInside(x, y, 2))
             { 
-               _child[2]->GetTriangleAt(x,y,out_pTriangle, out_eRelation, epsilon);
+               _child[2]->GetTriangleAt(x,y,out_nTriangle, out_eRelation, epsilon);
             }
             
             if (PointFitsInside(x, y, 3))
             {
-               _child[3]->GetTriangleAt(x,y,out_pTriangle, out_eRelation, epsilon);
+               _child[3]->GetTriangleAt(x,y,out_nTriangle, out_eRelation, epsilon);
             }
          }
 
          //--------------------------------------------------------------------
 
-         void Traverse(boost::function<void(DelaunayTriangle*)> callback)
+         void Traverse(boost::function<void(int)> callback)
          {
             // Callback for each triangle in current list...
             {
-               BOOST_FOREACH( DelaunayTriangle* pTri, _lstTriangles )
+               BOOST_FOREACH( int nTri, _lstTriangles )
                {
-                   callback(pTri);
+                   callback(nTri);
                }
             }
          
@@ -337,15 +334,15 @@ namespace math
 
          //--------------------------------------------------------------------
 
-         void SpatialTraverse(double xmin, double ymin, double xmax, double ymax, boost::function<void(DelaunayTriangle*)> callback)
+         void SpatialTraverse(double xmin, double ymin, double xmax, double ymax, boost::function<void(int)> callback)
          {
             if (RectInRect(xmin, ymin, xmax, ymax, _xmin, _ymin, _xmax, _ymax))
             {
-               BOOST_FOREACH( DelaunayTriangle* pTri, _lstTriangles )
+               BOOST_FOREACH( int nTri, _lstTriangles )
                {
-                  if (TriangleInRect(pTri, xmin, ymin, xmax, ymax))
+                  if (TriangleInRect(_pMesh, nTri, xmin, ymin, xmax, ymax))
                   {
-                     callback(pTri);
+                     callback(nTri);
                   }
                }
 
@@ -373,15 +370,14 @@ namespace math
 
          //--------------------------------------------------------------------
 
-         bool RemoveTriangle(DelaunayTriangle* pTriangle)
+         bool RemoveTriangle(int nTriangle)
          {
             //#todo: if last triangle was removed and there are no children
             //       then delete this quadtree node!
-            std::set<DelaunayTriangle*>::iterator it = _lstTriangles.find(pTriangle);
+            std::set<int>::iterator it = _lstTriangles.find(nTriangle);
             if (it != _lstTriangles.end())
             {
                _lstTriangles.erase(it);
-               pTriangle = 0;
                return true;
             } 
 
@@ -394,10 +390,11 @@ namespace math
 
 
       protected:
+         DelaunayMesh* _pMesh;
          double _xmin, _ymin, _xmax, _ymax;
          QuadtreeNode* _child[4];
          int _nDepth;
-         std::set<DelaunayTriangle*> _lstTriangles;
+         std::set<int> _lstTriangles;
       private:
          QuadtreeNode(){}
       };
@@ -412,12 +409,12 @@ namespace math
 
       //-----------------------------------------------------------------------
 
-      DelaunayLocationQuadtreeHierarchy(double xmin, double ymin, double xmax, double ymax) 
-         : _xmin(xmin), _ymin(ymin), _xmax(xmax), _ymax(ymax)
+      DelaunayLocationQuadtreeHierarchy(DelaunayMesh* pMesh, double xmin, double ymin, double xmax, double ymax) 
+         : IDelaunayLocationStructure(pMesh), _xmin(xmin), _ymin(ymin), _xmax(xmax), _ymax(ymax)
       {
          _nMaxDepth = 20; // Maximum Quadtree Depth
 
-         _pQuadtree = new DelaunayAcceleration::QuadtreeNode(0, _xmin, _ymin, _xmax, _ymax);
+         _pQuadtree = new DelaunayAcceleration::QuadtreeNode(_pMesh, 0, _xmin, _ymin, _xmax, _ymax);
         
       }
 
@@ -434,23 +431,23 @@ namespace math
 
       //-----------------------------------------------------------------------
 
-      virtual void AddTriangle(DelaunayTriangle* pTriangle) 
+      virtual void AddTriangle(int nTriangle) 
       {
          // Triangle must have position info!!
-         assert(pTriangle->GetVertex(0));
-         assert(pTriangle->GetVertex(1));
-         assert(pTriangle->GetVertex(2));
+         assert(_pMesh->GetVertex(nTriangle, 0) != -1);
+         assert(_pMesh->GetVertex(nTriangle, 1) != -1);
+         assert(_pMesh->GetVertex(nTriangle, 2) != -1);
 
-         _pQuadtree->InsertTriangle(pTriangle, _nMaxDepth, &_TriQuadMap);
+         _pQuadtree->InsertTriangle(nTriangle, _nMaxDepth, &_TriQuadMap);
       }
 
       //-----------------------------------------------------------------------
 
-      virtual void RemoveTriangle(DelaunayTriangle* pTriangle)
+      virtual void RemoveTriangle(int nTriangle)
       {
 
-         std::map<DelaunayTriangle*, DelaunayAcceleration::QuadtreeNode*>::iterator it;
-         it = _TriQuadMap.find(pTriangle);
+         std::map<int, DelaunayAcceleration::QuadtreeNode*>::iterator it;
+         it = _TriQuadMap.find(nTriangle);
 
          if (it != _TriQuadMap.end())
          {
@@ -459,7 +456,7 @@ namespace math
 
             if (pNode)
             {
-               if (pNode->RemoveTriangle(pTriangle))
+               if (pNode->RemoveTriangle(nTriangle))
                   return;
             }
          }
@@ -471,22 +468,22 @@ namespace math
 
       //-----------------------------------------------------------------------
 
-      virtual DelaunayTriangle* GetTriangleAt(double x, double y, ePointTriangleRelation& eRelation)
+      virtual int GetTriangleAt(double x, double y, ePointTriangleRelation& eRelation)
       {
-         DelaunayTriangle* pTriangle = 0;
-         _pQuadtree->GetTriangleAt(x, y, pTriangle, eRelation, _dEpsilon);
+         int nTriangle = -1;
+         _pQuadtree->GetTriangleAt(x, y, nTriangle, eRelation, _dEpsilon);
          
-         if (pTriangle == 0) // no triangle found at specified position!
+         if (nTriangle == -1) // no triangle found at specified position!
          {
             eRelation = PointTriangle_Invalid;
          }
          
-         return pTriangle;
+         return nTriangle;
       }
 
       //-----------------------------------------------------------------------
 
-      virtual void Traverse(boost::function<void(DelaunayTriangle*)> callback)
+      virtual void Traverse(boost::function<void(int)> callback)
       {
          // Traverse all triangles and call specified function
          _pQuadtree->Traverse(callback);
@@ -494,7 +491,7 @@ namespace math
 
       //-----------------------------------------------------------------------
 
-      virtual void SpatialTraverse(double xmin, double ymin, double xmax, double ymax, boost::function<void(DelaunayTriangle*)> callback)
+      virtual void SpatialTraverse(double xmin, double ymin, double xmax, double ymax, boost::function<void(int)> callback)
       {
          // Traverse all triangles that fit in specified region!
          _pQuadtree->SpatialTraverse(xmin, ymin, xmax, ymax, callback);
@@ -507,7 +504,7 @@ namespace math
       double _xmin, _ymin, _xmax, _ymax;
       int _nMaxDepth;
 
-      std::map<DelaunayTriangle*, DelaunayAcceleration::QuadtreeNode*> _TriQuadMap;
+      std::map<int, DelaunayAcceleration::QuadtreeNode*> _TriQuadMap;
    };
 
 }
@@ -32,17 +32,18 @@
 
 namespace math
 {
-   IDelaunayLocationStructure::IDelaunayLocationStructure()
+   IDelaunayLocationStructure::IDelaunayLocationStructure(DelaunayMesh* pMesh)
    { 
       _dEpsilon = DBL_EPSILON;
+      _pMesh = pMesh;
    }
 
    //--------------------------------------------------------------------------
    //--------------------------------------------------------------------------
 
-   boost::shared_ptr<IDelaunayLocationStructure>   IDelaunayLocationStructure::CreateLocationStructure(double xmin, double ymin, double xmax, double ymax, EDelaunayLocationAlgorithms eAlgorithm)
+   boost::shared_ptr<IDelaunayLocationStructure>   IDelaunayLocationStructure::CreateLocationStructure(DelaunayMesh* pMesh, double xmin, double ymin, double xmax, double ymax, EDelaunayLocationAlgorithms eAlgorithm)
    {
-       return boost::shared_ptr<IDelaunayLocationStructure>(new DelaunayLocationLinear());
+       return boost::shared_ptr<IDelaunayLocationStructure>(new DelaunayLocationLinear(pMesh));
 
 
       if (eAlgorithm == DELAUNAYLOCATION_LINEARLIST)
@@ -50,19 +51,19 @@ namespace math
 #ifdef _DEBUG
          std::cout << "Location Struct: Linear\n";
 #endif
-         return boost::shared_ptr<IDelaunayLocationStructure>(new DelaunayLocationLinear());
+         return boost::shared_ptr<IDelaunayLocationStructure>(new DelaunayLocationLinear(pMesh));
       }
       else if (eAlgorithm == DELAUNAYLOCATION_QUADTREE_HIERARCHY)
       {
 #ifdef _DEBUG
          std::cout << "Location Struct: Quadtree Hierarchy\n";
 #endif
-         return boost::shared_ptr<IDelaunayLocationStructure>(new DelaunayLocationQuadtreeHierarchy(xmin, ymin, xmax, ymax));
+         return boost::shared_ptr<IDelaunayLocationStructure>(new DelaunayLocationQuadtreeHierarchy(pMesh, xmin, ymin, xmax, ymax));
       }
       else if (eAlgorithm == DELAUNAYLOCATION_KDTREE_HIERARCHY)
       {
          assert(false); // not yet implemented!!
-         return boost::shared_ptr<IDelaunayLocationStructure>(new DelaunayLocationKdTreeHierarchy(xmin, ymin, xmax, ymax));
+         return boost::shared_ptr<IDelaunayLocationStructure>(new DelaunayLocationKdTreeHierarchy(pMesh, xmin, ymin, xmax, ymax));
       }
       else
       {
@@ -74,161 +75,181 @@ namespace math
 
    //--------------------------------------------------------------------------
 
-   void IDelaunayLocationStructure::DeleteMemory(DelaunayTriangle* pTri)
+   void IDelaunayLocationStructure::DeleteMemory(int nTri)
    {
-      DelaunayTriangle* n0 = pTri->GetTriangle(0);
-      DelaunayTriangle* n1 = pTri->GetTriangle(1);
-      DelaunayTriangle* n2 = pTri->GetTriangle(2);
-
-      if (n0)
-      {
-         int nr0 = pTri->NeighbourReference(0);
-         n0->SetTriangle(nr0, 0);
-      }
-
-      if (n1)
-      {
-         int nr1 = pTri->NeighbourReference(1);
-         n1->SetTriangle(nr1, 0);
-      }
-
-      if (n2)
+      for (int t=0;t<3;t++)
       {
-         int nr2 = pTri->NeighbourReference(2);
-         n2->SetTriangle(nr2, 0);
+         int nNeighbour = _pMesh->GetTriangle(nTri, t);
+         if (nNeighbour != -1)
+         {
+            int nr = _pMesh->NeighbourReference(nTri, t);
+            _pMesh->SetTriangle(nNeighbour, nr, -1);
+         }
       }
 
-      this->RemoveTriangle(pTri);
-      DelaunayMemoryManager::Free(pTri);
+      this->RemoveTriangle(nTri);
+      _pMesh->FreeTriangle(nTri);
    }
 
    //--------------------------------------------------------------------------
 
-   DelaunayTriangle* IDelaunayLocationStructure::InsertVertex(DelaunayVertex* pVertex, DelaunayTriangle* pStartTriangle)
+   int IDelaunayLocationStructure::InsertVertex(int nVertex, int nStartTriangle, bool bWalk)
    {
-      DelaunayTriangle* pResult = _InsertPointToTriangulation(pVertex);
+      int nResult = _InsertPointToTriangulation(nVertex, nStartTriangle, bWalk);
 
-      if (!pResult)
+      if (nResult == -1)
       {
-#ifdef _DEBUG
-            //std::cout << "Rejecting and deleting Vertex!\n";
-#endif
-            DelaunayMemoryManager::Free(pVertex);
-            return pStartTriangle;
+            // Rejecting and deleting Vertex
+            _pMesh->FreeVertex(nVertex);
+            return nStartTriangle;
       }
 
-      return pResult;
+      return nResult;
    }
 
    //--------------------------------------------------------------------------
 
-   DelaunayTriangle* IDelaunayLocationStructure::_InsertPointToTriangulation(DelaunayVertex* pVertex)
+   int IDelaunayLocationStructure::WalkToTriangle(double x, double y, int nStart, ePointTriangleRelation& eRelation)
    {
-      ePointTriangleRelation eRelation;
-      DelaunayTriangle* pTri = GetTriangleAt(pVertex->x(), pVertex->y(), eRelation);
-
-      if (eRelation == PointTriangle_Inside)
+      // Visibility walk: cross an edge which has the point on its outer side until
+      // the triangle containing the point is reached. The edge we came from is never
+      // crossed back and the first tested edge rotates, so the walk can't cycle.
+      const size_t nMaxSteps = 1<<20;
+      int nTri = nStart;
+      int nPrevious = -1;
+      size_t nSteps = 0;
+
+      while (nTri != -1 && nSteps < nMaxSteps)
       {
-         assert(pTri);
+         int nNext = -1;
 
-         // test again with more precision!
-         // this is only necessary if you go way below millimeter accuracy!
-         //eRelation = GetPointTriangleRelationExact(pVertex, pTri);
-         //if (eRelation == PointTriangle_Inside)
+         for (int i=0;i<3;i++)
          {
+            int t = (int)((nSteps+i)%3);
+            int nNeighbour = _pMesh->GetTriangle(nTri, t);
 
-            DelaunayTriangle* tri0 = DelaunayMemoryManager::AllocTriangle();
-            DelaunayTriangle* tri1 = DelaunayMemoryManager::AllocTriangle();
-            DelaunayTriangle* tri2 = DelaunayMemoryManager::AllocTriangle();
+            if (nNeighbour != -1 && nNeighbour != nPrevious)
+            {
+               int A = _pMesh->GetVertex(nTri, t);
+               int B = _pMesh->GetVertex(nTri, (t+1)%3);
+
+               if (math::ccw(x, y, _pMesh->x(A), _pMesh->y(A), _pMesh->x(B), _pMesh->y(B)) < 0)
+               {
+                  nNext = nNeighbour;
+                  break;
+               }
+            }
+         }
+
+         if (nNext == -1)
+         {
+            double px = x, py = y;
+            eRelation = _pMesh->GetPointTriangleRelationRobust(px, py, nTri, _dEpsilon);
+            if (eRelation != PointTriangle_Outside)
+            {
+               return nTri;
+            }
+            break;
+         }
+
+         nPrevious = nTri;
+         nTri = nNext;
+         nSteps++;
+      }
+
+      return GetTriangleAt(x, y, eRelation);
+   }
+
+   //--------------------------------------------------------------------------
 
-            tri0->SetVertex(0, pTri->GetVertex(0));
-            tri0->SetVertex(1, pTri->GetVertex(1));
-            tri0->SetVertex(2, pVertex);
+   int IDelaunayLocationStructure::_InsertPointToTriangulation(int nVertex, int nStartTriangle, bool bWalk)
+   {
+      DelaunayMesh& mesh = *_pMesh;
+      ePointTriangleRelation eRelation;
+      int nTri;
 
-            tri1->SetVertex(0, pTri->GetVertex(1));
-            tri1->SetVertex(1, pTri->GetVertex(2));
-            tri1->SetVertex(2, pVertex);
+      if (bWalk)
+      {
+         nTri = WalkToTriangle(mesh.x(nVertex), mesh.y(nVertex), nStartTriangle, eRelation);
+      }
+      else
+      {
+         nTri = GetTriangleAt(mesh.x(nVertex), mesh.y(nVertex), eRelation);
+      }
 
-            tri2->SetVertex(0, pTri->GetVertex(2));
-            tri2->SetVertex(1, pTri->GetVertex(0));
-            tri2->SetVertex(2, pVertex);
+      if (eRelation == PointTriangle_Inside)
+      {
+         assert(nTri != -1);
 
-            // Set new Triangle neighbours:
-            tri0->SetTriangle(0, pTri->GetTriangle(0));
-            tri0->SetTriangle(1, tri1);
-            tri0->SetTriangle(2, tri2);
+         int tri0 = mesh.AddTriangle();
+         int tri1 = mesh.AddTriangle();
+         int tri2 = mesh.AddTriangle();
 
-            tri1->SetTriangle(0, pTri->GetTriangle(1));
-            tri1->SetTriangle(1, tri2);
-            tri1->SetTriangle(2, tri0);
+         mesh.SetVertex(tri0, 0, mesh.GetVertex(nTri, 0));
+         mesh.SetVertex(tri0, 1, mesh.GetVertex(nTri, 1));
+         mesh.SetVertex(tri0, 2, nVertex);
 
-            tri2->SetTriangle(0, pTri->GetTriangle(2));
-            tri2->SetTriangle(1, tri0);
-            tri2->SetTriangle(2, tri1);
+         mesh.SetVertex(tri1, 0, mesh.GetVertex(nTri, 1));
+         mesh.SetVertex(tri1, 1, mesh.GetVertex(nTri, 2));
+         mesh.SetVertex(tri1, 2, nVertex);
 
-            this->AddTriangle(tri0);
-            this->AddTriangle(tri1);
-            this->AddTriangle(tri2);
+         mesh.SetVertex(tri2, 0, mesh.GetVertex(nTri, 2));
+         mesh.SetVertex(tri2, 1, mesh.GetVertex(nTri, 0));
+         mesh.SetVertex(tri2, 2, nVertex);
 
-            assert(tri0->IsCCW());
-            assert(tri1->IsCCW());
-            assert(tri2->IsCCW());
+         // Set new Triangle neighbours:
+         mesh.SetTriangle(tri0, 0, mesh.GetTriangle(nTri, 0));
+         mesh.SetTriangle(tri0, 1, tri1);
+         mesh.SetTriangle(tri0, 2, tri2);
 
-            // Update Neighbours
-            int i,j,k;
-            i = pTri->NeighbourReference(0);
-            j = pTri->NeighbourReference(1);
-            k = pTri->NeighbourReference(2);
+         mesh.SetTriangle(tri1, 0, mesh.GetTriangle(nTri, 1));
+         mesh.SetTriangle(tri1, 1, tri2);
+         mesh.SetTriangle(tri1, 2, tri0);
 
-            assert(pTri->IsCCW());
+         mesh.SetTriangle(tri2, 0, mesh.GetTriangle(nTri, 2));
+         mesh.SetTriangle(tri2, 1, tri0);
+         mesh.SetTriangle(tri2, 2, tri1);
 
-            DelaunayTriangle* pNeighbour0 = 0;
-            DelaunayTriangle* pNeighbour1 = 0;
-            DelaunayTriangle* pNeighbour2 = 0;
+         this->AddTriangle(tri0);
+         this->AddTriangle(tri1);
+         this->AddTriangle(tri2);
 
-            if (i>=0)
-            {
-               pNeighbour0 = pTri->GetTriangle(0); 
-            }
+         assert(mesh.IsCCW(tri0));
+         assert(mesh.IsCCW(tri1));
+         assert(mesh.IsCCW(tri2));
 
-            if (j>=0)
-            {
-               pNeighbour1 = pTri->GetTriangle(1);
-            }
+         // Update Neighbours
+         int i,j,k;
+         i = mesh.NeighbourReference(nTri, 0);
+         j = mesh.NeighbourReference(nTri, 1);
+         k = mesh.NeighbourReference(nTri, 2);
 
-            if (k>=0)
-            {
-               pNeighbour2 = pTri->GetTriangle(2);
-            }
+         int nNeighbour0 = mesh.GetTriangle(nTri, 0);
+         int nNeighbour1 = mesh.GetTriangle(nTri, 1);
+         int nNeighbour2 = mesh.GetTriangle(nTri, 2);
 
-            this->DeleteMemory(pTri);
+         this->DeleteMemory(nTri);
 
-            if (pNeighbour0)
-               pNeighbour0->SetTriangle(i, tri0);
-            if (pNeighbour1)
-               pNeighbour1->SetTriangle(j, tri1);
-            if (pNeighbour2)
-               pNeighbour2->SetTriangle(k, tri2);
+         if (nNeighbour0 != -1)
+            mesh.SetTriangle(nNeighbour0, i, tri0);
+         if (nNeighbour1 != -1)
+            mesh.SetTriangle(nNeighbour1, j, tri1);
+         if (nNeighbour2 != -1)
+            mesh.SetTriangle(nNeighbour2, k, tri2);
 
-            // LegalizeEdges:
+         // LegalizeEdges:
 
-            DelaunayTriangle::LegalizeEdges(tri0, 0);
-            DelaunayTriangle::LegalizeEdges(tri1, 0);
-            DelaunayTriangle::LegalizeEdges(tri2, 0);
+         mesh.LegalizeEdges(tri0, 0);
+         mesh.LegalizeEdges(tri1, 0);
+         mesh.LegalizeEdges(tri2, 0);
 
-            DelaunayTriangle::TestTriangle(tri0);
-            DelaunayTriangle::TestTriangle(tri1);
-            DelaunayTriangle::TestTriangle(tri2);
+         mesh.TestTriangle(tri0);
+         mesh.TestTriangle(tri1);
+         mesh.TestTriangle(tri2);
 
-            assert(tri0->IsCCW());
+         assert(mesh.IsCCW(tri0));
 
-            return tri0;
-         }
-         /*else
-         {
-         // other test result with higher precision
-         std::cout << "Higher Precision: other result!!\n";
-         }*/
+         return tri0;
       }
 
       if (eRelation == PointTriangle_Vertex0 ||
@@ -236,31 +257,28 @@ namespace math
           eRelation == PointTriangle_Vertex2)
       {
          // If new point is on an existing vertex, it will be ignored (rejected)
-         return 0; 
+         return -1; 
       }
       else if (eRelation == PointTriangle_Outside)
       {
-         return 0;
+         return -1;
       }
       else if (eRelation == PointTriangle_Invalid)
       {
-         return 0;
+         return -1;
       }
       else if (eRelation == PointTriangle_Edge0 ||
                eRelation == PointTriangle_Edge1 ||
                eRelation == PointTriangle_Edge2)
       {
-
-         DelaunayVertex* K = pVertex;
-         DelaunayVertex* A;
-         DelaunayVertex* B;
-         DelaunayVertex* C;
-         DelaunayVertex* S = 0;
-         DelaunayTriangle* pTriOpposite = 0;
-         DelaunayTriangle* N0 = 0;
-         DelaunayTriangle* N1 = 0;
-         DelaunayTriangle* N2 = 0;
-         DelaunayTriangle* N3 = 0;
+         int K = nVertex;
+         int A, B, C;
+         int S = -1;
+         int nTriOpposite = -1;
+         int N0 = -1;
+         int N1 = -1;
+         int N2 = -1;
+         int N3 = -1;
          int N0Back = -1;
          int N1Back = -1;
          int N2Back = -1;
@@ -276,138 +294,126 @@ namespace math
          {
             k = 1;
          }
-         else if (eRelation == PointTriangle_Edge2)
-         {
-            k = 2;
-         }
          else
          {
-            assert(false);
+            k = 2;
          }
 
-         A = pTri->GetVertex(k%3);
-         B = pTri->GetVertex((k+1)%3);
-         C = pTri->GetVertex((k+2)%3);
+         A = mesh.GetVertex(nTri, k%3);
+         B = mesh.GetVertex(nTri, (k+1)%3);
+         C = mesh.GetVertex(nTri, (k+2)%3);
 
-         S = pTri->GetOppositeVertex(k);
-         pTriOpposite = pTri->GetTriangle(k);
+         S = mesh.GetOppositeVertex(nTri, k);
+         nTriOpposite = mesh.GetTriangle(nTri, k);
 
-         N0 = pTri->GetTriangle((k+2)%3);
-         N3 = pTri->GetTriangle((k+1)%3);
+         N0 = mesh.GetTriangle(nTri, (k+2)%3);
+         N3 = mesh.GetTriangle(nTri, (k+1)%3);
 
-         int t = pTri->NeighbourReference(k);
+         int t = mesh.NeighbourReference(nTri, k);
 
-         N0Back = pTri->NeighbourReference((k+2)%3);
-         N3Back = pTri->NeighbourReference((k+1)%3);
+         N0Back = mesh.NeighbourReference(nTri, (k+2)%3);
+         N3Back = mesh.NeighbourReference(nTri, (k+1)%3);
 
-         if (pTriOpposite)
+         if (nTriOpposite != -1)
          {
-            N1 = pTriOpposite->GetTriangle((t+1)%3);
-            N2 = pTriOpposite->GetTriangle((t+2)%3);
+            N1 = mesh.GetTriangle(nTriOpposite, (t+1)%3);
+            N2 = mesh.GetTriangle(nTriOpposite, (t+2)%3);
 
-            N1Back = pTriOpposite->NeighbourReference((t+1)%3);
-            N2Back = pTriOpposite->NeighbourReference((t+2)%3);
+            N1Back = mesh.NeighbourReference(nTriOpposite, (t+1)%3);
+            N2Back = mesh.NeighbourReference(nTriOpposite, (t+2)%3);
          }
 
+         int T0 = -1;
+         int T1 = -1;
+         int T2 = -1;
+         int T3 = -1;
 
-         DelaunayTriangle* T0 = 0;
-         DelaunayTriangle* T1 = 0;
-         DelaunayTriangle* T2 = 0;
-         DelaunayTriangle* T3 = 0;
-
-         if (pTri)
-         {
-            this->RemoveTriangle(pTri); // "recycle" triangle: pointer is not deleted!
-         }
+         this->RemoveTriangle(nTri); // "recycle" triangle: it is not freed!
            
-         T0 = pTri; // recycle triangle!
-         T1 = DelaunayMemoryManager::AllocTriangle();
+         T0 = nTri; // recycle triangle!
+         T1 = mesh.AddTriangle();
 
-         if (pTriOpposite)
+         if (nTriOpposite != -1)
          {
-            this->RemoveTriangle(pTriOpposite); // "recycle" triangle: pointer is not deleted!
-            T2 = pTriOpposite; // recycle triangle!
-            T3 = DelaunayMemoryManager::AllocTriangle();
+            this->RemoveTriangle(nTriOpposite); // "recycle" triangle: it is not freed!
+            T2 = nTriOpposite; // recycle triangle!
+            T3 = mesh.AddTriangle();
          }
 
-         T0->SetTriangle(0, N0);
-         T0->SetTriangle(1, T2);
-         T0->SetTriangle(2, T1);
+         mesh.SetTriangle(T0, 0, N0);
+         mesh.SetTriangle(T0, 1, T2);
+         mesh.SetTriangle(T0, 2, T1);
 
-         T0->SetVertex(0, C);
-         T0->SetVertex(1, A);
-         T0->SetVertex(2, K);
+         mesh.SetVertex(T0, 0, C);
+         mesh.SetVertex(T0, 1, A);
+         mesh.SetVertex(T0, 2, K);
 
-         T1->SetTriangle(0, N3);
-         T1->SetTriangle(1, T0);
-         T1->SetTriangle(2, T3);
+         mesh.SetTriangle(T1, 0, N3);
+         mesh.SetTriangle(T1, 1, T0);
+         mesh.SetTriangle(T1, 2, T3);
 
-         T1->SetVertex(0, B);
-         T1->SetVertex(1, C);
-         T1->SetVertex(2, K);
+         mesh.SetVertex(T1, 0, B);
+         mesh.SetVertex(T1, 1, C);
+         mesh.SetVertex(T1, 2, K);
 
-         if (T2 && T3)
+         if (T2 != -1 && T3 != -1)
          {
-            T2->SetTriangle(0, N1);
-            T2->SetTriangle(1, T3);
-            T2->SetTriangle(2, T0);
+            mesh.SetTriangle(T2, 0, N1);
+            mesh.SetTriangle(T2, 1, T3);
+            mesh.SetTriangle(T2, 2, T0);
 
-            T2->SetVertex(0, A);
-            T2->SetVertex(1, S);
-            T2->SetVertex(2, K);
+            mesh.SetVertex(T2, 0, A);
+            mesh.SetVertex(T2, 1, S);
+            mesh.SetVertex(T2, 2, K);
 
-            T3->SetTriangle(0, N2);
-            T3->SetTriangle(1, T1);
-            T3->SetTriangle(2, T2);
+            mesh.SetTriangle(T3, 0, N2);
+            mesh.SetTriangle(T3, 1, T1);
+            mesh.SetTriangle(T3, 2, T2);
 
-            T3->SetVertex(0, S);
-            T3->SetVertex(1, B);
-            T3->SetVertex(2, K);
+            mesh.SetVertex(T3, 0, S);
+            mesh.SetVertex(T3, 1, B);
+            mesh.SetVertex(T3, 2, K);
          }
 
-         if (N0 && N0Back != -1)
+         if (N0 != -1 && N0Back != -1)
          {
-            N0->SetTriangle(N0Back, T0);
+            mesh.SetTriangle(N0, N0Back, T0);
          }
-         if (N1 && N1Back != -1)
+         if (N1 != -1 && N1Back != -1)
          {
-            N1->SetTriangle(N1Back, T2);
+            mesh.SetTriangle(N1, N1Back, T2);
          }
-         if (N2 && N2Back != -1)
+         if (N2 != -1 && N2Back != -1)
          {
-            N2->SetTriangle(N2Back, T3);
+            mesh.SetTriangle(N2, N2Back, T3);
          }
-         if (N3 && N3Back != -1)
+         if (N3 != -1 && N3Back != -1)
          {
-            N3->SetTriangle(N3Back, T1);
+            mesh.SetTriangle(N3, N3Back, T1);
          }
 
-         if (T0) this->AddTriangle(T0); // add "recycled" triangle ("old pointer")
-         if (T2) this->AddTriangle(T2); // add "recycled" triangle ("old pointer")
-         if (T1) this->AddTriangle(T1);
-         if (T3) this->AddTriangle(T3);
-
-#ifdef _DEBUG
-         //std::cout << "EDGE!\n";
-#endif
+         this->AddTriangle(T0); // add "recycled" triangle
+         if (T2 != -1) this->AddTriangle(T2); // add "recycled" triangle
+         this->AddTriangle(T1);
+         if (T3 != -1) this->AddTriangle(T3);
 
-         if (T0) DelaunayTriangle::LegalizeEdges(T0, 0);
-         if (T1) DelaunayTriangle::LegalizeEdges(T1, 0);
-         if (T2) DelaunayTriangle::LegalizeEdges(T2, 0);
-         if (T3) DelaunayTriangle::LegalizeEdges(T3, 0);
+         mesh.LegalizeEdges(T0, 0);
+         mesh.LegalizeEdges(T1, 0);
+         if (T2 != -1) mesh.LegalizeEdges(T2, 0);
+         if (T3 != -1) mesh.LegalizeEdges(T3, 0);
 
-         if (T0) DelaunayTriangle::TestTriangle(T0);
-         if (T1) DelaunayTriangle::TestTriangle(T1);
-         if (T2) DelaunayTriangle::TestTriangle(T2);
-         if (T3) DelaunayTriangle::TestTriangle(T3);
+         mesh.TestTriangle(T0);
+         mesh.TestTriangle(T1);
+         mesh.TestTriangle(T2);
+         mesh.TestTriangle(T3);
 
          return T0;
       }
 
 
-      return 0;
+      return -1;
    }
 
 
    //--------------------------------------------------------------------------
-}
\ No newline at end of file
+}
@@ -20,8 +20,7 @@
 #define _DELAUNAY_LOCATIONSTRUCTURE_H
 
 #include "og.h"
-#include "DelaunayMemoryManager.h"
-#include "DelaunayTriangle.h"
+#include "DelaunayMesh.h"
 #include <boost/shared_ptr.hpp>
 #include <boost/function.hpp>
 
@@ -38,22 +37,23 @@ namespace math
 
    //--------------------------------------------------------------------------
 
+   //! Location structure for the triangles of a mesh. Triangles are indices into the mesh.
    class OPENGLOBE_API IDelaunayLocationStructure
    {
    public:
-      IDelaunayLocationStructure();
+      IDelaunayLocationStructure(DelaunayMesh* pMesh);
       virtual ~IDelaunayLocationStructure() {}
 
       //! Add Triangle to Structure. This shouldn't be called from outside and will be removed at one point
       //! This method is available to create supersimplex triangle, however, this should be part of this class
       //! in future!
-      virtual void AddTriangle(DelaunayTriangle* pTriangle) = 0;
+      virtual void AddTriangle(int nTriangle) = 0;
 
       //! Get triangle (and its relation to) at specified 2D point.
-      virtual DelaunayTriangle* GetTriangleAt(double x, double y, ePointTriangleRelation& eRelation) = 0;
+      virtual int GetTriangleAt(double x, double y, ePointTriangleRelation& eRelation) = 0;
    
       //! Traverse Structure and call function for every triangle. Traversal order is not important.   
-      virtual void Traverse(boost::function<void(DelaunayTriangle*)> callback) = 0;
+      virtual void Traverse(boost::function<void(int)> callback) = 0;
 
 
       //! Spatial traverse Structure and call function for every triangle that has atleast one point within the specified axis aligned rectangular boundary. 
@@ -62,31 +62,39 @@ namespace math
       //! \param xmax max x value of axis aligned rectangular boundary
       //! \param ymax max y value of axis aligned rectangular boundary
       //! \param callback function to be called for every triangle inside bounding rect
-      virtual void SpatialTraverse(double xmin, double ymin, double xmax, double ymax, boost::function<void(DelaunayTriangle*)> callback) = 0;
+      virtual void SpatialTraverse(double xmin, double ymin, double xmax, double ymax, boost::function<void(int)> callback) = 0;
 
 
       //! Delete a triangle from memory. The delaunay trianglulation still exists, but
       //! the triangle is removed from memory.
-      void DeleteMemory(DelaunayTriangle* pTri);
+      void DeleteMemory(int nTri);
 
       //! Insert new Vertex into triangulation
-      //! pStartTriangle is a hint.
-      //! Returns true if a point was actually inserted.
-      DelaunayTriangle* InsertVertex(DelaunayVertex* pVertex, DelaunayTriangle* pStartTriangle);
+      //! nStartTriangle is a hint.
+      //! If bWalk is true, the vertex is located by walking from nStartTriangle, which must
+      //! be a valid triangle of this triangulation (or -1).
+      //! Returns a triangle incident to the inserted vertex. If the vertex is rejected
+      //! it is freed and nStartTriangle is returned.
+      int InsertVertex(int nVertex, int nStartTriangle, bool bWalk = false);
+
+      //! Get triangle (and its relation to) at specified 2D point by walking through the
+      //! triangulation, starting at triangle nStart. If the walk fails GetTriangleAt is used.
+      int WalkToTriangle(double x, double y, int nStart, ePointTriangleRelation& eRelation);
 
       //! Create instance of a location structure using specified algorithm
-      static boost::shared_ptr<IDelaunayLocationStructure>   CreateLocationStructure(double xmin, double ymin, double xmax, double ymax, EDelaunayLocationAlgorithms eAlgorithm = DELAUNAYLOCATION_LINEARLIST);
+      static boost::shared_ptr<IDelaunayLocationStructure>   CreateLocationStructure(DelaunayMesh* pMesh, double xmin, double ymin, double xmax, double ymax, EDelaunayLocationAlgorithms eAlgorithm = DELAUNAYLOCATION_LINEARLIST);
    
       //! Set Epsilon for point distance
       void SetEpsilon(double epsilon) {_dEpsilon = epsilon;}
 
    protected:
       //! Remove a triangle from acceleration structure
-      virtual void RemoveTriangle(DelaunayTriangle* pTriangle) = 0;
+      virtual void RemoveTriangle(int nTriangle) = 0;
 
       double _dEpsilon;
+      DelaunayMesh* _pMesh;
    private:
-      DelaunayTriangle* _InsertPointToTriangulation(DelaunayVertex* pVertex);
+      int _InsertPointToTriangulation(int nVertex, int nStartTriangle, bool bWalk);
 
    };
 }
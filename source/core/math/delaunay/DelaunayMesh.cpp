@@ -0,0 +1,601 @@
+/*******************************************************************************
+#      ____               __          __  _      _____ _       _               #
+#     / __ \              \ \        / / | |    / ____| |     | |              #
+#    | |  | |_ __   ___ _ __ \  /\  / /__| |__ | |  __| | ___ | |__   ___      #
+#    | |  | | '_ \ / _ \ '_ \ \/  \/ / _ \ '_ \| | |_ | |/ _ \| '_ \ / _ \     #
+#    | |__| | |_) |  __/ | | \  /\  /  __/ |_) | |__| | | (_) | |_) |  __/     #
+#     \____/| .__/ \___|_| |_|\/  \/ \___|_.__/ \_____|_|\___/|_.__/ \___|     #
+#           | |                                                                #
+#           |_|                                                                #
+#                                                                              #
+#                                (c) 2011 by                                   #
+#           University of Applied Sciences Northwestern Switzerland            #
+#                     Institute of Geomatics Engineering                       #
+#                           martin.christen@fhnw.ch                            #
+********************************************************************************
+*     Licensed under MIT License. Read the file LICENSE for more information   *
+*******************************************************************************/
+
+#include "DelaunayMesh.h"
+#include <float.h>
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+namespace math
+{
+   //--------------------------------------------------------------------------
+   DelaunayMesh::DelaunayMesh()
+   {
+   }
+   //--------------------------------------------------------------------------
+   DelaunayMesh::~DelaunayMesh()
+   {
+   }
+   //--------------------------------------------------------------------------
+   void DelaunayMesh::Clear()
+   {
+      _vX.clear();
+      _vY.clear();
+      _vElevation.clear();
+      _vWeight.clear();
+      _vError.clear();
+      _vId.clear();
+      _vHeapIndex.clear();
+      _vFreeVertices.clear();
+
+      _vTriVertex.clear();
+      _vTriNeighbour.clear();
+      _vTriLocation.clear();
+      _vFreeTriangles.clear();
+   }
+   //--------------------------------------------------------------------------
+   void DelaunayMesh::Reserve(int nVertices)
+   {
+      // every inserted vertex adds two triangles, a split allocates its three
+      // triangles before the old one is freed.
+      size_t nv = _vX.size() + nVertices;
+      size_t nt = _vTriLocation.size() + 2*nVertices + 2;
+
+      _vX.reserve(nv);
+      _vY.reserve(nv);
+      _vElevation.reserve(nv);
+      _vWeight.reserve(nv);
+      _vError.reserve(nv);
+      _vId.reserve(nv);
+      _vHeapIndex.reserve(nv);
+
+      _vTriVertex.reserve(3*nt);
+      _vTriNeighbour.reserve(3*nt);
+      _vTriLocation.reserve(nt);
+   }
+   //--------------------------------------------------------------------------
+   int DelaunayMesh::AddVertex(double x, double y, double elevation, double weight)
+   {
+      int nVertex;
+
+      if (_vFreeVertices.size() > 0)
+      {
+         nVertex = _vFreeVertices.back();
+         _vFreeVertices.pop_back();
+         _vX[nVertex] = x;
+         _vY[nVertex] = y;
+         _vElevation[nVertex] = elevation;
+         _vWeight[nVertex] = weight;
+         _vError[nVertex] = 0.0;
+         _vId[nVertex] = -1;
+         _vHeapIndex[nVertex] = -1;
+      }
+      else
+      {
+         nVertex = (int)_vX.size();
+         _vX.push_back(x);
+         _vY.push_back(y);
+         _vElevation.push_back(elevation);
+         _vWeight.push_back(weight);
+         _vError.push_back(0.0);
+         _vId.push_back(-1);
+         _vHeapIndex.push_back(-1);
+      }
+
+      return nVertex;
+   }
+   //--------------------------------------------------------------------------
+   int DelaunayMesh::AddVertex(const ElevationPoint& pt)
+   {
+      int nVertex = AddVertex(pt.x, pt.y, pt.elevation, pt.weight);
+      _vError[nVertex] = pt.error;
+      return nVertex;
+   }
+   //--------------------------------------------------------------------------
+   void DelaunayMesh::FreeVertex(int nVertex)
+   {
+      assert(nVertex >= 0 && nVertex < (int)_vX.size());
+      _vHeapIndex[nVertex] = -1;
+      _vFreeVertices.push_back(nVertex);
+   }
+   //--------------------------------------------------------------------------
+   ElevationPoint DelaunayMesh::GetElevationPoint(int nVertex) const
+   {
+      ElevationPoint pt;
+      pt.x = _vX[nVertex];
+      pt.y = _vY[nVertex];
+      pt.elevation = _vElevation[nVertex];
+      pt.weight = _vWeight[nVertex];
+      pt.error = _vError[nVertex];
+      return pt;
+   }
+   //--------------------------------------------------------------------------
+   void DelaunayMesh::ResetVertexIds()
+   {
+      std::fill(_vId.begin(), _vId.end(), -1);
+   }
+   //--------------------------------------------------------------------------
+   int DelaunayMesh::AddTriangle()
+   {
+      int nTri;
+
+      if (_vFreeTriangles.size() > 0)
+      {
+         nTri = _vFreeTriangles.back();
+         _vFreeTriangles.pop_back();
+      }
+      else
+      {
+         nTri = (int)_vTriLocation.size();
+         _vTriVertex.resize(_vTriVertex.size()+3);
+         _vTriNeighbour.resize(_vTriNeighbour.size()+3);
+         _vTriLocation.push_back(-1);
+      }
+
+      for (int i=0;i<3;i++)
+      {
+         _vTriVertex[3*nTri+i] = -1;
+         _vTriNeighbour[3*nTri+i] = -1;
+      }
+      _vTriLocation[nTri] = -1;
+
+      return nTri;
+   }
+   //--------------------------------------------------------------------------
+   void DelaunayMesh::FreeTriangle(int nTri)
+   {
+      assert(nTri >= 0 && nTri < (int)_vTriLocation.size());
+
+      // a freed triangle doesn't reference any vertex, so stale
+      // triangle indices (e.g. in the error heap) can be detected.
+      for (int i=0;i<3;i++)
+      {
+         _vTriVertex[3*nTri+i] = -1;
+         _vTriNeighbour[3*nTri+i] = -1;
+      }
+      _vTriLocation[nTri] = -1;
+      _vFreeTriangles.push_back(nTri);
+   }
+   //--------------------------------------------------------------------------
+   double DelaunayMesh::GetMemory() const
+   {
+      size_t nVertexSize = 5*sizeof(double) + 2*sizeof(int);
+      size_t nTriangleSize = 7*sizeof(int);
+      return double(_vX.capacity()*nVertexSize + _vTriLocation.capacity()*nTriangleSize)/1024.0/1024.0;
+   }
+   //--------------------------------------------------------------------------
+   bool DelaunayMesh::IsSuperSimplex(int nTri) const
+   {
+      if (weight(GetVertex(nTri, 0)) == -1) return true;
+      if (weight(GetVertex(nTri, 1)) == -1) return true;
+      if (weight(GetVertex(nTri, 2)) == -1) return true;
+
+      return false;
+   }
+   //--------------------------------------------------------------------------
+   bool DelaunayMesh::IsCCW(int nTri) const
+   {
+      double dCCW = ccw(GetVertex(nTri, 0), GetVertex(nTri, 1), GetVertex(nTri, 2));
+
+      return  dCCW >= 0;
+   }
+
+   //--------------------------------------------------------------------------
+
+   // This function updates point P to closest point on segment AB
+   // if P is updated to A or B (start/end point of segment) then
+   // false is returned and point is not updated.
+   inline bool UpdateToClosestPoint(double ax, double ay, double bx, double by, double& px, double& py, double epsilon)
+   {
+      double APx = px - ax;
+      double APy = py - ay;
+      double ABx = bx - ax;
+      double ABy = by - ay;
+
+      double ab2 = ABx*ABx + ABy*ABy;
+      double ap_ab = APx*ABx + APy*ABy;
+      double t = ap_ab / ab2;
+     
+      if (t <= epsilon || t>=1.0-epsilon) 
+      {
+         return false;
+      }
+      
+      px = ax + ABx * t;
+      py = ay + ABy * t;
+
+      return true;
+   }
+
+   //--------------------------------------------------------------------------
+
+   // This Epsilon is for sub millimeter accuracy when mapping the earth between
+   // [-1,+1]. (For 1 meter resolution an epsilon of 1e-9 is good enough.)
+
+   ePointTriangleRelation DelaunayMesh::GetPointTriangleRelationRobust(double& px, double& py, int nTri, const double epsilon) const
+   {
+      int A = GetVertex(nTri, 0);
+      int B = GetVertex(nTri, 1);
+      int C = GetVertex(nTri, 2);
+
+      const double ax = _vX[A], ay = _vY[A];
+      const double bx = _vX[B], by = _vY[B];
+      const double cx = _vX[C], cy = _vY[C];
+
+      const double edgeepsilon = DBL_EPSILON;
+      const double ptepsilon = 1e-12;
+
+      double p0 = math::ccw(px, py, ax, ay, bx, by);
+      double p1 = math::ccw(px, py, bx, by, cx, cy);
+      double p2 = math::ccw(px, py, cx, cy, ax, ay);
+
+      if (fabs(ax - px)<ptepsilon && fabs(ay - py)<ptepsilon)
+      {
+         return PointTriangle_Vertex0;
+      }
+
+      if (fabs(bx - px)<ptepsilon && fabs(by - py)<ptepsilon)
+      {
+         return PointTriangle_Vertex1;
+      }
+
+      if (fabs(cx - px)<ptepsilon && fabs(cy - py)<ptepsilon)
+      {
+         return PointTriangle_Vertex2;
+      }
+
+      if (p0>=0 && p1>=0 && p2>=0)
+      {
+         if (p0 <= edgeepsilon && p1 <= edgeepsilon && p2 <= edgeepsilon)
+         {
+            return PointTriangle_Invalid;
+         }
+
+         if (p0<=edgeepsilon)
+         {
+            if (UpdateToClosestPoint(ax, ay, bx, by, px, py, DBL_EPSILON))
+            {
+               if (math::ccw(px, py, ax, ay, bx, by)<=DBL_EPSILON)
+               {
+                  return PointTriangle_Edge0;
+               }
+            }
+
+            return PointTriangle_Invalid;
+         }
+         else if (p1<=edgeepsilon)
+         {
+            if (UpdateToClosestPoint(bx, by, cx, cy, px, py, DBL_EPSILON))
+            {
+               if (math::ccw(px, py, bx, by, cx, cy)<=DBL_EPSILON)
+               {
+                  return PointTriangle_Edge1;
+               }
+            }
+
+            return PointTriangle_Invalid;
+         }
+         else if (p2<=edgeepsilon)
+         {
+            if (UpdateToClosestPoint(cx, cy, ax, ay, px, py, DBL_EPSILON))
+            {
+               if (math::ccw(px, py, cx, cy, ax, ay)<=DBL_EPSILON)
+               {
+                  return PointTriangle_Edge2;
+               }
+            }
+
+            return PointTriangle_Invalid;
+         }
+
+         if (p0>=edgeepsilon && p1>=edgeepsilon && p2>=edgeepsilon)
+            return PointTriangle_Inside;
+         else
+            return PointTriangle_Outside;
+      }
+      else
+      {
+         return PointTriangle_Outside;
+      }
+   }
+
+   //--------------------------------------------------------------------------
+
+   int DelaunayMesh::NeighbourReference(int nTri, int t) const
+   {
+      int nNeighbour = GetTriangle(nTri, t);
+      if (nNeighbour == -1)
+      {
+         return -1;
+      }
+
+      if (GetTriangle(nNeighbour, 0) == nTri)
+      {
+         return 0;
+      }
+      else if (GetTriangle(nNeighbour, 1) == nTri)
+      {
+         return 1;
+      }
+      else if (GetTriangle(nNeighbour, 2) == nTri)
+      {
+         return 2;
+      }
+      else
+      {
+         assert(false);
+         return -1;
+      }
+   }
+
+   //--------------------------------------------------------------------------
+
+   bool DelaunayMesh::FlipEdge(int nTri, int t, int& Cret, int& Dret)
+   {
+      int A = nTri;
+      int B = GetTriangle(nTri, t);
+      Cret = -1;
+      Dret = -1;
+
+      // neighbour MUST exist to flip!!
+      if (B == -1)
+      {
+         return false;
+      }
+
+      int NRefB = NeighbourReference(A, t);
+      int i,j,k,l;
+
+      if (NRefB == 0)
+      { k = 1; l = 2; }
+      else if (NRefB == 1)
+      { k = 2; l = 0; }
+      else
+      { k = 0; l = 1; }
+
+      if (t == 0)
+      { j = 2; i = 1; }
+      else if (t == 1)
+      { j = 0; i = 2;}
+      else
+      { j = 1; i = 0;}
+
+      int P[4];
+
+      P[0] = GetVertex(A, t);
+      P[1] = GetOppositeVertex(A, t); //equal to: GetVertex(B, l);
+      P[2] = GetVertex(A, (t+1)%3);
+      P[3] = GetVertex(A, (t+2)%3);
+    
+      int C = A;
+      int D = B;
+
+      int C20 = GetTriangle(A, j);
+      int C01 = GetTriangle(B, k);
+      int C12 = D;
+      int D20 = GetTriangle(B, l);
+      int D01 = GetTriangle(A, i);
+      int D12 = C;
+
+      int q; 
+    
+      q = NeighbourReference(A, i);
+      if (q>=0)
+      {
+         SetTriangle(GetTriangle(A, i), q, D);
+      }
+      q = NeighbourReference(A, j);
+      if (q>=0)
+      {    
+         SetTriangle(GetTriangle(A, j), q, C);
+      }
+      q = NeighbourReference(B, k);
+      if (q>=0)
+      {
+         SetTriangle(GetTriangle(B, k), q, C);
+      }
+      q = NeighbourReference(B, l);
+      if (q>=0)
+      {
+         SetTriangle(GetTriangle(B, l), q, D);
+      }
+
+      SetTriangle(C, 0, C01);
+      SetTriangle(C, 1, C12);
+      SetTriangle(C, 2, C20);
+      SetTriangle(D, 0, D01);
+      SetTriangle(D, 1, D12);
+      SetTriangle(D, 2, D20);
+
+      SetVertex(C, 0, P[0]);
+      SetVertex(C, 1, P[1]);
+      SetVertex(C, 2, P[3]);
+      SetVertex(D, 0, P[2]);
+      SetVertex(D, 1, P[3]);
+      SetVertex(D, 2, P[1]);
+
+      // Degenerate cases are allowed for point removal, the ccw test
+      // of the new triangles is done in LegalizeEdges.
+
+      Cret = C;
+      Dret = D;
+
+      return true;
+   }
+
+   //--------------------------------------------------------------------------
+
+   int DelaunayMesh::GetOppositeVertex(int nTri, int t) const
+   {
+      int B = GetTriangle(nTri, t);
+      if (B == -1)
+      {
+         return -1;
+      }
+
+      int NRefB = NeighbourReference(nTri, t);
+      return GetVertex(B, (NRefB+2)%3);
+   }
+
+   //--------------------------------------------------------------------------
+
+   void DelaunayMesh::LegalizeEdges(int nTri, int t)
+   {
+      if (nTri == -1 || t<0)
+         return;
+
+      int P[4];
+
+      P[0] = GetVertex(nTri, t);
+      P[1] = GetOppositeVertex(nTri, t);
+      P[2] = GetVertex(nTri, (t+1)%3);
+      P[3] = GetVertex(nTri, (t+2)%3);
+
+      if (P[1] == -1)
+      {
+         return; // there is no opposite vertex...
+      }
+
+      // quadliteral must be convex!
+      if (!_IsConvex(P, 4))
+      {
+        return;
+      }
+
+      if (weight(P[1]) == -1)
+      {
+         return;
+      }
+
+      if (InCircle(P[0], P[2], P[3], P[1]))
+      {
+         if (_IsCollinear(P,4))
+         {
+            return;
+         }
+         else
+         {
+            int C, D;
+            if (FlipEdge(nTri, t, C, D))
+            {
+               assert(IsCCW(C));
+               assert(IsCCW(D));
+               LegalizeEdges(C, 0);
+               LegalizeEdges(D, 2);
+            }
+         }
+      }
+   }
+
+   //--------------------------------------------------------------------------
+   bool DelaunayMesh::_IsCollinear(const int p[], int n) const
+   {
+      if (n < 3)
+      {
+         return false; // not a polygon!
+      }
+
+      for (int i=0;i<n;i++)
+      {
+         double v = ccw(p[i%n], p[(i+1)%n], p[(i+2)%n]);
+         if (v<=DBL_EPSILON) 
+            return true;
+      }
+
+      return false;
+   }
+
+   //------------------------------------------------------------------------
+
+   bool DelaunayMesh::_IsConvex(const int p[], int n) const
+   {
+      int i,j,k;
+      int flag = 0;
+      double z;
+
+      if (n < 3)
+      {
+         return false; // not a polygon!
+      }
+
+      for (i=0;i<n;i++) 
+      {
+         j = (i + 1) % n;
+         k = (i + 2) % n;
+         z  = (_vX[p[j]] - _vX[p[i]]) * (_vY[p[k]] - _vY[p[j]]);
+         z -= (_vY[p[j]] - _vY[p[i]]) * (_vX[p[k]] - _vX[p[j]]);
+         if (z < 0)
+            flag |= 1;
+         else if (z > 0)
+            flag |= 2;
+         if (flag == 3)
+            return false; // concave!
+      }
+
+      if (flag != 0)
+      {
+         return true;
+      }
+      else
+      {
+         return false; // collinear (this should never happen!)
+      }
+   }
+
+   //--------------------------------------------------------------------------
+   // Test if triangle is correct. (topologic)
+   // This is for debug reasons and to ensure stability!
+   void DelaunayMesh::TestTriangle(int nTri) const
+   {
+      if (nTri == -1)
+      {
+         return;
+      }
+
+      int nNeighbour0 = GetTriangle(nTri, 0);
+      int nNeighbour1 = GetTriangle(nTri, 1);
+      int nNeighbour2 = GetTriangle(nTri, 2);
+
+      int NR0 = NeighbourReference(nTri, 0);
+      int NR1 = NeighbourReference(nTri, 1);
+      int NR2 = NeighbourReference(nTri, 2);
+
+      if (nNeighbour0 != -1)
+      {
+         assert(GetTriangle(nNeighbour0, NR0) == nTri);
+         assert(GetVertex(nNeighbour0, (NR0+0)%3) == GetVertex(nTri, 1));
+         assert(GetVertex(nNeighbour0, (NR0+1)%3) == GetVertex(nTri, 0));
+      }
+      if (nNeighbour1 != -1)
+      {
+         assert(GetTriangle(nNeighbour1, NR1) == nTri);
+         assert(GetVertex(nNeighbour1, (NR1+0)%3) == GetVertex(nTri, 2));
+         assert(GetVertex(nNeighbour1, (NR1+1)%3) == GetVertex(nTri, 1));
+      }
+      if (nNeighbour2 != -1)
+      {
+         assert(GetTriangle(nNeighbour2, NR2) == nTri);
+         assert(GetVertex(nNeighbour2, (NR2+0)%3) == GetVertex(nTri, 0));
+         assert(GetVertex(nNeighbour2, (NR2+1)%3) == GetVertex(nTri, 2));
+      }
+   }
+
+   //--------------------------------------------------------------------------
+
+} // namespace math
@@ -0,0 +1,196 @@
+/*******************************************************************************
+#      ____               __          __  _      _____ _       _               #
+#     / __ \              \ \        / / | |    / ____| |     | |              #
+#    | |  | |_ __   ___ _ __ \  /\  / /__| |__ | |  __| | ___ | |__   ___      #
+#    | |  | | '_ \ / _ \ '_ \ \/  \/ / _ \ '_ \| | |_ | |/ _ \| '_ \ / _ \     #
+#    | |__| | |_) |  __/ | | \  /\  /  __/ |_) | |__| | | (_) | |_) |  __/     #
+#     \____/| .__/ \___|_| |_|\/  \/ \___|_.__/ \_____|_|\___/|_.__/ \___|     #
+#           | |                                                                #
+#           |_|                                                                #
+#                                                                              #
+#                                (c) 2011 by                                   #
+#           University of Applied Sciences Northwestern Switzerland            #
+#                     Institute of Geomatics Engineering                       #
+#                           martin.christen@fhnw.ch                            #
+********************************************************************************
+*     Licensed under MIT License. Read the file LICENSE for more information   *
+*******************************************************************************/
+
+#ifndef DELAUNAY_MESH_H
+#define DELAUNAY_MESH_H
+
+#include "og.h"
+#include "math/ElevationPoint.h"
+#include "Predicates.h"
+#include <vector>
+
+namespace math
+{
+   //--------------------------------------------------------------------------
+   // Triangle <-> Point Relation
+   enum ePointTriangleRelation
+   {
+      PointTriangle_Invalid,  // Triangle is invalid
+      PointTriangle_Outside,  // Point is outside triangle
+      PointTriangle_Inside,   // Point is inside triangle
+      PointTriangle_Edge0,    // Point is on edge 0
+      PointTriangle_Edge1,    // Point is on edge 1
+      PointTriangle_Edge2,    // Point is on edge 2
+      PointTriangle_Vertex0,  // Point lies on vertex 0
+      PointTriangle_Vertex1,  // Point lies on vertex 1
+      PointTriangle_Vertex2,  // Point lies on vertex 2
+   };
+
+   //--------------------------------------------------------------------------
+
+   //! \brief Index based mesh of a triangulation.
+   //! Vertices and triangles are referenced by their index, -1 means "no vertex" or
+   //! "no triangle". Vertex attributes are stored as structure of arrays, so the
+   //! predicates only touch the coordinates. A triangle stores 3 vertex indices (ccw),
+   //! 3 neighbour indices and its position in the location structure (28 bytes).
+   //! Freed vertices and triangles are recycled, Clear() removes everything at once.
+   //! A mesh is not thread safe: it belongs to one triangulation.
+   class OPENGLOBE_API DelaunayMesh
+   {
+   public:
+      DelaunayMesh();
+      ~DelaunayMesh();
+
+      //! Remove all vertices and triangles (the memory is kept for reuse).
+      void Clear();
+
+      //! Reserve memory for nVertices additional vertices and the triangles they create.
+      void Reserve(int nVertices);
+
+      //-----------------------------------------------------------------------
+      // Vertices
+
+      //! Add vertex, returns its index.
+      int AddVertex(double x, double y, double elevation = 0.0, double weight = 0.0);
+
+      //! Add vertex, returns its index.
+      int AddVertex(const ElevationPoint& pt);
+
+      //! Free vertex, the index is recycled. The vertex must not be used by a triangle anymore.
+      void FreeVertex(int nVertex);
+
+      double x(int nVertex) const { return _vX[nVertex]; }
+      double y(int nVertex) const { return _vY[nVertex]; }
+      double elevation(int nVertex) const { return _vElevation[nVertex]; }
+      double weight(int nVertex) const { return _vWeight[nVertex]; }
+      double error(int nVertex) const { return _vError[nVertex]; }
+
+      void SetWeight(int nVertex, double weight) { _vWeight[nVertex] = weight; }
+      void SetError(int nVertex, double error) { _vError[nVertex] = error; }
+
+      //! Retrieve copy of all attributes of vertex
+      ElevationPoint GetElevationPoint(int nVertex) const;
+
+      void SetId(int nVertex, int nId) { _vId[nVertex] = nId; }
+      int  GetId(int nVertex) const { return _vId[nVertex]; }
+
+      //! Set id of all vertices to -1
+      void ResetVertexIds();
+
+      // position in DelaunayVertexHeap (-1 if not in heap)
+      void SetHeapIndex(int nVertex, int nHeapIndex) { _vHeapIndex[nVertex] = nHeapIndex; }
+      int  GetHeapIndex(int nVertex) const { return _vHeapIndex[nVertex]; }
+
+      //-----------------------------------------------------------------------
+      // Triangles
+
+      //! Add triangle without vertices and neighbours, returns its index.
+      int AddTriangle();
+
+      //! Free triangle, the index is recycled.
+      void FreeTriangle(int nTri);
+
+      //! Set Vertex 0,1,2. (counterclockwise)
+      void SetVertex(int nTri, int v, int nVertex) { _vTriVertex[3*nTri+v] = nVertex; }
+
+      //! Retrieve Vertex 0,1,2
+      int GetVertex(int nTri, int v) const { return _vTriVertex[3*nTri+v]; }
+
+      //! Set Triangle 0,1,2, where 
+      //!     0 is triangle at edge 0-1
+      //!     1 is triangle at edge 1-2
+      //!     2 is triangle at edge 2-0
+      void SetTriangle(int nTri, int t, int nNeighbour) { _vTriNeighbour[3*nTri+t] = nNeighbour; }
+
+      //! Retrieve Triangle 0,1,2 (see SetTriangle)
+      int GetTriangle(int nTri, int t) const { return _vTriNeighbour[3*nTri+t]; }
+
+      //! Position of the triangle in the location structure (-1: not in location structure)
+      void SetLocationIndex(int nTri, int nIndex) { _vTriLocation[nTri] = nIndex; }
+      int GetLocationIndex(int nTri) const { return _vTriLocation[nTri]; }
+
+      //! Returns the Edge (Triangle) number of the neighbour triangle t=[0,1,2]
+      //! pointing to this triangle. Returns -1 if there is no neighbour at t.
+      int NeighbourReference(int nTri, int t) const;
+
+      //! Flip Edge with triangle neighbour t=[0,1,2]
+      //! returns true if edge is actually flipped
+      //! C and D will contain the new triangles (nTri and its neighbour are reused).
+      bool FlipEdge(int nTri, int t, int& C, int& D);
+
+      //! Retrieve opposite ("non shared") vertex of neighbour triangle in direction t.
+      int GetOppositeVertex(int nTri, int t) const;
+
+      //! Returns true if triangle is a supersimplex triangle
+      bool IsSuperSimplex(int nTri) const;
+
+      //! Returns true if triangle is counterclockwise!
+      //! This function is used for testing only because triangles must always be ccw!
+      bool IsCCW(int nTri) const;
+
+      //! Legalize edges of a Triangle
+      void LegalizeEdges(int nTri, int t);
+
+      //! Test triangle integrity (ccw, neighbour relations, ...)
+      void TestTriangle(int nTri) const;
+
+      //! Get Point Triangle Relation using robust arithmetic (double precision).
+      //! If the point is on an edge, x and y are moved onto the edge.
+      ePointTriangleRelation GetPointTriangleRelationRobust(double& x, double& y, int nTri, double epsilon) const;
+
+      //-----------------------------------------------------------------------
+      // Predicates
+
+      double ccw(int P, int A, int B) const { return math::ccw(_vX[P], _vY[P], _vX[A], _vY[A], _vX[B], _vY[B]); }
+      bool InCircle(int A, int B, int C, int D) const { return InCircleValue(A, B, C, D) > 0; }
+      double InCircleValue(int A, int B, int C, int D) const { return math::InCircleValue(_vX[A], _vY[A], _vX[B], _vY[B], _vX[C], _vY[C], _vX[D], _vY[D]); }
+
+      //-----------------------------------------------------------------------
+
+      int GetNumVertices() const { return (int)(_vX.size() - _vFreeVertices.size()); }
+      int GetNumTriangles() const { return (int)(_vTriLocation.size() - _vFreeTriangles.size()); }
+
+      double GetMemory() const; // return occupied memory in MB
+
+   private:
+      bool _IsConvex(const int p[], int numPts) const;
+      bool _IsCollinear(const int p[], int numPts) const;
+
+      // vertices
+      std::vector<double>  _vX;
+      std::vector<double>  _vY;
+      std::vector<double>  _vElevation;
+      std::vector<double>  _vWeight;
+      std::vector<double>  _vError;
+      std::vector<int>     _vId;
+      std::vector<int>     _vHeapIndex;
+      std::vector<int>     _vFreeVertices;
+
+      // triangles
+      std::vector<int>     _vTriVertex;      // 3 vertices per triangle
+      std::vector<int>     _vTriNeighbour;   // 3 neighbours per triangle
+      std::vector<int>     _vTriLocation;
+      std::vector<int>     _vFreeTriangles;
+
+      DelaunayMesh(const DelaunayMesh&);
+      DelaunayMesh& operator=(const DelaunayMesh&);
+   };
+}
+
+
+#endif
@@ -17,11 +17,11 @@
 *******************************************************************************/
 
 #include "DelaunayTriangulation.h"
-#include "DelaunayMemoryManager.h"
 #include "math/mathutils.h"
 #include <float.h>
 #include <cassert>
 #include <set>
+#include <algorithm>
 #include <list>
 #include <iostream>
 #include <boost/bind.hpp>
@@ -32,7 +32,7 @@ namespace math
    //--------------------------------------------------------------------------
 
    DelaunayTriangulation::DelaunayTriangulation(double xmin, double ymin, double xmax, double ymax, EDelaunayLocationAlgorithms eAlgorithm)
-      : _xmin(xmin), _ymin(ymin), _xmax(xmax), _ymax(ymax), _pStartTriangle(0), _eLocationAlgorithm(eAlgorithm)
+      : _nStartTriangle(-1), _xmin(xmin), _ymin(ymin), _xmax(xmax), _ymax(ymax), _eLocationAlgorithm(eAlgorithm), _oErrorHeap(&_oMesh)
    {
       assert(_xmin<_xmax);
       assert(_ymin<_ymax);
@@ -46,17 +46,7 @@ namespace math
 
    DelaunayTriangulation::~DelaunayTriangulation()
    {
-      Clear();
-      if (_pStartTriangle)
-      {
-         //std::cout << "<b>Removing Triangle</b>\n";
-         _qLocationStructure->DeleteMemory(_pStartTriangle);
-
-         // This assertion is only valid when one instance of DelaunayTriangulation exists!
-         //assert(DelaunayMemoryManager::GetNumTriangles() == 0);
-         //assert(DelaunayMemoryManager::GetNumVertices() == 0);
-
-      }
+      _ReleaseMemory();
    }
 
    //--------------------------------------------------------------------------
@@ -75,15 +65,15 @@ namespace math
       double Ax = Cx-(Cy-My+r)*(_xmin-Cx)/(_ymax-Cy);
 
       
-      DelaunayVertex* A = DelaunayMemoryManager::AllocVertex(Ax,Ay,0,-1);
-      DelaunayVertex* B = DelaunayMemoryManager::AllocVertex(Bx,By,0,-1);
-      DelaunayVertex* C = DelaunayMemoryManager::AllocVertex(Cx,Cy,0,-1);
+      int A = _oMesh.AddVertex(Ax,Ay,0,-1);
+      int B = _oMesh.AddVertex(Bx,By,0,-1);
+      int C = _oMesh.AddVertex(Cx,Cy,0,-1);
 
-      _pStartTriangle = DelaunayMemoryManager::AllocTriangle();
+      _nStartTriangle = _oMesh.AddTriangle();
 
-      _pStartTriangle->SetVertex(0, A);
-      _pStartTriangle->SetVertex(1, B);
-      _pStartTriangle->SetVertex(2, C);
+      _oMesh.SetVertex(_nStartTriangle, 0, A);
+      _oMesh.SetVertex(_nStartTriangle, 1, B);
+      _oMesh.SetVertex(_nStartTriangle, 2, C);
 
       double xmax, ymax, xmin, ymin;
       xmax = ymax = -1e20;
@@ -102,15 +92,10 @@ namespace math
       ymax = math::Max<double>(By, ymax);
       ymax = math::Max<double>(Cy, ymax);
 
-      _qLocationStructure = IDelaunayLocationStructure::CreateLocationStructure(xmin, ymin, xmax, ymax, _eLocationAlgorithm);
+      _qLocationStructure = IDelaunayLocationStructure::CreateLocationStructure(&_oMesh, xmin, ymin, xmax, ymax, _eLocationAlgorithm);
       if (_qLocationStructure)
       {
-         _qLocationStructure->AddTriangle(_pStartTriangle);
-      }
-
-      if (!_pStartTriangle->IsCCW())
-      {
-         //assert(false);
+         _qLocationStructure->AddTriangle(_nStartTriangle);
       }
 
       _bError = false;
@@ -118,32 +103,37 @@ namespace math
 
    //--------------------------------------------------------------------------
 
-   void DelaunayTriangulation::_CollectTriangle(DelaunayTriangle* pTri)
+   void DelaunayTriangulation::_CollectTriangle(int nTri)
    {
-      _vecTriangles.push_back(pTri);
+      _vecTriangles.push_back(nTri);
    }
 
    //--------------------------------------------------------------------------
 
    void DelaunayTriangulation::Clear()
    {
-      if (_pStartTriangle)
+      if (_nStartTriangle != -1)
       {
-         _vecTriangles.clear();
-         _qLocationStructure->Traverse(boost::bind(&DelaunayTriangulation::_CollectTriangle, this, _1));
-
-         for (size_t i=0;i<_vecTriangles.size();i++)
-         {
-            _qLocationStructure->DeleteMemory(_vecTriangles[i]);
-         }
-
-         _pStartTriangle = 0;
+         _ReleaseMemory();
          _Init();
       }
    }
 
    //--------------------------------------------------------------------------
 
+   void DelaunayTriangulation::_ReleaseMemory()
+   {
+      // All vertices and triangles are stored in the mesh of this
+      // triangulation, so they can be released at once without traversal.
+      _InvalidateErrors();
+      _vecTriangles.clear();
+      _qLocationStructure.reset();
+      _nStartTriangle = -1;
+      _oMesh.Clear();
+   }
+
+   //--------------------------------------------------------------------------
+
  
 
 
@@ -167,16 +157,16 @@ namespace math
       {
          query_result = EQ_INTERIOR;
          ePointTriangleRelation relation;
-         DelaunayTriangle* pTri = _qLocationStructure->GetTriangleAt(x,y,relation);
+         int nTri = _qLocationStructure->GetTriangleAt(x,y,relation);
 
-         if (pTri && !pTri->IsSuperSimplex())
+         if (nTri != -1 && !_oMesh.IsSuperSimplex(nTri))
          {
             ElevationPoint P;
             P.x = x; P.y = y; P.elevation = 0.0;
 
-            ElevationPoint A = pTri->GetVertex(0)->GetElevationPointCopy();
-            ElevationPoint B = pTri->GetVertex(1)->GetElevationPointCopy();
-            ElevationPoint C = pTri->GetVertex(2)->GetElevationPointCopy();
+            ElevationPoint A = _oMesh.GetElevationPoint(_oMesh.GetVertex(nTri, 0));
+            ElevationPoint B = _oMesh.GetElevationPoint(_oMesh.GetVertex(nTri, 1));
+            ElevationPoint C = _oMesh.GetElevationPoint(_oMesh.GetVertex(nTri, 2));
 
             double elva = A.elevation;
             double elvb = B.elevation;
@@ -210,11 +200,11 @@ namespace math
                }
                break;
             case PointTriangle_Vertex0:  // Point lies on vertex 0
-               return pTri->GetVertex(0)->elevation();
+               return _oMesh.elevation(_oMesh.GetVertex(nTri, 0));
             case PointTriangle_Vertex1:  // Point lies on vertex 1
-               return pTri->GetVertex(1)->elevation();
+               return _oMesh.elevation(_oMesh.GetVertex(nTri, 1));
             case PointTriangle_Vertex2:  // Point lies on vertex 2
-               return pTri->GetVertex(2)->elevation();
+               return _oMesh.elevation(_oMesh.GetVertex(nTri, 2));
             default: // outside triangle / invalid triangle
                query_result = EQ_EXTERIOR;
                return 0.0;
@@ -241,61 +231,158 @@ namespace math
       if (pt.x<=_xmax && pt.x>=_xmin &&
          pt.y<=_ymax && pt.y>=_ymin)
       {
-         DelaunayVertex* pNewVertex = DelaunayMemoryManager::AllocVertex(pt);
-         _pStartTriangle = _qLocationStructure->InsertVertex(pNewVertex, _pStartTriangle);
-         _bError = false; // inserting a point invalidates errors!
+         _InvalidateErrors(); // inserting a point invalidates errors!
+         int nNewVertex = _oMesh.AddVertex(pt);
+         _nStartTriangle = _qLocationStructure->InsertVertex(nNewVertex, _nStartTriangle);
       }
    }
 
 
-   void DelaunayTriangulation::_InsertPointSetId(const ElevationPoint& pt, int id)
+   namespace internal
    {
-      if (pt.x<=_xmax && pt.x>=_xmin &&
-         pt.y<=_ymax && pt.y>=_ymin)
+      // Position of (x,y) on a Hilbert curve covering [0,65535]x[0,65535].
+      inline unsigned int _HilbertIndex(unsigned int x, unsigned int y)
+      {
+         const unsigned int n = 1u<<16;
+         unsigned int d = 0;
+
+         for (unsigned int s = n/2; s>0; s/=2)
+         {
+            unsigned int rx = (x & s) ? 1 : 0;
+            unsigned int ry = (y & s) ? 1 : 0;
+            d += s * s * ((3 * rx) ^ ry);
+
+            if (ry == 0)
+            {
+               if (rx == 1)
+               {
+                  x = n-1 - x;
+                  y = n-1 - y;
+               }
+               std::swap(x, y);
+            }
+         }
+
+         return d;
+      }
+
+      //-----------------------------------------------------------------------
+      // Calculate biased randomized insertion order (BRIO) of all points inside
+      // the specified rectangle: the (shuffled) points are split into rounds
+      // of doubling size and every round is sorted along a Hilbert curve.
+      // A fixed seed is used, so the triangulation is reproducible.
+      inline void _BrioOrder(const std::vector<ElevationPoint>& vPoints, double xmin, double ymin, double xmax, double ymax, std::vector<size_t>& vOrder)
+      {
+         const size_t nMinRound = 64;
+         std::vector<std::pair<unsigned int, size_t> > vKeys;
+         vKeys.reserve(vPoints.size());
+
+         double sx = 65535.0 / (xmax-xmin);
+         double sy = 65535.0 / (ymax-ymin);
+
+         for (size_t i=0;i<vPoints.size();i++)
+         {
+            const ElevationPoint& pt = vPoints[i];
+            if (pt.x<=xmax && pt.x>=xmin &&
+               pt.y<=ymax && pt.y>=ymin)
+            {
+               unsigned int hx = (unsigned int)((pt.x-xmin)*sx);
+               unsigned int hy = (unsigned int)((pt.y-ymin)*sy);
+               vKeys.push_back(std::make_pair(_HilbertIndex(hx, hy), i));
+            }
+         }
+
+         // shuffle (linear congruential generator, independent of rand())
+         unsigned int seed = 12345;
+         for (size_t i=vKeys.size();i>1;i--)
+         {
+            seed = seed * 1664525u + 1013904223u;
+            std::swap(vKeys[i-1], vKeys[(size_t)(seed>>8) % i]);
+         }
+
+         // rounds: [0, ..., end/4), [end/4, end/2), [end/2, end)
+         size_t end = vKeys.size();
+         while (end > 0)
+         {
+            size_t begin = (end > nMinRound) ? end/2 : 0;
+            std::sort(vKeys.begin()+begin, vKeys.begin()+end);
+            end = begin;
+         }
+
+         vOrder.resize(vKeys.size());
+         for (size_t i=0;i<vKeys.size();i++)
+         {
+            vOrder[i] = vKeys[i].second;
+         }
+      }
+   }
+
+   //--------------------------------------------------------------------------
+
+   void DelaunayTriangulation::InsertPoints(const std::vector<ElevationPoint>& vPoints)
+   {
+      std::vector<size_t> vOrder;
+      internal::_BrioOrder(vPoints, _xmin, _ymin, _xmax, _ymax, vOrder);
+
+      if (vOrder.size() == 0)
+      {
+         return;
+      }
+
+      _InvalidateErrors(); // inserting a point invalidates errors!
+      _oMesh.Reserve((int)vOrder.size());
+
+      // the first point is located using the location structure, all other
+      // points are located by walking from the previously inserted triangle.
+      int nTri = -1;
+
+      for (size_t i=0;i<vOrder.size();i++)
       {
-         DelaunayVertex* pNewVertex = DelaunayMemoryManager::AllocVertex(pt);
-         pNewVertex->SetId(id);
-         _pStartTriangle = _qLocationStructure->InsertVertex(pNewVertex, _pStartTriangle);
-         _bError = false; // inserting a point invalidates errors!
+         int nNewVertex = _oMesh.AddVertex(vPoints[vOrder[i]]);
+         nTri = _qLocationStructure->InsertVertex(nNewVertex, nTri, true);
+      }
+
+      if (nTri != -1)
+      {
+         _nStartTriangle = nTri;
       }
    }
 
    //--------------------------------------------------------------------------
 
-   void DelaunayTriangulation::_ResetVertexId(DelaunayTriangle* pTri)
+   void DelaunayTriangulation::_InsertPointSetId(const ElevationPoint& pt, int id)
    {
-      assert(pTri);
-      assert(pTri->GetVertex(0));
-      assert(pTri->GetVertex(1));
-      assert(pTri->GetVertex(2));
-
-      pTri->GetVertex(0)->SetId(-1);
-      pTri->GetVertex(1)->SetId(-1);
-      pTri->GetVertex(2)->SetId(-1);
+      if (pt.x<=_xmax && pt.x>=_xmin &&
+         pt.y<=_ymax && pt.y>=_ymin)
+      {
+         _InvalidateErrors(); // inserting a point invalidates errors!
+         int nNewVertex = _oMesh.AddVertex(pt);
+         _oMesh.SetId(nNewVertex, id);
+         _nStartTriangle = _qLocationStructure->InsertVertex(nNewVertex, _nStartTriangle);
+      }
    }
 
    //--------------------------------------------------------------------------
 
-   void DelaunayTriangulation::_CollectElevationPoints(DelaunayTriangle* pTri)
+   void DelaunayTriangulation::_CollectElevationPoints(int nTri)
    {
-      assert(pTri);
-      assert(pTri->GetVertex(0));
-      assert(pTri->GetVertex(1));
-      assert(pTri->GetVertex(2));
+      assert(nTri != -1);
 
       // ignore supersimplex triangles.
-      if (!pTri->IsSuperSimplex())
+      if (!_oMesh.IsSuperSimplex(nTri))
       {
          for (int v=0;v<3;v++)
          {
-            if (pTri->GetVertex(v)->GetId() == -1)
+            int nVertex = _oMesh.GetVertex(nTri, v);
+
+            if (_oMesh.GetId(nVertex) == -1)
             { 
-               pTri->GetVertex(v)->SetId(_idcnt);
-               _vPts.push_back(pTri->GetVertex(v)->GetElevationPoint());
+               _oMesh.SetId(nVertex, _idcnt);
+               _vPts.push_back(_oMesh.GetElevationPoint(nVertex));
                _idcnt++;
             }
 
-            _vIndex.push_back(pTri->GetVertex(v)->GetId());
+            _vIndex.push_back(_oMesh.GetId(nVertex));
          }
       }
    }
@@ -304,44 +391,37 @@ namespace math
    //--------------------------------------------------------------------------
 
    // before calling this make sure to clear _vCutEdge, _vIndex and _vPts
-   void DelaunayTriangulation::_CollectTriangulationStructure(DelaunayTriangle* pTri)
+   void DelaunayTriangulation::_CollectTriangulationStructure(int nTri)
    {
-      assert(pTri);
-      assert(pTri->GetVertex(0));
-      assert(pTri->GetVertex(1));
-      assert(pTri->GetVertex(2));
+      assert(nTri != -1);
 
       // ignore supersimplex triangles.
-      if (!pTri->IsSuperSimplex())
+      if (!_oMesh.IsSuperSimplex(nTri))
       {
+         int nId[3];
+
          for (int v=0;v<3;v++)
          {
-            if (pTri->GetVertex(v)->GetId() == -1)
+            int nVertex = _oMesh.GetVertex(nTri, v);
+
+            if (_oMesh.GetId(nVertex) == -1)
             { 
-               pTri->GetVertex(v)->SetId(_idcnt);
-               _vPts.push_back(pTri->GetVertex(v)->GetElevationPoint());
+               _oMesh.SetId(nVertex, _idcnt);
+               _vPts.push_back(_oMesh.GetElevationPoint(nVertex));
                _idcnt++;
             }
 
-            _vIndex.push_back(pTri->GetVertex(v)->GetId());
-         }
-
-        
-         if (pTri->GetTriangle(0) == 0)
-         {
-            _vCutEdge.push_back(std::pair<int, int>(pTri->GetVertex(0)->GetId(), pTri->GetVertex(1)->GetId()));
-         }
-
-         if (pTri->GetTriangle(1) == 0)
-         {
-            _vCutEdge.push_back(std::pair<int, int>(pTri->GetVertex(1)->GetId(), pTri->GetVertex(2)->GetId()));
+            nId[v] = _oMesh.GetId(nVertex);
+            _vIndex.push_back(nId[v]);
          }
 
-         if (pTri->GetTriangle(2) == 0)
+         for (int t=0;t<3;t++)
          {
-            _vCutEdge.push_back(std::pair<int, int>(pTri->GetVertex(2)->GetId(), pTri->GetVertex(0)->GetId()));
+            if (_oMesh.GetTriangle(nTri, t) == -1)
+            {
+               _vCutEdge.push_back(std::pair<int, int>(nId[t], nId[(t+1)%3]));
+            }
          }
-
       }
 
    }
@@ -351,10 +431,8 @@ namespace math
    // Retrieve Triangulation as Point / Index List
    void DelaunayTriangulation::GetPointVec(std::vector<ElevationPoint>& vPoints)
    {
-      
-
-      // Reset All Vertices to 0
-      _qLocationStructure->Traverse(boost::bind(&DelaunayTriangulation::_ResetVertexId, this, _1));
+      // Reset All Vertices
+      _oMesh.ResetVertexIds();
 
       _idcnt = 0; _vPts.clear(); _vIndex.clear(); _vCutEdge.clear();
       _qLocationStructure->Traverse(boost::bind(&DelaunayTriangulation::_CollectTriangulationStructure, this, _1));
@@ -380,7 +458,7 @@ namespace math
    }
    //--------------------------------------------------------------------------
 
-   std::vector<DelaunayTriangle*>& DelaunayTriangulation::GetAllTriangles()
+   std::vector<int>& DelaunayTriangulation::GetAllTriangles()
    {
       _vecTriangles.clear();
       _qLocationStructure->Traverse(boost::bind(&DelaunayTriangulation::_CollectTriangle, this, _1));
@@ -390,9 +468,10 @@ namespace math
 
    //--------------------------------------------------------------------------
 
-   void DelaunayTriangulation::DeleteMemory(DelaunayTriangle* pTri)
+   void DelaunayTriangulation::DeleteMemory(int nTri)
    {
-      _qLocationStructure->DeleteMemory(pTri);
+      _InvalidateErrors();
+      _qLocationStructure->DeleteMemory(nTri);
    }
 
    //--------------------------------------------------------------------------
@@ -401,21 +480,18 @@ namespace math
    {
       // Traverse triangulation structure and delete corresponding triangles 
 
-      std::vector<DelaunayTriangle*>& vTri = DelaunayTriangulation::GetAllTriangles();
+      std::vector<int>& vTri = DelaunayTriangulation::GetAllTriangles();
 
-      std::set<DelaunayTriangle*> setDelete;
+      std::set<int> setDelete;
 
       for (size_t i=0;i<vTri.size();i++)
       {
-         DelaunayTriangle* pTri = vTri[i];
-         DelaunayTriangle* pTri0 = pTri->GetTriangle(0);
-         DelaunayTriangle* pTri1 = pTri->GetTriangle(1);
-         DelaunayTriangle* pTri2 = pTri->GetTriangle(2);
+         int nTri = vTri[i];
 
          int A,B,C;
-         A = pTri->GetVertex(0)->GetId();
-         B = pTri->GetVertex(1)->GetId();
-         C = pTri->GetVertex(2)->GetId();
+         A = _oMesh.GetId(_oMesh.GetVertex(nTri, 0));
+         B = _oMesh.GetId(_oMesh.GetVertex(nTri, 1));
+         C = _oMesh.GetId(_oMesh.GetVertex(nTri, 2));
 
          // does this triangle contain a cut edge ?
 
@@ -423,23 +499,29 @@ namespace math
          {
             int start = vCut[c].first;
             int end = vCut[c].second;
+            int nNeighbour = -1;
 
             if (A == start && B == end)
             {
-               setDelete.insert(pTri0);
+               nNeighbour = _oMesh.GetTriangle(nTri, 0);
             }
             else if (B == start && C == end)
             {
-               setDelete.insert(pTri1);
+               nNeighbour = _oMesh.GetTriangle(nTri, 1);
             }
             else if (C == start && A == end)
             {
-               setDelete.insert(pTri2);
+               nNeighbour = _oMesh.GetTriangle(nTri, 2);
+            }
+
+            if (nNeighbour != -1)
+            {
+               setDelete.insert(nNeighbour);
             }
          }
       }
 
-      std::set<DelaunayTriangle*>::iterator it = setDelete.begin();
+      std::set<int>::iterator it = setDelete.begin();
 
       while (it != setDelete.end())
       {
@@ -463,41 +545,41 @@ namespace math
 
    //--------------------------------------------------------------------------
 
-   void DelaunayTriangulation::_ResetVertexErrors(DelaunayTriangle* pTri)
+   void DelaunayTriangulation::_ResetVertexErrors(int nTri)
    {
-      pTri->GetVertex(0)->GetElevationPoint().error = -1.0;
-      pTri->GetVertex(1)->GetElevationPoint().error = -1.0;
-      pTri->GetVertex(2)->GetElevationPoint().error = -1.0;
+      _oMesh.SetError(_oMesh.GetVertex(nTri, 0), -1.0);
+      _oMesh.SetError(_oMesh.GetVertex(nTri, 1), -1.0);
+      _oMesh.SetError(_oMesh.GetVertex(nTri, 2), -1.0);
    }
 
    //--------------------------------------------------------------------------
 
-   void DelaunayTriangulation::_GetCCWVertices(DelaunayTriangle* pTri, int vertex_index, std::vector<DelaunayVertex*>& outputVertices)
+   void DelaunayTriangulation::_GetCCWVertices(int nTri, int vertex_index, std::vector<int>& outputVertices)
    {
       outputVertices.clear();
-      std::list<DelaunayVertex*> lst;
+      std::list<int> lst;
 
-      const DelaunayTriangle* pStartTriangle = pTri;
+      const int nStartTriangle = nTri;
 
       int vtx = vertex_index;
       int triangle_index = (vtx+2)%3;
-      lst.push_front(pTri->GetVertex((vtx+2)%3));
+      lst.push_front(_oMesh.GetVertex(nTri, (vtx+2)%3));
 
-      DelaunayTriangle* A = pTri;
-      DelaunayTriangle* C = pTri->GetTriangle(triangle_index);
+      int A = nTri;
+      int C = _oMesh.GetTriangle(nTri, triangle_index);
 
 
-      while(C && C != pStartTriangle && !C->IsSuperSimplex() && !A->IsSuperSimplex())
+      while(C != -1 && C != nStartTriangle && !_oMesh.IsSuperSimplex(C) && !_oMesh.IsSuperSimplex(A))
       {
-         if (A->GetVertex(vtx) == C->GetVertex(0))
+         if (_oMesh.GetVertex(A, vtx) == _oMesh.GetVertex(C, 0))
          {
             vtx = 0;
          }
-         else if (A->GetVertex(vtx) == C->GetVertex(1))
+         else if (_oMesh.GetVertex(A, vtx) == _oMesh.GetVertex(C, 1))
          {
             vtx = 1;
          }
-         else if (A->GetVertex(vtx) == C->GetVertex(2))
+         else if (_oMesh.GetVertex(A, vtx) == _oMesh.GetVertex(C, 2))
          {
             vtx = 2;
          }
@@ -507,18 +589,18 @@ namespace math
             break;
          }
 
-         lst.push_front(C->GetVertex((vtx+2)%3));
+         lst.push_front(_oMesh.GetVertex(C, (vtx+2)%3));
 
          triangle_index = (vtx+2)%3; 
          A = C;
-         C = C->GetTriangle(triangle_index);
+         C = _oMesh.GetTriangle(C, triangle_index);
       }
 
-      lst.push_back(pTri->GetVertex((vertex_index+1)%3));
+      lst.push_back(_oMesh.GetVertex(nTri, (vertex_index+1)%3));
 
       // ignore non ccw direction!
       // copy result to output
-      std::list<DelaunayVertex*>::iterator it = lst.begin();
+      std::list<int>::iterator it = lst.begin();
       while (it!=lst.end())
       {
          outputVertices.push_back(*it);
@@ -529,32 +611,32 @@ namespace math
 
    //--------------------------------------------------------------------------
 
-   void DelaunayTriangulation::_CreateSurroundingPolygon(DelaunayTriangle* pTri, int vertex_index, std::vector<ElevationPoint>& outputPolygon)
+   void DelaunayTriangulation::_CreateSurroundingPolygon(int nTri, int vertex_index, std::vector<ElevationPoint>& outputPolygon)
    {
       outputPolygon.clear();
       std::list<ElevationPoint> lst;
 
-      const DelaunayTriangle* pStartTriangle = pTri;
+      const int nStartTriangle = nTri;
 
       int vtx = vertex_index;
       int triangle_index = (vtx+2)%3;
-      lst.push_front(pTri->GetVertex((vtx+2)%3)->GetElevationPoint());
+      lst.push_front(_oMesh.GetElevationPoint(_oMesh.GetVertex(nTri, (vtx+2)%3)));
 
-      DelaunayTriangle* A = pTri;
-      DelaunayTriangle* B;
-      DelaunayTriangle* C = pTri->GetTriangle(triangle_index);
+      int A = nTri;
+      int B;
+      int C = _oMesh.GetTriangle(nTri, triangle_index);
 
-      while(C && C != pStartTriangle && !C->IsSuperSimplex() && !A->IsSuperSimplex())
+      while(C != -1 && C != nStartTriangle && !_oMesh.IsSuperSimplex(C) && !_oMesh.IsSuperSimplex(A))
       {
-         if (A->GetVertex(vtx) == C->GetVertex(0))
+         if (_oMesh.GetVertex(A, vtx) == _oMesh.GetVertex(C, 0))
          {
             vtx = 0;
          }
-         else if (A->GetVertex(vtx) == C->GetVertex(1))
+         else if (_oMesh.GetVertex(A, vtx) == _oMesh.GetVertex(C, 1))
          {
             vtx = 1;
          }
-         else if (A->GetVertex(vtx) == C->GetVertex(2))
+         else if (_oMesh.GetVertex(A, vtx) == _oMesh.GetVertex(C, 2))
          {
             vtx = 2;
          }
@@ -564,45 +646,45 @@ namespace math
             break;
          }
 
-         lst.push_front(C->GetVertex((vtx+2)%3)->GetElevationPoint());
+         lst.push_front(_oMesh.GetElevationPoint(_oMesh.GetVertex(C, (vtx+2)%3)));
 
          triangle_index = (vtx+2)%3; 
          A = C;
-         C = C->GetTriangle(triangle_index);
+         C = _oMesh.GetTriangle(C, triangle_index);
       }
 
-      // other direction and only if pTri->GetTriangle(vtx) != pStartTriangle
-      lst.push_back(pTri->GetVertex((vertex_index+1)%3)->GetElevationPoint());
+      // other direction and only if GetTriangle(nTri, vtx) != nStartTriangle
+      lst.push_back(_oMesh.GetElevationPoint(_oMesh.GetVertex(nTri, (vertex_index+1)%3)));
 
-      if (C != pStartTriangle)
+      if (C != nStartTriangle)
       {
          vtx = vertex_index;
          triangle_index = vtx;
 
-         A = pTri;
-         B = pTri->GetTriangle(triangle_index);
+         A = nTri;
+         B = _oMesh.GetTriangle(nTri, triangle_index);
 
-         while(B && B != pStartTriangle && !B->IsSuperSimplex() && !A->IsSuperSimplex())
+         while(B != -1 && B != nStartTriangle && !_oMesh.IsSuperSimplex(B) && !_oMesh.IsSuperSimplex(A))
          {
-            if (A->GetVertex(vtx) == B->GetVertex(0))
+            if (_oMesh.GetVertex(A, vtx) == _oMesh.GetVertex(B, 0))
             {
                vtx = 0;
             }
-            else if (A->GetVertex(vtx) == B->GetVertex(1))
+            else if (_oMesh.GetVertex(A, vtx) == _oMesh.GetVertex(B, 1))
             {
                vtx = 1;
             }
-            else if (A->GetVertex(vtx) == B->GetVertex(2))
+            else if (_oMesh.GetVertex(A, vtx) == _oMesh.GetVertex(B, 2))
             {
                vtx = 2;
             }
 
 
-            lst.push_back(B->GetVertex((vtx+1)%3)->GetElevationPoint());
+            lst.push_back(_oMesh.GetElevationPoint(_oMesh.GetVertex(B, (vtx+1)%3)));
             triangle_index = vtx; 
 
             A = B;
-            B = B->GetTriangle(triangle_index);
+            B = _oMesh.GetTriangle(B, triangle_index);
          }
 
       }
@@ -622,31 +704,33 @@ namespace math
 
    //--------------------------------------------------------------------------
 
-   void DelaunayTriangulation::_CalcVertexErrorsVtx(DelaunayTriangle* pTri, int vtx)
+   void DelaunayTriangulation::_CalcVertexErrorsVtx(int nTri, int vtx)
    {
       assert(vtx>=0 && vtx<=3);
-      assert(pTri);
+      assert(nTri != -1);
 
-      ElevationPoint pt = pTri->GetVertex(vtx)->GetElevationPoint();
+      int nVertex = _oMesh.GetVertex(nTri, vtx);
+      ElevationPoint pt = _oMesh.GetElevationPoint(nVertex);
 
       // corner points always have max error
       if (pt.weight < -2 
-         || pTri->GetVertex((vtx+1)%3)->GetElevationPoint().weight < -2
-         || pTri->GetVertex((vtx+2)%3)->GetElevationPoint().weight < -2)
+         || _oMesh.weight(_oMesh.GetVertex(nTri, (vtx+1)%3)) < -2
+         || _oMesh.weight(_oMesh.GetVertex(nTri, (vtx+2)%3)) < -2)
       {
-         pTri->GetVertex(vtx)->GetElevationPoint().error = DBL_MAX;
+         _oMesh.SetError(nVertex, DBL_MAX);
       }
       else
       {
          boost::shared_ptr<DelaunayTriangulation> qTriangulation;
 
-         if (pTri->GetVertex(vtx)->GetElevationPoint().error <= -1.0)
+         if (pt.error <= -1.0)
          {
             std::vector<ElevationPoint> outputPolygon;
-            _CreateSurroundingPolygon(pTri, vtx, outputPolygon);
+            _CreateSurroundingPolygon(nTri, vtx, outputPolygon);
 
             qTriangulation = boost::shared_ptr<DelaunayTriangulation>(new DelaunayTriangulation(_xmin, _ymin, _xmax, _ymax, _eLocationAlgorithm));
             qTriangulation->SetEpsilon(DBL_EPSILON); // can be removed later
+            qTriangulation->_oMesh.Reserve((int)outputPolygon.size());
 
             for (size_t i=0;i<outputPolygon.size();i++)
             {
@@ -659,19 +743,11 @@ namespace math
             if (query == EQ_INTERIOR)
             {
                double dError = fabs(elv - pt.elevation);
-               pTri->GetVertex(vtx)->GetElevationPoint().error = dError;
-               
-               if (dError < _minError)
-               {
-                  _oVertexMinError.pTri = pTri;
-                  _oVertexMinError.idx0 = vtx;
-                  _minError = dError;
-               }
-               
+               _oMesh.SetError(nVertex, dError);
             }
             else
             {
-               pTri->GetVertex(vtx)->GetElevationPoint().error = DBL_MAX;
+               _oMesh.SetError(nVertex, DBL_MAX);
             }
 
          }
@@ -681,15 +757,15 @@ namespace math
 
    //--------------------------------------------------------------------------
 
-   void DelaunayTriangulation::_CalcVertexErrors(DelaunayTriangle* pTri)
+   void DelaunayTriangulation::_CalcVertexErrors(int nTri)
    {
-      assert(pTri);
+      assert(nTri != -1);
 
-      if (!pTri->IsSuperSimplex()) // ignore supersimplex triangles!
+      if (!_oMesh.IsSuperSimplex(nTri)) // ignore supersimplex triangles!
       {
-         _CalcVertexErrorsVtx(pTri,0);
-         _CalcVertexErrorsVtx(pTri,1);
-         _CalcVertexErrorsVtx(pTri,2);
+         _CalcVertexErrorsVtx(nTri,0);
+         _CalcVertexErrorsVtx(nTri,1);
+         _CalcVertexErrorsVtx(nTri,2);
       }
    }
 
@@ -697,134 +773,253 @@ namespace math
 
    void DelaunayTriangulation::CalculateVertexErrors()
    {
-      _oVertexMinError.pTri = 0;
-      _oVertexMinError.idx0 = -1;
+      _oErrorHeap.Clear();
 
-      _minError = DBL_MAX;
       // Reset Errors:
       _qLocationStructure->Traverse(boost::bind(&DelaunayTriangulation::_ResetVertexErrors, this, _1));
       _qLocationStructure->Traverse(boost::bind(&DelaunayTriangulation::_CalcVertexErrors, this, _1));
+      _qLocationStructure->Traverse(boost::bind(&DelaunayTriangulation::_BuildErrorHeap, this, _1));
    
       _bError = true;
-      //std::cout << "MinError: " << _minError << "\n";
    }
 
    //--------------------------------------------------------------------------
 
-   void DelaunayTriangulation::UpdateVertexErrors(std::vector<DelaunayVertex*>& vVertex)
+   void DelaunayTriangulation::_BuildErrorHeap(int nTri)
+   {
+      if (!_oMesh.IsSuperSimplex(nTri))
+      {
+         for (int i=0;i<3;i++)
+         {
+            _UpdateErrorHeap(_oMesh.GetVertex(nTri, i), nTri);
+         }
+      }
+   }
+
+   //--------------------------------------------------------------------------
+
+   void DelaunayTriangulation::_UpdateErrorHeap(int nVertex, int nTri)
    {
+      double dError = _oMesh.error(nVertex);
+
+      // only vertices with a valid error can be removed
+      if (dError < 0.0 || dError == DBL_MAX)
+      {
+         _oErrorHeap.Remove(nVertex);
+      }
+      else
+      {
+         _oErrorHeap.Push(nVertex, nTri);
+      }
+   }
+
+   //--------------------------------------------------------------------------
 
+   void DelaunayTriangulation::_InvalidateErrors()
+   {
+      // must be called before any vertex is freed, the heap references vertices!
+      _oErrorHeap.Clear();
+      _bError = false;
+   }
+
+   //--------------------------------------------------------------------------
+
+   bool DelaunayTriangulation::_FindVertex(int nVertex, int& nTri, int& idx)
+   {
       ePointTriangleRelation e;
-      DelaunayTriangle* pTri;
-      int idx;
-      
-      for (size_t i=0;i<vVertex.size();i++)
+      idx = -1;
+      nTri = _qLocationStructure->GetTriangleAt(_oMesh.x(nVertex),_oMesh.y(nVertex),e);
+      if (nTri != -1 && !_oMesh.IsSuperSimplex(nTri))
       {
-         idx = -1;
-         pTri = _qLocationStructure->GetTriangleAt(vVertex[i]->x(),vVertex[i]->y(),e);
-         if (pTri && !pTri->IsSuperSimplex())
+         if (_oMesh.GetVertex(nTri, 0) == nVertex)
+            idx = 0;
+         else if (_oMesh.GetVertex(nTri, 1) == nVertex)
+            idx = 1;
+         else if (_oMesh.GetVertex(nTri, 2) == nVertex)
+            idx = 2;
+      }
+
+      return idx != -1;
+   }
+
+   //--------------------------------------------------------------------------
+
+   void DelaunayTriangulation::_LocateVertices(int nStart, std::vector<int>& vVertex, std::vector<STriangleVertex>& vLocation)
+   {
+      // Search incident triangles of the specified vertices, starting at nStart.
+      // Only triangles with an edge between two of the vertices are visited. When the
+      // vertices are the neighbours of a removed vertex this covers the retriangulated
+      // hole and the number of visited triangles only depends on the vertex degree.
+      vLocation.resize(vVertex.size());
+      for (size_t i=0;i<vLocation.size();i++)
+      {
+         vLocation[i].nTri = -1;
+         vLocation[i].idx0 = -1;
+      }
+
+      if (nStart == -1)
+         return;
+
+      std::vector<int> vVisited;
+      std::vector<int> vStack;
+      const size_t maxVisited = 8*vVertex.size()+16;
+      vStack.push_back(nStart);
+
+      while (!vStack.empty() && vVisited.size() < maxVisited)
+      {
+         int nTri = vStack.back();
+         vStack.pop_back();
+
+         if (std::find(vVisited.begin(), vVisited.end(), nTri) != vVisited.end())
+            continue;
+         vVisited.push_back(nTri);
+
+         int nFound = 0;
+         int pos[3];
+         for (int v=0;v<3;v++)
          {
-            if (pTri->GetVertex(0) == vVertex[i])
-               idx = 0;
-            else if (pTri->GetVertex(1) == vVertex[i])
-               idx = 1;
-            else if (pTri->GetVertex(2) == vVertex[i])
-               idx = 2;
-
-            if (idx != -1)
+            pos[v] = -1;
+            for (size_t i=0;i<vVertex.size();i++)
             {
-               _CalcVertexErrorsVtx(pTri,idx);
+               if (vVertex[i] == _oMesh.GetVertex(nTri, v))
+               {
+                  pos[v] = (int)i;
+                  nFound++;
+                  break;
+               }
             }
-            else
+         }
+
+         if (nFound < 2 && nTri != nStart)
+            continue;
+
+         if (!_oMesh.IsSuperSimplex(nTri))
+         {
+            for (int v=0;v<3;v++)
             {
-               assert(false); // vertex not found!! How can this be ??!??
+               if (pos[v] != -1 && vLocation[pos[v]].nTri == -1)
+               {
+                  vLocation[pos[v]].nTri = nTri;
+                  vLocation[pos[v]].idx0 = v;
+               }
             }
          }
 
+         for (int t=0;t<3;t++)
+         {
+            int nNeighbour = _oMesh.GetTriangle(nTri, t);
+            if (nNeighbour != -1)
+            {
+               vStack.push_back(nNeighbour);
+            }
+         }
       }
-      
-      _UpdateMinError();
    }
 
    //--------------------------------------------------------------------------
 
-   void DelaunayTriangulation::_UpdateVertexErrors(DelaunayTriangle* pTri)
+   void DelaunayTriangulation::_UpdateVertexErrors(std::vector<int>& vVertex, int nStart)
    {
-      double dError;
-
-      if (!pTri->IsSuperSimplex())
+      std::vector<STriangleVertex> vLocation;
+      _LocateVertices(nStart, vVertex, vLocation);
+      
+      for (size_t i=0;i<vVertex.size();i++)
       {
-         for (int i=0;i<3;i++)
+         int nTri = vLocation[i].nTri;
+         int idx = vLocation[i].idx0;
+
+         if (nTri != -1 || _FindVertex(vVertex[i], nTri, idx))
          {
-            dError = pTri->GetVertex(i)->GetElevationPoint().error;
-            if (dError < _minError)
-            {
-               _oVertexMinError.pTri = pTri;
-               _oVertexMinError.idx0 = i;
-               _minError = dError;
-            }
+            // the neighbourhood changed: force recalculation of error
+            _oMesh.SetError(vVertex[i], -1.0);
+            _CalcVertexErrorsVtx(nTri,idx);
+            _UpdateErrorHeap(vVertex[i], nTri);
+         }
+         else
+         {
+            // no valid triangle: the stored triangle may be invalid now.
+            _oErrorHeap.Remove(vVertex[i]);
          }
       }
    }
 
    //--------------------------------------------------------------------------
 
-   void DelaunayTriangulation::_UpdateMinError()
+   void DelaunayTriangulation::UpdateVertexErrors(std::vector<int>& vVertex)
    {
-      _minError = DBL_MAX;
-      _qLocationStructure->Traverse(boost::bind(&DelaunayTriangulation::_UpdateVertexErrors, this, _1));    
+      _UpdateVertexErrors(vVertex, -1);
    }
 
    //--------------------------------------------------------------------------
 
-   void DelaunayTriangulation::RemoveLeastErrorVertex()
+   bool DelaunayTriangulation::_RemoveLeastErrorVertex(std::vector<int>& vNeighbours, int& nRemaining)
    {
-      if (_minError == DBL_MAX)
-         return;
-
+      vNeighbours.clear();
+      nRemaining = -1;
 
-      if (_oVertexMinError.pTri)
+      while (!_oErrorHeap.IsEmpty())
       {
-         // GetNeighbourVertices and save in list
-         if (_oVertexMinError.pTri->GetVertex(_oVertexMinError.idx0)->weight() == -3)
+         // The stored triangle is still valid: triangles are only modified when a
+         // vertex is removed and then all its neighbours get a new triangle assigned.
+         int nTri;
+         int nVertex = _oErrorHeap.Pop(nTri);
+         int idx = -1;
+
+         for (int v=0;v<3;v++)
          {
-            //std::cout << "**** FATAL ERROR ****: Removing corner vertex!!\n";
+            if (_oMesh.GetVertex(nTri, v) == nVertex)
+               idx = v;
          }
 
-         _RemoveVertex(_oVertexMinError.pTri, _oVertexMinError.idx0);
-         _oVertexMinError.pTri = 0;
-         _oVertexMinError.idx0 = -1;
+         if (idx != -1 || _FindVertex(nVertex, nTri, idx))
+         {
+            GetCCWVertices(nTri, idx, vNeighbours);
+
+            if (_RemoveVertex(nTri, idx, &nRemaining))
+            {
+               return true;
+            }
+
+            // vertex can't be removed, it stays in triangulation. The neighbourhood
+            // may have changed (edge flips), so the neighbours must still be updated.
+            _oMesh.SetError(nVertex, DBL_MAX);
+            return true;
+         }
       }
 
+      return false;
    }
 
+   //--------------------------------------------------------------------------
+
+   void DelaunayTriangulation::RemoveLeastErrorVertex()
+   {
+      std::vector<int> vVertex;
+      int nRemaining;
+      if (_RemoveLeastErrorVertex(vVertex, nRemaining))
+      {
+         _UpdateVertexErrors(vVertex, nRemaining);
+      }
+   }
 
    //--------------------------------------------------------------------------
 
    int DelaunayTriangulation::Simplify(double epsilon, int maxiterations)
    {
-      std::vector<DelaunayVertex*> vVertex;
+      std::vector<int> vVertex;
+      int nRemaining;
       int rmvsteps = 0;
       if (!_bError)
          CalculateVertexErrors();
 
-       while (_minError <= epsilon && _minError != DBL_MAX && rmvsteps < maxiterations)
+       while (_oErrorHeap.TopError() <= epsilon && rmvsteps < maxiterations)
        {
-          GetCCWVertices(_oVertexMinError.pTri, _oVertexMinError.idx0, vVertex);
-          RemoveLeastErrorVertex(); rmvsteps++;
-          UpdateVertexErrors(vVertex);
+          if (!_RemoveLeastErrorVertex(vVertex, nRemaining))
+             break;
+          rmvsteps++;
+          _UpdateVertexErrors(vVertex, nRemaining);
        }
 
-       /*if (rmvsteps >= maxiterations)
-       {
-          std::cout << "Simplify-Condition: Max Iterations reached!\n";
-       }
-
-       if (_minError > epsilon)
-       {
-          std::cout << "Simplify-Condition: Epsilon condition reached!\n";
-       }*/
-
        return rmvsteps;
 
    }
@@ -832,36 +1027,40 @@ namespace math
    //--------------------------------------------------------------------------
    void DelaunayTriangulation::Reduce(int nPoints)
    {
-      std::vector<DelaunayVertex*> vVertex;
+      std::vector<int> vVertex;
+      int nRemaining;
       int rmvsteps = 0;
       if (!_bError)
          CalculateVertexErrors();
 
-      while (_minError != DBL_MAX && rmvsteps < nPoints)
+      // every step removes the vertex with least error and updates the errors
+      // of its neighbours in the error heap: O(log n) per step.
+      while (rmvsteps < nPoints)
       {
-         GetCCWVertices(_oVertexMinError.pTri, _oVertexMinError.idx0, vVertex);
-         RemoveLeastErrorVertex(); rmvsteps++;
-         UpdateVertexErrors(vVertex);
+         if (!_RemoveLeastErrorVertex(vVertex, nRemaining))
+            break;
+         rmvsteps++;
+         _UpdateVertexErrors(vVertex, nRemaining);
       }
    }
 
    //--------------------------------------------------------------------------
 
-   void DelaunayTriangulation::_GetVertexAt(double x, double y, DelaunayTriangle*& pTri, int& idx)
+   void DelaunayTriangulation::_GetVertexAt(double x, double y, int& nTri, int& idx)
    {
       ePointTriangleRelation e;
-      pTri = _qLocationStructure->GetTriangleAt(x,y,e);
-      if (pTri)
+      nTri = _qLocationStructure->GetTriangleAt(x,y,e);
+      if (nTri != -1)
       {
-         const ElevationPoint& P0 = pTri->GetVertex(0)->GetElevationPoint();
-         const ElevationPoint& P1 = pTri->GetVertex(1)->GetElevationPoint();
-         const ElevationPoint& P2 = pTri->GetVertex(2)->GetElevationPoint();
+         int P0 = _oMesh.GetVertex(nTri, 0);
+         int P1 = _oMesh.GetVertex(nTri, 1);
+         int P2 = _oMesh.GetVertex(nTri, 2);
 
          double dist0, dist1, dist2;
 
-         dist0 = sqrt((P0.x-x)*(P0.x-x)+(P0.y-y)*(P0.y-y));
-         dist1 = sqrt((P1.x-x)*(P1.x-x)+(P1.y-y)*(P1.y-y));
-         dist2 = sqrt((P2.x-x)*(P2.x-x)+(P2.y-y)*(P2.y-y));
+         dist0 = sqrt((_oMesh.x(P0)-x)*(_oMesh.x(P0)-x)+(_oMesh.y(P0)-y)*(_oMesh.y(P0)-y));
+         dist1 = sqrt((_oMesh.x(P1)-x)*(_oMesh.x(P1)-x)+(_oMesh.y(P1)-y)*(_oMesh.y(P1)-y));
+         dist2 = sqrt((_oMesh.x(P2)-x)*(_oMesh.x(P2)-x)+(_oMesh.y(P2)-y)*(_oMesh.y(P2)-y));
 
          if (dist0 <= dist1 && dist0 <= dist2)
          {   
@@ -885,37 +1084,37 @@ namespace math
 
    //--------------------------------------------------------------------------
 
-   void DelaunayTriangulation::GetCCWTriangles(DelaunayTriangle* pTri, int vertex_index, std::vector<STriangleVertex>& outputVertices)
+   void DelaunayTriangulation::GetCCWTriangles(int nTri, int vertex_index, std::vector<STriangleVertex>& outputVertices)
    {
       outputVertices.clear();
       std::list<STriangleVertex> lst;
 
-      const DelaunayTriangle* pStartTriangle = pTri;
+      const int nStartTriangle = nTri;
 
       STriangleVertex oElement;
       int vtx = vertex_index;
       int triangle_index = (vtx+2)%3;
 
-      oElement.pTri = pTri;
+      oElement.nTri = nTri;
       oElement.idx0 = (vertex_index+1)%3;
       lst.push_front(oElement);
 
-      DelaunayTriangle* A = pTri;
-      DelaunayTriangle* B;
-      DelaunayTriangle* C = pTri->GetTriangle(triangle_index);
+      int A = nTri;
+      int B;
+      int C = _oMesh.GetTriangle(nTri, triangle_index);
 
 
-      while(C && C != pStartTriangle)
+      while(C != -1 && C != nStartTriangle)
       {
-         if (A->GetVertex(vtx) == C->GetVertex(0))
+         if (_oMesh.GetVertex(A, vtx) == _oMesh.GetVertex(C, 0))
          {
             vtx = 0;
          }
-         else if (A->GetVertex(vtx) == C->GetVertex(1))
+         else if (_oMesh.GetVertex(A, vtx) == _oMesh.GetVertex(C, 1))
          {
             vtx = 1;
          }
-         else if (A->GetVertex(vtx) == C->GetVertex(2))
+         else if (_oMesh.GetVertex(A, vtx) == _oMesh.GetVertex(C, 2))
          {
             vtx = 2;
          }
@@ -925,47 +1124,47 @@ namespace math
             break;
          }
 
-         oElement.pTri = C;
+         oElement.nTri = C;
          oElement.idx0 = (vtx+1)%3;
          lst.push_front(oElement);
 
          triangle_index = (vtx+2)%3; 
          A = C;
-         C = C->GetTriangle(triangle_index);
+         C = _oMesh.GetTriangle(C, triangle_index);
       }
 
       // move around other side:
 
-      if (C != pStartTriangle)
+      if (C != nStartTriangle)
       {
          vtx = vertex_index;
          triangle_index = vtx;
 
-         A = pTri;
-         B = pTri->GetTriangle(triangle_index);
+         A = nTri;
+         B = _oMesh.GetTriangle(nTri, triangle_index);
 
-         while(B && B != pStartTriangle)
+         while(B != -1 && B != nStartTriangle)
          {
-            if (A->GetVertex(vtx) == B->GetVertex(0))
+            if (_oMesh.GetVertex(A, vtx) == _oMesh.GetVertex(B, 0))
             {
                vtx = 0;
             }
-            else if (A->GetVertex(vtx) == B->GetVertex(1))
+            else if (_oMesh.GetVertex(A, vtx) == _oMesh.GetVertex(B, 1))
             {
                vtx = 1;
             }
-            else if (A->GetVertex(vtx) == B->GetVertex(2))
+            else if (_oMesh.GetVertex(A, vtx) == _oMesh.GetVertex(B, 2))
             {
                vtx = 2;
             }
 
-            oElement.pTri = B;
+            oElement.nTri = B;
             oElement.idx0 = (vtx+1)%3;
             lst.push_back(oElement);
             triangle_index = vtx; 
 
             A = B;
-            B = B->GetTriangle(triangle_index);
+            B = _oMesh.GetTriangle(B, triangle_index);
          }
 
       }
@@ -983,34 +1182,34 @@ namespace math
 
    //--------------------------------------------------------------------------
 
-   void DelaunayTriangulation::GetCCWVertices(DelaunayTriangle* pTri, int vertex_index, std::vector<DelaunayVertex*>& outputVertices)
+   void DelaunayTriangulation::GetCCWVertices(int nTri, int vertex_index, std::vector<int>& outputVertices)
    {
       outputVertices.clear();
-      std::list<DelaunayVertex*> lst;
+      std::list<int> lst;
 
-      const DelaunayTriangle* pStartTriangle = pTri;
+      const int nStartTriangle = nTri;
 
       int vtx = vertex_index;
       int triangle_index = (vtx+2)%3;
 
-      lst.push_front(pTri->GetVertex((vertex_index+1)%3));
+      lst.push_front(_oMesh.GetVertex(nTri, (vertex_index+1)%3));
 
-      DelaunayTriangle* A = pTri;
-      DelaunayTriangle* B;
-      DelaunayTriangle* C = pTri->GetTriangle(triangle_index);
+      int A = nTri;
+      int B;
+      int C = _oMesh.GetTriangle(nTri, triangle_index);
 
 
-      while(C && C != pStartTriangle)
+      while(C != -1 && C != nStartTriangle)
       {
-         if (A->GetVertex(vtx) == C->GetVertex(0))
+         if (_oMesh.GetVertex(A, vtx) == _oMesh.GetVertex(C, 0))
          {
             vtx = 0;
          }
-         else if (A->GetVertex(vtx) == C->GetVertex(1))
+         else if (_oMesh.GetVertex(A, vtx) == _oMesh.GetVertex(C, 1))
          {
             vtx = 1;
          }
-         else if (A->GetVertex(vtx) == C->GetVertex(2))
+         else if (_oMesh.GetVertex(A, vtx) == _oMesh.GetVertex(C, 2))
          {
             vtx = 2;
          }
@@ -1020,43 +1219,43 @@ namespace math
             break;
          }
 
-         lst.push_front(C->GetVertex((vtx+1)%3));
+         lst.push_front(_oMesh.GetVertex(C, (vtx+1)%3));
 
          triangle_index = (vtx+2)%3; 
          A = C;
-         C = C->GetTriangle(triangle_index);
+         C = _oMesh.GetTriangle(C, triangle_index);
       }
 
       // move around other side:
 
-      if (C != pStartTriangle)
+      if (C != nStartTriangle)
       {
          vtx = vertex_index;
          triangle_index = vtx;
 
-         A = pTri;
-         B = pTri->GetTriangle(triangle_index);
+         A = nTri;
+         B = _oMesh.GetTriangle(nTri, triangle_index);
 
-         while(B && B != pStartTriangle)
+         while(B != -1 && B != nStartTriangle)
          {
-            if (A->GetVertex(vtx) == B->GetVertex(0))
+            if (_oMesh.GetVertex(A, vtx) == _oMesh.GetVertex(B, 0))
             {
                vtx = 0;
             }
-            else if (A->GetVertex(vtx) == B->GetVertex(1))
+            else if (_oMesh.GetVertex(A, vtx) == _oMesh.GetVertex(B, 1))
             {
                vtx = 1;
             }
-            else if (A->GetVertex(vtx) == B->GetVertex(2))
+            else if (_oMesh.GetVertex(A, vtx) == _oMesh.GetVertex(B, 2))
             {
                vtx = 2;
             }
 
-            lst.push_back(B->GetVertex((vtx+1)%3));
+            lst.push_back(_oMesh.GetVertex(B, (vtx+1)%3));
             triangle_index = vtx; 
 
             A = B;
-            B = B->GetTriangle(triangle_index);
+            B = _oMesh.GetTriangle(B, triangle_index);
          }
 
       }
@@ -1064,7 +1263,7 @@ namespace math
       std::reverse(lst.begin(), lst.end());
 
       // copy result to output
-      std::list<DelaunayVertex*>::iterator it = lst.begin();
+      std::list<int>::iterator it = lst.begin();
       while (it!=lst.end())
       {
          outputVertices.push_back(*it);
@@ -1074,15 +1273,20 @@ namespace math
 
    //--------------------------------------------------------------------------
 
-   void DelaunayTriangulation::_RemoveVertex(DelaunayTriangle* pTri, int idx)
+   bool DelaunayTriangulation::_RemoveVertex(int nTri, int idx, int* pRemaining)
    {
-      if (pTri && idx>=0 && idx<=3)
+      bool bRemoved = false;
+
+      if (pRemaining)
+         *pRemaining = nTri;
+
+      if (nTri != -1 && idx>=0 && idx<3)
       {
          bool DebugOutput = false;
-         DelaunayVertex* pVertex = pTri->GetVertex(idx); // this is the point P to be removed.
+         int nVertex = _oMesh.GetVertex(nTri, idx); // this is the point P to be removed.
 
          std::vector<STriangleVertex> outputTriangles;
-         GetCCWTriangles(pTri, idx, outputTriangles);
+         GetCCWTriangles(nTri, idx, outputTriangles);
 
          if (outputTriangles.size() < 3 )
          {
@@ -1091,7 +1295,7 @@ namespace math
             // however this can happen in a triangulation with holes. This
             // case is currently not supported!
             //std::cout<< "*Error* Can't remove specified vertex! (Triangulation would be broken.)\n";
-            return;
+            return false;
          }
          else
          {
@@ -1112,22 +1316,16 @@ namespace math
                   while (it != outputTriangles.end() && outputTriangles.size()>3)
                   {
 
-                     DelaunayTriangle* pCurrentTriangle = (*it).pTri;
+                     int nCurrentTriangle = (*it).nTri;
                      int idx0 = (*it).idx0;
                      int idx1 = (idx0+1)%3;
 
 
-                     DelaunayVertex* s0 = pCurrentTriangle->GetVertex(idx0);
-                     DelaunayVertex* s1 = pCurrentTriangle->GetVertex(idx1);
-                     DelaunayVertex* s2 = pCurrentTriangle->GetOppositeVertex(idx1);
-
-                     // for debugging reasons only:
-                     ElevationPoint s0p = s0->GetElevationPoint(); 
-                     ElevationPoint s1p = s1->GetElevationPoint(); 
-                     ElevationPoint s2p = s2->GetElevationPoint(); 
-                     ElevationPoint sP = pVertex->GetElevationPoint();
+                     int s0 = _oMesh.GetVertex(nCurrentTriangle, idx0);
+                     int s1 = _oMesh.GetVertex(nCurrentTriangle, idx1);
+                     int s2 = _oMesh.GetOppositeVertex(nCurrentTriangle, idx1);
 
-                     double ccwpredicate = math::ccw(s0,s1,s2);
+                     double ccwpredicate = _oMesh.ccw(s0,s1,s2);
 
                      /*if (DebugOutput)
                         std::cout << "ccwpredicate0 = " << ccwpredicate << "\n";*/
@@ -1138,7 +1336,7 @@ namespace math
                      }
                      else
                      {
-                        ccwpredicate = math::ccw(s0,s2,pVertex);
+                        ccwpredicate = _oMesh.ccw(s0,s2,nVertex);
                         /*if (DebugOutput)
                            std::cout << "ccwpredicate1 = " << ccwpredicate << "\n";*/
                         if (ccwpredicate<0) // P encloses Triangle ?
@@ -1154,28 +1352,28 @@ namespace math
                            std::vector<STriangleVertex>::iterator it2 = outputTriangles.begin();
                            while (it2 != outputTriangles.end())
                            {     
-                              if ((*it2).pTri != (*it).pTri)
+                              if ((*it2).nTri != (*it).nTri)
                               {
                                  int tidx0 = (*it2).idx0;
                                  int tidx1 = (tidx0+1)%3;
 
-                                 DelaunayVertex* p0 = (*it2).pTri->GetVertex(tidx0);
-                                 DelaunayVertex* p1 = (*it2).pTri->GetVertex(tidx1);
+                                 int p0 = _oMesh.GetVertex((*it2).nTri, tidx0);
+                                 int p1 = _oMesh.GetVertex((*it2).nTri, tidx1);
 
-                                 assert(p0 != pVertex);
-                                 assert(p1 != pVertex);
+                                 assert(p0 != nVertex);
+                                 assert(p1 != nVertex);
                                  
                                  if (p0 != s0 && p0 != s1 && p0 != s2 && 
                                      p1 != s0 && p1 != s1 && p1 != s2)
                                  {
-                                    double circ = math::InCircleValue(s0,s1,s2,p0);
+                                    double circ = _oMesh.InCircleValue(s0,s1,s2,p0);
                                     /*if (DebugOutput)
                                        std::cout << "circ0 = " << circ << "\n";*/
                                     if (circ >= DBL_EPSILON)
                                     {
                                        bCircleTest = false;
                                     }
-                                    circ = math::InCircleValue(s0,s1,s2,p1);
+                                    circ = _oMesh.InCircleValue(s0,s1,s2,p1);
                                     /*if (DebugOutput)
                                        std::cout << "circ1 = " << circ << "\n";*/
                                     if (circ >= DBL_EPSILON)
@@ -1192,10 +1390,9 @@ namespace math
                               // this triangle and (next) are swapped and removed from list.
                               // new (swapped) triangle containing P will be added to list.
 
-                              DelaunayTriangle* C;
-                              DelaunayTriangle* D;
+                              int C, D;
 
-                              if (pCurrentTriangle->FlipEdge(idx1, &C, &D))
+                              if (_oMesh.FlipEdge(nCurrentTriangle, idx1, C, D))
                               {
                                  it = outputTriangles.erase(it);
                                  if (it==outputTriangles.end())
@@ -1206,29 +1403,29 @@ namespace math
 
                                  STriangleVertex newElement;
 
-                                 if (C->GetVertex(0) == pVertex)
+                                 if (_oMesh.GetVertex(C, 0) == nVertex)
                                  {
-                                    newElement.pTri = C; newElement.idx0 = 1;
+                                    newElement.nTri = C; newElement.idx0 = 1;
                                  }
-                                 else if (C->GetVertex(1) == pVertex)
+                                 else if (_oMesh.GetVertex(C, 1) == nVertex)
                                  {
-                                    newElement.pTri = C; newElement.idx0 = 2;
+                                    newElement.nTri = C; newElement.idx0 = 2;
                                  }
-                                 else if (C->GetVertex(2) == pVertex)
+                                 else if (_oMesh.GetVertex(C, 2) == nVertex)
                                  {
-                                    newElement.pTri = C; newElement.idx0 = 0;
+                                    newElement.nTri = C; newElement.idx0 = 0;
                                  }
-                                 else if (D->GetVertex(0) == pVertex)
+                                 else if (_oMesh.GetVertex(D, 0) == nVertex)
                                  {
-                                    newElement.pTri = D; newElement.idx0 = 1;
+                                    newElement.nTri = D; newElement.idx0 = 1;
                                  }
-                                 else if (D->GetVertex(1) == pVertex)
+                                 else if (_oMesh.GetVertex(D, 1) == nVertex)
                                  {
-                                    newElement.pTri = D; newElement.idx0 = 2;
+                                    newElement.nTri = D; newElement.idx0 = 2;
                                  }
-                                 else if (D->GetVertex(2) == pVertex)
+                                 else if (_oMesh.GetVertex(D, 2) == nVertex)
                                  {
-                                    newElement.pTri = D; newElement.idx0 = 0;
+                                    newElement.nTri = D; newElement.idx0 = 0;
                                  }
                                  else
                                  {
@@ -1255,7 +1452,7 @@ namespace math
                if (outputTriangles.size()>3 && num_changes == 0)
                {
                   //std::cout << "<b>*WARNING* Detected infinite loop!</b>\n";
-                  pVertex->GetElevationPoint().error = -0.5;
+                  _oMesh.SetError(nVertex, -0.5);
 
                   if (DebugOutput)
                      break;
@@ -1267,46 +1464,54 @@ namespace math
                // 3 Remaining pairs: Remove 3 Triangles!!
                if (outputTriangles.size() == 3)
                {
-                  STriangleVertex* st0 =  &outputTriangles[0];
-                  STriangleVertex* st1 =  &outputTriangles[1];
-                  STriangleVertex* st2 =  &outputTriangles[2];
+                  const STriangleVertex& st0 = outputTriangles[0];
+                  const STriangleVertex& st1 = outputTriangles[1];
+                  const STriangleVertex& st2 = outputTriangles[2];
 
                   // Create New Triangle
-                  DelaunayTriangle* pNewTriangle = DelaunayMemoryManager::AllocTriangle();
-                  pNewTriangle->SetVertex(0, st0->pTri->GetVertex(st0->idx0));
-                  pNewTriangle->SetVertex(1, st1->pTri->GetVertex(st1->idx0));
-                  pNewTriangle->SetVertex(2, st2->pTri->GetVertex(st2->idx0));
+                  int nNewTriangle = _oMesh.AddTriangle();
+                  _oMesh.SetVertex(nNewTriangle, 0, _oMesh.GetVertex(st0.nTri, st0.idx0));
+                  _oMesh.SetVertex(nNewTriangle, 1, _oMesh.GetVertex(st1.nTri, st1.idx0));
+                  _oMesh.SetVertex(nNewTriangle, 2, _oMesh.GetVertex(st2.nTri, st2.idx0));
+
+
+                  int nNeighbour0 = _oMesh.GetTriangle(st0.nTri, st0.idx0);
+                  int nr0 = _oMesh.NeighbourReference(st0.nTri, st0.idx0);
 
+                  int nNeighbour1 = _oMesh.GetTriangle(st1.nTri, st1.idx0);
+                  int nr1 = _oMesh.NeighbourReference(st1.nTri, st1.idx0);
 
-                  DelaunayTriangle* pNeighbour0 = st0->pTri->GetTriangle(st0->idx0);
-                  int nr0 = st0->pTri->NeighbourReference(st0->idx0);
+                  int nNeighbour2 = _oMesh.GetTriangle(st2.nTri, st2.idx0);
+                  int nr2 = _oMesh.NeighbourReference(st2.nTri, st2.idx0);
 
-                  DelaunayTriangle* pNeighbour1 = st1->pTri->GetTriangle(st1->idx0);
-                  int nr1 = st1->pTri->NeighbourReference(st1->idx0);
+                  _oMesh.SetTriangle(nNewTriangle, 0, nNeighbour0);
+                  _oMesh.SetTriangle(nNewTriangle, 1, nNeighbour1);
+                  _oMesh.SetTriangle(nNewTriangle, 2, nNeighbour2);
 
-                  DelaunayTriangle* pNeighbour2 = st2->pTri->GetTriangle(st2->idx0);
-                  int nr2 = st2->pTri->NeighbourReference(st2->idx0);
+                  _qLocationStructure->DeleteMemory(st0.nTri);
+                  _qLocationStructure->DeleteMemory(st1.nTri);
+                  _qLocationStructure->DeleteMemory(st2.nTri);
 
-                  pNewTriangle->SetTriangle(0, pNeighbour0);
-                  pNewTriangle->SetTriangle(1, pNeighbour1);
-                  pNewTriangle->SetTriangle(2, pNeighbour2);
+                  if (nNeighbour0 != -1) 
+                     _oMesh.SetTriangle(nNeighbour0, nr0, nNewTriangle);
 
-                  _qLocationStructure->DeleteMemory(st0->pTri);
-                  _qLocationStructure->DeleteMemory(st1->pTri);
-                  _qLocationStructure->DeleteMemory(st2->pTri);
+                  if (nNeighbour1 != -1)
+                     _oMesh.SetTriangle(nNeighbour1, nr1, nNewTriangle);
 
-                  if (pNeighbour0) 
-                     pNeighbour0->SetTriangle(nr0, pNewTriangle);
+                  if (nNeighbour2 != -1)
+                     _oMesh.SetTriangle(nNeighbour2, nr2, nNewTriangle);
 
-                  if (pNeighbour1)
-                     pNeighbour1->SetTriangle(nr1, pNewTriangle);
+                  _qLocationStructure->AddTriangle(nNewTriangle);
+                  bRemoved = true;
 
-                  if (pNeighbour2)
-                     pNeighbour2->SetTriangle(nr2, pNewTriangle);
+                  // P is no longer referenced by any triangle
+                  _oErrorHeap.Remove(nVertex);
+                  _oMesh.FreeVertex(nVertex);
 
-                  _qLocationStructure->AddTriangle(pNewTriangle);
+                  if (pRemaining)
+                     *pRemaining = nNewTriangle;
 
-                  //assert(pNewTriangle->IsCCW()); // the mosted hated assertion
+                  //assert(_oMesh.IsCCW(nNewTriangle)); // the mosted hated assertion
                }
 
             } 
@@ -1314,6 +1519,8 @@ namespace math
          }
 
       }
+
+      return bRemoved;
    }
 
    //--------------------------------------------------------------------------
@@ -1321,9 +1528,10 @@ namespace math
    void DelaunayTriangulation::RemoveVertex(double x, double y)
    {
       int idx;
-      DelaunayTriangle* pTri;
-      _GetVertexAt(x,y,pTri,idx);
-      _RemoveVertex(pTri,idx);
+      int nTri;
+      _GetVertexAt(x,y,nTri,idx);
+      _InvalidateErrors();
+      _RemoveVertex(nTri,idx);
    }
 
    //--------------------------------------------------------------------------
@@ -1378,41 +1586,25 @@ namespace math
 
    //---------------------------------------------------------------------------
 
-   void DelaunayTriangulation::_LineTraversal(DelaunayTriangle* pTri)
+   void DelaunayTriangulation::_LineTraversal(int nTri)
    {
       double t;
 
-      DelaunayVertex* pVertex0 = pTri->GetVertex(0);
-      DelaunayVertex* pVertex1 = pTri->GetVertex(1);
-      DelaunayVertex* pVertex2 = pTri->GetVertex(2);
-
       ElevationPoint pt;
 
-      if (math::FindOrientedIntersection(pVertex0->x(), pVertex0->y(), pVertex1->x(), pVertex1->y(), _pt1->x, _pt1->y, _pt2->x, _pt2->y,t))
+      for (int v=0;v<3;v++)
       {
-         pt.x = pVertex0->x() + t * (pVertex1->x() - pVertex0->x());
-         pt.y = pVertex0->y() + t * (pVertex1->y() - pVertex0->y());
-         pt.elevation = pVertex0->elevation() + t * (pVertex1->elevation() - pVertex0->elevation());
-         pt.weight = -2;
-         _vecEdgePoints.push_back(pt);
-      }
+         int A = _oMesh.GetVertex(nTri, v);
+         int B = _oMesh.GetVertex(nTri, (v+1)%3);
 
-      if (math::FindOrientedIntersection(pVertex1->x(), pVertex1->y(), pVertex2->x(), pVertex2->y(), _pt1->x, _pt1->y, _pt2->x, _pt2->y,t))
-      {
-         pt.x = pVertex1->x() + t * (pVertex2->x() - pVertex1->x());
-         pt.y = pVertex1->y() + t * (pVertex2->y() - pVertex1->y());
-         pt.elevation = pVertex1->elevation() + t * (pVertex2->elevation() - pVertex1->elevation());
-         pt.weight = -2;
-         _vecEdgePoints.push_back(pt);
-      }
-
-      if (math::FindOrientedIntersection(pVertex2->x(), pVertex2->y(), pVertex0->x(), pVertex0->y(), _pt1->x, _pt1->y, _pt2->x, _pt2->y,t))
-      {
-         pt.x = pVertex2->x() + t * (pVertex0->x() - pVertex2->x());
-         pt.y = pVertex2->y() + t * (pVertex0->y() - pVertex2->y());
-         pt.elevation = pVertex2->elevation() + t * (pVertex0->elevation() - pVertex2->elevation());
-         pt.weight = -2;
-         _vecEdgePoints.push_back(pt);
+         if (math::FindOrientedIntersection(_oMesh.x(A), _oMesh.y(A), _oMesh.x(B), _oMesh.y(B), _pt1->x, _pt1->y, _pt2->x, _pt2->y,t))
+         {
+            pt.x = _oMesh.x(A) + t * (_oMesh.x(B) - _oMesh.x(A));
+            pt.y = _oMesh.y(A) + t * (_oMesh.y(B) - _oMesh.y(A));
+            pt.elevation = _oMesh.elevation(A) + t * (_oMesh.elevation(B) - _oMesh.elevation(A));
+            pt.weight = -2;
+            _vecEdgePoints.push_back(pt);
+         }
       }
    }
 
@@ -1701,7 +1893,7 @@ namespace math
       _y1 = y1;
 
        // Reset All Vertices to 0
-      _qLocationStructure->Traverse(boost::bind(&DelaunayTriangulation::_ResetVertexId, this, _1));
+      _oMesh.ResetVertexIds();
 
       _qLocationStructure->Traverse(boost::bind(&DelaunayTriangulation::_MiddleTraversal, this, _1));
 
@@ -1767,79 +1959,40 @@ namespace math
 
    //---------------------------------------------------------------------------
 
-   void DelaunayTriangulation::_MiddleTraversal(DelaunayTriangle* pTri)
+   void DelaunayTriangulation::_MiddleTraversal(int nTri)
    {
-      DelaunayVertex* pVertex0 = pTri->GetVertex(0);
-      DelaunayVertex* pVertex1 = pTri->GetVertex(1);
-      DelaunayVertex* pVertex2 = pTri->GetVertex(2);
-
-      if (pVertex0->GetId() == -1)
+      for (int v=0;v<3;v++)
       {
-         pVertex0->SetId(1);
-         if (  pVertex0->x() > _x0 &&
-            pVertex0->x() < _x1 &&
-            pVertex0->y() > _y0 &&
-            pVertex0->y() < _y1)
-         {
-            _vecEdgePoints.push_back(pVertex0->GetElevationPoint());
-         }
-      }
+         int nVertex = _oMesh.GetVertex(nTri, v);
 
-      if (pVertex1->GetId() == -1)
-      {
-         pVertex1->SetId(1);
-         if (  pVertex1->x() > _x0 &&
-            pVertex1->x() < _x1 &&
-            pVertex1->y() > _y0 &&
-            pVertex1->y() < _y1)
+         if (_oMesh.GetId(nVertex) == -1)
          {
-            _vecEdgePoints.push_back(pVertex1->GetElevationPoint());
-         }
-      }
-
-      if (pVertex2->GetId() == -1)
-      {
-         pVertex2->SetId(1);
-         if (  pVertex2->x() > _x0 &&
-            pVertex2->x() < _x1 &&
-            pVertex2->y() > _y0 &&
-            pVertex2->y() < _y1)
-         {
-            _vecEdgePoints.push_back(pVertex2->GetElevationPoint());
+            _oMesh.SetId(nVertex, 1);
+            if (  _oMesh.x(nVertex) > _x0 &&
+               _oMesh.x(nVertex) < _x1 &&
+               _oMesh.y(nVertex) > _y0 &&
+               _oMesh.y(nVertex) < _y1)
+            {
+               _vecEdgePoints.push_back(_oMesh.GetElevationPoint(nVertex));
+            }
          }
       }
    }
 
    //---------------------------------------------------------------------------
-   void DelaunayTriangulation::_SuperSimplexTraversal(DelaunayTriangle* pTri)
+   void DelaunayTriangulation::_SuperSimplexTraversal(int nTri)
    {
-      DelaunayVertex* pVertex0 = pTri->GetVertex(0);
-      DelaunayVertex* pVertex1 = pTri->GetVertex(1);
-      DelaunayVertex* pVertex2 = pTri->GetVertex(2);
-
-
-      if (pVertex0->x() < _x0 ||
-          pVertex0->x() > _x1 ||
-          pVertex0->y() < _y0 ||
-          pVertex0->y() > _y1)
+      for (int v=0;v<3;v++)
       {
-         pVertex0->GetElevationPoint().weight = -1;
-      }
+         int nVertex = _oMesh.GetVertex(nTri, v);
 
-      if (pVertex1->x() < _x0 ||
-          pVertex1->x() > _x1 ||
-          pVertex1->y() < _y0 ||
-          pVertex1->y() > _y1)
-      {
-         pVertex1->GetElevationPoint().weight = -1;
-      }
-
-      if (pVertex2->x() < _x0 ||
-          pVertex2->x() > _x1 ||
-          pVertex2->y() < _y0 ||
-          pVertex2->y() > _y1)
-      {
-         pVertex2->GetElevationPoint().weight = -1;
+         if (_oMesh.x(nVertex) < _x0 ||
+             _oMesh.x(nVertex) > _x1 ||
+             _oMesh.y(nVertex) < _y0 ||
+             _oMesh.y(nVertex) > _y1)
+         {
+            _oMesh.SetWeight(nVertex, -1);
+         }
       }
    }
    //---------------------------------------------------------------------------
@@ -20,8 +20,9 @@
 #define DELAUNAYTRIANGULATION_H
 
 #include "og.h"
-#include "DelaunayTriangle.h"
+#include "DelaunayMesh.h"
 #include "DelaunayLocationStructure.h"
+#include "DelaunayVertexHeap.h"
 #include "math/ElevationPoint.h"
 #include <vector>
 #include <boost/shared_ptr.hpp>
@@ -52,7 +53,7 @@ namespace math
 
    struct STriangleVertex
    {
-      DelaunayTriangle* pTri;
+      int nTri;
       int idx0;
    };
 
@@ -67,6 +68,14 @@ namespace math
       void Clear();  // Clear Triangulation
       void InsertPoint(const ElevationPoint& pt);
 
+      //! Insert a batch of points. The points are inserted in biased randomized insertion
+      //! order (BRIO), every round is sorted along a Hilbert curve and points are located by
+      //! walking from the previously inserted triangle. This is much faster than calling
+      //! InsertPoint for every point of large point sets. The result is equivalent to inserting
+      //! the points one by one up to degenerate configurations: the diagonal chosen for cocircular
+      //! points and the point kept of duplicate points depend on the insertion order.
+      void InsertPoints(const std::vector<ElevationPoint>& vPoints);
+
       //! Retrieve vector Containing all Elevation Points
       void GetPointVec(std::vector<ElevationPoint>& lstElevationPoint);
 
@@ -80,13 +89,16 @@ namespace math
 
       //! Delete a triangle from memory. The delaunay trianglulation still exists, but
       //! the triangle is removed from memory.
-      void DeleteMemory(DelaunayTriangle* pTri);
+      void DeleteMemory(int nTri);
 
-      //! Retrieve list of all triangles. Please note that this list invalidates
+      //! Retrieve list of all triangles (indices into GetMesh()). Please note that this list invalidates
       //! when new points are added to the triangulation or when the triangulation
       //! structure is invalidated.
       //! It is recommended to clear the vector when data is no longer neeed!
-      std::vector<DelaunayTriangle*>& GetAllTriangles();
+      std::vector<int>& GetAllTriangles();
+
+      //! Retrieve mesh containing vertices and triangles of the triangulation
+      const DelaunayMesh& GetMesh() const { return _oMesh; }
 
       //! Retrieve elevation at specified point (x,y). The elevation value is returned.
       //! Also a query result is returned providing more information about the query.
@@ -99,8 +111,8 @@ namespace math
       //! Calculate Vertex Errors
       void CalculateVertexErrors();
 
-      //! Update Vertex Errors for specified Vertices
-      void UpdateVertexErrors(std::vector<DelaunayVertex*>& vVertex);
+      //! Update Vertex Errors for specified Vertices (recalculates error and updates error heap)
+      void UpdateVertexErrors(std::vector<int>& vVertex);
 
       //! only valid after caling "CalculateVertexErrors"!!! 
       void RemoveLeastErrorVertex();
@@ -120,10 +132,10 @@ namespace math
       void RemoveVertex(double x, double y);
 
       // Get Triangles around a point in CCW Order
-      void GetCCWTriangles(DelaunayTriangle* pTri, int vertex_index, std::vector<STriangleVertex>& outputVertices);
+      void GetCCWTriangles(int nTri, int vertex_index, std::vector<STriangleVertex>& outputVertices);
 
       // Get Vertices around a point in CCW Order
-      void GetCCWVertices(DelaunayTriangle* pTri, int vertex_index, std::vector<DelaunayVertex*>& outputVertices);
+      void GetCCWVertices(int nTri, int vertex_index, std::vector<int>& outputVertices);
 
       // create Wavefront OBJ 3D-Object of current triangulation
       std::string CreateOBJ(double xmin, double ymin, double xmax, double ymax);
@@ -155,29 +167,35 @@ namespace math
 
    protected:
       void _GetElevation(double x, double y, ElevationPoint& out, double weight);
-      void _RemoveVertex(DelaunayTriangle* pTri, int vtx);
-      void _CreateSurroundingPolygon(DelaunayTriangle* pTri, int vertex_index, std::vector<ElevationPoint>& outputPolygon);
-      void _CollectTriangle(DelaunayTriangle* pTri);
-      void _ResetVertexErrors(DelaunayTriangle* pTri);
-      void _CalcVertexErrors(DelaunayTriangle* pTri);
-      void _UpdateVertexErrors(DelaunayTriangle* pTri);
-      void _CalcVertexErrorsVtx(DelaunayTriangle* pTri, int vtx);
-      void _CollectElevationPoints(DelaunayTriangle* pTri);
-      void _CollectTriangulationStructure(DelaunayTriangle* pTri);
-      void _ResetVertexId(DelaunayTriangle* pTri);
+      bool _RemoveVertex(int nTri, int vtx, int* pRemaining = 0);
+      void _CreateSurroundingPolygon(int nTri, int vertex_index, std::vector<ElevationPoint>& outputPolygon);
+      void _CollectTriangle(int nTri);
+      void _ResetVertexErrors(int nTri);
+      void _CalcVertexErrors(int nTri);
+      void _BuildErrorHeap(int nTri);
+      void _UpdateErrorHeap(int nVertex, int nTri);
+      void _UpdateVertexErrors(std::vector<int>& vVertex, int nStart);
+      void _InvalidateErrors();
+      bool _FindVertex(int nVertex, int& nTri, int& idx);
+      void _LocateVertices(int nStart, std::vector<int>& vVertex, std::vector<STriangleVertex>& vLocation);
+      bool _RemoveLeastErrorVertex(std::vector<int>& vNeighbours, int& nRemaining);
+      void _CalcVertexErrorsVtx(int nTri, int vtx);
+      void _CollectElevationPoints(int nTri);
+      void _CollectTriangulationStructure(int nTri);
       void _Init();
+      void _ReleaseMemory();
       void _InsertPointSetId(const ElevationPoint& pt, int id);
       void _CutEdges(std::vector< std::pair<int,int> >& vCut);
-      void _GetVertexAt(double x, double y, DelaunayTriangle*& pTri, int& idx);
-      void _GetCCWVertices(DelaunayTriangle* pTri, int vertex_index, std::vector<DelaunayVertex*>& outputVertices);
-      void _UpdateMinError();
-      void _LineTraversal(DelaunayTriangle* pTri);
-      void _SuperSimplexTraversal(DelaunayTriangle* pTri);
-      void _MiddleTraversal(DelaunayTriangle* pTri);
+      void _GetVertexAt(double x, double y, int& nTri, int& idx);
+      void _GetCCWVertices(int nTri, int vertex_index, std::vector<int>& outputVertices);
+      void _LineTraversal(int nTri);
+      void _SuperSimplexTraversal(int nTri);
+      void _MiddleTraversal(int nTri);
 
-      DelaunayTriangle*  _pStartTriangle;
+      DelaunayMesh       _oMesh; // all vertices and triangles of this triangulation
+      int                _nStartTriangle;
 
-      std::vector<DelaunayTriangle*> _vecTriangles;
+      std::vector<int>              _vecTriangles;
       std::vector<ElevationPoint>   _vPts;
       std::vector<int>              _vIndex;
       std::vector<std::pair<int, int> > _vCutEdge;
@@ -187,8 +205,7 @@ namespace math
       EDelaunayLocationAlgorithms                   _eLocationAlgorithm;
       
       bool     _bError; // true if errors are calculated and ok. false -> call CalculateVertexErrors() to have valid errors!
-      double _minError;
-      STriangleVertex  _oVertexMinError; // holds triangle / vertex with minimum error (only valid if _bError is true!!)
+      DelaunayVertexHeap _oErrorHeap; // removable vertices ordered by error (only valid if _bError is true!!)
       
       ElevationPoint* _pt1;
       ElevationPoint* _pt2;
@@ -197,7 +214,7 @@ namespace math
       double _x0, _y0, _x1, _y1;
 
    private:
-      DelaunayTriangulation(){}
+      DelaunayTriangulation() : _oErrorHeap(&_oMesh) {}
    };
 }
 
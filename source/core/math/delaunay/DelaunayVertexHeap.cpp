@@ -0,0 +1,151 @@
+/*******************************************************************************
+#      ____               __          __  _      _____ _       _               #
+#     / __ \              \ \        / / | |    / ____| |     | |              #
+#    | |  | |_ __   ___ _ __ \  /\  / /__| |__ | |  __| | ___ | |__   ___      #
+#    | |  | | '_ \ / _ \ '_ \ \/  \/ / _ \ '_ \| | |_ | |/ _ \| '_ \ / _ \     #
+#    | |__| | |_) |  __/ | | \  /\  /  __/ |_) | |__| | | (_) | |_) |  __/     #
+#     \____/| .__/ \___|_| |_|\/  \/ \___|_.__/ \_____|_|\___/|_.__/ \___|     #
+#           | |                                                                #
+#           |_|                                                                #
+#                                                                              #
+#                                (c) 2011 by                                   #
+#           University of Applied Sciences Northwestern Switzerland            #
+#                     Institute of Geomatics Engineering                       #
+#                           martin.christen@fhnw.ch                            #
+********************************************************************************
+*     Licensed under MIT License. Read the file LICENSE for more information   *
+*******************************************************************************/
+
+#include "DelaunayVertexHeap.h"
+#include <float.h>
+#include <cassert>
+
+namespace math
+{
+   //--------------------------------------------------------------------------
+   DelaunayVertexHeap::DelaunayVertexHeap(DelaunayMesh* pMesh)
+      : _pMesh(pMesh)
+   {
+   }
+   //--------------------------------------------------------------------------
+   DelaunayVertexHeap::~DelaunayVertexHeap()
+   {
+      // vertices are not owned by the heap and may already be freed.
+   }
+   //--------------------------------------------------------------------------
+   void DelaunayVertexHeap::Clear()
+   {
+      for (size_t i=0;i<_vHeap.size();i++)
+      {
+         _pMesh->SetHeapIndex(_vHeap[i].nVertex, -1);
+      }
+      _vHeap.clear();
+   }
+   //--------------------------------------------------------------------------
+   bool DelaunayVertexHeap::Contains(int nVertex) const
+   {
+      int idx = _pMesh->GetHeapIndex(nVertex);
+      return idx >= 0 && size_t(idx) < _vHeap.size() && _vHeap[idx].nVertex == nVertex;
+   }
+   //--------------------------------------------------------------------------
+   void DelaunayVertexHeap::Push(int nVertex, int nTriangle)
+   {
+      if (Contains(nVertex))
+      {
+         _vHeap[_pMesh->GetHeapIndex(nVertex)].nTriangle = nTriangle;
+         Update(nVertex);
+         return;
+      }
+
+      SHeapEntry entry;
+      entry.nVertex = nVertex;
+      entry.nTriangle = nTriangle;
+      _vHeap.push_back(entry);
+      _pMesh->SetHeapIndex(nVertex, (int)(_vHeap.size()-1));
+      _SiftUp(_vHeap.size()-1);
+   }
+   //--------------------------------------------------------------------------
+   void DelaunayVertexHeap::Update(int nVertex)
+   {
+      assert(Contains(nVertex));
+      _SiftUp((size_t)_pMesh->GetHeapIndex(nVertex));
+      _SiftDown((size_t)_pMesh->GetHeapIndex(nVertex));
+   }
+   //--------------------------------------------------------------------------
+   void DelaunayVertexHeap::Remove(int nVertex)
+   {
+      if (!Contains(nVertex))
+         return;
+
+      size_t i = (size_t)_pMesh->GetHeapIndex(nVertex);
+      size_t last = _vHeap.size()-1;
+      _pMesh->SetHeapIndex(nVertex, -1);
+
+      if (i != last)
+      {
+         // move last element into the gap and restore heap order
+         SHeapEntry moved = _vHeap[last];
+         _Set(i, moved);
+         _vHeap.pop_back();
+         _SiftUp(i);
+         _SiftDown((size_t)_pMesh->GetHeapIndex(moved.nVertex));
+      }
+      else
+      {
+         _vHeap.pop_back();
+      }
+   }
+   //--------------------------------------------------------------------------
+   double DelaunayVertexHeap::TopError() const
+   {
+      if (_vHeap.empty())
+         return DBL_MAX;
+
+      return _Key(0);
+   }
+   //--------------------------------------------------------------------------
+   int DelaunayVertexHeap::Pop(int& nTriangle)
+   {
+      assert(!_vHeap.empty());
+      int nTop = _vHeap[0].nVertex;
+      nTriangle = _vHeap[0].nTriangle;
+      Remove(nTop);
+      return nTop;
+   }
+   //--------------------------------------------------------------------------
+   void DelaunayVertexHeap::_SiftUp(size_t i)
+   {
+      SHeapEntry entry = _vHeap[i];
+      double key = _pMesh->error(entry.nVertex);
+
+      while (i > 0)
+      {
+         size_t parent = (i-1)/2;
+         if (_Key(parent) <= key)
+            break;
+         _Set(i, _vHeap[parent]);
+         i = parent;
+      }
+      _Set(i, entry);
+   }
+   //--------------------------------------------------------------------------
+   void DelaunayVertexHeap::_SiftDown(size_t i)
+   {
+      SHeapEntry entry = _vHeap[i];
+      double key = _pMesh->error(entry.nVertex);
+      size_t n = _vHeap.size();
+
+      while (2*i+1 < n)
+      {
+         size_t child = 2*i+1;
+         if (child+1 < n && _Key(child+1) < _Key(child))
+            child++;
+         if (key <= _Key(child))
+            break;
+         _Set(i, _vHeap[child]);
+         i = child;
+      }
+      _Set(i, entry);
+   }
+   //--------------------------------------------------------------------------
+}
@@ -0,0 +1,90 @@
+/*******************************************************************************
+#      ____               __          __  _      _____ _       _               #
+#     / __ \              \ \        / / | |    / ____| |     | |              #
+#    | |  | |_ __   ___ _ __ \  /\  / /__| |__ | |  __| | ___ | |__   ___      #
+#    | |  | | '_ \ / _ \ '_ \ \/  \/ / _ \ '_ \| | |_ | |/ _ \| '_ \ / _ \     #
+#    | |__| | |_) |  __/ | | \  /\  /  __/ |_) | |__| | | (_) | |_) |  __/     #
+#     \____/| .__/ \___|_| |_|\/  \/ \___|_.__/ \_____|_|\___/|_.__/ \___|     #
+#           | |                                                                #
+#           |_|                                                                #
+#                                                                              #
+#                                (c) 2011 by                                   #
+#           University of Applied Sciences Northwestern Switzerland            #
+#                     Institute of Geomatics Engineering                       #
+#                           martin.christen@fhnw.ch                            #
+********************************************************************************
+*     Licensed under MIT License. Read the file LICENSE for more information   *
+*******************************************************************************/
+
+#ifndef _DELAUNAY_VERTEXHEAP_H
+#define _DELAUNAY_VERTEXHEAP_H
+
+#include "og.h"
+#include "DelaunayMesh.h"
+#include <vector>
+
+namespace math
+{
+   //--------------------------------------------------------------------------
+   // Indexed min-heap of vertices ordered by vertex error (DelaunayMesh::error).
+   // The heap position is stored in the mesh for every vertex, so a changed error
+   // can be updated in O(log n) without searching the heap.
+   // Every vertex is stored together with an incident triangle, this avoids
+   // point location when the vertex is removed. The caller is responsible for
+   // keeping this triangle valid (see DelaunayTriangulation::Reduce).
+   // A vertex must be removed from the heap before it is freed!
+   // Vertices and triangles are indices into the mesh specified in the constructor.
+   //--------------------------------------------------------------------------
+
+   class OPENGLOBE_API DelaunayVertexHeap
+   {
+   public:
+      DelaunayVertexHeap(DelaunayMesh* pMesh);
+      virtual ~DelaunayVertexHeap();
+
+      //! Remove all vertices from heap
+      void Clear();
+
+      bool IsEmpty() const { return _vHeap.empty(); }
+      size_t Size() const { return _vHeap.size(); }
+
+      //! Returns true if vertex is currently stored in heap
+      bool Contains(int nVertex) const;
+
+      //! Insert vertex with incident triangle. If vertex is already in heap its position and triangle are updated.
+      void Push(int nVertex, int nTriangle);
+
+      //! Restore heap order after error of vertex changed (increase or decrease key)
+      void Update(int nVertex);
+
+      //! Remove vertex from heap (if it is in heap)
+      void Remove(int nVertex);
+
+      //! Returns vertex with minimum error (heap must not be empty)
+      int Top() const { return _vHeap[0].nVertex; }
+
+      //! Returns minimum error or DBL_MAX if heap is empty
+      double TopError() const;
+
+      //! Remove and return vertex with minimum error and its incident triangle (heap must not be empty)
+      int Pop(int& nTriangle);
+
+   protected:
+      struct SHeapEntry
+      {
+         int nVertex;
+         int nTriangle;
+      };
+
+      inline double _Key(size_t i) const { return _pMesh->error(_vHeap[i].nVertex); }
+      inline void _Set(size_t i, const SHeapEntry& entry) { _vHeap[i] = entry; _pMesh->SetHeapIndex(entry.nVertex, (int)i); }
+      void _SiftUp(size_t i);
+      void _SiftDown(size_t i);
+
+   private:
+      DelaunayMesh* _pMesh;
+      std::vector<SHeapEntry> _vHeap;
+   };
+}
+
+#endif
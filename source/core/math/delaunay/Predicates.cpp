@@ -1851,25 +1851,6 @@ REAL incircle(REAL* pa, REAL* pb, REAL* pc, REAL* pd)
 
 namespace math
 {
-   double ccw(DelaunayVertex* P, DelaunayVertex* A, DelaunayVertex* B)
-   {
-      REAL a[2];
-      REAL b[2];
-      REAL c[2];
-
-      a[0] = P->x();
-      a[1] = P->y();
-
-      b[0] = A->x();
-      b[1] = A->y();
-
-      c[0] = B->x();
-      c[1] = B->y();
-
-      return orient2d(a, b, c);
-   }
-
-
    double OPENGLOBE_API ccw(double ax, double ay, double bx, double by, double cx, double cy)
    {
       REAL a[2];
@@ -1891,7 +1872,7 @@ namespace math
 
    //--------------------------------------------------------------------------
 
-   double InCircleValue(DelaunayVertex* A, DelaunayVertex* B, DelaunayVertex* C, DelaunayVertex* D)
+   double InCircleValue(double ax, double ay, double bx, double by, double cx, double cy, double dx, double dy)
    {
 
       REAL a[2];
@@ -1899,17 +1880,17 @@ namespace math
       REAL c[2];
       REAL d[2];
 
-      a[0] = A->x();
-      a[1] = A->y();
+      a[0] = ax;
+      a[1] = ay;
 
-      b[0] = B->x();
-      b[1] = B->y();
+      b[0] = bx;
+      b[1] = by;
 
-      c[0] = C->x();
-      c[1] = C->y();
+      c[0] = cx;
+      c[1] = cy;
 
-      d[0] = D->x();
-      d[1] = D->y();
+      d[0] = dx;
+      d[1] = dy;
 
       double circ = incircle(a,b,c,d);
 
@@ -1917,7 +1898,7 @@ namespace math
    }
 
 
-   bool InCircle(DelaunayVertex* A, DelaunayVertex* B, DelaunayVertex* C, DelaunayVertex* D)
+   bool InCircle(double ax, double ay, double bx, double by, double cx, double cy, double dx, double dy)
    {
 
       REAL a[2];
@@ -1925,17 +1906,17 @@ namespace math
       REAL c[2];
       REAL d[2];
 
-      a[0] = A->x();
-      a[1] = A->y();
+      a[0] = ax;
+      a[1] = ay;
 
-      b[0] = B->x();
-      b[1] = B->y();
+      b[0] = bx;
+      b[1] = by;
 
-      c[0] = C->x();
-      c[1] = C->y();
+      c[0] = cx;
+      c[1] = cy;
 
-      d[0] = D->x();
-      d[1] = D->y();
+      d[0] = dx;
+      d[1] = dy;
 
       double circ = incircle(a,b,c,d);
 
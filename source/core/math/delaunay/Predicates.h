@@ -3,16 +3,15 @@
 #define _PREDICATES_H
 
 #include "og.h"
-#include <math/delaunay/DelaunayVertex.h>
 #include <cmath>
+#include <float.h>
 
 
 namespace math
 {
    double OPENGLOBE_API ccw(double ax, double ay, double bx, double by, double cx, double cy);
-   double OPENGLOBE_API ccw(DelaunayVertex* P, DelaunayVertex* A, DelaunayVertex* B);
-   bool OPENGLOBE_API InCircle(DelaunayVertex* a, DelaunayVertex* b, DelaunayVertex* c, DelaunayVertex* d);
-   double OPENGLOBE_API InCircleValue(DelaunayVertex* a, DelaunayVertex* b, DelaunayVertex* c, DelaunayVertex* d);
+   bool OPENGLOBE_API InCircle(double ax, double ay, double bx, double by, double cx, double cy, double dx, double dy);
+   double OPENGLOBE_API InCircleValue(double ax, double ay, double bx, double by, double cx, double cy, double dx, double dy);
 
    inline double SignedTriArea(double ax, double ay, double bx, double by, double cx, double cy)
    {
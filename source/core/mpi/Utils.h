@@ -27,12 +27,21 @@
 #ifdef _OPENMP
 #include <omp.h>
 #endif
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/bind.hpp>
 #include <stack>
 #include <vector>
 #include <iostream>
 #include <ctime>
 
 // High Performance job Manager: Distribute workload asynchronously.
+//
+// Workers request packets from rank 0 when they are idle. Rank 0 blocks in
+// MPI_Waitsome until requests arrive, packet sizes shrink as the job stack
+// drains (guided self-scheduling) so the last packets are small. Optionally
+// rank 0 processes packets itself in a worker thread; the callback must not
+// call MPI in that case.
 
 template<class SJob>
 class MPIJobManager
@@ -50,11 +59,19 @@ public:
 #     else
          _nMaxthreads = 1;
 #     endif
+      _nMinWorkSize = _nMaxthreads < nMaxWorkSize ? _nMaxthreads : nMaxWorkSize;
+      _bRootWorker = false;
    }
    virtual ~MPIJobManager(){}
 
    bool IsRoot() { return (_rank == 0);}
 
+   // Smallest packet sent while the job stack drains (default: number of threads)
+   void SetMinWorkSize(int nMinWorkSize) { _nMinWorkSize = nMinWorkSize < 1 ? 1 : nMinWorkSize; }
+
+   // Process packets on rank 0 too (in a worker thread besides the dispatcher)
+   void SetRootWorker(bool bRootWorker) { _bRootWorker = bRootWorker; }
+
    // Add job stack (
    void AddJobStack(const std::stack<SJob>& js) { if (_rank == 0) _jobstack = js;}
 
@@ -86,23 +103,16 @@ public:
    {
       if (_rank == 0 && _totalnodes == 1)
       {
-         std::vector<SJob> vecJobsRoot =_MakeRootJobPacket(_jobstack);
-         // -- Process on rank 0
-         std::cout << "-->>Rank " << _rank << " is processing " << vecJobsRoot.size()<< " jobs....!\n"<< std::flush;
-#ifndef _DEBUG
-         #pragma omp parallel for
-#endif
-         for (int i=0;i<(int)vecJobsRoot.size();i++)
+         std::vector<SJob> vecJobsRoot;
+         while (_MakeJobPacket(_jobstack, vecJobsRoot))
          {
-               fnc(vecJobsRoot[i], _rank);
+            _ProcessPacket(fnc, vecJobsRoot, _nMaxthreads);
          }
-         std::cout << "<<--Rank " << _rank << " finished processing " << vecJobsRoot.size()<< " jobs!\n"<< std::flush;
       }
       else if (_rank == 0) 
       {
          int totaljobs = (int)_jobstack.size();
-         clock_t tprog0, tprog1;
-         tprog0 = clock();
+         int nWorkers = _totalnodes-1;
 
          if (bVerbose)
          {
@@ -110,68 +120,56 @@ public:
             std::cout << "Total jobs: " << totaljobs << "\n" << std::flush;
          }
 
-         for (int i=1;i<_totalnodes;i++)
+         // one core stays with the dispatcher
+         boost::thread rootworker;
+         if (_bRootWorker)
          {
-            _MakeJobPacket(_jobstack, i);
+            int nRootThreads = _nMaxthreads > 1 ? _nMaxthreads-1 : 1;
+            rootworker = boost::thread(boost::bind(&MPIJobManager<SJob>::_RootWorker, this, fnc, nRootThreads));
          }
 
-         if(bVerbose)
+         // every worker has one outstanding work request
+         std::vector<MPI_Request> vecRequests(nWorkers);
+         std::vector<int> vecRequestData(nWorkers);
+         for (int i=0;i<nWorkers;i++)
          {
-            std::cout << " Prepared " << (totaljobs-_jobstack.size()) << " jobs of "<< totaljobs << " for external nodes...\n";
+            MPI_Irecv(&vecRequestData[i], 1, MPI_INT, i+1, TAG_REQUEST, MPI_COMM_WORLD, &vecRequests[i]);
          }
-         
-      
-         while (_lstActiveRequests.size()>0)
+
+         std::vector<int> vecCompleted(nWorkers);
+         std::vector<SJob> vJobs;
+         int nActive = nWorkers;
+         while (nActive > 0)
          {
-            if(bVerbose)
+            int nCompleted = 0;
+            MPI_Waitsome(nWorkers, &vecRequests[0], &nCompleted, &vecCompleted[0], MPI_STATUSES_IGNORE);
+            if (nCompleted == MPI_UNDEFINED)
             {
-               std::cout << " Remaining requests: " << _lstActiveRequests.size() << "\n";
+               break;
             }
-         
-            std::vector<int> freenodes;
-            
-            std::list< std::pair<MPI_Request, int> >::iterator it = _lstActiveRequests.begin();
-            if (it != _lstActiveRequests.end())
+            for (int k=0;k<nCompleted;k++)
             {
-               MPI_Request& req = it->first;
-               int flag;
-               MPI_Test(&req, &flag, MPI_STATUS_IGNORE);
-
-               if (flag)
+               int i = vecCompleted[k];
+               if (_MakeJobPacket(_jobstack, vJobs))
                {
-                  int targetnode = it->second;
-                  it = _lstActiveRequests.erase(it);
-                  if (_jobstack.size()>0)
-                  {
-                     freenodes.push_back(targetnode);
-                  }
+                  _SendJobs(vJobs, i+1);
+                  MPI_Irecv(&vecRequestData[i], 1, MPI_INT, i+1, TAG_REQUEST, MPI_COMM_WORLD, &vecRequests[i]);
                }
-            }
-            if(freenodes.size() > 0)
-            {
-               for (size_t i=0;i<freenodes.size();i++)
+               else
                {
-                  _MakeJobPacket(_jobstack, freenodes[i]);
+                  _SendTerminate(i+1);
+                  nActive--;
                }
             }
-            /*if (_jobstack.size()>0)
+            if (bVerbose)
             {
-               std::vector<SJob> vecJobsRoot =_MakeRootJobPacket(_jobstack);
-               // -- Process on rank 0
-               std::cout << "-->>Rank " << _rank << " is processing " << vecJobsRoot.size()<< " jobs....!\n"<< std::flush;
-               #pragma omp parallel for
-               for (int i=0;i<(int)vecJobsRoot.size();i++)
-               {
-                    fnc(vecJobsRoot[i], _rank);
-               }
-               std::cout << "<<--Rank " << _rank << " finished processing " << vecJobsRoot.size()<< " jobs!\n"<< std::flush;
-            }*/
+               std::cout << " Remaining jobs: " << _RemainingJobs() << ", active nodes: " << nActive << "\n" << std::flush;
+            }
          }
 
-         // send terminate
-         for (int i=1;i<_totalnodes;i++)
+         if (_bRootWorker)
          {
-            _SendTerminate(i);
+            rootworker.join();
          }
       } 
       else
@@ -179,13 +177,7 @@ public:
          std::vector<SJob> vecJobs;
          while (_ReceiveJobs(vecJobs))
          {
-            std::cout << "-->>Rank " << _rank << " is processing " << vecJobs.size()<< " jobs....!\n"<< std::flush;
-            #pragma omp parallel for
-            for (int i=0;i<(int)vecJobs.size();i++)
-            {
-                 fnc(vecJobs[i], _rank);
-            }
-            std::cout << "<<--Rank " << _rank << " finished processing " << vecJobs.size()<< " jobs!\n"<< std::flush;
+            _ProcessPacket(fnc, vecJobs, _nMaxthreads);
          }
       }
       MPI_Barrier(MPI_COMM_WORLD);
@@ -194,107 +186,118 @@ public:
    //---------------------------------------------------------------------------
 
 protected:
+   enum
+   {
+      TAG_JOBS = 77,
+      TAG_TERMINATE = 88,
+      TAG_REQUEST = 99
+   };
    //---------------------------------------------------------------------------
    // Member variables
    //---------------------------------------------------------------------------
    int                                       _totalnodes;
    int                                       _rank;
    int                                       _nMaxWorkSize;
+   int                                       _nMinWorkSize;
    int                                       _nMaxthreads;
+   bool                                      _bRootWorker;
    std::stack<SJob>                          _jobstack;
-   std::list< std::pair<MPI_Request, int> >  _lstActiveRequests;
+   boost::mutex                              _mutexJobstack;  // dispatcher and root worker
    //---------------------------------------------------------------------------
    // private methods
    //---------------------------------------------------------------------------
+   void _ProcessPacket(CallBack_Process fnc, const std::vector<SJob>& vecJobs, int nThreads)
+   {
+      std::cout << "-->>Rank " << _rank << " is processing " << vecJobs.size()<< " jobs....!\n"<< std::flush;
+#ifndef _DEBUG
+      #pragma omp parallel for num_threads(nThreads)
+#endif
+      for (int i=0;i<(int)vecJobs.size();i++)
+      {
+           fnc(vecJobs[i], _rank);
+      }
+      std::cout << "<<--Rank " << _rank << " finished processing " << vecJobs.size()<< " jobs!\n"<< std::flush;
+   }
+   //---------------------------------------------------------------------------
+   void _RootWorker(CallBack_Process fnc, int nThreads)
+   {
+      std::vector<SJob> vecJobs;
+      while (_MakeJobPacket(_jobstack, vecJobs))
+      {
+         _ProcessPacket(fnc, vecJobs, nThreads);
+      }
+   }
+   //---------------------------------------------------------------------------
    void _SendJobs(std::vector<SJob>& vecJobs, int target)
    {
-      MPI_Request request;
-
       std::cout << " ..Sending "<< vecJobs.size()<<" jobs to rank " << target << "\n"<< std::flush;
       int count = vecJobs.size() * sizeof(SJob);
-      if (count > 0)
-      {
-         void* adr = (void*) &(vecJobs[0]);
-         MPI_Isend (adr, count, MPI_BYTE, target, 77, MPI_COMM_WORLD, &request);
-         _lstActiveRequests.push_back(std::pair<MPI_Request, int>(request, target));
-      }
+      void* adr = (void*) &(vecJobs[0]);
+      // worker is waiting for the packet, buffer is reused for the next one
+      MPI_Send(adr, count, MPI_BYTE, target, TAG_JOBS, MPI_COMM_WORLD);
    }
    //---------------------------------------------------------------------------
    void _SendTerminate(int target)
    {
       unsigned char data = 88;
-      MPI_Send(&data, 1, MPI_BYTE, target, 88, MPI_COMM_WORLD);
+      MPI_Send(&data, 1, MPI_BYTE, target, TAG_TERMINATE, MPI_COMM_WORLD);
    }
    //---------------------------------------------------------------------------
-   // receive jobs or return false if there are no more jobs!
+   // request and receive jobs or return false if there are no more jobs!
    bool _ReceiveJobs(std::vector<SJob>& vecJobs)
    {
-      vecJobs.clear();
-      MPI_Request request;
-      int flag = 0;
       MPI_Status status;
       int msglen;
+      int request = (int)vecJobs.size();   // jobs done since last request
+      vecJobs.clear();
 
-      while(true)
-      {
-         int flag = 0;
-         MPI_Iprobe(0, 88, MPI_COMM_WORLD, &flag, &status);
-         
-         if (flag) // "terminate"
-         {
-            std::cout << " ..Rank "<< _rank <<" received TERMINATE signal\n" << std::flush;
-            char buffer;
-            MPI_Irecv (&buffer, 1, MPI_BYTE, 0, 88, MPI_COMM_WORLD, &request);
-            MPI_Wait(&request, &status);
-            return false;
-         }
+      MPI_Send(&request, 1, MPI_INT, 0, TAG_REQUEST, MPI_COMM_WORLD);
+      MPI_Probe(0, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
 
-         MPI_Iprobe(0, 77, MPI_COMM_WORLD, &flag, &status);
-        
-         if (flag)
-         {
-            MPI_Get_count(&status, MPI_BYTE, &msglen);
-            vecJobs.resize(msglen / sizeof(SJob));
-            void* adr = (void*) &(vecJobs[0]);
-            MPI_Irecv (adr, msglen, MPI_BYTE, 0, 77, MPI_COMM_WORLD, &request);
-            MPI_Wait(&request, &status);
-            std::cout << " ..Rank "<< _rank <<" received "<< vecJobs.size() << " Jobs\n" << std::flush;
-            return true;
-         }
+      if (status.MPI_TAG == TAG_TERMINATE)
+      {
+         std::cout << " ..Rank "<< _rank <<" received TERMINATE signal\n" << std::flush;
+         char buffer;
+         MPI_Recv(&buffer, 1, MPI_BYTE, 0, TAG_TERMINATE, MPI_COMM_WORLD, &status);
+         return false;
       }
+
+      MPI_Get_count(&status, MPI_BYTE, &msglen);
+      vecJobs.resize(msglen / sizeof(SJob));
+      void* adr = (void*) &(vecJobs[0]);
+      MPI_Recv(adr, msglen, MPI_BYTE, 0, TAG_JOBS, MPI_COMM_WORLD, &status);
+      std::cout << " ..Rank "<< _rank <<" received "<< vecJobs.size() << " Jobs\n" << std::flush;
+      return true;
    }
    //---------------------------------------------------------------------------
-   void _MakeJobPacket( std::stack<SJob> &jobs, int i) 
+   int _RemainingJobs()
    {
-      std::vector<SJob> vJobs;
-      for (int w=0;w<_nMaxWorkSize;w++)
-      {
-         if (jobs.size()>0)
-         {
-            vJobs.push_back(jobs.top());
-            jobs.pop();
-         }
-      }
-
-      if (vJobs.size()>0)
-      {
-         _SendJobs(vJobs, i);
-      }
+      boost::mutex::scoped_lock lock(_mutexJobstack);
+      return (int)_jobstack.size();
+   }
+   //---------------------------------------------------------------------------
+   // Packet size: 1/(2*nodes) of the remaining jobs, clamped to [min, max] work size.
+   int _PacketSize(int nRemaining)
+   {
+      int nNodes = _totalnodes - 1 + (_bRootWorker ? 1 : 0);
+      if (nNodes < 1) nNodes = 1;
+      int nSize = (nRemaining + 2*nNodes - 1) / (2*nNodes);
+      if (nSize < _nMinWorkSize) nSize = _nMinWorkSize;
+      if (nSize > _nMaxWorkSize) nSize = _nMaxWorkSize;
+      return nSize;
    }
-
    //---------------------------------------------------------------------------
-   std::vector<SJob> _MakeRootJobPacket(std::stack<SJob> &jobs) 
+   bool _MakeJobPacket( std::stack<SJob> &jobs, std::vector<SJob>& vJobs) 
    {
-      std::vector<SJob> vJobs;
-      for (int w=0;w<_nMaxWorkSize;w++)
+      boost::mutex::scoped_lock lock(_mutexJobstack);
+      vJobs.clear();
+      int nSize = _PacketSize((int)jobs.size());
+      for (int w=0;w<nSize && jobs.size()>0;w++)
       {
-         if (jobs.size()>0)
-         {
-            vJobs.push_back(jobs.top());
-            jobs.pop();
-         }
+         vJobs.push_back(jobs.top());
+         jobs.pop();
       }
-      return vJobs;
+      return vJobs.size()>0;
    }
 
 private: